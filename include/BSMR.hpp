@@ -4,11 +4,26 @@
 
 #include "devVector.cuh"
 #include "Matrix.hpp"
+#include "ReorderingCache.hpp"
 
 constexpr UIN ROW_PANEL_SIZE = WMMA_M;
 constexpr UIN BLOCK_COL_SIZE = WMMA_N;
 constexpr UIN BLOCK_SIZE = ROW_PANEL_SIZE * BLOCK_COL_SIZE;
 
+/**
+ * @structName: PatternDelta
+ * @structInterpretation: A change of the sparsity pattern of a matrix, the coordinates of the nonzeros that are
+ * inserted and the coordinates of the nonzeros that are removed.
+ **/
+struct PatternDelta{
+    std::vector<UIN> insertedRows;
+    std::vector<UIN> insertedCols;
+    std::vector<UIN> removedRows;
+    std::vector<UIN> removedCols;
+};
+
+class RPHM;
+
 /**
  * @className: BSMR
  * @classInterpretation: Reorder the rows and columns of a sparse matrix and divide it into dense tiled and sparse tiled.
@@ -16,26 +31,80 @@ constexpr UIN BLOCK_SIZE = ROW_PANEL_SIZE * BLOCK_COL_SIZE;
  * `reorderedRows_`: Store the reordered row indexes.
  * `denseCols_`: Store the reordered dense column indexes for each row panel in order.
  * `denseColOffsets_`: Offset array of reordered dense column array in each row panel.
+ * `isLoadedFromCache_`: The reordering result was loaded from the reordering cache instead of being calculated.
+ * `savedReorderingTime_`: Reordering time saved by the reordering cache, in milliseconds.
+ * `similarityThreshold_`, `blockDensityThreshold_`, `rowReorderingEngine_`: The alpha, delta and engine of the last
+ * row and column reordering, `update` reorders from scratch with them.
+ * `baselineDenseFraction_`: The fraction of the nonzeros in the dense blocks after the last column reordering.
  *
  **/
 class BSMR{
 public:
+    /**
+     * The result of `update`. `updatedRowPanels` are the row panels whose rows or columns changed, in ascending order,
+     * all the row panels if the matrix was reordered from scratch.
+     **/
+    struct Update{
+        bool isRebuilt = false;
+        float drift = 0.0f;
+        std::vector<UIN> updatedRowPanels;
+    };
+
     BSMR() = default;
 
+    /**
+     * If `cache` is not null, the reordering result is loaded from the cache when the matrix structure,
+     * alpha and delta were reordered before, otherwise the result is calculated and stored in the cache.
+     **/
     BSMR(const float similarityThreshold,
          const float blockDensityThreshold,
          const sparseMatrix::CSR<float>& matrix,
-         const int numIterations = 1);
+         const int numIterations = 1,
+         const ReorderingCache* cache = nullptr,
+         const RowReorderingEngine rowReorderingEngine = RowReorderingEngine::gpu);
+
+    /**
+     * The reordering of a matrix that is not owned, the structure is read in place and the values are not used
+     **/
+    template <typename T>
+    BSMR(const float similarityThreshold,
+         const float blockDensityThreshold,
+         const sparseMatrix::CsrView<T>& matrix,
+         const int numIterations = 1,
+         const ReorderingCache* cache = nullptr,
+         const RowReorderingEngine rowReorderingEngine = RowReorderingEngine::gpu)
+        : BSMR(similarityThreshold, blockDensityThreshold, sparseMatrix::CSR<float>::borrowStructure(matrix),
+               numIterations, cache, rowReorderingEngine){}
+
+    /**
+     * The reordering that `rphm` was built from, recovered from the arrays of the tiling and the structure of `matrix`
+     * without reordering the matrix again, for a tiling loaded from a binary RPHM file. The reordering times are zero.
+     **/
+    BSMR(const sparseMatrix::CSR<float>& matrix, const RPHM& rphm);
 
     void rowReordering(const float similarityThreshold,
                        const sparseMatrix::CSR<float>& matrix,
-                       const int numIterations = 1);
+                       const int numIterations = 1,
+                       const RowReorderingEngine rowReorderingEngine = RowReorderingEngine::gpu);
 
     void colReordering(const float blockDensityThreshold,
                        const sparseMatrix::CSR<float>& matrix,
                        const std::vector<UIN>& reorderedRows = std::vector<UIN>(),
                        const int numIterations = 1);
 
+    /**
+     * Patch the reordering after `delta` is applied to the matrix, `matrix` is the matrix after the change.
+     * The rows of the delta that do not fit their row panel any more are swapped into the row panel whose dense columns
+     * cover most of their nonzeros, the rows that lose all the nonzeros leave the order and the rows that gain the
+     * first nonzeros join the last row panel. Then only the columns of the row panels that changed are reordered.
+     * If the fraction of the nonzeros in the dense blocks dropped by more than `maxDrift` since the last full
+     * reordering, the matrix is reordered from scratch with the alpha, delta and engine of the last reordering.
+     **/
+    Update update(const sparseMatrix::CSR<float>& matrix, const PatternDelta& delta, const float maxDrift = 0.05f);
+
+    // The fraction of the nonzeros of the matrix that are in the dense blocks
+    float calculateDenseFraction(const sparseMatrix::CSR<float>& matrix) const;
+
     int numRowPanels() const{ return numRowPanels_; }
     const std::vector<UIN>& reorderedRows() const{ return reorderedRows_; }
     const std::vector<UIN>& denseCols() const{ return denseCols_; }
@@ -44,11 +113,18 @@ public:
     const std::vector<UIN>& sparseColOffsets() const{ return sparseColOffsets_; }
     const std::vector<UIN>& sparseValueOffsets() const{ return sparseValueOffsets_; }
     int numClusters() const{ return numClusters_; }
+    float similarityThreshold() const{ return similarityThreshold_; }
+    float blockDensityThreshold() const{ return blockDensityThreshold_; }
+    RowReorderingEngine rowReorderingEngine() const{ return rowReorderingEngine_; }
     float rowReorderingTime() const{ return rowReorderingTime_; }
     float colReorderingTime() const{ return colReorderingTime_; }
     float reorderingTime() const{ return rowReorderingTime_ + colReorderingTime_; }
+    bool isLoadedFromCache() const{ return isLoadedFromCache_; }
+    float savedReorderingTime() const{ return savedReorderingTime_; }
 
 private:
+    friend class ReorderingCache;
+
     int numRowPanels_ = 0;
     std::vector<UIN> reorderedRows_;
     std::vector<UIN> denseCols_;
@@ -60,6 +136,14 @@ private:
     int numClusters_ = 1;
     float rowReorderingTime_ = 0.0f;
     float colReorderingTime_ = 0.0f;
+
+    bool isLoadedFromCache_ = false;
+    float savedReorderingTime_ = 0.0f;
+
+    float similarityThreshold_ = 0.0f;
+    float blockDensityThreshold_ = 0.0f;
+    RowReorderingEngine rowReorderingEngine_ = RowReorderingEngine::gpu;
+    float baselineDenseFraction_ = 0.0f;
 };
 
 /**
@@ -75,31 +159,105 @@ private:
  * `sparseData_`: values in COO format.
  * `sparseRelativeRows_`: row indices in COO format, but relative to the row panel.
  * `sparseCols_`: column indices in COO format.
+ * `hostArrays_`: Host copy of the arrays above, the device arrays are copied from it.
+ * `isOnDevice_`: The device arrays are up to date with `hostArrays_`.
  **/
 class RPHM{
 public:
+    /**
+     * The tiling arrays on the host, in the same layout as the device arrays.
+     **/
+    struct HostArrays{
+        std::vector<UIN> reorderedRows;
+        std::vector<UIN> denseCols;
+        std::vector<UIN> blockOffsets;
+        std::vector<UIN> blockValues;
+        std::vector<UIN> sparseValueOffsets;
+        std::vector<UIN> sparseValues;
+        std::vector<UIN> sparseRelativeRows;
+        std::vector<UIN> sparseColIndices;
+        std::vector<UIN> denseRowPanelIds;
+        std::vector<UIN> denseColBlockIters;
+        std::vector<UIN> sparseRowPanelIds;
+        std::vector<UIN> sparseColBlockIters;
+    };
+
     RPHM() = default;
 
     RPHM(const sparseMatrix::CSR<float>& matrix, const BSMR& bsmr);
 
+    // The tiling of a matrix that is not owned, the values are not used
+    template <typename T>
+    RPHM(const sparseMatrix::CsrView<T>& matrix, const BSMR& bsmr)
+        : RPHM(sparseMatrix::CSR<float>::borrowStructure(matrix), bsmr){}
+
+    /**
+     * Initialize from binary RPHM file, the format written by `outputToBinaryFile`.
+     * The file is rejected if it was built for another matrix structure, other tile constants
+     * (BLOCK_SIZE, each_thread_block_counts_the_number_Of_dense_blocks,
+     * sddmm_sparse_block_each_thread_block_counts_the_number_Of_data), another alpha, delta or row reordering engine,
+     * or if an index is out of range.
+     **/
+    bool initializeFromBinaryFile(const std::string& file,
+                                  const sparseMatrix::CSR<float>& matrix,
+                                  const float similarityThreshold,
+                                  const float blockDensityThreshold,
+                                  const RowReorderingEngine rowReorderingEngine);
+
+    /**
+     * Output to binary RPHM file.
+     *
+     * binary RPHM file:
+     *    1) A 256 bytes header: magic, version, tile constants, matrix size and structure hash,
+     *       the scalar members, the number of elements of each array, alpha, delta, the row reordering engine
+     *       and the number of clusters.
+     *    2) The arrays in the order of `HostArrays`, each starting at a multiple of 64 bytes.
+     **/
+    bool outputToBinaryFile(const std::string& file, const sparseMatrix::CSR<float>& matrix) const;
+
+    /**
+     * Patch the tiling after `bsmr.update(matrix, delta)`, `matrix` is the matrix after the change. The row panels of
+     * `update.updatedRowPanels` are tiled again, the arrays of the other row panels are moved to their new offsets and
+     * their indexes of the matrix elements are shifted by the change of the row offsets.
+     **/
+    void update(const sparseMatrix::CSR<float>& matrix,
+                const BSMR& bsmr,
+                const PatternDelta& delta,
+                const BSMR::Update& update);
+
+    const HostArrays& hostArrays() const{ return hostArrays_; }
+
     UIN numRowPanels() const{ return numRowPanels_; }
     UIN maxNumDenseColBlocksInRowPanel() const{ return maxNumDenseColBlocksInRowPanel_; }
     UIN maxNumSparseColBlocksInRowPanel() const{ return maxNumSparseColBlocksInRowPanel_; }
     UIN numDenseThreadBlocks() const{ return numDenseThreadBlocks_; }
     UIN numSparseThreadBlocks() const{ return numSparseThreadBlocks_; }
-    const dev::vector<UIN>& reorderedRows() const{ return reorderedRows_; }
-    const dev::vector<UIN>& denseCols() const{ return denseCols_; }
-    const dev::vector<UIN>& blockValues() const{ return blockValues_; }
-    const dev::vector<UIN>& blockOffsets() const{ return blockOffsets_; }
-    const dev::vector<UIN>& sparseValueOffsets() const{ return sparseValueOffsets_; }
-    const dev::vector<UIN>& sparseValues() const{ return sparseValues_; }
-    const dev::vector<UIN>& sparseRelativeRows() const{ return sparseRelativeRows_; }
-    const dev::vector<UIN>& sparseColIndices() const{ return sparseColIndices_; }
-
-    const dev::vector<UIN>& denseRowPanelIds() const{ return denseRowPanelIds_; }
-    const dev::vector<UIN> denseColBlockIters() const{ return denseColBlockIters_; }
-    const dev::vector<UIN>& sparseRowPanelIds() const{ return sparseRowPanelIds_; }
-    const dev::vector<UIN>& sparseColBlockIters() const{ return sparseColBlockIters_; }
+    float similarityThreshold() const{ return similarityThreshold_; }
+    float blockDensityThreshold() const{ return blockDensityThreshold_; }
+    RowReorderingEngine rowReorderingEngine() const{ return rowReorderingEngine_; }
+    int numClusters() const{ return numClusters_; }
+
+    /**
+     * The tiling is built and loaded on the host only. The device arrays below are copied from `hostArrays_` on the
+     * first use after the tiling changed, so the cpu backend never touches the device. `copyToDevice` does the copy
+     * ahead, so that it is not timed with the kernels.
+     **/
+    void copyToDevice() const;
+    bool isOnDevice() const{ return isOnDevice_; }
+
+    const dev::vector<UIN>& reorderedRows() const{ copyToDevice(); return reorderedRows_; }
+    const dev::vector<UIN>& denseCols() const{ copyToDevice(); return denseCols_; }
+    const dev::vector<UIN>& blockValues() const{ copyToDevice(); return blockValues_; }
+    const dev::vector<UIN>& blockOffsets() const{ copyToDevice(); return blockOffsets_; }
+    const dev::vector<UIN>& sparseValueOffsets() const{ copyToDevice(); return sparseValueOffsets_; }
+    const dev::vector<UIN>& sparseValues() const{ copyToDevice(); return sparseValues_; }
+    const dev::vector<UIN>& sparseRelativeRows() const{ copyToDevice(); return sparseRelativeRows_; }
+    const dev::vector<UIN>& sparseColIndices() const{ copyToDevice(); return sparseColIndices_; }
+
+    const dev::vector<UIN>& denseRowPanelIds() const{ copyToDevice(); return denseRowPanelIds_; }
+    const dev::vector<UIN>& denseColBlockIters() const{ copyToDevice(); return denseColBlockIters_; }
+    const dev::vector<UIN>& sparseRowPanelIds() const{ copyToDevice(); return sparseRowPanelIds_; }
+    const dev::vector<UIN>& sparseColBlockIters() const{ copyToDevice(); return sparseColBlockIters_; }
 
     float time() const{ return reorderingTime_; }
 
@@ -115,7 +273,7 @@ public:
     // Calculate the colBlockId in row panel by blockValueIndex
     UIN calculateColBlockIdByBlockValueIndex(UIN blockValueIndex) const;
 
-    UIN getNumDenseBlocks() const{ return blockOffsets().back_data(); }
+    UIN getNumDenseBlocks() const{ return hostArrays_.blockOffsets.empty() ? 0 : hostArrays_.blockOffsets.back(); }
 
     UIN getNumSparseBlocks() const;
 
@@ -135,27 +293,47 @@ private:
     UIN numDenseThreadBlocks_ = 0;
     UIN numSparseThreadBlocks_ = 0;
 
+    // The reordering the tiling was built from
+    float similarityThreshold_ = 0.0f;
+    float blockDensityThreshold_ = 0.0f;
+    RowReorderingEngine rowReorderingEngine_ = RowReorderingEngine::gpu;
+    int numClusters_ = 1;
+
     // Reordered row indexes
-    dev::vector<UIN> reorderedRows_;
+    mutable dev::vector<UIN> reorderedRows_;
 
     // Dense block data
-    dev::vector<UIN> denseCols_;
-    dev::vector<UIN> blockOffsets_;
-    dev::vector<UIN> blockValues_;
+    mutable dev::vector<UIN> denseCols_;
+    mutable dev::vector<UIN> blockOffsets_;
+    mutable dev::vector<UIN> blockValues_;
 
     // Sparse block data
-    dev::vector<UIN> sparseValueOffsets_;
-    dev::vector<UIN> sparseValues_;
-    dev::vector<UIN> sparseRelativeRows_;
-    dev::vector<UIN> sparseColIndices_;
+    mutable dev::vector<UIN> sparseValueOffsets_;
+    mutable dev::vector<UIN> sparseValues_;
+    mutable dev::vector<UIN> sparseRelativeRows_;
+    mutable dev::vector<UIN> sparseColIndices_;
 
     // Row panel IDs and column block iterators
-    dev::vector<UIN> denseRowPanelIds_;
-    dev::vector<UIN> denseColBlockIters_;
-    dev::vector<UIN> sparseRowPanelIds_;
-    dev::vector<UIN> sparseColBlockIters_;
+    mutable dev::vector<UIN> denseRowPanelIds_;
+    mutable dev::vector<UIN> denseColBlockIters_;
+    mutable dev::vector<UIN> sparseRowPanelIds_;
+    mutable dev::vector<UIN> sparseColBlockIters_;
 
     float reorderingTime_ = 0.0f;
+
+    HostArrays hostArrays_;
+    mutable bool isOnDevice_ = false;
+
+    void initialize(const sparseMatrix::CSR<float>& matrix, const BSMR& bsmr);
+
+    // The offsets of the row panels from `bsmr`, the arrays of the elements are resized and the dense blocks are empty
+    void initializeRowPanelOffsets(const BSMR& bsmr);
+
+    // The tiles of one row panel, after `initializeRowPanelOffsets`
+    void tileRowPanel(const sparseMatrix::CSR<float>& matrix, const BSMR& bsmr, UIN rowPanelId);
+
+    // The row panel and the first column block of each thread block, from the offsets
+    void initializeThreadBlocks(const BSMR& bsmr);
 };
 
 void noReorderRow(const sparseMatrix::CSR<float>& matrix, std::vector<UIN>& reorderedRows, float& time);
@@ -175,13 +353,52 @@ void rowReordering_gpu(const sparseMatrix::CSR<float>& matrix,
                        std::vector<UIN>& reorderedRows,
                        float& time);
 
+/**
+ * @funcitonName: calculateBlockSize
+ * @functionInterpretation: The number of columns of the column blocks of the row encodings. The encodings are sparse,
+ * so only the dense encoding of a cluster in the shared memory of the GPU clustering bounds it, and it does not use
+ * the device. The CPU and the GPU row reordering use the same block size.
+ **/
 UIN calculateBlockSize(const sparseMatrix::CSR<float>& matrix);
 
-std::vector<int> bsa_rowReordering_cpu(const sparseMatrix::CSR<float>& matrix,
-                                       const float similarity_threshold_alpha,
-                                       const int block_size,
+/**
+ * @funcitonName: bsa_rowReordering_cpu
+ * @functionInterpretation: The BSA row reordering of `bsa_rowReordering_gpu` on the CPU, for the matrices with
+ * many rows.
+ * The rows are clustered greedily in the same order, but a row is only compared with the clusters that share a
+ * MinHash LSH bucket with it, and the rows are clustered in chunks in parallel and the clusters of the chunks merged,
+ * so the time is near linear in the number of nonzeros instead of quadratic in the number of rows.
+ * The reordering is close to the GPU one but not equal, and it does not depend on the number of threads.
+ * @input:
+ * `matrix`: Sparse matrix data in CSR format.
+ * `alpha`: A row joins a cluster if the normalized weighted Jaccard similarity is greater than alpha.
+ * `block_size`: The number of columns of the blocks of the row encodings.
+ * @output: The reordered rows, the rows without nonzeros are removed. Update `num_clusters` and `reordering_time`.
+ **/
+std::vector<UIN> bsa_rowReordering_cpu(const sparseMatrix::CSR<float>& matrix,
+                                       const float alpha,
+                                       const UIN block_size,
+                                       int& num_clusters,
                                        float& reordering_time);
 
+/**
+ * @funcitonName: bsa_rowReordering_cpu_exact
+ * @functionInterpretation: The clustering of `bsa_rowReordering_gpu` on the CPU, every row is compared with the
+ * clusters in the same order as on the GPU, so the clusters are the same as on the GPU, up to the rounding of the
+ * similarity. The clusters run as a pipeline on the threads, and the reordering does not depend on the number of
+ * threads. It is the reference of the GPU reordering on a machine without a device.
+ * @input:
+ * `matrix`: Sparse matrix data in CSR format.
+ * `alpha`: A row joins a cluster if the normalized weighted Jaccard similarity is greater than alpha.
+ * `block_size`: The number of columns of the blocks of the row encodings.
+ * @output: The reordered rows, the rows without nonzeros are removed. Update `num_clusters` and `reordering_time`.
+ **/
+std::vector<UIN> bsa_rowReordering_cpu_exact(const sparseMatrix::CSR<float>& matrix,
+                                             const float alpha,
+                                             const UIN block_size,
+                                             int& num_clusters,
+                                             float& reordering_time);
+
 std::vector<UIN> bsa_rowReordering_gpu(const sparseMatrix::CSR<float>& matrix,
                                        const float alpha,
                                        const UIN block_size,
@@ -220,6 +437,21 @@ void colReordering_cpu(const sparseMatrix::CSR<float>& matrix,
                        std::vector<UIN>& sparseDataOffsets,
                        float& time);
 
+/**
+ * @funcitonName: colReorderingOfRowPanels_cpu
+ * @functionInterpretation: The column reordering of `colReordering_cpu` for the row panels of `rowPanelIds` only.
+ * @output: The columns of the row panel `rowPanelIds[i]`, dense columns first, are `colsInEachRowPanel[i]`, with the
+ * numbers of dense columns, sparse columns and sparse data.
+ **/
+void colReorderingOfRowPanels_cpu(const sparseMatrix::CSR<float>& matrix,
+                                  const std::vector<UIN>& reorderedRows,
+                                  const std::vector<UIN>& rowPanelIds,
+                                  const float blockDensityThreshold,
+                                  std::vector<std::vector<UIN>>& colsInEachRowPanel,
+                                  std::vector<UIN>& numDenseColsInEachRowPanel,
+                                  std::vector<UIN>& numSparseColsInEachRowPanel,
+                                  std::vector<UIN>& numSparseDataInEachRowPanel);
+
 void colReordering_gpu(const sparseMatrix::CSR<float>& matrix,
                        const UIN numRowPanels,
                        const std::vector<UIN>& reorderedRows,
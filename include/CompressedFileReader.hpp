@@ -0,0 +1,90 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @className: CompressedFileReader
+ * @classInterpretation: Streams the decompressed content of a `.gz` or `.zst` file.
+ * A decoder thread decompresses the file into fixed-size blocks and hands them over through a bounded queue,
+ * so the decompression overlaps with the parsing of the blocks that are already done.
+ * `.zst` files are only supported when the program is built with zstd (`BSMR_WITH_ZSTD`).
+ * @MemberVariables:
+ * `blocks_`: Decompressed blocks that have not been taken by the reader yet.
+ * `isFinished_`: The decoder thread has put the last block in the queue.
+ * `hasError_`: The file could not be decompressed.
+ * `lineCarry_`: The unfinished last line of the previous block, used by `nextLineBlock`.
+ **/
+class CompressedFileReader{
+public:
+    CompressedFileReader() = default;
+
+    ~CompressedFileReader();
+
+    CompressedFileReader(const CompressedFileReader&) = delete;
+
+    CompressedFileReader& operator=(const CompressedFileReader&) = delete;
+
+    /**
+     * @funcitonName: isCompressedFile
+     * @functionInterpretation: Whether the file suffix is one of the supported compressed formats.
+     **/
+    static bool isCompressedFile(const std::string& file);
+
+    /**
+     * @funcitonName: getUncompressedFileName
+     * @functionInterpretation: Remove the compression suffix, "a.mtx.gz" -> "a.mtx".
+     **/
+    static std::string getUncompressedFileName(const std::string& file);
+
+    /**
+     * @funcitonName: open
+     * @functionInterpretation: Open the file and start the decoder thread.
+     * @output:
+     * Return false if the file cannot be opened or the format is not supported.
+     **/
+    bool open(const std::string& file);
+
+    /**
+     * @funcitonName: nextBlock
+     * @functionInterpretation: Wait for the next decompressed block.
+     * @output:
+     * Return false when the whole file has been read or an error has occurred, see `hasError`.
+     **/
+    bool nextBlock(std::vector<char>& block);
+
+    /**
+     * @funcitonName: nextLineBlock
+     * @functionInterpretation: Same as `nextBlock`, but the block always ends at the end of a line,
+     * the unfinished last line is moved to the beginning of the next block.
+     **/
+    bool nextLineBlock(std::vector<char>& block);
+
+    bool hasError() const;
+
+private:
+    static constexpr size_t blockSize_ = 4 << 20;
+    static constexpr size_t maxNumQueuedBlocks_ = 4;
+
+    std::thread decoder_;
+    mutable std::mutex mutex_;
+    std::condition_variable blockReady_;
+    std::condition_variable spaceReady_;
+    std::deque<std::vector<char>> blocks_;
+    bool isFinished_ = false;
+    bool isStopped_ = false;
+    bool hasError_ = false;
+    std::vector<char> lineCarry_;
+
+    void decodeGzip(const std::string& file);
+
+    void decodeZstd(const std::string& file);
+
+    bool pushBlock(std::vector<char>&& block);
+
+    void finish(bool hasError);
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <type_traits>
+
+#include "TensorCoreConfig.cuh"
+
+/**
+ * Dispatch of the kernels that are specialized for a compile-time K. A kernel template takes K as a template parameter
+ * (`FixedK`), 0 is the generic kernel with the runtime K. `dispatchK` calls `function(KConstant<FixedK>{})` with the
+ * specialized K that equals the runtime K, or with KConstant<0>, so the caller instantiates one kernel for each size of
+ * `SpecializedKs` and picks it without writing the table by hand.
+ * It only uses the host side of C++17, the CUDA launches use it the same way, e.g.
+ * `kdispatch::dispatchK(K, [&](auto fixedK){ kernel<decltype(fixedK)::value><<<grid, block>>>(...); });`
+ **/
+namespace kdispatch{
+template<UIN K>
+using KConstant = std::integral_constant<UIN, K>;
+
+template<UIN... Ks>
+struct KList{
+};
+
+// The embedding widths of the models
+using SpecializedKs = KList<32, 64, 128, 256, 512>;
+
+constexpr UIN maxSpecializedK = 512;
+
+// The K of a kernel instantiated for FixedK, the runtime K for the generic kernel
+template<UIN FixedK>
+constexpr UIN resolveK(const UIN K){
+    return FixedK > 0 ? FixedK : K;
+}
+
+template<typename Function>
+decltype(auto) dispatchK(KList<>, UIN, Function&& function){
+    return function(KConstant<0>{});
+}
+
+template<UIN First, UIN... Rest, typename Function>
+decltype(auto) dispatchK(KList<First, Rest...>, const UIN K, Function&& function){
+    if (K == First){
+        return function(KConstant<First>{});
+    }
+    return dispatchK(KList<Rest...>{}, K, function);
+}
+
+template<typename Function>
+decltype(auto) dispatchK(const UIN K, Function&& function){
+    return dispatchK(SpecializedKs{}, K, function);
+}
+
+/**
+ * @funcitonName: isSpecializedK
+ * @functionInterpretation: Whether K has its own kernels.
+ **/
+inline bool isSpecializedK(const UIN K){
+    return dispatchK(K, [](auto fixedK){
+        return decltype(fixedK)::value > 0;
+    });
+}
+} // namespace kdispatch
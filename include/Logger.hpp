@@ -4,6 +4,7 @@
 #include <cstdio>
 #include <iostream>
 #include <string>
+#include <vector>
 #include <fstream>
 #include <iomanip>
 #include <cmath>
@@ -54,6 +55,10 @@ struct Logger{
     std::string gpu_;
     std::string buildType_;
 
+    std::string backend_ = "gpu";
+    std::string cpuIsa_;
+    float loadImbalance_ = 0.0f;
+
     size_t wmma_m_;
     size_t wmma_n_;
     size_t wmma_k_;
@@ -95,13 +100,25 @@ struct Logger{
     float alpha_;
     float delta_;
 
+    std::string rowReorderingEngine_ = "gpu";
     int numClusters_ = 1;
 
     float sddmmTime_ = 0.0f;
+    size_t attentionDim_ = 0;
+    float attentionTime_ = 0.0f;
+    size_t numHeads_ = 1;
+    float batchTime_ = 0.0f;
+    std::vector<float> headTimes_;
+    bool isQuantized_ = false;
+    float quantizationTime_ = 0.0f;
+    float relativeError_ = 0.0f;
     float rowReorderingTime_ = 0.0f;
     float colReorderingTime_ = 0.0f;
     float reorderingTime_ = 0.0f;
 
+    bool isReorderingCacheHit_ = false;
+    float savedReorderingTime_ = 0.0f;
+
 };
 
 void Logger::getInformation(const Options& options){
@@ -124,6 +141,10 @@ void Logger::printLogInformation(std::ostream& out) const{
 
     out << "[Build type : " << buildType_ << "]\n";
     out << "[Device : " << gpu_ << "]\n";
+    out << "[Backend : " << backend_ << "]\n";
+    if (!cpuIsa_.empty()){
+        out << "[CPU ISA : " << cpuIsa_ << "]\n";
+    }
 
     out << "[WMMA_M : " << wmma_m_ << "], [WMMA_N : " << wmma_n_ << "], [WMMA_K : " << wmma_k_ << "]\n";
 
@@ -150,6 +171,7 @@ void Logger::printLogInformation(std::ostream& out) const{
     out << "[bsmr_alpha : " << alpha_ << "]\n";
     out << "[bsmr_delta : " << delta_ << "]\n";
 
+    out << "[bsmr_rowReorderingEngine : " << rowReorderingEngine_ << "]\n";
     out << "[bsmr_numClusters : " << numClusters_ << "]\n";
     out << "[bsmr_numDenseBlock : " << numDenseBlock_ << "]\n";
     out << "[bsmr_averageDensity : " << averageDensity_ << "]\n";
@@ -157,6 +179,8 @@ void Logger::printLogInformation(std::ostream& out) const{
     out << "[bsmr_rowReordering : " << rowReorderingTime_ << "]\n";
     out << "[bsmr_colReordering : " << colReorderingTime_ << "]\n";
     out << "[bsmr_reordering : " << reorderingTime_ << "]\n";
+    out << "[bsmr_reorderingCacheHit : " << isReorderingCacheHit_ << "]\n";
+    out << "[bsmr_savedReorderingTime : " << savedReorderingTime_ << "]\n";
 
     out << "[gridDim_dense : " << gridDim_dense_.x << ", " << gridDim_dense_.y << ", " << gridDim_dense_.z << "]\n";
     out << "[blockDim_dense : " << blockDim_dense_.x << ", " << blockDim_dense_.y << ", " << blockDim_dense_.z << "]\n";
@@ -179,6 +203,28 @@ void Logger::printLogInformation(std::ostream& out) const{
 
     out << "[bsmr_gflops : " << (flops / (sddmmTime_ * 1e6)) << "]\n";
     out << "[bsmr_sddmm : " << sddmmTime_ << "]\n";
+    if (attentionDim_ > 0){
+        out << "[cpu_attentionDim : " << attentionDim_ << "]\n";
+        out << "[cpu_attention : " << attentionTime_ << "]\n";
+    }
+    if (numHeads_ > 1){
+        out << "[batch_numHeads : " << numHeads_ << "]\n";
+        out << "[batch_sddmm : " << batchTime_ << "]\n";
+        if (!headTimes_.empty()){
+            out << "[batch_headTimes :";
+            for (size_t headId = 0; headId < headTimes_.size(); ++headId){
+                out << (headId == 0 ? " " : ", ") << headTimes_[headId];
+            }
+            out << "]\n";
+        }
+    }
+    if (isQuantized_){
+        out << "[cpu_int8Quantize : " << quantizationTime_ << "]\n";
+        out << "[cpu_int8RelativeError : " << relativeError_ << "]\n";
+    }
+    if (loadImbalance_ > 0){
+        out << "[cpu_loadImbalance : " << std::fixed << std::setprecision(2) << loadImbalance_ << "]\n";
+    }
 
     if (errorRate_ > 0){
         out << "[checkResults : NO PASS Error rate : " << std::fixed << std::setprecision(2)
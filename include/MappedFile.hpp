@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/**
+ * @className: MappedFile
+ * @classInterpretation: Read-only memory mapping of a whole file. The mapping is released when the object is destroyed.
+ * @MemberVariables:
+ * `data_`: Start address of the mapped file.
+ * `size_`: Number of bytes in the file.
+ **/
+class MappedFile{
+public:
+    MappedFile() = default;
+
+    explicit MappedFile(const std::string& file){ open(file); }
+
+    ~MappedFile(){ close(); }
+
+    MappedFile(const MappedFile&) = delete;
+
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept;
+
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    /**
+     * Map the whole file. `sequentialAccess` tells the kernel that the file will be scanned once from front to back.
+     **/
+    bool open(const std::string& file, bool sequentialAccess = true);
+
+    void close();
+
+    bool isOpen() const{ return fd_ >= 0; }
+
+    const char* data() const{ return data_; }
+
+    const char* end() const{ return data_ + size_; }
+
+    size_t size() const{ return size_; }
+
+private:
+    int fd_ = -1;
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+};
@@ -4,8 +4,11 @@
 #include <string>
 #include <vector>
 #include <tuple>
+#include <utility>
 
 #include "TensorCoreConfig.cuh"
+#include "SharedArray.hpp"
+#include "precision.hpp"
 
 enum MatrixStorageOrder{
     row_major,
@@ -20,6 +23,49 @@ enum MatrixMultiplicationOrder{
 template <typename T>
 class Matrix;
 
+/**
+ * @className: MatrixView
+ * @classInterpretation: A dense matrix in memory that is not owned: the values, the size, the leading dimension and
+ * the storage order. Nothing is copied or freed, the memory must outlive the view. T is const for a read-only operand.
+ **/
+template <typename T>
+struct MatrixView{
+    T* data;
+    UIN row;
+    UIN col;
+    UIN leadingDimension;
+    MatrixStorageOrder storageOrder;
+
+    // Number of values from `data` to the last value, the padding after the last row (row-major) or column
+    // (col-major) is not part of the view
+    size_t size() const{
+        const bool isRowMajor = storageOrder == MatrixStorageOrder::row_major;
+        const UIN numVectors = isRowMajor ? row : col;
+        const UIN vectorLength = isRowMajor ? col : row;
+        return numVectors == 0 ? 0 : static_cast<size_t>(numVectors - 1) * leadingDimension + vectorLength;
+    }
+
+    // Whether the leading dimension is the number of columns (row-major) or rows (col-major)
+    bool isPacked() const{
+        return leadingDimension == (storageOrder == MatrixStorageOrder::row_major ? col : row);
+    }
+};
+
+/**
+ * A Matrix that owns a copy of `matrix` with the values rounded to `U`. The copy is packed.
+ * The conversions are the ones of `precision::convert`.
+ **/
+template <typename U, typename T>
+Matrix<U> convertTo(const MatrixView<const T>& matrix);
+
+/**
+ * The int8 quantization of `Matrix::quantize` for a view, the int8 matrix is packed.
+ **/
+template <typename T>
+Matrix<int8_t> quantize(const MatrixView<const T>& matrix,
+                        MatrixMultiplicationOrder multiplicationOrder,
+                        std::vector<float>& scales);
+
 namespace sparseMatrix{
 struct DataBase;
 
@@ -50,7 +96,7 @@ public:
           col_(col),
           storageOrder_(matrixOrder){
         leadingDimension_ = matrixOrder == MatrixStorageOrder::row_major ? col : row;
-        values_.resize(row * col);
+        values_.resize(static_cast<size_t>(row) * col);
     }
 
     Matrix(UIN row,
@@ -62,7 +108,7 @@ public:
           storageOrder_(matrixOrder),
           values_(values){
         leadingDimension_ = matrixOrder == MatrixStorageOrder::row_major ? col : row;
-        if (row * col != values.size()){
+        if (static_cast<size_t>(row) * col != values.size()){
             std::cout << "Warning! Matrix initialization mismatch" << std::endl;
         }
     }
@@ -74,7 +120,7 @@ public:
         : row_(row),
           col_(col),
           storageOrder_(matrixOrder),
-          values_(values, values + row * col){
+          values_(values, values + static_cast<size_t>(row) * col){
         leadingDimension_ = matrixOrder == MatrixStorageOrder::row_major ? col : row;
     }
 
@@ -84,9 +130,9 @@ public:
 
     void changeStorageOrder();
 
-    UIN rowOfValueIndex(UIN idx) const;
+    UIN rowOfValueIndex(size_t idx) const;
 
-    UIN colOfValueIndex(UIN idx) const;
+    UIN colOfValueIndex(size_t idx) const;
 
     T getOneValue(UIN row, UIN col) const;
 
@@ -112,7 +158,16 @@ public:
 
     std::vector<T> getColVector(UIN col) const;
 
-    UIN size() const{
+    /**
+     * quantize
+     * Symmetric int8 quantization, value = scale * q with q in [-127, 127]. There is one scale for each vector
+     * along K of the multiplication: each row of a left matrix (A), each column of a right matrix (B).
+     * The scale maps the largest magnitude of the vector to 127, a vector of 0 has the scale 0.
+     * The int8 matrix has the storage order of this matrix.
+     **/
+    Matrix<int8_t> quantize(MatrixMultiplicationOrder multiplicationOrder, std::vector<float>& scales) const;
+
+    size_t size() const{
         return values_.size();
     }
 
@@ -140,14 +195,34 @@ public:
         return values_.data();
     }
 
-    const T& operator[](UIN idx) const{
+    T* data(){
+        return values_.data();
+    }
+
+    /**
+     * A copy with the values rounded to `U`, e.g. to fp16 or bf16 to halve the storage of a dense operand.
+     * The conversions are the ones of `precision::convert`.
+     **/
+    template<typename U>
+    Matrix<U> convertTo() const{
+        return ::convertTo<U>(view());
+    }
+
+    /**
+     * A view of the values, valid as long as this matrix is neither destroyed nor resized
+     **/
+    MatrixView<const T> view() const{
+        return {values_.data(), row_, col_, leadingDimension_, storageOrder_};
+    }
+
+    const T& operator[](size_t idx) const{
         if (idx > values_.size()){
             std::cerr << "Error! Array access out of bounds" << std::endl;
         }
         return values_[idx];
     }
 
-    T& operator[](UIN idx){
+    T& operator[](size_t idx){
         if (idx > values_.size()){
             std::cerr << "Error! Array access out of bounds" << std::endl;
         }
@@ -163,6 +238,23 @@ private:
     std::vector<T> values_;
 };
 
+template <typename U, typename T>
+Matrix<U> convertTo(const MatrixView<const T>& matrix){
+    const bool isRowMajor = matrix.storageOrder == MatrixStorageOrder::row_major;
+    const UIN numVectors = isRowMajor ? matrix.row : matrix.col;
+    const UIN vectorLength = isRowMajor ? matrix.col : matrix.row;
+    std::vector<U> values(static_cast<size_t>(numVectors) * vectorLength);
+#pragma omp parallel for
+    for (UIN vectorId = 0; vectorId < numVectors; ++vectorId){
+        const T* vector = matrix.data + static_cast<size_t>(vectorId) * matrix.leadingDimension;
+        U* convertedVector = values.data() + static_cast<size_t>(vectorId) * vectorLength;
+        for (UIN idx = 0; idx < vectorLength; ++idx){
+            convertedVector[idx] = precision::convert<U>(vector[idx]);
+        }
+    }
+    return Matrix<U>(matrix.row, matrix.col, matrix.storageOrder, values);
+}
+
 template <typename T>
 inline std::ostream& operator<<(std::ostream& os, const Matrix<T>& mtx){
     os << " [row : " << mtx.row() << ", col : " << mtx.col() << "]";
@@ -170,6 +262,21 @@ inline std::ostream& operator<<(std::ostream& os, const Matrix<T>& mtx){
 }
 
 namespace sparseMatrix{
+/**
+ * @className: CsrView
+ * @classInterpretation: A CSR matrix in memory that is not owned, like `MatrixView`. The structure is read-only,
+ * `values` can be the values of the matrix or a buffer of nnz values for a result with the same structure.
+ **/
+template <typename T>
+struct CsrView{
+    UIN row;
+    UIN col;
+    UIN nnz;
+    const UIN* rowOffsets;
+    const UIN* colIndices;
+    T* values;
+};
+
 class DataBase{
 public:
     DataBase() = default;
@@ -213,8 +320,8 @@ public:
         UIN nnz,
         const UIN* rowOffsets,
         const UIN* colIndices,
-        const T* values) : rowOffsets_(rowOffsets, rowOffsets + row + 1),
-                           colIndices_(colIndices, colIndices + nnz),
+        const T* values) : rowOffsets_(std::vector<UIN>(rowOffsets, rowOffsets + row + 1)),
+                           colIndices_(std::vector<UIN>(colIndices, colIndices + nnz)),
                            values_(values, values + nnz){
         row_ = row;
         col_ = col;
@@ -226,8 +333,8 @@ public:
         UIN nnz,
         const int* rowOffsets,
         const int* colIndices,
-        const T* values) : rowOffsets_(rowOffsets, rowOffsets + row + 1),
-                           colIndices_(colIndices, colIndices + nnz),
+        const T* values) : rowOffsets_(std::vector<UIN>(rowOffsets, rowOffsets + row + 1)),
+                           colIndices_(std::vector<UIN>(colIndices, colIndices + nnz)),
                            values_(values, values + nnz){
         row_ = row;
         col_ = col;
@@ -244,7 +351,11 @@ public:
         nnz_ = nnz;
     }
 
-    bool initializeFromMatrixFile(const std::string& file);
+    /**
+     * Initialize from any supported file, chosen by the file suffix.
+     * `degreeOrderedRelabel` only applies to graph datasets, see `initializeFromGraphDataset`.
+     **/
+    bool initializeFromMatrixFile(const std::string& file, bool degreeOrderedRelabel = false);
 
     /**
      * Initialize from smtx file.
@@ -259,10 +370,34 @@ public:
     /**
      * Initialize from txt file.
      *
-     * txt file(CSR):
+     * txt file(SNAP edge list):
+     *    1) The file begins with comment information beginning with #, which contains "Nodes: n" and "Edges: e".
+     *    2) Each after line has two node IDs separated by a space: source node and destination node.
+     *
+     * Node IDs are relabeled to 0..n-1 in ascending order of ID.
+     * If `degreeOrderedRelabel` is true, they are relabeled in descending order of degree instead.
+     **/
+    bool initializeFromGraphDataset(const std::string& file, bool degreeOrderedRelabel = false);
+
+    /**
+     * Initialize from binary CSR file, the format written by `outputToBinaryFile`.
+     * rowOffsets and colIndices are not copied, they point into the memory mapped file.
+     * If the file has no values, all the values are 1 and `values()` is empty.
+     * The header and the structure are always verified. `verifyChecksum` also checks every data section.
+     **/
+    bool initializeFromBinaryFile(const std::string& file, bool verifyChecksum = false);
+
+    /**
+     * Initialize from npz file.
      *
+     * npz file (zip archive of npy arrays, stored or deflated):
+     *    1) `scipy.sparse.save_npz` of a CSR matrix: "indptr", "indices", "data", "shape", "format".
+     *       The arrays are used as they are, index arrays of the width of UIN are not copied.
+     *    2) `scipy.sparse.save_npz` of a COO matrix: "row", "col", "data", "shape", "format".
+     *    3) scripts/convert_mtx_to_npz.py: "src_li", "dst_li", "num_nodes_src", "num_nodes_dst", "num_edges".
+     *       There are no values, so every value is 1.
      **/
-    bool initializeFromGraphDataset(const std::string& file);
+    bool initializeFromNpzFile(const std::string& file);
 
     /**
     * Initialize from mtx file.
@@ -281,17 +416,82 @@ public:
 
     bool outputToMarketMatrixFile() const;
 
-    const std::vector<UIN>& rowOffsets() const{ return rowOffsets_; }
+    /**
+     * Output to binary CSR file.
+     *
+     * binary CSR file:
+     *    1) A 128 bytes header: magic, version, index and value types, row, col, nnz, section offsets and checksums.
+     *    2) The rowOffsets, colIndices and values sections, each starting at a multiple of 64 bytes.
+     *       The values section is omitted if all values are 1.
+     **/
+    bool outputToBinaryFile(const std::string& file) const;
 
-    const std::vector<UIN>& colIndices() const{ return colIndices_; }
+    /**
+     * Hash of the sparsity structure (size, rowOffsets and colIndices), calculated in parallel.
+     * The values are not part of the hash, so matrices with the same structure have the same hash.
+     **/
+    uint64_t structureHash() const;
+
+    const SharedArray<UIN>& rowOffsets() const{ return rowOffsets_; }
+
+    const SharedArray<UIN>& colIndices() const{ return colIndices_; }
 
     const std::vector<T>& values() const{ return values_; }
 
     std::vector<T>& setValues(){ return values_; }
 
+    /**
+     * A view of the structure and the values, valid as long as this matrix is neither destroyed nor changed
+     **/
+    CsrView<const T> view() const{
+        return {row_, col_, nnz_, rowOffsets_.data(), colIndices_.data(), values_.empty() ? nullptr : values_.data()};
+    }
+
+    /**
+     * A view of the structure with other values, e.g. the output buffer of an SDDMM with the structure of this matrix
+     **/
+    template <typename U>
+    CsrView<U> view(U* values) const{
+        return {row_, col_, nnz_, rowOffsets_.data(), colIndices_.data(), values};
+    }
+
+    /**
+     * A matrix with the structure of this matrix and `values`, e.g. the result P of an SDDMM with the structure of S.
+     * The structure is shared through the reference counted arrays, only the values are owned.
+     **/
+    template <typename U>
+    CSR<U> withValues(std::vector<U> values) const{
+        CSR<U> csr;
+        csr.row_ = row_;
+        csr.col_ = col_;
+        csr.nnz_ = nnz_;
+        csr.rowOffsets_ = rowOffsets_;
+        csr.colIndices_ = colIndices_;
+        csr.values_ = std::move(values);
+        return csr;
+    }
+
+    /**
+     * A CSR matrix that shares the structure of `matrix` without copying it, and has no values.
+     * For the functions that only read the structure, e.g. the reorderings. The memory must outlive the matrix.
+     **/
+    template <typename U>
+    static CSR borrowStructure(const CsrView<U>& matrix){
+        CSR csr;
+        csr.row_ = matrix.row;
+        csr.col_ = matrix.col;
+        csr.nnz_ = matrix.nnz;
+        csr.rowOffsets_ = SharedArray<UIN>::borrow(matrix.rowOffsets, static_cast<size_t>(matrix.row) + 1, nullptr);
+        csr.colIndices_ = SharedArray<UIN>::borrow(matrix.colIndices, matrix.nnz, nullptr);
+        return csr;
+    }
+
 private:
-    std::vector<UIN> rowOffsets_;
-    std::vector<UIN> colIndices_;
+    template <typename U>
+    friend class CSR;
+
+    SharedArray<UIN> rowOffsets_;
+    SharedArray<UIN> colIndices_;
     std::vector<T> values_;
 };
 
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "MappedFile.hpp"
+
+/**
+ * @className: NpyArray
+ * @classInterpretation: One array of a .npz file, as written by `numpy.save`.
+ * @MemberVariables:
+ * `dtype`: The numpy type string, for example "<i4" or "<f8".
+ * `shape`: The dimensions, empty for a scalar.
+ * `data`: Start address of the elements, inside the mapped file or the inflated buffer.
+ * `numBytes`: Number of bytes of the elements.
+ * `owner`: Keeps `data` valid.
+ **/
+struct NpyArray{
+    std::string dtype;
+    std::vector<size_t> shape;
+    const char* data = nullptr;
+    size_t numBytes = 0;
+    std::shared_ptr<const void> owner;
+
+    size_t numElements() const{
+        size_t num = 1;
+        for (const size_t dim : shape){
+            num *= dim;
+        }
+        return num;
+    }
+};
+
+/**
+ * @className: NpzFile
+ * @classInterpretation: Reader of the zip archive written by `numpy.savez` and `numpy.savez_compressed`.
+ * The archive is memory mapped. Stored arrays point straight into the mapping, deflated arrays are inflated with zlib.
+ * @MemberVariables:
+ * `mappedFile_`: The whole archive.
+ * `entries_`: Array name (without ".npy") -> position of the member in the archive.
+ **/
+class NpzFile{
+public:
+    bool open(const std::string& file);
+
+    bool contains(const std::string& name) const{ return entries_.find(name) != entries_.end(); }
+
+    /**
+     * @funcitonName: getArray
+     * @functionInterpretation: Locate (and inflate if needed) one array of the archive.
+     * @input:
+     * `name`: Array name, the keyword used in `numpy.savez`.
+     * @output:
+     * Return false if the array does not exist or cannot be read.
+     **/
+    bool getArray(const std::string& name, NpyArray& array) const;
+
+private:
+    struct Entry{
+        uint16_t compressionMethod = 0;
+        uint64_t compressedSize = 0;
+        uint64_t uncompressedSize = 0;
+        uint64_t localHeaderOffset = 0;
+    };
+
+    std::string file_;
+    std::shared_ptr<MappedFile> mappedFile_;
+    std::unordered_map<std::string, Entry> entries_;
+};
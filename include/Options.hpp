@@ -22,6 +22,10 @@ public:
     float similarityThresholdAlpha() const{ return similarityThresholdAlpha_; }
     float blockDensityThresholdDelta() const{ return blockDensityThresholdDelta_; }
 
+    bool degreeOrderedRelabel() const{
+        return degreeOrderedRelabel_;
+    }
+
     bool testMode() const{
         return testMode_;
     }
@@ -30,17 +34,63 @@ public:
         return outputLogDirectory_;
     }
 
+    std::string convertFile() const{
+        return convertFile_;
+    }
+
+    std::string reorderingCacheDirectory() const{
+        return reorderingCacheDirectory_;
+    }
+
+    size_t reorderingCacheSizeMB() const{
+        return reorderingCacheSizeMB_;
+    }
+
+    std::string rphmFile() const{
+        return rphmFile_;
+    }
+
+    std::string backend() const{
+        return backend_;
+    }
+
+    size_t attentionDim() const{
+        return attentionDim_;
+    }
+
+    size_t numHeads() const{
+        return numHeads_;
+    }
+
+    std::string precision() const{
+        return precision_;
+    }
+
+    std::string rowReorderingEngine() const{
+        return rowReorderingEngine_;
+    }
+
 private:
     std::string programPath_;
     std::string programName_;
     std::string inputFile_ = filePath;
     std::string outputLogDirectory_;
+    std::string convertFile_;
+    std::string reorderingCacheDirectory_;
+    size_t reorderingCacheSizeMB_ = 1024;
+    std::string rphmFile_;
+    std::string backend_ = "gpu";
+    size_t attentionDim_ = 0;
+    size_t numHeads_ = 1;
+    std::string precision_ = "fp32";
+    std::string rowReorderingEngine_ = "gpu";
     size_t K_ = 32;
     int numIterations_ = 10;
     float similarityThresholdAlpha_ = 0.3f;
     float blockDensityThresholdDelta_ = 0.3f;
 
     bool testMode_ = false;
+    bool degreeOrderedRelabel_ = false;
 
     inline void parsingOptionAndParameters(const std::string& option,
                                            const std::string& value);
@@ -67,6 +117,36 @@ inline void Options::parsingOptionAndParameters(const std::string& option,
         if (option == "-l" || option == "-L"){
             outputLogDirectory_ = value;
         }
+        if (option == "-g" || option == "-G"){
+            degreeOrderedRelabel_ = std::stoi(value);
+        }
+        if (option == "-c" || option == "-C"){
+            convertFile_ = value;
+        }
+        if (option == "-r" || option == "-R"){
+            reorderingCacheDirectory_ = value;
+        }
+        if (option == "-s" || option == "-S"){
+            reorderingCacheSizeMB_ = std::stoul(value);
+        }
+        if (option == "-p" || option == "-P"){
+            rphmFile_ = value;
+        }
+        if (option == "-b" || option == "-B"){
+            backend_ = value;
+        }
+        if (option == "-v" || option == "-V"){
+            attentionDim_ = std::stoul(value);
+        }
+        if (option == "-h" || option == "-H"){
+            numHeads_ = std::stoul(value);
+        }
+        if (option == "-e" || option == "-E"){
+            precision_ = value;
+        }
+        if (option == "-o" || option == "-O"){
+            rowReorderingEngine_ = value;
+        }
     }
     catch (const std::invalid_argument& e){
         std::cerr << "Invalid argument: " << e.what() << std::endl;
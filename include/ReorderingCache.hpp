@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "Matrix.hpp"
+
+class BSMR;
+
+/**
+ * The implementation of the BSMR row reordering. `cpu_exact` gives the clusters of `gpu`, `cpu` gives another
+ * reordering.
+ **/
+enum class RowReorderingEngine{
+    gpu,
+    cpu,
+    cpu_exact
+};
+
+inline const char* toString(const RowReorderingEngine rowReorderingEngine){
+    switch (rowReorderingEngine){
+        case RowReorderingEngine::cpu: return "cpu";
+        case RowReorderingEngine::cpu_exact: return "cpu_exact";
+        default: return "gpu";
+    }
+}
+
+/**
+ * @className: ReorderingCache
+ * @classInterpretation: On-disk cache of the BSMR reordering result. One file per entry in `directory_`.
+ * The key is the structure hash of the matrix, alpha, delta, the row reordering engine, ROW_PANEL_SIZE,
+ * BLOCK_COL_SIZE and the width of UIN, so the same sparsity structure with new values or new dense matrices reuses
+ * the reordering.
+ * The total size of the entries is bounded, the least recently used entries are removed first.
+ * @MemberVariables:
+ * `directory_`: Directory of the cache files, created if it does not exist.
+ * `maxBytes_`: Upper bound of the total size of the cache files.
+ **/
+class ReorderingCache{
+public:
+    /**
+     * The size of the matrix is not part of the file name, it bounds the indexes of a loaded entry.
+     **/
+    struct Key{
+        uint64_t structureHash = 0;
+        UIN row = 0;
+        UIN col = 0;
+        UIN nnz = 0;
+        float alpha = 0.0f;
+        float delta = 0.0f;
+        RowReorderingEngine rowReorderingEngine = RowReorderingEngine::gpu;
+    };
+
+    ReorderingCache(const std::string& directory, uint64_t maxBytes = defaultMaxBytes);
+
+    static Key makeKey(const sparseMatrix::CSR<float>& matrix,
+                       float alpha,
+                       float delta,
+                       RowReorderingEngine rowReorderingEngine = RowReorderingEngine::gpu);
+
+    /**
+     * @funcitonName: load
+     * @functionInterpretation: Load the reordering result of `key` into `bsmr`, and mark the entry as recently used.
+     * @output:
+     * Return false if there is no entry of `key`, the entry cannot be read or an index of the entry is out of range.
+     **/
+    bool load(const Key& key, BSMR& bsmr) const;
+
+    /**
+     * @funcitonName: store
+     * @functionInterpretation: Save the reordering result of `bsmr` as the entry of `key`,
+     * then remove the least recently used entries until the cache fits in `maxBytes_`.
+     **/
+    bool store(const Key& key, const BSMR& bsmr) const;
+
+    static constexpr uint64_t defaultMaxBytes = 1ULL << 30;
+
+private:
+    std::string directory_;
+    uint64_t maxBytes_;
+
+    std::string getFileName(const Key& key) const;
+
+    void evict() const;
+};
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+/**
+ * @className: SharedArray
+ * @classInterpretation: Immutable array whose storage is reference counted. The storage is either a `std::vector`
+ * owned by the array, or memory owned by someone else (for example a memory mapped file) that is kept alive by `owner_`.
+ * Copying a SharedArray shares the storage instead of copying the elements.
+ * @MemberVariables:
+ * `owner_`: Keeps the storage alive.
+ * `data_`: Start address of the elements.
+ * `size_`: Number of elements.
+ **/
+template <typename T>
+class SharedArray{
+public:
+    SharedArray() = default;
+
+    SharedArray(std::vector<T>&& values){
+        auto storage = std::make_shared<const std::vector<T>>(std::move(values));
+        data_ = storage->data();
+        size_ = storage->size();
+        owner_ = std::move(storage);
+    }
+
+    SharedArray(const std::vector<T>& values) : SharedArray(std::vector<T>(values)){}
+
+    /**
+     * @funcitonName: borrow
+     * @functionInterpretation: Wrap memory that is not owned by the array. No element is copied.
+     * @input:
+     * `data`, `size`: The elements.
+     * `owner`: Object that keeps `data` valid as long as any copy of the array exists.
+     **/
+    static SharedArray borrow(const T* data, const size_t size, std::shared_ptr<const void> owner){
+        SharedArray array;
+        array.data_ = data;
+        array.size_ = size;
+        array.owner_ = std::move(owner);
+        return array;
+    }
+
+    size_t size() const{ return size_; }
+
+    bool empty() const{ return size_ == 0; }
+
+    const T* data() const{ return data_; }
+
+    const T& operator[](const size_t idx) const{ return data_[idx]; }
+
+    const T* begin() const{ return data_; }
+
+    const T* end() const{ return data_ + size_; }
+
+    const T& back() const{ return data_[size_ - 1]; }
+
+    std::vector<T> toVector() const{ return std::vector<T>(begin(), end()); }
+
+private:
+    std::shared_ptr<const void> owner_;
+    const T* data_ = nullptr;
+    size_t size_ = 0;
+};
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cinttypes>
 #include <cstdint>
 #include <limits>
 
@@ -7,10 +8,26 @@
 #include <cuda_fp16.h>
 #include <mma.h>
 
+// Index type of rows, columns and non-zero elements.
+// 32-bit by default, build with `BSMR_INDEX_64` for matrices with more than 2^32 - 1 non-zero or dense elements.
+#ifdef BSMR_INDEX_64
+using UIN = uint64_t;
+#define PRIuUIN PRIu64
+#else
 using UIN = uint32_t;
+#define PRIuUIN PRIu32
+#endif
 constexpr UIN MAX_UIN = std::numeric_limits<UIN>::max();
 constexpr UIN NULL_VALUE = MAX_UIN;
 
+#ifdef BSMR_INDEX_64
+// CUDA only provides the 64-bit atomicAdd for `unsigned long long`, which is a different type from `uint64_t` on Linux
+static_assert(sizeof(UIN) == sizeof(unsigned long long), "UIN must be 64-bit");
+inline __device__ UIN atomicAdd(UIN *address, const UIN val) {
+    return ::atomicAdd(reinterpret_cast<unsigned long long *>(address), static_cast<unsigned long long>(val));
+}
+#endif
+
 constexpr UIN maxSharedMemoryPerBlock = 49152;
 
 // The dimension supported by WMMA
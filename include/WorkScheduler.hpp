@@ -0,0 +1,163 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <omp.h>
+
+#include "TensorCoreConfig.cuh"
+
+namespace scheduler{
+/**
+ * A chunk of work: the values [indexBegin, indexEnd) of the rows [rowBegin, rowEnd).
+ * Only the first and the last row of a chunk can be partial.
+ **/
+struct WorkChunk{
+    UIN rowBegin;
+    UIN rowEnd;
+    size_t indexBegin;
+    size_t indexEnd;
+};
+
+/**
+ * @funcitonName: exclusiveScan
+ * @functionInterpretation: Parallel prefix sum of `weights`, `offsets[i]` is the sum of the first i weights.
+ * @output: `offsets` has `weights.size() + 1` elements.
+ **/
+template<typename OffsetType>
+void exclusiveScan(const std::vector<OffsetType>& weights, std::vector<OffsetType>& offsets);
+
+/**
+ * @funcitonName: partition
+ * @functionInterpretation: Split the rows into at most `numChunks` chunks of the same weight.
+ * Row `row` weighs `offsets[row + 1] - offsets[row]`, e.g. `offsets` is the `rowOffsets` of a CSR matrix.
+ * A row heavier than `longRowThreshold` is split between chunks, the others are kept whole and move
+ * the chunk boundary to the nearer end of the row. Empty chunks are removed.
+ **/
+template<typename OffsetType>
+std::vector<WorkChunk> partition(const OffsetType* offsets, UIN numRows, UIN numChunks, uint64_t longRowThreshold);
+
+/**
+ * The default number of chunks: several for each thread, so stealing can even out the remaining imbalance.
+ **/
+inline UIN defaultNumChunks(){
+    return static_cast<UIN>(omp_get_max_threads()) * 8;
+}
+
+/**
+ * @className: WorkStealingDeque
+ * @classInterpretation: Lock-free deque of chunk ids [front, back). The owner takes from the front, thieves
+ * take from the back. Both ends are kept in one atomic word, so a take is one compare-and-swap.
+ * The chunks are all known before the work starts, so the deque only shrinks.
+ **/
+class WorkStealingDeque{
+public:
+    WorkStealingDeque() : range_(0){}
+
+    void reset(uint32_t front, uint32_t back){
+        range_.store(pack(front, back), std::memory_order_relaxed);
+    }
+
+    bool popFront(uint32_t& chunkId){
+        uint64_t range = range_.load(std::memory_order_acquire);
+        while (front(range) < back(range)){
+            if (range_.compare_exchange_weak(range, pack(front(range) + 1, back(range)), std::memory_order_acq_rel)){
+                chunkId = front(range);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool stealBack(uint32_t& chunkId){
+        uint64_t range = range_.load(std::memory_order_acquire);
+        while (front(range) < back(range)){
+            if (range_.compare_exchange_weak(range, pack(front(range), back(range) - 1), std::memory_order_acq_rel)){
+                chunkId = back(range) - 1;
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    // One cache line each, the deques of different threads do not share lines
+    alignas(64) std::atomic<uint64_t> range_;
+
+    static uint64_t pack(uint32_t front, uint32_t back){
+        return static_cast<uint64_t>(front) << 32 | back;
+    }
+
+    static uint32_t front(uint64_t range){
+        return static_cast<uint32_t>(range >> 32);
+    }
+
+    static uint32_t back(uint64_t range){
+        return static_cast<uint32_t>(range);
+    }
+};
+
+/**
+ * @funcitonName: run
+ * @functionInterpretation: Run `function(chunk, threadId)` for every chunk in parallel. Each thread starts with
+ * a contiguous range of chunks in its own deque, and steals from the other deques when its own is empty.
+ * @output: The load imbalance, the longest busy time of a thread divided by the average busy time (1 is balanced).
+ **/
+template<typename Function>
+float run(const std::vector<WorkChunk>& chunks, Function&& function){
+    const int numThreads = omp_get_max_threads();
+    const uint32_t numChunks = static_cast<uint32_t>(chunks.size());
+    std::vector<WorkStealingDeque> deques(numThreads);
+    std::vector<double> busyTimes(numThreads, 0.0);
+    int numTeamThreads = numThreads;
+
+#pragma omp parallel num_threads(numThreads)
+    {
+        const int threadId = omp_get_thread_num();
+#pragma omp single
+        numTeamThreads = omp_get_num_threads();
+        deques[threadId].reset(static_cast<uint64_t>(numChunks) * threadId / numTeamThreads,
+                               static_cast<uint64_t>(numChunks) * (threadId + 1) / numTeamThreads);
+#pragma omp barrier
+
+        const auto startTime = std::chrono::steady_clock::now();
+        uint32_t chunkId;
+        while (deques[threadId].popFront(chunkId)){
+            function(chunks[chunkId], threadId);
+        }
+        for (int victimOffset = 1; victimOffset < numTeamThreads; ++victimOffset){
+            WorkStealingDeque& victim = deques[(threadId + victimOffset) % numTeamThreads];
+            while (victim.stealBack(chunkId)){
+                function(chunks[chunkId], threadId);
+            }
+        }
+        busyTimes[threadId] = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    }
+
+    double maxBusyTime = 0.0, totalBusyTime = 0.0;
+    for (int threadId = 0; threadId < numTeamThreads; ++threadId){
+        maxBusyTime = std::max(maxBusyTime, busyTimes[threadId]);
+        totalBusyTime += busyTimes[threadId];
+    }
+    return totalBusyTime > 0.0 ? static_cast<float>(maxBusyTime * numTeamThreads / totalBusyTime) : 1.0f;
+}
+
+/**
+ * @funcitonName: forEachRow
+ * @functionInterpretation: Call `function(row, indexBegin, indexEnd)` for the part of each row that is in `chunk`.
+ **/
+template<typename OffsetType, typename Function>
+void forEachRow(const WorkChunk& chunk, const OffsetType* offsets, Function&& function){
+    for (UIN row = chunk.rowBegin; row < chunk.rowEnd; ++row){
+        const size_t indexBegin = std::max<size_t>(offsets[row], chunk.indexBegin);
+        const size_t indexEnd = std::min<size_t>(offsets[row + 1], chunk.indexEnd);
+        if (indexBegin < indexEnd){
+            function(row, indexBegin, indexEnd);
+        }
+    }
+}
+} // namespace scheduler
@@ -0,0 +1,218 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "TensorCoreConfig.cuh"
+
+class RPHM;
+
+namespace cpu{
+/**
+ * Instruction sets of the CPU kernels, in increasing order.
+ **/
+enum class Isa{
+    scalar,
+    avx2,
+    avx512
+};
+
+/**
+ * @funcitonName: getIsa
+ * @functionInterpretation: The instruction set used by the CPU kernels. It is detected once at runtime,
+ * the environment variable BSMR_CPU_ISA ("scalar", "avx2" or "avx512") can select a lower one.
+ **/
+Isa getIsa();
+
+const char* getIsaName(Isa isa);
+
+/**
+ * @funcitonName: sddmm
+ * @functionInterpretation: SDDMM on the CPU. For each nonzero (row, col) of the sparse matrix,
+ * values[idx] = dot(row `row` of A, column `col` of B). The nonzeros are split into chunks of the same size
+ * (long rows are split between chunks) that the threads steal from each other, K is processed in blocks
+ * that fit in L1 and the dot products use the instruction set of `getIsa`.
+ * T is float, __half or __nv_bfloat16. 16-bit operands are converted to fp32 when they are loaded (F16C or AVX512
+ * for fp16, AVX512-BF16 dot products for bf16 if the CPU has them) and the products are accumulated in fp32,
+ * so only the memory traffic of A and B is halved.
+ * @input:
+ * `matrixA`: Row-major A (row x K), row i starts at `matrixA + i * lda`.
+ * `matrixB`: Col-major B (K x col), column j starts at `matrixB + j * ldb`.
+ * `numRows`, `rowOffsets`, `colIndices`: Structure of the sparse matrix in CSR format.
+ * @output: `values`, one value for each nonzero. `loadImbalance`, if not null, the load imbalance of the threads
+ * (see `scheduler::run`).
+ **/
+template<typename T>
+void sddmm(const T* matrixA,
+           size_t lda,
+           const T* matrixB,
+           size_t ldb,
+           UIN K,
+           UIN numRows,
+           const UIN* rowOffsets,
+           const UIN* colIndices,
+           float* values,
+           float* loadImbalance = nullptr);
+
+/**
+ * @funcitonName: sddmm_coo
+ * @functionInterpretation: Same as `sddmm`, for a sparse matrix in COO format.
+ **/
+void sddmm_coo(const float* matrixA,
+               size_t lda,
+               const float* matrixB,
+               size_t ldb,
+               UIN K,
+               UIN nnz,
+               const UIN* rowIndices,
+               const UIN* colIndices,
+               float* values);
+
+/**
+ * @funcitonName: sddmm
+ * @functionInterpretation: SDDMM on the CPU with the BSMR tiling, the counterpart of `sddmm_gpu`.
+ * The rows of a row panel are packed once and reused by all of its dense blocks. A dense block is a register-blocked
+ * GEMM over the reordered rows and `denseCols`, and only its occupied slots are written.
+ * The sparse remainder is a dot product per value. Row panels are split into chunks of the same number of
+ * multiply-adds that the threads steal from each other. For 16-bit T the rows are converted when they are packed and
+ * the columns of a dense block once for its ROW_PANEL_SIZE rows.
+ * @input:
+ * `matrixA`: Row-major A (row x K), row i starts at `matrixA + i * lda`.
+ * `matrixB`: Col-major B (K x N), column j starts at `matrixB + j * ldb`.
+ * `rphm`: The tiling, its host arrays are used.
+ * @output: `matrixP`, one value for each nonzero of the original matrix. `loadImbalance`, as in `sddmm`.
+ **/
+template<typename T>
+void sddmm(const T* matrixA,
+           size_t lda,
+           const T* matrixB,
+           size_t ldb,
+           UIN N,
+           UIN K,
+           const RPHM& rphm,
+           float* matrixP,
+           float* loadImbalance = nullptr);
+
+/**
+ * int8 operands of `sddmm_int8`, quantized with `Matrix::quantize`: A = scalesA[i] * row i of `matrixA`,
+ * B = scalesB[j] * column j of `matrixB`. The layouts are those of `sddmm`.
+ **/
+struct QuantizedOperands{
+    const int8_t* matrixA; // Row-major A (row x K)
+    size_t lda;
+    const float* scalesA; // One scale for each row of A
+    const int8_t* matrixB; // Col-major B (K x N)
+    size_t ldb;
+    const float* scalesB; // One scale for each column of B
+};
+
+/**
+ * @funcitonName: sddmm_int8
+ * @functionInterpretation: `sddmm` with int8 operands, a quarter of the memory traffic of fp32 A and B.
+ * The dot products are accumulated in int32 (AVX512-VNNI if the CPU has it, else AVX2 or scalar) and are exact,
+ * the error is only the quantization. They are dequantized when they are written, value = scalesA[row] *
+ * scalesB[col] * dot.
+ * @output: `values`, as in `sddmm`.
+ **/
+void sddmm_int8(const QuantizedOperands& operands,
+                UIN K,
+                UIN numRows,
+                const UIN* rowOffsets,
+                const UIN* colIndices,
+                float* values,
+                float* loadImbalance = nullptr);
+
+/**
+ * @funcitonName: sddmm_int8
+ * @functionInterpretation: `sddmm_int8` with the BSMR tiling. The rows of a row panel are packed in groups of 4 values
+ * of K, a dense block is 4 multiply-adds per VNNI instruction.
+ * @output: `matrixP`, as in `sddmm`.
+ **/
+void sddmm_int8(const QuantizedOperands& operands,
+                UIN N,
+                UIN K,
+                const RPHM& rphm,
+                float* matrixP,
+                float* loadImbalance = nullptr);
+
+/**
+ * @funcitonName: sddmm_batch
+ * @functionInterpretation: `sddmm` with the BSMR tiling for `numHeads` heads that share the sparse matrix, e.g. the
+ * heads of a multi-head attention. The index metadata of a row panel is decoded once and reused by every head.
+ * @input:
+ * `matrixA`: [numHeads, row, K], head h is a row-major matrix at `matrixA + h * headStrideA`.
+ * `matrixB`: [numHeads, K, N], head h is a col-major matrix at `matrixB + h * headStrideB`.
+ * @output: `matrixP`, [numHeads, nnz] at `matrixP + h * headStrideP`. `headTimes`, if not null, the compute time of
+ * each head in ms summed over the threads. `loadImbalance`, as in `sddmm`.
+ **/
+void sddmm_batch(UIN numHeads,
+                 const float* matrixA,
+                 size_t lda,
+                 size_t headStrideA,
+                 const float* matrixB,
+                 size_t ldb,
+                 size_t headStrideB,
+                 UIN N,
+                 UIN K,
+                 const RPHM& rphm,
+                 float* matrixP,
+                 size_t headStrideP,
+                 float* headTimes = nullptr,
+                 float* loadImbalance = nullptr);
+
+/**
+ * Arguments of the fused attention, O = softmax(scale * S .* (A * B)) * V with the softmax over the nonzeros
+ * of each row of S. The pointers are host pointers here, a GPU kernel takes the same arguments as device pointers.
+ **/
+struct AttentionArguments{
+    const float* matrixA; // Row-major Q (row x K)
+    size_t lda;
+    const float* matrixB; // Col-major K^T (K x N)
+    size_t ldb;
+    const float* matrixV; // Row-major V (N x D)
+    size_t ldv;
+    const float* valuesS; // Values of S indexed like the original CSR, null if S is a 0/1 mask
+    float* matrixO; // Row-major O (row x D)
+    size_t ldo;
+    UIN N;
+    UIN K;
+    UIN D;
+    float scale;
+};
+
+/**
+ * @funcitonName: attention
+ * @functionInterpretation: Fused SDDMM + row-wise softmax + SpMM on the CPU with the BSMR tiling. The scores of a row
+ * panel are computed like `sddmm` (dense blocks, then the sparse remainder) and go straight into an online softmax
+ * that keeps the max, the sum and the weighted sum of V of each row, so P is never stored.
+ * @output: The rows of `matrixO` that are in the tiling, the rows of S without nonzeros are not written.
+ * `loadImbalance`, as in `sddmm`.
+ **/
+void attention(const AttentionArguments& arguments, const RPHM& rphm, float* loadImbalance = nullptr);
+
+/**
+ * @funcitonName: gemm
+ * @functionInterpretation: Dense C = A * B on the CPU. Blocked for the caches (MC x KC blocks of A, KC x NC panels of B),
+ * both operands are packed, and the tiles of C are computed by a micro-kernel of the instruction set of `getIsa`
+ * (float) or a generic vectorizable one (int, double). The row blocks of A are processed in parallel.
+ * Any storage order is supported through the strides, element (i, j) of a matrix X is at
+ * `matrixX[i * rowStrideX + j * colStrideX]`.
+ * @input:
+ * `matrixA`: M x K.
+ * `matrixB`: K x N.
+ * @output: `matrixC`, M x N, overwritten.
+ **/
+template<typename T>
+void gemm(UIN M,
+          UIN N,
+          UIN K,
+          const T* matrixA,
+          size_t rowStrideA,
+          size_t colStrideA,
+          const T* matrixB,
+          size_t rowStrideB,
+          size_t colStrideB,
+          T* matrixC,
+          size_t rowStrideC,
+          size_t colStrideC);
+} // namespace cpu
@@ -4,6 +4,8 @@
 
 #include <cuda_runtime.h>
 
+#include "SharedArray.hpp"
+
 namespace dev {
 
 template<typename T>
@@ -14,6 +16,7 @@ class vector {
   vector(size_t size, T value);
   vector(const vector<T> &src);
   vector(const std::vector<T> &src);
+  vector(const SharedArray<T> &src);
 
   ~vector() {
       if (data_) { cudaFree(data_); }
@@ -102,6 +105,19 @@ inline vector<T>::vector(const std::vector<T> &src) {
     cudaMemcpy(data_, src.data(), src.size() * sizeof(T), cudaMemcpyHostToDevice);
 }
 
+template<typename T>
+inline vector<T>::vector(const SharedArray<T> &src) : vector() {
+    size_ = src.size();
+    if(!size_){
+        return;
+    }
+    cudaMalloc(reinterpret_cast<void **> (&data_), src.size() * sizeof(T));
+    if (!data_) {
+        fprintf(stderr, "dev::vector: Device memory allocation failed\n");
+    }
+    cudaMemcpy(data_, src.data(), src.size() * sizeof(T), cudaMemcpyHostToDevice);
+}
+
 template<typename T>
 inline void vector<T>::resize(size_t size) {
     if (data_) {
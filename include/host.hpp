@@ -4,6 +4,9 @@
 
 #include "Matrix.hpp"
 
+class RPHM;
+struct Logger;
+
 template<typename T>
 void dmm_cpu(const Matrix<T> &matrixA,
              const Matrix<T> &matrixB,
@@ -16,9 +19,106 @@ void sddmm_cpu(
     const sparseMatrix::CSR<T> &matrixS,
     sparseMatrix::CSR<T> &matrixP);
 
+/**
+ * SDDMM on the CPU into the values of matrixP, which has the structure of S. Nothing is allocated, `matrixP.values`
+ * is a buffer of nnz values of the caller.
+ **/
+template<typename T>
+void sddmm_cpu(
+    const MatrixView<const T> &matrixA,
+    const MatrixView<const T> &matrixB,
+    const sparseMatrix::CsrView<T> &matrixP);
+
 template<typename T>
 void sddmm_cpu(
     const Matrix<T> &matrixA,
     const Matrix<T> &matrixB,
     const sparseMatrix::COO<T> &matrixS,
-    sparseMatrix::COO<T> &matrixP);
\ No newline at end of file
+    sparseMatrix::COO<T> &matrixP);
+
+/**
+ * SDDMM on the CPU with the BSMR tiling, the counterpart of `sddmm_gpu`. matrixA must be row-major and
+ * matrixB col-major. Runs `logger.numITER_` times and records the average time in `logger.sddmmTime_`.
+ * T is float, __half or __nv_bfloat16, the values of matrixP are always accumulated in fp32.
+ **/
+template<typename T>
+void sddmm_cpu(const Matrix<T> &matrixA,
+               const Matrix<T> &matrixB,
+               const RPHM &rphm,
+               sparseMatrix::CSR<float> &matrixP,
+               Logger &logger);
+
+/**
+ * `sddmm_cpu` with the BSMR tiling into the values of matrixP, a buffer of nnz values of the caller
+ **/
+template<typename T>
+void sddmm_cpu(const MatrixView<const T> &matrixA,
+               const MatrixView<const T> &matrixB,
+               const RPHM &rphm,
+               const sparseMatrix::CsrView<float> &matrixP,
+               Logger &logger);
+
+/**
+ * Error check of the values of matrixP, an SDDMM whose operands were rounded to T. `matrixA` and `matrixB` are the
+ * fp32 operands before the rounding. A value passes if it differs from the fp32 SDDMM by at most
+ * (2u + u^2 + 2K * 2^-24) * sum_k |a_k * b_k|, the bound of the rounding of both operands to T (unit roundoff u) and of the two fp32 accumulations.
+ * The checking table is printed like `checkData`, `numError` is the number of values out of the bound.
+ **/
+template<typename T>
+bool checkSddmmPrecision(const MatrixView<const float> &matrixA,
+                         const MatrixView<const float> &matrixB,
+                         const sparseMatrix::CsrView<const float> &matrixP,
+                         size_t &numError);
+
+/**
+ * int8 SDDMM on the CPU with the BSMR tiling, see `cpu::sddmm_int8`. A is quantized with one scale per row and B with
+ * one scale per column (`Matrix::quantize`), the values of matrixP are dequantized to fp32. Records the time of the
+ * quantization in `logger.quantizationTime_` and the average time of `logger.numITER_` runs in `logger.sddmmTime_`.
+ **/
+void sddmm_cpu_int8(const Matrix<float> &matrixA,
+                    const Matrix<float> &matrixB,
+                    const RPHM &rphm,
+                    sparseMatrix::CSR<float> &matrixP,
+                    Logger &logger);
+
+void sddmm_cpu_int8(const MatrixView<const float> &matrixA,
+                    const MatrixView<const float> &matrixB,
+                    const RPHM &rphm,
+                    const sparseMatrix::CsrView<float> &matrixP,
+                    Logger &logger);
+
+/**
+ * Relative error ||P - R||_2 / ||R||_2 of the values of an SDDMM result P, R is the fp32 SDDMM of `matrixA` and
+ * `matrixB`. For the results that are not checked value by value, e.g. the int8 SDDMM.
+ **/
+float sddmmRelativeError(const MatrixView<const float> &matrixA,
+                         const MatrixView<const float> &matrixB,
+                         const sparseMatrix::CsrView<const float> &matrixP);
+
+/**
+ * Batched SDDMM on the CPU with the BSMR tiling for `numHeads` heads that share S, see `cpu::sddmm_batch`.
+ * matrixA stacks the heads by rows ([H, M, K]: (H * M) x K, row-major) and matrixB by columns
+ * ([H, K, N]: K x (H * N), col-major). `matrixP` gets H * nnz values, head by head. Runs `logger.numITER_` times and
+ * records the average time of the batch in `logger.batchTime_` and of each head in `logger.headTimes_`.
+ **/
+void sddmm_cpu_batch(UIN numHeads,
+                     const Matrix<float> &matrixA,
+                     const Matrix<float> &matrixB,
+                     const RPHM &rphm,
+                     const sparseMatrix::CSR<float> &matrixS,
+                     std::vector<float> &matrixP,
+                     Logger &logger);
+
+/**
+ * Fused attention on the CPU with the BSMR tiling, O = softmax(scale * S .* (A * B)) * V, see `cpu::attention`.
+ * matrixA (Q) must be row-major, matrixB (K^T) col-major, matrixV and matrixO row-major. `valuesS` are the values of S,
+ * null if S is a 0/1 mask. Runs `logger.numITER_` times and records the average time in `logger.attentionTime_`.
+ **/
+void attention_cpu(const MatrixView<const float> &matrixA,
+                   const MatrixView<const float> &matrixB,
+                   const Matrix<float> &matrixV,
+                   const RPHM &rphm,
+                   const float *valuesS,
+                   float scale,
+                   Matrix<float> &matrixO,
+                   Logger &logger);
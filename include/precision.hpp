@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include <cuda_fp16.h>
+#include <cuda_bf16.h>
+
+/**
+ * Host conversions of the 16-bit operand types, `__half` (fp16) and `__nv_bfloat16` (bf16). They work on the bits,
+ * round to nearest even and do not depend on the host support of the CUDA conversion intrinsics.
+ * The CPU kernels load 16-bit values and accumulate in fp32.
+ **/
+namespace precision{
+inline uint32_t floatToBits(const float value){
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+inline float bitsToFloat(const uint32_t bits){
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+inline float fp16BitsToFloat(const uint16_t bits){
+    // Exponent and mantissa moved to their fp32 position, the multiplication rebiases the exponent (15 -> 127)
+    // and also normalizes the subnormal values
+    const uint32_t magnitude = static_cast<uint32_t>(bits & 0x7fffu) << 13;
+    uint32_t result = floatToBits(bitsToFloat(magnitude) * 0x1p112f);
+    if (magnitude >= 0x0f800000u){ // Inf and NaN
+        result |= 0x7f800000u;
+    }
+    return bitsToFloat(result | static_cast<uint32_t>(bits & 0x8000u) << 16);
+}
+
+inline uint16_t floatToFp16Bits(const float value){
+    const uint32_t bits = floatToBits(value);
+    const uint32_t sign = bits & 0x80000000u;
+    const uint32_t magnitude = bits ^ sign;
+    uint32_t result;
+    if (magnitude >= 0x47800000u){ // Overflows to Inf, or NaN
+        result = magnitude > 0x7f800000u ? 0x7e00u : 0x7c00u;
+    }
+    else if (magnitude < 0x38800000u){ // Subnormal or 0, the addition of 0.5 rounds the mantissa
+        result = floatToBits(bitsToFloat(magnitude) + 0.5f) - 0x3f000000u;
+    }
+    else{
+        const uint32_t isMantissaOdd = (magnitude >> 13) & 1u;
+        result = (magnitude + 0xc8000fffu + isMantissaOdd) >> 13; // Rebias (127 -> 15) and round
+    }
+    return static_cast<uint16_t>(result | sign >> 16);
+}
+
+inline float bf16BitsToFloat(const uint16_t bits){
+    return bitsToFloat(static_cast<uint32_t>(bits) << 16);
+}
+
+inline uint16_t floatToBf16Bits(const float value){
+    const uint32_t bits = floatToBits(value);
+    if ((bits & 0x7fffffffu) > 0x7f800000u){ // NaN stays NaN
+        return static_cast<uint16_t>(bits >> 16 | 0x40u);
+    }
+    return static_cast<uint16_t>((bits + 0x7fffu + (bits >> 16 & 1u)) >> 16);
+}
+
+template<typename T>
+inline uint16_t bitsOf(const T value){
+    static_assert(sizeof(T) == sizeof(uint16_t), "Only for the 16-bit types");
+    uint16_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+template<typename T>
+inline T fromBits(const uint16_t bits){
+    static_assert(sizeof(T) == sizeof(uint16_t), "Only for the 16-bit types");
+    T value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+inline float toFloat(const float value){
+    return value;
+}
+
+inline float toFloat(const __half value){
+    return fp16BitsToFloat(bitsOf(value));
+}
+
+inline float toFloat(const __nv_bfloat16 value){
+    return bf16BitsToFloat(bitsOf(value));
+}
+
+template<typename T>
+inline T fromFloat(float value);
+
+template<>
+inline float fromFloat<float>(const float value){
+    return value;
+}
+
+template<>
+inline __half fromFloat<__half>(const float value){
+    return fromBits<__half>(floatToFp16Bits(value));
+}
+
+template<>
+inline __nv_bfloat16 fromFloat<__nv_bfloat16>(const float value){
+    return fromBits<__nv_bfloat16>(floatToBf16Bits(value));
+}
+
+template<typename To, typename From>
+inline To convert(const From value){
+    return fromFloat<To>(toFloat(value));
+}
+
+/**
+ * The name of a type and its unit roundoff u, the relative error of rounding a value to it is at most u
+ **/
+template<typename T>
+struct Traits;
+
+template<>
+struct Traits<float>{
+    static constexpr const char* name = "fp32";
+    static constexpr float unitRoundoff = 0x1p-24f;
+};
+
+template<>
+struct Traits<__half>{
+    static constexpr const char* name = "fp16";
+    static constexpr float unitRoundoff = 0x1p-11f;
+};
+
+template<>
+struct Traits<__nv_bfloat16>{
+    static constexpr const char* name = "bf16";
+    static constexpr float unitRoundoff = 0x1p-8f;
+};
+} // namespace precision
@@ -11,11 +11,35 @@ void sddmm(const Options& options,
            sparseMatrix::CSR<float>& matrixP,
            Logger& logger);
 
+/**
+ * `sddmm` with only the values of P as output, P has the structure of S. `valuesP` is resized to nnz.
+ **/
+void sddmm(const Options& options,
+           const Matrix<float>& matrixA,
+           const Matrix<float>& matrixB,
+           const sparseMatrix::CSR<float>& matrixS,
+           std::vector<float>& valuesP,
+           Logger& logger);
+
+/**
+ * `sddmm` on memory of the caller: the operands are read in place and the result is written to `matrixP.values`,
+ * a buffer of nnz values. Neither the operands nor the structure of P are copied on the host.
+ **/
+void sddmm(const Options& options,
+           const MatrixView<const float>& matrixA,
+           const MatrixView<const float>& matrixB,
+           const sparseMatrix::CsrView<float>& matrixP,
+           Logger& logger);
+
 void sddmm_testMode(const Options& options,
-                    sparseMatrix::CSR<float>& matrixP);
+                    const sparseMatrix::CSR<float>& matrixS);
 
 // Error check
 bool checkSddmm(const Matrix<float>& matrixA,
                 const Matrix<float>& matrixB,
                 const sparseMatrix::CSR<float>& matrixS,
                 const sparseMatrix::CSR<float>& matrixP);
+
+bool checkSddmm(const MatrixView<const float>& matrixA,
+                const MatrixView<const float>& matrixB,
+                const sparseMatrix::CsrView<const float>& matrixP);
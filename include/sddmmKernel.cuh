@@ -22,6 +22,16 @@ void sddmm_gpu(const Matrix<float> &matrixA,
                sparseMatrix::CSR<float> &matrixP,
                Logger &logger);
 
+/**
+ * SDDMM on the GPU into the values of matrixP, a buffer of nnz values of the caller. A and B are copied to the device
+ * from the views and must be packed, the device pointer form below takes operands that are already on the device.
+ **/
+void sddmm_gpu(const MatrixView<const float> &matrixA,
+               const MatrixView<const float> &matrixB,
+               const RPHM &rphm,
+               const sparseMatrix::CsrView<float> &matrixP,
+               Logger &logger);
+
 void sddmm_gpu(UIN M, UIN N, UIN K,
                const float *matrixA,
                const float *matrixB,
@@ -38,6 +48,18 @@ void sddmm_gpu_k32(UIN M,
                    float* matrixP,
                    Logger& logger);
 
+/**
+ * Batched SDDMM on the GPU, the layouts of `sddmm_cpu_batch`. The heads run in one launch,
+ * so only the time of the batch is recorded, in `logger.batchTime_`.
+ **/
+void sddmm_gpu_batch(UIN numHeads,
+                     const Matrix<float> &matrixA,
+                     const Matrix<float> &matrixB,
+                     const RPHM &rphm,
+                     const sparseMatrix::CSR<float> &matrixS,
+                     std::vector<float> &matrixP,
+                     Logger &logger);
+
 void sddmm_gpu_batch(const UIN numBatch,
                      const UIN M, const UIN N, const UIN K, const UIN nnz,
                      const float *matrixA,
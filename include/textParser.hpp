@@ -0,0 +1,230 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <vector>
+
+namespace parser{
+/**
+ * @funcitonName: isBlank
+ * @functionInterpretation: Whether the character separates two words in a line.
+ **/
+inline bool isBlank(const char c){
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+/**
+ * @funcitonName: skipBlank
+ * @functionInterpretation: Skip the spaces, tabs and carriage returns, but not the line feed.
+ * @output:
+ * Return the first position in [cur, end) that is not blank.
+ **/
+inline const char* skipBlank(const char* cur, const char* end){
+    while (cur < end && isBlank(*cur)){
+        ++cur;
+    }
+    return cur;
+}
+
+/**
+ * @funcitonName: nextLine
+ * @functionInterpretation: Find the beginning of the line after the one that contains `cur`.
+ * @output:
+ * Return the position after the next '\n', or `end` if there is no next line.
+ **/
+inline const char* nextLine(const char* cur, const char* end){
+    if (cur >= end){
+        return end;
+    }
+    const void* lineFeed = std::memchr(cur, '\n', end - cur);
+    return lineFeed ? static_cast<const char*>(lineFeed) + 1 : end;
+}
+
+/**
+ * @funcitonName: skipCommentLines
+ * @functionInterpretation: Skip every line that begins with `commentMark`.
+ * @output:
+ * Return the beginning of the first line that is not a comment.
+ **/
+inline const char* skipCommentLines(const char* cur, const char* end, const char commentMark){
+    while (cur < end && *cur == commentMark){
+        cur = nextLine(cur, end);
+    }
+    return cur;
+}
+
+/**
+ * @funcitonName: parseUnsigned
+ * @functionInterpretation: Parse one unsigned decimal integer after the leading blanks.
+ * @input:
+ * `cur`: Where to start. Note that the variable changes to the position after the number!
+ * `value`: Output value.
+ * @output:
+ * Return false if there is no digit or the number exceeds the range of `T`.
+ **/
+template <typename T>
+inline bool parseUnsigned(const char*& cur, const char* end, T& value){
+    const char* pos = skipBlank(cur, end);
+    if (pos < end && *pos == '+'){
+        ++pos;
+    }
+    if (pos >= end || static_cast<unsigned>(*pos - '0') > 9){
+        return false;
+    }
+
+    uint64_t result = 0;
+    while (pos < end && static_cast<unsigned>(*pos - '0') <= 9){
+        const uint64_t digit = *pos - '0';
+        if (result > (UINT64_MAX - digit) / 10){
+            return false;
+        }
+        result = result * 10 + digit;
+        ++pos;
+    }
+    if (result > static_cast<uint64_t>(static_cast<T>(-1))){
+        return false;
+    }
+
+    value = static_cast<T>(result);
+    cur = pos;
+    return true;
+}
+
+/**
+ * @funcitonName: parseFloat
+ * @functionInterpretation: Parse one decimal floating point number after the leading blanks.
+ * Numbers with at most 19 significant digits and a small exponent are converted exactly in place,
+ * the rest (long mantissas, huge exponents, inf, nan) fall back to `std::strtod`.
+ * @input:
+ * `cur`: Where to start. Note that the variable changes to the position after the number!
+ * `value`: Output value.
+ * @output:
+ * Return false if no number can be read.
+ **/
+inline bool parseFloat(const char*& cur, const char* end, double& value){
+    static constexpr double exactPowersOf10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+    const char* begin = skipBlank(cur, end);
+    const char* pos = begin;
+
+    bool negative = false;
+    if (pos < end && (*pos == '-' || *pos == '+')){
+        negative = *pos == '-';
+        ++pos;
+    }
+
+    uint64_t mantissa = 0;
+    int numDigits = 0;
+    int exponent = 0;
+    bool hasDigit = false;
+    while (pos < end && static_cast<unsigned>(*pos - '0') <= 9){
+        if (numDigits < 19){
+            mantissa = mantissa * 10 + (*pos - '0');
+            if (mantissa){
+                ++numDigits;
+            }
+        }
+        else{
+            ++exponent;
+        }
+        hasDigit = true;
+        ++pos;
+    }
+    if (pos < end && *pos == '.'){
+        ++pos;
+        while (pos < end && static_cast<unsigned>(*pos - '0') <= 9){
+            if (numDigits < 19){
+                mantissa = mantissa * 10 + (*pos - '0');
+                if (mantissa){
+                    ++numDigits;
+                }
+                --exponent;
+            }
+            hasDigit = true;
+            ++pos;
+        }
+    }
+    if (hasDigit && pos < end && (*pos == 'e' || *pos == 'E')){
+        const char* exponentPos = pos + 1;
+        bool negativeExponent = false;
+        if (exponentPos < end && (*exponentPos == '-' || *exponentPos == '+')){
+            negativeExponent = *exponentPos == '-';
+            ++exponentPos;
+        }
+        if (exponentPos < end && static_cast<unsigned>(*exponentPos - '0') <= 9){
+            int explicitExponent = 0;
+            while (exponentPos < end && static_cast<unsigned>(*exponentPos - '0') <= 9){
+                if (explicitExponent < 100000){
+                    explicitExponent = explicitExponent * 10 + (*exponentPos - '0');
+                }
+                ++exponentPos;
+            }
+            exponent += negativeExponent ? -explicitExponent : explicitExponent;
+            pos = exponentPos;
+        }
+    }
+
+    const bool isTokenEnd = pos >= end || isBlank(*pos) || *pos == '\n';
+    if (hasDigit && isTokenEnd && mantissa <= (uint64_t(1) << 53) && exponent >= -22 && exponent <= 22){
+        double result = static_cast<double>(mantissa);
+        result = exponent < 0 ? result / exactPowersOf10[-exponent] : result * exactPowersOf10[exponent];
+        value = negative ? -result : result;
+        cur = pos;
+        return true;
+    }
+
+    // Slow path: copy the word and let the C library handle it
+    const char* wordEnd = begin;
+    while (wordEnd < end && !isBlank(*wordEnd) && *wordEnd != '\n'){
+        ++wordEnd;
+    }
+    char buffer[128];
+    const size_t length = std::min(static_cast<size_t>(wordEnd - begin), sizeof(buffer) - 1);
+    if (length == 0){
+        return false;
+    }
+    std::memcpy(buffer, begin, length);
+    buffer[length] = '\0';
+    char* parsedEnd = nullptr;
+    const double result = std::strtod(buffer, &parsedEnd);
+    if (parsedEnd == buffer){
+        return false;
+    }
+    value = result;
+    cur = begin + (parsedEnd - buffer);
+    return true;
+}
+
+/**
+ * @funcitonName: isLineEnd
+ * @functionInterpretation: Whether there is nothing but blanks between `cur` and the end of the line.
+ **/
+inline bool isLineEnd(const char* cur, const char* end){
+    cur = skipBlank(cur, end);
+    return cur >= end || *cur == '\n';
+}
+
+/**
+ * @funcitonName: splitIntoLineAlignedChunks
+ * @functionInterpretation: Divide [begin, end) into `numChunks` parts of about the same size,
+ * moving every boundary forward to the beginning of a line so that no line is split.
+ * @output:
+ * Return `numChunks + 1` boundaries. Chunk `i` is [boundaries[i], boundaries[i + 1]) and may be empty.
+ **/
+inline std::vector<const char*> splitIntoLineAlignedChunks(const char* begin, const char* end, const int numChunks){
+    std::vector<const char*> boundaries(numChunks + 1, end);
+    boundaries[0] = begin;
+    const size_t size = end - begin;
+    for (int chunkId = 1; chunkId < numChunks; ++chunkId){
+        const char* approximate = begin + size / numChunks * chunkId;
+        approximate = std::max(approximate, boundaries[chunkId - 1]);
+        boundaries[chunkId] = approximate > begin && approximate[-1] == '\n' ? approximate : nextLine(approximate, end);
+    }
+    return boundaries;
+}
+} // namespace parser
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cstdio>
 #include <cmath>
 #include <unordered_map>
@@ -6,44 +7,151 @@
 #include <limits>
 #include <numeric>
 #include <array>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
 #include <omp.h>
 
 #include "BSMR.hpp"
 #include "CudaTimeCalculator.cuh"
+#include "MappedFile.hpp"
 #include "parallelAlgorithm.cuh"
 #include "sddmmKernel.cuh"
+#include "WorkScheduler.hpp"
 
 BSMR::BSMR(const float similarityThreshold,
            const float blockDensityThreshold,
            const sparseMatrix::CSR<float>& matrix,
-           const int numIterations){
+           const int numIterations,
+           const ReorderingCache* cache,
+           const RowReorderingEngine rowReorderingEngine)
+    : similarityThreshold_(similarityThreshold),
+      blockDensityThreshold_(blockDensityThreshold),
+      rowReorderingEngine_(rowReorderingEngine){
+    ReorderingCache::Key cacheKey;
+    if (cache){
+        CudaTimeCalculator timeCalculator;
+        timeCalculator.startClock();
+        cacheKey = ReorderingCache::makeKey(matrix, similarityThreshold, blockDensityThreshold, rowReorderingEngine);
+        const bool isHit = cache->load(cacheKey, *this);
+        timeCalculator.endClock();
+
+        // The loaded times are the times of the reordering that was cached, the loading time replaces them
+        if (isHit){
+            const float loadTime = timeCalculator.getTime();
+            isLoadedFromCache_ = true;
+            savedReorderingTime_ = std::max(reorderingTime() - loadTime, 0.0f);
+            rowReorderingTime_ = loadTime;
+            colReorderingTime_ = 0.0f;
+            baselineDenseFraction_ = calculateDenseFraction(matrix);
+            return;
+        }
+    }
+
     // Row reordering
-    rowReordering(similarityThreshold, matrix, numIterations);
+    rowReordering(similarityThreshold, matrix, numIterations, rowReorderingEngine);
 
     // Column reordering
     colReordering(blockDensityThreshold, matrix, reorderedRows_, numIterations);
+
+    if (cache){
+        cache->store(cacheKey, *this);
+    }
+}
+
+BSMR::BSMR(const sparseMatrix::CSR<float>& matrix, const RPHM& rphm)
+    : similarityThreshold_(rphm.similarityThreshold()),
+      blockDensityThreshold_(rphm.blockDensityThreshold()),
+      rowReorderingEngine_(rphm.rowReorderingEngine()){
+    const RPHM::HostArrays& hostArrays = rphm.hostArrays();
+    numRowPanels_ = rphm.numRowPanels();
+    numClusters_ = rphm.numClusters();
+    reorderedRows_ = hostArrays.reorderedRows;
+    denseCols_ = hostArrays.denseCols;
+    sparseValueOffsets_ = hostArrays.sparseValueOffsets;
+
+    // Every dense block has BLOCK_COL_SIZE dense columns
+    denseColOffsets_.resize(numRowPanels_ + 1);
+    for (int rowPanelId = 0; rowPanelId <= numRowPanels_; ++rowPanelId){
+        denseColOffsets_[rowPanelId] = hostArrays.blockOffsets[rowPanelId] * BLOCK_COL_SIZE;
+    }
+
+    // The sparse columns of a row panel are the columns of its sparse data, in the order of `colReordering_cpu`:
+    // descending number of nonzeros, the columns with the same number in ascending order, and padded to a multiple of
+    // BLOCK_COL_SIZE with the number of columns
+    std::vector<std::vector<UIN>> sparseColsInEachRowPanel(numRowPanels_);
+#pragma omp parallel for schedule(dynamic)
+    for (int rowPanelId = 0; rowPanelId < numRowPanels_; ++rowPanelId){
+        std::vector<UIN> cols(hostArrays.sparseColIndices.begin() + sparseValueOffsets_[rowPanelId],
+                              hostArrays.sparseColIndices.begin() + sparseValueOffsets_[rowPanelId + 1]);
+        std::sort(cols.begin(), cols.end());
+        std::vector<std::pair<UIN, UIN>> numNonZerosAndCols;
+        for (size_t idx = 0; idx < cols.size(); ++idx){
+            if (numNonZerosAndCols.empty() || numNonZerosAndCols.back().second != cols[idx]){
+                numNonZerosAndCols.emplace_back(0, cols[idx]);
+            }
+            ++numNonZerosAndCols.back().first;
+        }
+        std::stable_sort(numNonZerosAndCols.begin(), numNonZerosAndCols.end(),
+                         [](const std::pair<UIN, UIN>& lhs, const std::pair<UIN, UIN>& rhs){
+                             return lhs.first > rhs.first;
+                         });
+
+        std::vector<UIN>& sparseColsCurrentRowPanel = sparseColsInEachRowPanel[rowPanelId];
+        for (const auto& [numNonZeros, col] : numNonZerosAndCols){
+            sparseColsCurrentRowPanel.push_back(col);
+        }
+        if (sparseColsCurrentRowPanel.size() % BLOCK_COL_SIZE != 0){
+            sparseColsCurrentRowPanel.resize(
+                sparseColsCurrentRowPanel.size() + BLOCK_COL_SIZE - sparseColsCurrentRowPanel.size() % BLOCK_COL_SIZE,
+                matrix.col());
+        }
+    }
+
+    sparseColOffsets_.resize(numRowPanels_ + 1);
+    sparseColOffsets_[0] = 0;
+    for (int rowPanelId = 0; rowPanelId < numRowPanels_; ++rowPanelId){
+        sparseColOffsets_[rowPanelId + 1] = sparseColOffsets_[rowPanelId] + sparseColsInEachRowPanel[rowPanelId].size();
+        sparseCols_.insert(sparseCols_.end(),
+                           sparseColsInEachRowPanel[rowPanelId].begin(),
+                           sparseColsInEachRowPanel[rowPanelId].end());
+    }
+
+    baselineDenseFraction_ = calculateDenseFraction(matrix);
 }
 
 void BSMR::rowReordering(const float similarityThreshold,
                          const sparseMatrix::CSR<float>& matrix,
-                         const int numIterations){
+                         const int numIterations,
+                         const RowReorderingEngine rowReorderingEngine){
     // Row reordering
     float rowReordering_time = 0.0f;
     const UIN blockSize = calculateBlockSize(matrix);
     for (int iter = 0; iter < numIterations; ++iter){
         float oneIterationTime = 0.0f;
         // noReorderRow(matrix,reorderedRows_,oneIterationTime);
-        reorderedRows_ = bsa_rowReordering_gpu(matrix,
-                                               similarityThreshold,
-                                               blockSize,
-                                               numClusters_,
-                                               oneIterationTime);
+        switch (rowReorderingEngine){
+            case RowReorderingEngine::cpu:
+                reorderedRows_ =
+                    bsa_rowReordering_cpu(matrix, similarityThreshold, blockSize, numClusters_, oneIterationTime);
+                break;
+            case RowReorderingEngine::cpu_exact:
+                reorderedRows_ =
+                    bsa_rowReordering_cpu_exact(matrix, similarityThreshold, blockSize, numClusters_, oneIterationTime);
+                break;
+            default:
+                reorderedRows_ =
+                    bsa_rowReordering_gpu(matrix, similarityThreshold, blockSize, numClusters_, oneIterationTime);
+        }
         rowReordering_time += oneIterationTime;
     }
     rowReordering_time /= numIterations;
 
     rowReorderingTime_ = rowReordering_time;
     // printf("rowReordering time : %f ms\n", rowReordering_time);
+    similarityThreshold_ = similarityThreshold;
+    rowReorderingEngine_ = rowReorderingEngine;
 
     numRowPanels_ = std::ceil(static_cast<float>(reorderedRows_.size()) / ROW_PANEL_SIZE);
     // printf("numRowPanels : %d\n", numRowPanels_);
@@ -78,48 +186,257 @@ void BSMR::colReordering(const float blockDensityThreshold,
 
     colReorderingTime_ = colReordering_time;
     // printf("colReordering time : %f ms\n", colReordering_time);
+    blockDensityThreshold_ = blockDensityThreshold;
+    baselineDenseFraction_ = calculateDenseFraction(matrix);
 }
 
-RPHM::RPHM(const sparseMatrix::CSR<float>& matrix, const BSMR& bsmr){
-    std::vector<UIN> blockOffsets;
-    std::vector<UIN> blockValues;
+float BSMR::calculateDenseFraction(const sparseMatrix::CSR<float>& matrix) const{
+    if (matrix.nnz() == 0 || sparseValueOffsets_.empty()){
+        return 0.0f;
+    }
+    return static_cast<float>(matrix.nnz() - sparseValueOffsets_.back()) / static_cast<float>(matrix.nnz());
+}
 
-    std::vector<UIN> sparseValues;
-    std::vector<UIN> sparseRelativeRows;
-    std::vector<UIN> sparseColIndices;
+namespace{
+// The number of nonzeros of `row` in the sorted columns `cols`
+UIN countCoveredNonZeros(const sparseMatrix::CSR<float>& matrix, const UIN row, const std::vector<UIN>& cols){
+    UIN numCovered = 0;
+    for (UIN idx = matrix.rowOffsets()[row]; idx < matrix.rowOffsets()[row + 1]; ++idx){
+        numCovered += std::binary_search(cols.begin(), cols.end(), matrix.colIndices()[idx]) ? 1 : 0;
+    }
+    return numCovered;
+}
+} // namespace
 
-    numRowPanels_ = bsmr.numRowPanels();
+BSMR::Update BSMR::update(const sparseMatrix::CSR<float>& matrix, const PatternDelta& delta, const float maxDrift){
+    Update result;
 
-    std::vector<UIN> denseRowPanelIds;
-    std::vector<UIN> denseColBlockIters;
+    CudaTimeCalculator timeCalculator;
+    timeCalculator.startClock();
 
-    maxNumDenseColBlocksInRowPanel_ = 0;
-    numDenseThreadBlocks_ = 0;
-    // #pragma omp parallel for reduction(max : maxNumDenseColBlocksInRowPanel_) reduction(+: numDenseThreadBlocks_)
-    for (int rowPanelId = 0; rowPanelId < numRowPanels_; ++rowPanelId){
-        const UIN numBlocksCurrentRowPanel = std::ceil(
-            static_cast<float>(bsmr.denseColOffsets()[rowPanelId + 1] - bsmr.denseColOffsets()[rowPanelId])
-            / BLOCK_COL_SIZE);
-        maxNumDenseColBlocksInRowPanel_ = std::max(maxNumDenseColBlocksInRowPanel_, numBlocksCurrentRowPanel);
-        const UIN numDenseThreadBlocksCurrentRowPanel = std::ceil(
-            static_cast<float>(numBlocksCurrentRowPanel) / each_thread_block_counts_the_number_Of_dense_blocks);
-        std::vector<UIN> rowPanelIdsCurrentRowPanel(numDenseThreadBlocksCurrentRowPanel);
-        std::vector<UIN> colBlockItersCurrentRowPanel(numDenseThreadBlocksCurrentRowPanel);
-        for (int i = 0; i < numDenseThreadBlocksCurrentRowPanel; ++i){
-            rowPanelIdsCurrentRowPanel[i] = rowPanelId;
-            colBlockItersCurrentRowPanel[i] = bsmr.denseColOffsets()[rowPanelId] / BLOCK_COL_SIZE +
-                i * each_thread_block_counts_the_number_Of_dense_blocks;
+    std::vector<UIN> changedRows(delta.insertedRows);
+    changedRows.insert(changedRows.end(), delta.removedRows.begin(), delta.removedRows.end());
+    std::sort(changedRows.begin(), changedRows.end());
+    changedRows.erase(std::unique(changedRows.begin(), changedRows.end()), changedRows.end());
+
+    const UIN numRowPanelsBeforeUpdate = numRowPanels_;
+    std::vector<UIN> indexOfReorderedRows(matrix.row(), NULL_VALUE);
+    for (UIN indexOfReorderedRow = 0; indexOfReorderedRow < reorderedRows_.size(); ++indexOfReorderedRow){
+        indexOfReorderedRows[reorderedRows_[indexOfReorderedRow]] = indexOfReorderedRow;
+    }
+    std::vector<char> isRowPanelUpdated(numRowPanelsBeforeUpdate + changedRows.size() / ROW_PANEL_SIZE + 1, 0);
+    auto markRowPanel = [&](const UIN indexOfReorderedRow){
+        isRowPanelUpdated[indexOfReorderedRow / ROW_PANEL_SIZE] = 1;
+    };
+
+    // The rows without nonzeros leave the order and the last row takes their place, the rows with the first nonzeros
+    // join the last row panel, so the other row panels keep their rows
+    for (const UIN row : changedRows){
+        const UIN numNonZero = matrix.rowOffsets()[row + 1] - matrix.rowOffsets()[row];
+        const UIN indexOfReorderedRow = indexOfReorderedRows[row];
+        if (numNonZero == 0 && indexOfReorderedRow != NULL_VALUE){
+            const UIN lastRow = reorderedRows_.back();
+            markRowPanel(indexOfReorderedRow);
+            markRowPanel(reorderedRows_.size() - 1);
+            reorderedRows_[indexOfReorderedRow] = lastRow;
+            indexOfReorderedRows[lastRow] = indexOfReorderedRow;
+            indexOfReorderedRows[row] = NULL_VALUE;
+            reorderedRows_.pop_back();
         }
-        denseRowPanelIds.insert(denseRowPanelIds.end(), rowPanelIdsCurrentRowPanel.begin(),
-                                rowPanelIdsCurrentRowPanel.end());
-        denseColBlockIters.insert(denseColBlockIters.end(), colBlockItersCurrentRowPanel.begin(),
-                                  colBlockItersCurrentRowPanel.end());
+        else if (numNonZero > 0 && indexOfReorderedRow == NULL_VALUE){
+            indexOfReorderedRows[row] = reorderedRows_.size();
+            reorderedRows_.push_back(row);
+            markRowPanel(reorderedRows_.size() - 1);
+        }
+        else if (numNonZero > 0){
+            markRowPanel(indexOfReorderedRow);
+        }
+    }
+    numRowPanels_ = std::ceil(static_cast<float>(reorderedRows_.size()) / ROW_PANEL_SIZE);
 
-        numDenseThreadBlocks_ += numDenseThreadBlocksCurrentRowPanel;
+    // BSMR keeps the row panels and not the clusters, so the row panels of the last column reordering are the
+    // existing clusters. A changed row is swapped with the row of the row panel whose dense columns cover most of its
+    // nonzeros that the row panel covers least, if the two rows have more nonzeros in dense columns after the swap.
+    // A swap only changes the two row panels
+    std::vector<UIN> denseColRowPanelOffsets(static_cast<size_t>(matrix.col()) + 1, 0);
+    for (const UIN col : denseCols_){
+        ++denseColRowPanelOffsets[col + 1];
+    }
+    std::partial_sum(denseColRowPanelOffsets.begin(), denseColRowPanelOffsets.end(), denseColRowPanelOffsets.begin());
+    std::vector<UIN> denseColRowPanels(denseCols_.size());
+    {
+        std::vector<UIN> positions(denseColRowPanelOffsets.begin(), denseColRowPanelOffsets.end() - 1);
+        for (UIN rowPanelId = 0; rowPanelId < numRowPanelsBeforeUpdate; ++rowPanelId){
+            for (UIN idx = denseColOffsets_[rowPanelId]; idx < denseColOffsets_[rowPanelId + 1]; ++idx){
+                denseColRowPanels[positions[denseCols_[idx]]++] = rowPanelId;
+            }
+        }
     }
+    auto sortedDenseColsOf = [&](const UIN rowPanelId){
+        std::vector<UIN> cols;
+        if (rowPanelId < numRowPanelsBeforeUpdate){
+            cols.assign(denseCols_.begin() + denseColOffsets_[rowPanelId],
+                        denseCols_.begin() + denseColOffsets_[rowPanelId + 1]);
+            std::sort(cols.begin(), cols.end());
+        }
+        return cols;
+    };
 
-    CudaTimeCalculator timeCalculator;
+    std::unordered_map<UIN, UIN> numCoveredInEachRowPanel;
+    for (const UIN row : changedRows){
+        if (indexOfReorderedRows[row] == NULL_VALUE){
+            continue;
+        }
+        const UIN rowPanelId = indexOfReorderedRows[row] / ROW_PANEL_SIZE;
+
+        numCoveredInEachRowPanel.clear();
+        for (UIN idx = matrix.rowOffsets()[row]; idx < matrix.rowOffsets()[row + 1]; ++idx){
+            const UIN col = matrix.colIndices()[idx];
+            for (UIN iter = denseColRowPanelOffsets[col]; iter < denseColRowPanelOffsets[col + 1]; ++iter){
+                ++numCoveredInEachRowPanel[denseColRowPanels[iter]];
+            }
+        }
+        UIN bestRowPanelId = rowPanelId;
+        UIN numCoveredInBest = numCoveredInEachRowPanel[rowPanelId];
+        for (const auto& [candidateRowPanelId, numCovered] : numCoveredInEachRowPanel){
+            if (numCovered > numCoveredInBest
+                || (numCovered == numCoveredInBest && candidateRowPanelId < bestRowPanelId)){
+                bestRowPanelId = candidateRowPanelId;
+                numCoveredInBest = numCovered;
+            }
+        }
+        const UIN numCoveredInCurrent = numCoveredInEachRowPanel[rowPanelId];
+        if (bestRowPanelId == rowPanelId || numCoveredInBest <= numCoveredInCurrent){
+            continue;
+        }
+
+        const std::vector<UIN> currentDenseCols = sortedDenseColsOf(rowPanelId);
+        const std::vector<UIN> bestDenseCols = sortedDenseColsOf(bestRowPanelId);
+        const UIN startIndexOfBest = bestRowPanelId * ROW_PANEL_SIZE;
+        const UIN endIndexOfBest = std::min(startIndexOfBest + ROW_PANEL_SIZE, static_cast<UIN>(reorderedRows_.size()));
+        UIN swappedIndex = NULL_VALUE;
+        int64_t bestGain = 0;
+        for (UIN indexOfReorderedRow = startIndexOfBest; indexOfReorderedRow < endIndexOfBest; ++indexOfReorderedRow){
+            const UIN otherRow = reorderedRows_[indexOfReorderedRow];
+            const int64_t gain = static_cast<int64_t>(numCoveredInBest) - numCoveredInCurrent
+                + countCoveredNonZeros(matrix, otherRow, currentDenseCols)
+                - countCoveredNonZeros(matrix, otherRow, bestDenseCols);
+            if (gain > bestGain){
+                bestGain = gain;
+                swappedIndex = indexOfReorderedRow;
+            }
+        }
+        if (swappedIndex == NULL_VALUE){
+            continue;
+        }
+        const UIN indexOfReorderedRow = indexOfReorderedRows[row];
+        const UIN otherRow = reorderedRows_[swappedIndex];
+        std::swap(reorderedRows_[indexOfReorderedRow], reorderedRows_[swappedIndex]);
+        indexOfReorderedRows[row] = swappedIndex;
+        indexOfReorderedRows[otherRow] = indexOfReorderedRow;
+        markRowPanel(swappedIndex);
+    }
+
+    timeCalculator.endClock();
+    rowReorderingTime_ = timeCalculator.getTime();
+
+    // Reorder the columns of the updated row panels and move the columns of the other row panels
     timeCalculator.startClock();
+    for (UIN rowPanelId = 0; rowPanelId < static_cast<UIN>(numRowPanels_); ++rowPanelId){
+        if (isRowPanelUpdated[rowPanelId] || rowPanelId >= numRowPanelsBeforeUpdate){
+            result.updatedRowPanels.push_back(rowPanelId);
+        }
+    }
+    std::vector<std::vector<UIN>> colsInEachUpdatedRowPanel;
+    std::vector<UIN> numDenseColsInEachUpdatedRowPanel, numSparseColsInEachUpdatedRowPanel,
+        numSparseDataInEachUpdatedRowPanel;
+    colReorderingOfRowPanels_cpu(matrix,
+                                 reorderedRows_,
+                                 result.updatedRowPanels,
+                                 blockDensityThreshold_,
+                                 colsInEachUpdatedRowPanel,
+                                 numDenseColsInEachUpdatedRowPanel,
+                                 numSparseColsInEachUpdatedRowPanel,
+                                 numSparseDataInEachUpdatedRowPanel);
+
+    std::vector<UIN> denseCols, denseColOffsets{0}, sparseCols, sparseColOffsets{0}, sparseValueOffsets{0};
+    for (UIN rowPanelId = 0, idxOfUpdated = 0; rowPanelId < static_cast<UIN>(numRowPanels_); ++rowPanelId){
+        if (idxOfUpdated < result.updatedRowPanels.size() && result.updatedRowPanels[idxOfUpdated] == rowPanelId){
+            const std::vector<UIN>& cols = colsInEachUpdatedRowPanel[idxOfUpdated];
+            const UIN numDenseCols = numDenseColsInEachUpdatedRowPanel[idxOfUpdated];
+            denseCols.insert(denseCols.end(), cols.begin(), cols.begin() + numDenseCols);
+            sparseCols.insert(sparseCols.end(),
+                              cols.begin() + numDenseCols,
+                              cols.begin() + numDenseCols + numSparseColsInEachUpdatedRowPanel[idxOfUpdated]);
+            sparseValueOffsets.push_back(sparseValueOffsets.back() + numSparseDataInEachUpdatedRowPanel[idxOfUpdated]);
+            ++idxOfUpdated;
+        }
+        else{
+            denseCols.insert(denseCols.end(),
+                             denseCols_.begin() + denseColOffsets_[rowPanelId],
+                             denseCols_.begin() + denseColOffsets_[rowPanelId + 1]);
+            sparseCols.insert(sparseCols.end(),
+                              sparseCols_.begin() + sparseColOffsets_[rowPanelId],
+                              sparseCols_.begin() + sparseColOffsets_[rowPanelId + 1]);
+            sparseValueOffsets.push_back(sparseValueOffsets.back()
+                + sparseValueOffsets_[rowPanelId + 1] - sparseValueOffsets_[rowPanelId]);
+        }
+        denseColOffsets.push_back(denseCols.size());
+        sparseColOffsets.push_back(sparseCols.size());
+    }
+    denseCols_ = std::move(denseCols);
+    denseColOffsets_ = std::move(denseColOffsets);
+    sparseCols_ = std::move(sparseCols);
+    sparseColOffsets_ = std::move(sparseColOffsets);
+    sparseValueOffsets_ = std::move(sparseValueOffsets);
+
+    timeCalculator.endClock();
+    colReorderingTime_ = timeCalculator.getTime();
+
+    // Reorder from scratch if the patched tiling lost too many nonzeros to the sparse part
+    result.drift = baselineDenseFraction_ - calculateDenseFraction(matrix);
+    if (result.drift > maxDrift){
+        rowReordering(similarityThreshold_, matrix, 1, rowReorderingEngine_);
+        colReordering(blockDensityThreshold_, matrix, reorderedRows_);
+        result.isRebuilt = true;
+        result.updatedRowPanels.resize(numRowPanels_);
+        std::iota(result.updatedRowPanels.begin(), result.updatedRowPanels.end(), 0);
+    }
+
+    return result;
+}
+
+RPHM::RPHM(const sparseMatrix::CSR<float>& matrix, const BSMR& bsmr){
+    initialize(matrix, bsmr);
+}
+
+void RPHM::initialize(const sparseMatrix::CSR<float>& matrix, const BSMR& bsmr){
+    hostArrays_ = HostArrays();
+    similarityThreshold_ = bsmr.similarityThreshold();
+    blockDensityThreshold_ = bsmr.blockDensityThreshold();
+    rowReorderingEngine_ = bsmr.rowReorderingEngine();
+    numClusters_ = bsmr.numClusters();
+
+    initializeRowPanelOffsets(bsmr);
+#pragma omp parallel for schedule(dynamic)
+    for (int rowPanelId = 0; rowPanelId < numRowPanels_; ++rowPanelId){
+        tileRowPanel(matrix, bsmr, rowPanelId);
+    }
+    initializeThreadBlocks(bsmr);
+
+    hostArrays_.reorderedRows = bsmr.reorderedRows();
+    hostArrays_.denseCols = bsmr.denseCols();
+    hostArrays_.sparseValueOffsets = bsmr.sparseValueOffsets();
+
+    // The device arrays are copied on the first use
+    isOnDevice_ = false;
+}
+
+void RPHM::initializeRowPanelOffsets(const BSMR& bsmr){
+    std::vector<UIN>& blockOffsets = hostArrays_.blockOffsets;
+    std::vector<UIN>& blockValues = hostArrays_.blockValues;
+
+    numRowPanels_ = bsmr.numRowPanels();
 
     // initialize blockRowOffsets_
     std::vector<UIN> numBlockInEachRowPanel(numRowPanels_);
@@ -135,29 +452,46 @@ RPHM::RPHM(const sparseMatrix::CSR<float>& matrix, const BSMR& bsmr){
                          numBlockInEachRowPanel.data() + numBlockInEachRowPanel.size(),
                          blockOffsets.data() + 1);
 
-    sparseRelativeRows.resize(bsmr.sparseValueOffsets().back());
-    sparseValues.resize(bsmr.sparseValueOffsets().back());
-    sparseColIndices.resize(bsmr.sparseValueOffsets().back());
+    hostArrays_.sparseRelativeRows.resize(bsmr.sparseValueOffsets().back());
+    hostArrays_.sparseValues.resize(bsmr.sparseValueOffsets().back());
+    hostArrays_.sparseColIndices.resize(bsmr.sparseValueOffsets().back());
 
     // initialize blockValues_
-    blockValues.resize(blockOffsets.back() * BLOCK_SIZE);
+    const size_t numBlockValues = static_cast<size_t>(blockOffsets.back()) * BLOCK_SIZE;
+    if (numBlockValues >= NULL_VALUE){
+        fprintf(stderr, "Error! The dense blocks have %zu elements, which exceeds the range of UIN. "
+                        "Use the 64-bit index build.\n", numBlockValues);
+        std::exit(EXIT_FAILURE);
+    }
+    blockValues.resize(numBlockValues);
     host::fill_n(blockValues.data(), blockValues.size(), NULL_VALUE);
-#pragma omp parallel for
-    for (int indexOfReorderedRows = 0; indexOfReorderedRows < bsmr.reorderedRows().size(); ++indexOfReorderedRows){
+}
+
+void RPHM::tileRowPanel(const sparseMatrix::CSR<float>& matrix, const BSMR& bsmr, const UIN rowPanelId){
+    std::vector<UIN>& blockValues = hostArrays_.blockValues;
+
+    std::vector<UIN>& sparseValues = hostArrays_.sparseValues;
+    std::vector<UIN>& sparseRelativeRows = hostArrays_.sparseRelativeRows;
+    std::vector<UIN>& sparseColIndices = hostArrays_.sparseColIndices;
+
+    const UIN startIndex = rowPanelId * ROW_PANEL_SIZE;
+    const UIN endIndex = std::min(startIndex + ROW_PANEL_SIZE, static_cast<UIN>(bsmr.reorderedRows().size()));
+
+    // Initialize dense part data
+    const UIN startIndexOfBlockValuesCurrentRowPanel = hostArrays_.blockOffsets[rowPanelId] * BLOCK_SIZE;
+    for (UIN indexOfReorderedRows = startIndex; indexOfReorderedRows < endIndex; ++indexOfReorderedRows){
         const UIN row = bsmr.reorderedRows()[indexOfReorderedRows];
 
         std::unordered_map<UIN, UIN> colToIndexOfOriginalMatrixMap;
-        for (int idxOfOriginalMatrix = matrix.rowOffsets()[row]; idxOfOriginalMatrix < matrix.rowOffsets()[row + 1];
+        for (UIN idxOfOriginalMatrix = matrix.rowOffsets()[row]; idxOfOriginalMatrix < matrix.rowOffsets()[row + 1];
              ++idxOfOriginalMatrix){
             colToIndexOfOriginalMatrixMap[matrix.colIndices()[idxOfOriginalMatrix]] = idxOfOriginalMatrix;
         }
 
-        const UIN rowPanelId = indexOfReorderedRows / ROW_PANEL_SIZE;
         const UIN localRowId = indexOfReorderedRows % ROW_PANEL_SIZE;
-        const UIN startIndexOfBlockValuesCurrentRowPanel = blockOffsets[rowPanelId] * BLOCK_SIZE;
 
         // Iterate over the dense columns in the row panel
-        for (int count = 0, indexOfReorderedCols = bsmr.denseColOffsets()[rowPanelId];
+        for (UIN count = 0, indexOfReorderedCols = bsmr.denseColOffsets()[rowPanelId];
              indexOfReorderedCols < bsmr.denseColOffsets()[rowPanelId + 1];
              ++count, ++indexOfReorderedCols){
             const UIN localColId = count % BLOCK_COL_SIZE;
@@ -174,52 +508,80 @@ RPHM::RPHM(const sparseMatrix::CSR<float>& matrix, const BSMR& bsmr){
     }
 
     // Initialize sparse part data
-#pragma omp parallel for
-    for (int rowPanelId = 0; rowPanelId < numRowPanels_; ++rowPanelId){
-        std::unordered_map<UIN, std::vector<std::array<UIN, 2>>> colToRelativeRowAndOriginIndexMap;
-
-        const UIN startIndex = rowPanelId * ROW_PANEL_SIZE;
-        const UIN endIndex = std::min(startIndex + ROW_PANEL_SIZE, static_cast<UIN>(bsmr.reorderedRows().size()));
-
-        for (int indexOfReorderedRows = startIndex; indexOfReorderedRows < endIndex; ++indexOfReorderedRows){
-            const UIN row = bsmr.reorderedRows()[indexOfReorderedRows];
-            for (int idx = matrix.rowOffsets()[row]; idx < matrix.rowOffsets()[row + 1]; ++idx){
-                const UIN col = matrix.colIndices()[idx];
-                std::array<UIN, 2> relativeRowAndOriginIndex =
-                    {static_cast<UIN>(indexOfReorderedRows % ROW_PANEL_SIZE), static_cast<UIN>(idx)};
+    std::unordered_map<UIN, std::vector<std::array<UIN, 2>>> colToRelativeRowAndOriginIndexMap;
 
-                auto findIter = colToRelativeRowAndOriginIndexMap.find(col);
-                if (findIter == colToRelativeRowAndOriginIndexMap.end()){
-                    colToRelativeRowAndOriginIndexMap[col] = {relativeRowAndOriginIndex};
-                }
-                else{
-                    findIter->second.push_back(relativeRowAndOriginIndex);
-                }
+    for (UIN indexOfReorderedRows = startIndex; indexOfReorderedRows < endIndex; ++indexOfReorderedRows){
+        const UIN row = bsmr.reorderedRows()[indexOfReorderedRows];
+        for (UIN idx = matrix.rowOffsets()[row]; idx < matrix.rowOffsets()[row + 1]; ++idx){
+            const UIN col = matrix.colIndices()[idx];
+            std::array<UIN, 2> relativeRowAndOriginIndex =
+                {static_cast<UIN>(indexOfReorderedRows % ROW_PANEL_SIZE), static_cast<UIN>(idx)};
+
+            auto findIter = colToRelativeRowAndOriginIndexMap.find(col);
+            if (findIter == colToRelativeRowAndOriginIndexMap.end()){
+                colToRelativeRowAndOriginIndexMap[col] = {relativeRowAndOriginIndex};
+            }
+            else{
+                findIter->second.push_back(relativeRowAndOriginIndex);
             }
         }
+    }
 
-        UIN count = 0;
-        const UIN startSparsePartIndex = bsmr.sparseValueOffsets()[rowPanelId];
-        // Iterate over the sparse columns in the row panel
-        for (int indexOfReorderedCols = bsmr.sparseColOffsets()[rowPanelId];
-             indexOfReorderedCols < bsmr.sparseColOffsets()[rowPanelId + 1]; ++indexOfReorderedCols){
-            const UIN col = bsmr.sparseCols()[indexOfReorderedCols];
+    UIN count = 0;
+    const UIN startSparsePartIndex = bsmr.sparseValueOffsets()[rowPanelId];
+    // Iterate over the sparse columns in the row panel
+    for (UIN indexOfReorderedCols = bsmr.sparseColOffsets()[rowPanelId];
+         indexOfReorderedCols < bsmr.sparseColOffsets()[rowPanelId + 1]; ++indexOfReorderedCols){
+        const UIN col = bsmr.sparseCols()[indexOfReorderedCols];
+
+        const auto findIter = colToRelativeRowAndOriginIndexMap.find(col);
+        if (findIter != colToRelativeRowAndOriginIndexMap.end()){
+            for (const std::array<UIN, 2>& iter : findIter->second){
+                sparseRelativeRows[startSparsePartIndex + count] = iter[0];
+                sparseValues[startSparsePartIndex + count] = iter[1];
+                sparseColIndices[startSparsePartIndex + count] = col;
+
+                ++count;
+            }
+        }
+    }
+}
 
-            const auto findIter = colToRelativeRowAndOriginIndexMap.find(col);
-            if (findIter != colToRelativeRowAndOriginIndexMap.end()){
-                for (const std::array<UIN, 2>& iter : findIter->second){
-                    sparseRelativeRows[startSparsePartIndex + count] = iter[0];
-                    sparseValues[startSparsePartIndex + count] = iter[1];
-                    sparseColIndices[startSparsePartIndex + count] = col;
+void RPHM::initializeThreadBlocks(const BSMR& bsmr){
+    std::vector<UIN>& denseRowPanelIds = hostArrays_.denseRowPanelIds;
+    std::vector<UIN>& denseColBlockIters = hostArrays_.denseColBlockIters;
+    denseRowPanelIds.clear();
+    denseColBlockIters.clear();
 
-                    ++count;
-                }
-            }
+    maxNumDenseColBlocksInRowPanel_ = 0;
+    numDenseThreadBlocks_ = 0;
+    // #pragma omp parallel for reduction(max : maxNumDenseColBlocksInRowPanel_) reduction(+: numDenseThreadBlocks_)
+    for (int rowPanelId = 0; rowPanelId < numRowPanels_; ++rowPanelId){
+        const UIN numBlocksCurrentRowPanel = std::ceil(
+            static_cast<float>(bsmr.denseColOffsets()[rowPanelId + 1] - bsmr.denseColOffsets()[rowPanelId])
+            / BLOCK_COL_SIZE);
+        maxNumDenseColBlocksInRowPanel_ = std::max(maxNumDenseColBlocksInRowPanel_, numBlocksCurrentRowPanel);
+        const UIN numDenseThreadBlocksCurrentRowPanel = std::ceil(
+            static_cast<float>(numBlocksCurrentRowPanel) / each_thread_block_counts_the_number_Of_dense_blocks);
+        std::vector<UIN> rowPanelIdsCurrentRowPanel(numDenseThreadBlocksCurrentRowPanel);
+        std::vector<UIN> colBlockItersCurrentRowPanel(numDenseThreadBlocksCurrentRowPanel);
+        for (int i = 0; i < numDenseThreadBlocksCurrentRowPanel; ++i){
+            rowPanelIdsCurrentRowPanel[i] = rowPanelId;
+            colBlockItersCurrentRowPanel[i] = bsmr.denseColOffsets()[rowPanelId] / BLOCK_COL_SIZE +
+                i * each_thread_block_counts_the_number_Of_dense_blocks;
         }
+        denseRowPanelIds.insert(denseRowPanelIds.end(), rowPanelIdsCurrentRowPanel.begin(),
+                                rowPanelIdsCurrentRowPanel.end());
+        denseColBlockIters.insert(denseColBlockIters.end(), colBlockItersCurrentRowPanel.begin(),
+                                  colBlockItersCurrentRowPanel.end());
+
+        numDenseThreadBlocks_ += numDenseThreadBlocksCurrentRowPanel;
     }
 
-    std::vector<UIN> sparseRowPanelIds;
-    std::vector<UIN> sparseColBlockIters;
+    std::vector<UIN>& sparseRowPanelIds = hostArrays_.sparseRowPanelIds;
+    std::vector<UIN>& sparseColBlockIters = hostArrays_.sparseColBlockIters;
+    sparseRowPanelIds.clear();
+    sparseColBlockIters.clear();
 
     maxNumSparseColBlocksInRowPanel_ = 0;
     numSparseThreadBlocks_ = 0;
@@ -244,34 +606,353 @@ RPHM::RPHM(const sparseMatrix::CSR<float>& matrix, const BSMR& bsmr){
         sparseColBlockIters.insert(sparseColBlockIters.end(), colBlockItersCurrentRowPanel.begin(),
                                    colBlockItersCurrentRowPanel.end());
     }
+}
 
-    timeCalculator.endClock();
-    float rphm_time = timeCalculator.getTime();
-    // printf("rphm time : %f ms\n", rphm_time);
-
-    // Copy data to device
-    h2d(denseRowPanelIds_, denseRowPanelIds);
-    h2d(denseColBlockIters_, denseColBlockIters);
-    h2d(sparseRowPanelIds_, sparseRowPanelIds);
-    h2d(sparseColBlockIters_, sparseColBlockIters);
-    h2d(reorderedRows_, bsmr.reorderedRows());
-    h2d(denseCols_, bsmr.denseCols());
-    h2d(blockOffsets_, blockOffsets);
-    h2d(blockValues_, blockValues);
-    h2d(sparseValueOffsets_, bsmr.sparseValueOffsets());
-    h2d(sparseValues_, sparseValues);
-    h2d(sparseRelativeRows_, sparseRelativeRows);
-    h2d(sparseColIndices_, sparseColIndices);
+void RPHM::update(const sparseMatrix::CSR<float>& matrix,
+                  const BSMR& bsmr,
+                  const PatternDelta& delta,
+                  const BSMR::Update& update){
+    if (update.isRebuilt){
+        initialize(matrix, bsmr);
+        return;
+    }
+
+    // The row offsets before the change, from the numbers of inserted and removed nonzeros of each row
+    std::vector<UIN> oldRowOffsets(matrix.row() + 1);
+    for (UIN row = 0; row < matrix.row(); ++row){
+        oldRowOffsets[row + 1] = matrix.rowOffsets()[row + 1] - matrix.rowOffsets()[row];
+    }
+    for (const UIN row : delta.insertedRows){
+        --oldRowOffsets[row + 1];
+    }
+    for (const UIN row : delta.removedRows){
+        ++oldRowOffsets[row + 1];
+    }
+    std::partial_sum(oldRowOffsets.begin(), oldRowOffsets.end(), oldRowOffsets.begin());
+    // The index of an element of `row` before the change plus the shift is its index after the change
+    auto shiftOf = [&](const UIN row){
+        return matrix.rowOffsets()[row] - oldRowOffsets[row];
+    };
+
+    const HostArrays oldHostArrays = std::move(hostArrays_);
+    hostArrays_ = HostArrays();
+    initializeRowPanelOffsets(bsmr);
+
+    std::vector<char> isRowPanelUpdated(numRowPanels_, 0);
+    for (const UIN rowPanelId : update.updatedRowPanels){
+        isRowPanelUpdated[rowPanelId] = 1;
+    }
+
+    // The row panels that are not updated have the same rows and columns, their tiles are moved
+#pragma omp parallel for schedule(dynamic)
+    for (int rowPanelId = 0; rowPanelId < numRowPanels_; ++rowPanelId){
+        if (isRowPanelUpdated[rowPanelId]){
+            tileRowPanel(matrix, bsmr, rowPanelId);
+            continue;
+        }
+
+        const UIN startIndexOfOldBlockValues = oldHostArrays.blockOffsets[rowPanelId] * BLOCK_SIZE;
+        const UIN endIndexOfOldBlockValues = oldHostArrays.blockOffsets[rowPanelId + 1] * BLOCK_SIZE;
+        const UIN startIndexOfBlockValues = hostArrays_.blockOffsets[rowPanelId] * BLOCK_SIZE;
+        for (UIN idx = startIndexOfOldBlockValues; idx < endIndexOfOldBlockValues; ++idx){
+            const UIN value = oldHostArrays.blockValues[idx];
+            if (value == NULL_VALUE){
+                continue;
+            }
+            const UIN localRowId = (idx - startIndexOfOldBlockValues) % BLOCK_SIZE / BLOCK_COL_SIZE;
+            const UIN row = bsmr.reorderedRows()[rowPanelId * ROW_PANEL_SIZE + localRowId];
+            hostArrays_.blockValues[startIndexOfBlockValues + idx - startIndexOfOldBlockValues] = value + shiftOf(row);
+        }
+
+        const UIN startIndexOfOldSparseValues = oldHostArrays.sparseValueOffsets[rowPanelId];
+        const UIN endIndexOfOldSparseValues = oldHostArrays.sparseValueOffsets[rowPanelId + 1];
+        const UIN startIndexOfSparseValues = bsmr.sparseValueOffsets()[rowPanelId];
+        for (UIN idx = startIndexOfOldSparseValues; idx < endIndexOfOldSparseValues; ++idx){
+            const UIN localRowId = oldHostArrays.sparseRelativeRows[idx];
+            const UIN row = bsmr.reorderedRows()[rowPanelId * ROW_PANEL_SIZE + localRowId];
+            const UIN newIdx = startIndexOfSparseValues + idx - startIndexOfOldSparseValues;
+            hostArrays_.sparseRelativeRows[newIdx] = localRowId;
+            hostArrays_.sparseValues[newIdx] = oldHostArrays.sparseValues[idx] + shiftOf(row);
+            hostArrays_.sparseColIndices[newIdx] = oldHostArrays.sparseColIndices[idx];
+        }
+    }
+    initializeThreadBlocks(bsmr);
+
+    hostArrays_.reorderedRows = bsmr.reorderedRows();
+    hostArrays_.denseCols = bsmr.denseCols();
+    hostArrays_.sparseValueOffsets = bsmr.sparseValueOffsets();
+
+    isOnDevice_ = false;
+}
+
+void RPHM::copyToDevice() const{
+    if (isOnDevice_){
+        return;
+    }
+    h2d(denseRowPanelIds_, hostArrays_.denseRowPanelIds);
+    h2d(denseColBlockIters_, hostArrays_.denseColBlockIters);
+    h2d(sparseRowPanelIds_, hostArrays_.sparseRowPanelIds);
+    h2d(sparseColBlockIters_, hostArrays_.sparseColBlockIters);
+    h2d(reorderedRows_, hostArrays_.reorderedRows);
+    h2d(denseCols_, hostArrays_.denseCols);
+    h2d(blockOffsets_, hostArrays_.blockOffsets);
+    h2d(blockValues_, hostArrays_.blockValues);
+    h2d(sparseValueOffsets_, hostArrays_.sparseValueOffsets);
+    h2d(sparseValues_, hostArrays_.sparseValues);
+    h2d(sparseRelativeRows_, hostArrays_.sparseRelativeRows);
+    h2d(sparseColIndices_, hostArrays_.sparseColIndices);
+    isOnDevice_ = true;
+}
+
+namespace{
+/**
+ * Header of the binary RPHM file. The tile constants, the matrix and the reordering parameters are recorded,
+ * so a stale file is rejected.
+ **/
+struct RphmBinaryFileHeader{
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrderMark;
+    uint32_t indexBytes;
+    uint32_t blockSize;
+    uint32_t rowPanelSize;
+    uint32_t blockColSize;
+    uint32_t numDenseBlocksEachThreadBlock;
+    uint32_t numSparseDataEachThreadBlock;
+    uint64_t row;
+    uint64_t col;
+    uint64_t nnz;
+    uint64_t structureHash;
+    uint64_t numRowPanels;
+    uint64_t maxNumDenseColBlocksInRowPanel;
+    uint64_t maxNumSparseColBlocksInRowPanel;
+    uint64_t numDenseThreadBlocks;
+    uint64_t numSparseThreadBlocks;
+    uint64_t arraySizes[12];
+    float similarityThreshold;
+    float blockDensityThreshold;
+    uint32_t rowReorderingEngine;
+    uint32_t numClusters;
+    char reserved[32];
+};
+static_assert(sizeof(RphmBinaryFileHeader) == 256, "The binary RPHM file header must be 256 bytes");
+
+constexpr char rphmBinaryFileMagic[8] = {'B', 'S', 'M', 'R', 'R', 'P', 'H', 'M'};
+constexpr uint32_t rphmBinaryFileVersion = 2;
+constexpr uint32_t rphmBinaryFileByteOrderMark = 0x01020304;
+constexpr uint64_t rphmBinaryFileSectionAlignment = 64;
+
+uint64_t alignToRphmBinaryFileSection(const uint64_t offset){
+    return (offset + rphmBinaryFileSectionAlignment - 1) / rphmBinaryFileSectionAlignment
+        * rphmBinaryFileSectionAlignment;
+}
+
+// Arrays in the order of the file sections
+template <typename HostArrays>
+auto getRphmHostArrays(HostArrays& hostArrays){
+    return std::array<decltype(&hostArrays.reorderedRows), 12>{&hostArrays.reorderedRows, &hostArrays.denseCols, &hostArrays.blockOffsets, &hostArrays.blockValues,
+            &hostArrays.sparseValueOffsets, &hostArrays.sparseValues, &hostArrays.sparseRelativeRows,
+            &hostArrays.sparseColIndices, &hostArrays.denseRowPanelIds, &hostArrays.denseColBlockIters,
+            &hostArrays.sparseRowPanelIds, &hostArrays.sparseColBlockIters};
+}
+
+// Every element is less than `bound`, or is NULL_VALUE if `allowNullValue`
+bool isAllLessThan(const std::vector<UIN>& array, const UIN bound, const bool allowNullValue = false){
+    bool isValid = true;
+#pragma omp parallel for reduction(&& : isValid)
+    for (size_t idx = 0; idx < array.size(); ++idx){
+        isValid = isValid && (array[idx] < bound || (allowNullValue && array[idx] == NULL_VALUE));
+    }
+    return isValid;
+}
+
+// Offsets of `numRowPanels` row panels into an array of `size` elements
+bool isRowPanelOffsetsValid(const std::vector<UIN>& offsets, const UIN numRowPanels, const size_t size){
+    return offsets.size() == static_cast<size_t>(numRowPanels) + 1 && offsets.front() == 0
+        && offsets.back() == size && std::is_sorted(offsets.begin(), offsets.end());
+}
+} // namespace
+
+bool RPHM::initializeFromBinaryFile(const std::string& file,
+                                    const sparseMatrix::CSR<float>& matrix,
+                                    const float similarityThreshold,
+                                    const float blockDensityThreshold,
+                                    const RowReorderingEngine rowReorderingEngine){
+    MappedFile mappedFile;
+    if (!mappedFile.open(file, true)){
+        std::cerr << "Error, file cannot be opened : " << file << std::endl;
+        return false;
+    }
+
+    std::cout << "RPHM initialize from file : " << file << std::endl;
+
+    // Check header
+    RphmBinaryFileHeader header;
+    if (mappedFile.size() < sizeof(RphmBinaryFileHeader)){
+        std::cerr << "Error, file " << file << " format is incorrect!" << std::endl;
+        return false;
+    }
+    std::memcpy(&header, mappedFile.data(), sizeof(RphmBinaryFileHeader));
+    if (std::memcmp(header.magic, rphmBinaryFileMagic, sizeof(rphmBinaryFileMagic)) != 0){
+        std::cerr << "Error, file " << file << " format is incorrect!" << std::endl;
+        return false;
+    }
+    if (header.version != rphmBinaryFileVersion || header.byteOrderMark != rphmBinaryFileByteOrderMark
+        || header.indexBytes != sizeof(UIN)){
+        std::cerr << "Error, file " << file << " version, byte order or index type is not supported!" << std::endl;
+        return false;
+    }
+    if (header.blockSize != BLOCK_SIZE || header.rowPanelSize != ROW_PANEL_SIZE
+        || header.blockColSize != BLOCK_COL_SIZE
+        || header.numDenseBlocksEachThreadBlock != each_thread_block_counts_the_number_Of_dense_blocks
+        || header.numSparseDataEachThreadBlock != sddmm_sparse_block_each_thread_block_counts_the_number_Of_data){
+        std::cerr << "Error, file " << file << " was built with other tile constants!" << std::endl;
+        return false;
+    }
+    if (header.row != matrix.row() || header.col != matrix.col() || header.nnz != matrix.nnz()
+        || header.structureHash != matrix.structureHash()){
+        std::cerr << "Error, file " << file << " was built for another matrix!" << std::endl;
+        return false;
+    }
+    if (header.similarityThreshold != similarityThreshold || header.blockDensityThreshold != blockDensityThreshold
+        || header.rowReorderingEngine != static_cast<uint32_t>(rowReorderingEngine)){
+        std::cerr << "Error, file " << file << " was built with another alpha, delta or row reordering engine!"
+            << std::endl;
+        return false;
+    }
+    if (header.numRowPanels >= NULL_VALUE || header.numDenseThreadBlocks >= NULL_VALUE
+        || header.numSparseThreadBlocks >= NULL_VALUE){
+        std::cerr << "Error, file " << file << " format is incorrect!" << std::endl;
+        return false;
+    }
+
+    // Copy sections
+    HostArrays hostArrays;
+    uint64_t offset = sizeof(RphmBinaryFileHeader);
+    const auto arrays = getRphmHostArrays(hostArrays);
+    for (size_t arrayId = 0; arrayId < arrays.size(); ++arrayId){
+        offset = alignToRphmBinaryFileSection(offset);
+        const uint64_t size = header.arraySizes[arrayId];
+        if (offset > mappedFile.size() || size > (mappedFile.size() - offset) / sizeof(UIN)){
+            std::cerr << "Error, file " << file << " is truncated!" << std::endl;
+            return false;
+        }
+        arrays[arrayId]->resize(size);
+        std::memcpy(arrays[arrayId]->data(), mappedFile.data() + offset, size * sizeof(UIN));
+        offset += size * sizeof(UIN);
+    }
+
+    // Every index is checked, so a corrupted file never makes the kernels access out of bounds.
+    // The dense columns of a row panel are padded to a multiple of BLOCK_COL_SIZE with the number of columns
+    const UIN numRowPanels = header.numRowPanels;
+    const UIN numDenseColBlocks = hostArrays.denseCols.size() / BLOCK_COL_SIZE + 1;
+    const bool isValid =
+        isRowPanelOffsetsValid(hostArrays.blockOffsets, numRowPanels, hostArrays.blockValues.size() / BLOCK_SIZE)
+        && hostArrays.blockValues.size() % BLOCK_SIZE == 0
+        && hostArrays.denseCols.size() == hostArrays.blockValues.size() / BLOCK_SIZE * BLOCK_COL_SIZE
+        && isRowPanelOffsetsValid(hostArrays.sparseValueOffsets, numRowPanels, hostArrays.sparseValues.size())
+        && hostArrays.sparseRelativeRows.size() == hostArrays.sparseValues.size()
+        && hostArrays.sparseColIndices.size() == hostArrays.sparseValues.size()
+        && (hostArrays.reorderedRows.size() + ROW_PANEL_SIZE - 1) / ROW_PANEL_SIZE == numRowPanels
+        && hostArrays.denseRowPanelIds.size() == header.numDenseThreadBlocks
+        && hostArrays.denseColBlockIters.size() == header.numDenseThreadBlocks
+        && hostArrays.sparseRowPanelIds.size() == header.numSparseThreadBlocks
+        && hostArrays.sparseColBlockIters.size() == header.numSparseThreadBlocks
+        && isAllLessThan(hostArrays.reorderedRows, matrix.row())
+        && isAllLessThan(hostArrays.denseCols, matrix.col() + 1)
+        && isAllLessThan(hostArrays.blockValues, matrix.nnz(), true)
+        && isAllLessThan(hostArrays.sparseValues, matrix.nnz())
+        && isAllLessThan(hostArrays.sparseRelativeRows, ROW_PANEL_SIZE)
+        && isAllLessThan(hostArrays.sparseColIndices, matrix.col())
+        && isAllLessThan(hostArrays.denseRowPanelIds, numRowPanels)
+        && isAllLessThan(hostArrays.denseColBlockIters, numDenseColBlocks)
+        && isAllLessThan(hostArrays.sparseRowPanelIds, numRowPanels)
+        && isAllLessThan(hostArrays.sparseColBlockIters, hostArrays.sparseValues.size() + 1);
+    if (!isValid){
+        std::cerr << "Error, file " << file << " data is incorrect!" << std::endl;
+        return false;
+    }
+
+    numRowPanels_ = numRowPanels;
+    maxNumDenseColBlocksInRowPanel_ = header.maxNumDenseColBlocksInRowPanel;
+    maxNumSparseColBlocksInRowPanel_ = header.maxNumSparseColBlocksInRowPanel;
+    numDenseThreadBlocks_ = header.numDenseThreadBlocks;
+    numSparseThreadBlocks_ = header.numSparseThreadBlocks;
+    similarityThreshold_ = header.similarityThreshold;
+    blockDensityThreshold_ = header.blockDensityThreshold;
+    rowReorderingEngine_ = rowReorderingEngine;
+    numClusters_ = header.numClusters;
+    hostArrays_ = std::move(hostArrays);
+    isOnDevice_ = false;
+
+    return true;
+}
+
+bool RPHM::outputToBinaryFile(const std::string& file, const sparseMatrix::CSR<float>& matrix) const{
+    RphmBinaryFileHeader header{};
+    std::memcpy(header.magic, rphmBinaryFileMagic, sizeof(rphmBinaryFileMagic));
+    header.version = rphmBinaryFileVersion;
+    header.byteOrderMark = rphmBinaryFileByteOrderMark;
+    header.indexBytes = sizeof(UIN);
+    header.blockSize = BLOCK_SIZE;
+    header.rowPanelSize = ROW_PANEL_SIZE;
+    header.blockColSize = BLOCK_COL_SIZE;
+    header.numDenseBlocksEachThreadBlock = each_thread_block_counts_the_number_Of_dense_blocks;
+    header.numSparseDataEachThreadBlock = sddmm_sparse_block_each_thread_block_counts_the_number_Of_data;
+    header.row = matrix.row();
+    header.col = matrix.col();
+    header.nnz = matrix.nnz();
+    header.structureHash = matrix.structureHash();
+    header.numRowPanels = numRowPanels_;
+    header.maxNumDenseColBlocksInRowPanel = maxNumDenseColBlocksInRowPanel_;
+    header.maxNumSparseColBlocksInRowPanel = maxNumSparseColBlocksInRowPanel_;
+    header.numDenseThreadBlocks = numDenseThreadBlocks_;
+    header.numSparseThreadBlocks = numSparseThreadBlocks_;
+    header.similarityThreshold = similarityThreshold_;
+    header.blockDensityThreshold = blockDensityThreshold_;
+    header.rowReorderingEngine = static_cast<uint32_t>(rowReorderingEngine_);
+    header.numClusters = numClusters_;
+
+    const auto arrays = getRphmHostArrays(hostArrays_);
+    for (size_t arrayId = 0; arrayId < arrays.size(); ++arrayId){
+        header.arraySizes[arrayId] = arrays[arrayId]->size();
+    }
+
+    std::ofstream outfile(file, std::ios::binary);
+    if (!outfile.is_open()){
+        std::cerr << "Unable to create file: " << file << std::endl;
+        return false;
+    }
+
+    const char padding[rphmBinaryFileSectionAlignment] = {};
+    outfile.write(reinterpret_cast<const char*>(&header), sizeof(RphmBinaryFileHeader));
+    uint64_t offset = sizeof(RphmBinaryFileHeader);
+    for (const std::vector<UIN>* array : arrays){
+        const uint64_t sectionOffset = alignToRphmBinaryFileSection(offset);
+        outfile.write(padding, sectionOffset - offset);
+        outfile.write(reinterpret_cast<const char*>(array->data()), array->size() * sizeof(UIN));
+        offset = sectionOffset + array->size() * sizeof(UIN);
+    }
+
+    outfile.close();
+    if (!outfile){
+        std::cerr << "Error, failed to write file: " << file << std::endl;
+        return false;
+    }
+
+    return true;
 }
 
 UIN RPHM::getNumSparseBlocks() const{
-    return sparseValueOffsets().back_data()
+    if (hostArrays_.sparseValueOffsets.empty()){
+        return 0;
+    }
+    return hostArrays_.sparseValueOffsets.back()
         / static_cast<float>(sddmm_sparse_block_each_thread_block_counts_the_number_Of_data);
 }
 
 UIN RPHM::calculateRowPanelIdByBlockValuesIndex(UIN blockValueIndex) const{
-    std::vector<UIN> blockOffsets;
-    d2h(blockOffsets, blockOffsets_);
+    const std::vector<UIN>& blockOffsets = hostArrays_.blockOffsets;
 
     UIN rowPanelId = 0;
     while (rowPanelId + 1 < blockOffsets.size()){
@@ -285,7 +966,7 @@ UIN RPHM::calculateRowPanelIdByBlockValuesIndex(UIN blockValueIndex) const{
 
 std::pair<UIN, UIN> RPHM::calculateLocalRowColByBlockValueIndex(UIN blockValueIndex) const{
     const UIN rowPanelId = calculateRowPanelIdByBlockValuesIndex(blockValueIndex);
-    const UIN startIndexOfBlockValuesCurrentRowPanel = blockOffsets()[rowPanelId] * BLOCK_SIZE;
+    const UIN startIndexOfBlockValuesCurrentRowPanel = hostArrays_.blockOffsets[rowPanelId] * BLOCK_SIZE;
     const UIN localIndex = (blockValueIndex - startIndexOfBlockValuesCurrentRowPanel) % BLOCK_SIZE;
     const UIN localRowId = localIndex / BLOCK_COL_SIZE;
     const UIN localColId = localIndex % BLOCK_COL_SIZE;
@@ -293,12 +974,9 @@ std::pair<UIN, UIN> RPHM::calculateLocalRowColByBlockValueIndex(UIN blockValueIn
 }
 
 std::pair<UIN, UIN> RPHM::calculateRowColByBlockValueIndex(UIN blockValueIndex) const{
-    std::vector<UIN> blockOffsets;
-    std::vector<UIN> reorderedRows;
-    std::vector<UIN> denseCols;
-    d2h(blockOffsets, blockOffsets_);
-    d2h(reorderedRows, reorderedRows_);
-    d2h(denseCols, denseCols_);
+    const std::vector<UIN>& blockOffsets = hostArrays_.blockOffsets;
+    const std::vector<UIN>& reorderedRows = hostArrays_.reorderedRows;
+    const std::vector<UIN>& denseCols = hostArrays_.denseCols;
 
     const UIN rowPanelId = calculateRowPanelIdByBlockValuesIndex(blockValueIndex);
 
@@ -322,8 +1000,7 @@ std::pair<UIN, UIN> RPHM::calculateRowColByBlockValueIndex(UIN blockValueIndex)
 }
 
 UIN RPHM::calculateColBlockIdByBlockValueIndex(UIN blockValueIndex) const{
-    std::vector<UIN> blockOffsets;
-    d2h(blockOffsets, blockOffsets_);
+    const std::vector<UIN>& blockOffsets = hostArrays_.blockOffsets;
 
     const UIN rowPanel = calculateRowPanelIdByBlockValuesIndex(blockValueIndex);
     const UIN startIndexOfBlockValueCurrentRowPanel = blockOffsets[rowPanel] * BLOCK_SIZE;
@@ -332,10 +1009,8 @@ UIN RPHM::calculateColBlockIdByBlockValueIndex(UIN blockValueIndex) const{
 }
 
 float RPHM::calculateDenseBlockAverageDensity() const{
-    std::vector<UIN> blockOffsets;
-    std::vector<UIN> blockValues;
-    d2h(blockOffsets, blockOffsets_);
-    d2h(blockValues, blockValues_);
+    const std::vector<UIN>& blockOffsets = hostArrays_.blockOffsets;
+    const std::vector<UIN>& blockValues = hostArrays_.blockValues;
 
     float totalDensity = 0.0f;
 #pragma omp parallel for reduction(+ : totalDensity)
@@ -343,7 +1018,7 @@ float RPHM::calculateDenseBlockAverageDensity() const{
         const UIN startIndexOfBlockValuesCurrentRowPanel = blockOffsets[rowPanelId] * BLOCK_SIZE;
         const UIN endIndexOfBlockValuesCurrentRowPanel = blockOffsets[rowPanelId + 1] * BLOCK_SIZE;
         UIN numNonZero = 0;
-        for (int idxOfBlockValues = startIndexOfBlockValuesCurrentRowPanel;
+        for (UIN idxOfBlockValues = startIndexOfBlockValuesCurrentRowPanel;
              idxOfBlockValues < endIndexOfBlockValuesCurrentRowPanel; ++idxOfBlockValues){
             if (blockValues[idxOfBlockValues] != NULL_VALUE){
                 ++numNonZero;
@@ -359,10 +1034,8 @@ float RPHM::calculateDenseBlockAverageDensity() const{
 }
 
 std::pair<float, float> RPHM::calculateMaxMinDensity() const{
-    std::vector<UIN> blockOffsets;
-    std::vector<UIN> blockValues;
-    d2h(blockOffsets, blockOffsets_);
-    d2h(blockValues, blockValues_);
+    const std::vector<UIN>& blockOffsets = hostArrays_.blockOffsets;
+    const std::vector<UIN>& blockValues = hostArrays_.blockValues;
 
     float maxDensity = std::numeric_limits<float>::min();
     float minDensity = std::numeric_limits<float>::max();
@@ -372,7 +1045,7 @@ std::pair<float, float> RPHM::calculateMaxMinDensity() const{
         const UIN startIndexOfBlockValuesCurrentRowPanel = blockOffsets[rowPanelId] * BLOCK_SIZE;
         const UIN endIndexOfBlockValuesCurrentRowPanel = blockOffsets[rowPanelId + 1] * BLOCK_SIZE;
         UIN numNonZero = 0;
-        for (int idxOfBlockValues = startIndexOfBlockValuesCurrentRowPanel;
+        for (UIN idxOfBlockValues = startIndexOfBlockValuesCurrentRowPanel;
              idxOfBlockValues < endIndexOfBlockValuesCurrentRowPanel; ++idxOfBlockValues){
             if (blockValues[idxOfBlockValues] != NULL_VALUE){
                 ++numNonZero;
@@ -391,10 +1064,8 @@ std::pair<float, float> RPHM::calculateMaxMinDensity() const{
 }
 
 std::pair<float, UIN> RPHM::calculateDensityMode() const{
-    std::vector<UIN> blockOffsets;
-    std::vector<UIN> blockValues;
-    d2h(blockOffsets, blockOffsets_);
-    d2h(blockValues, blockValues_);
+    const std::vector<UIN>& blockOffsets = hostArrays_.blockOffsets;
+    const std::vector<UIN>& blockValues = hostArrays_.blockValues;
 
     constexpr UIN numberOfDecimalPlacesToRetain = 3;
     const UIN divisor = static_cast<UIN>(std::pow(10, numberOfDecimalPlacesToRetain));
@@ -405,7 +1076,7 @@ std::pair<float, UIN> RPHM::calculateDensityMode() const{
         const UIN startIndexOfBlockValuesCurrentRowPanel = blockOffsets[rowPanelId] * BLOCK_SIZE;
         const UIN endIndexOfBlockValuesCurrentRowPanel = blockOffsets[rowPanelId + 1] * BLOCK_SIZE;
         UIN numNonZero = 0;
-        for (int idxOfBlockValues = startIndexOfBlockValuesCurrentRowPanel;
+        for (UIN idxOfBlockValues = startIndexOfBlockValuesCurrentRowPanel;
              idxOfBlockValues < endIndexOfBlockValuesCurrentRowPanel; ++idxOfBlockValues){
             if (blockValues[idxOfBlockValues] != NULL_VALUE){
                 ++numNonZero;
@@ -443,10 +1114,10 @@ std::pair<float, UIN> RPHM::calculateDensityMode() const{
 
 bool check_rowReordering(const sparseMatrix::CSR<float>& matrix, const RPHM& rphm){
     std::vector<UIN> reorderedRows;
-    d2h(reorderedRows, rphm.reorderedRows());
+    reorderedRows = rphm.hostArrays().reorderedRows;
 
     std::unordered_map<UIN, UIN> rowToIndexOfReorderedRowsMap;
-    for (int indexOfReorderedRows = 0; indexOfReorderedRows < reorderedRows.size();
+    for (UIN indexOfReorderedRows = 0; indexOfReorderedRows < reorderedRows.size();
          ++indexOfReorderedRows){
         const UIN row = reorderedRows[indexOfReorderedRows];
 
@@ -459,7 +1130,7 @@ bool check_rowReordering(const sparseMatrix::CSR<float>& matrix, const RPHM& rph
         rowToIndexOfReorderedRowsMap[row] = indexOfReorderedRows;
     }
 
-    for (int row = 0; row < matrix.row(); ++row){
+    for (UIN row = 0; row < matrix.row(); ++row){
         const UIN numColIndices = matrix.rowOffsets()[row + 1] - matrix.rowOffsets()[row];
 
         if (numColIndices == 0){
@@ -495,11 +1166,11 @@ bool check_colReordering(const sparseMatrix::CSR<float>& matrix,
     std::vector<UIN> sparseRelativeRows;
     std::vector<UIN> sparseColIndices;
 
-    d2h(reorderedRows, rphm.reorderedRows());
-    d2h(denseCols, rphm.denseCols());
-    d2h(sparseValueOffsets, rphm.sparseValueOffsets());
-    d2h(sparseRelativeRows, rphm.sparseRelativeRows());
-    d2h(sparseColIndices, rphm.sparseColIndices());
+    reorderedRows = rphm.hostArrays().reorderedRows;
+    denseCols = rphm.hostArrays().denseCols;
+    sparseValueOffsets = rphm.hostArrays().sparseValueOffsets;
+    sparseRelativeRows = rphm.hostArrays().sparseRelativeRows;
+    sparseColIndices = rphm.hostArrays().sparseColIndices;
 
     for (int rowPanelId = 0; rowPanelId < rphm.numRowPanels(); ++rowPanelId){
         const UIN startIdxOfReorderedRowIndicesCurrentRowPanel = rowPanelId * ROW_PANEL_SIZE;
@@ -510,7 +1181,7 @@ bool check_colReordering(const sparseMatrix::CSR<float>& matrix,
         // Count the number of non-zero elements for each column segment, and store the row and column indices in the current row panel
         std::unordered_map<UIN, UIN> colToNumOfNonZeroMap;
         std::unordered_set<UIN> rowIndicesCurrentRowPanelSet;
-        for (int reorderedRowIndex = startIdxOfReorderedRowIndicesCurrentRowPanel;
+        for (UIN reorderedRowIndex = startIdxOfReorderedRowIndicesCurrentRowPanel;
              reorderedRowIndex < endIdxOfReorderedRowIndicesCurrentRowPanel;
              ++reorderedRowIndex){
             // Loop through the rows in this row panel
@@ -531,7 +1202,7 @@ bool check_colReordering(const sparseMatrix::CSR<float>& matrix,
 
         // check dense column segment
         std::unordered_set<UIN> denseColIndicesRecordSet;
-        for (int idxOfReorderedColIndices = bsmr.denseColOffsets()[rowPanelId];
+        for (UIN idxOfReorderedColIndices = bsmr.denseColOffsets()[rowPanelId];
              idxOfReorderedColIndices < bsmr.denseColOffsets()[rowPanelId + 1];
              ++idxOfReorderedColIndices){
             const UIN col = denseCols[idxOfReorderedColIndices];
@@ -561,7 +1232,7 @@ bool check_colReordering(const sparseMatrix::CSR<float>& matrix,
         // check sparse column segment
         std::unordered_set<UIN> sparseColIndicesRecordSet;
         int numConsecutiveDenseCols = 0;
-        for (int idxOfReorderedColIndices = bsmr.sparseColOffsets()[rowPanelId];
+        for (UIN idxOfReorderedColIndices = bsmr.sparseColOffsets()[rowPanelId];
              idxOfReorderedColIndices < bsmr.sparseColOffsets()[rowPanelId + 1];
              ++idxOfReorderedColIndices){
             const UIN col = bsmr.sparseCols()[idxOfReorderedColIndices];
@@ -592,7 +1263,7 @@ bool check_colReordering(const sparseMatrix::CSR<float>& matrix,
         }
 
         // check sparse part data
-        for (int idx = sparseValueOffsets[rowPanelId];
+        for (UIN idx = sparseValueOffsets[rowPanelId];
              idx < sparseValueOffsets[rowPanelId + 1];
              ++idx){
             const UIN relativeRow = sparseRelativeRows[idx];
@@ -650,18 +1321,18 @@ bool check_rphm(const sparseMatrix::CSR<float>& matrix, const RPHM& rphm){
     std::vector<UIN> sparseRelativeRows;
     std::vector<UIN> sparseColIndices;
 
-    // Copy data from device to host
-    d2h(reorderedRows, rphm.reorderedRows());
-    d2h(denseCols, rphm.denseCols());
-    d2h(blockOffsets, rphm.blockOffsets());
-    d2h(blockValues, rphm.blockValues());
-    d2h(sparseValueOffsets, rphm.sparseValueOffsets());
-    d2h(sparseValues, rphm.sparseValues());
-    d2h(sparseRelativeRows, rphm.sparseRelativeRows());
-    d2h(sparseColIndices, rphm.sparseColIndices());
+    // The host copy of the tiling
+    reorderedRows = rphm.hostArrays().reorderedRows;
+    denseCols = rphm.hostArrays().denseCols;
+    blockOffsets = rphm.hostArrays().blockOffsets;
+    blockValues = rphm.hostArrays().blockValues;
+    sparseValueOffsets = rphm.hostArrays().sparseValueOffsets;
+    sparseValues = rphm.hostArrays().sparseValues;
+    sparseRelativeRows = rphm.hostArrays().sparseRelativeRows;
+    sparseColIndices = rphm.hostArrays().sparseColIndices;
 
     // Check if the blockRowOffsets is correct
-    for (int idxOfBlockRowOffsets = 1; idxOfBlockRowOffsets < blockOffsets.size(); ++idxOfBlockRowOffsets){
+    for (UIN idxOfBlockRowOffsets = 1; idxOfBlockRowOffsets < blockOffsets.size(); ++idxOfBlockRowOffsets){
         const UIN rowPanelId = idxOfBlockRowOffsets - 1;
         const UIN numBlockCurrentRowPanel =
             blockOffsets[idxOfBlockRowOffsets] - blockOffsets[idxOfBlockRowOffsets - 1];
@@ -679,21 +1350,21 @@ bool check_rphm(const sparseMatrix::CSR<float>& matrix, const RPHM& rphm){
     for (UIN iter : blockValues){
         // Check if the block value is duplicated
         if (blockValuesSet.find(iter) != blockValuesSet.end() && iter != NULL_VALUE){
-            fprintf(stderr, "Error! The block value is duplicated! val: %d\n", iter);
+            fprintf(stderr, "Error! The block value is duplicated! val: %" PRIuUIN "\n", iter);
             return false;
         }
         blockValuesSet.insert(iter);
     }
 
     std::unordered_map<UIN, UIN> rowToIndexOfReorderedRowsMap;
-    for (int indexOfReorderedRows = 0; indexOfReorderedRows < reorderedRows.size();
+    for (UIN indexOfReorderedRows = 0; indexOfReorderedRows < reorderedRows.size();
          ++indexOfReorderedRows){
         const UIN row = reorderedRows[indexOfReorderedRows];
         rowToIndexOfReorderedRowsMap[row] = indexOfReorderedRows;
     }
 
     std::unordered_map<UIN, UIN> idxOfOriginalMatrixToSparsePartDataIndexMap;
-    for (int idx = 0; idx < sparseValues.size(); ++idx){
+    for (UIN idx = 0; idx < sparseValues.size(); ++idx){
         const UIN originalMatrixIndex = sparseValues[idx];
 
         // Check if the original matrix index is duplicated in sparsePartData
@@ -711,14 +1382,14 @@ bool check_rphm(const sparseMatrix::CSR<float>& matrix, const RPHM& rphm){
     }
 
     // Check based on the original matrix, check if the index of the original matrix is correctly stored in blockValue
-    for (int row = 0; row < matrix.row(); ++row){
+    for (UIN row = 0; row < matrix.row(); ++row){
         if (row + 1 < matrix.rowOffsets().size() && matrix.rowOffsets()[row + 1] - matrix.rowOffsets()[row] == 0){
             continue;
         }
 
         // Check if the row exists in `reorderedRows`
         if (rowToIndexOfReorderedRowsMap.find(row) == rowToIndexOfReorderedRowsMap.end()){
-            fprintf(stderr, "Error! Row does not exist in \"reorderedRows\"! row = %d\n", row);
+            fprintf(stderr, "Error! Row does not exist in \"reorderedRows\"! row = %" PRIuUIN "\n", row);
             return false;
         }
         const UIN indexOfReorderedRows = rowToIndexOfReorderedRowsMap[row];
@@ -727,14 +1398,14 @@ bool check_rphm(const sparseMatrix::CSR<float>& matrix, const RPHM& rphm){
         const UIN startIndexOfBlockValuesCurrentRowPanel = blockOffsets[rowPanelId] * BLOCK_SIZE;
 
         std::unordered_map<UIN, UIN> colToIndexOfReorderedColsMap_currentRow;
-        for (int indexOfReorderedCols = blockOffsets[rowPanelId] * BLOCK_COL_SIZE;
+        for (UIN indexOfReorderedCols = blockOffsets[rowPanelId] * BLOCK_COL_SIZE;
              indexOfReorderedCols < blockOffsets[rowPanelId + 1] * BLOCK_COL_SIZE;
              ++indexOfReorderedCols){
             const UIN col = denseCols[indexOfReorderedCols];
             colToIndexOfReorderedColsMap_currentRow[col] = indexOfReorderedCols;
         }
 
-        for (int idxOfOriginalMatrix = matrix.rowOffsets()[row];
+        for (UIN idxOfOriginalMatrix = matrix.rowOffsets()[row];
              idxOfOriginalMatrix < matrix.rowOffsets()[row + 1];
              ++idxOfOriginalMatrix){
             const UIN col = matrix.colIndices()[idxOfOriginalMatrix];
@@ -766,7 +1437,7 @@ bool check_rphm(const sparseMatrix::CSR<float>& matrix, const RPHM& rphm){
     }
 
     // Check based on the blockValues, check if the value of blockValue is stored correctly
-    for (int idxOfBlockValues = 0; idxOfBlockValues < blockValues.size(); ++idxOfBlockValues){
+    for (UIN idxOfBlockValues = 0; idxOfBlockValues < blockValues.size(); ++idxOfBlockValues){
         std::pair<UIN, UIN> rowCol = rphm.calculateRowColByBlockValueIndex(idxOfBlockValues);
         const UIN row = rowCol.first;
         const UIN col = rowCol.second;
@@ -782,7 +1453,7 @@ bool check_rphm(const sparseMatrix::CSR<float>& matrix, const RPHM& rphm){
             continue;
         }
 
-        for (int idxOfOriginalMatrix = matrix.rowOffsets()[row]; idxOfOriginalMatrix < matrix.rowOffsets()[row + 1];
+        for (UIN idxOfOriginalMatrix = matrix.rowOffsets()[row]; idxOfOriginalMatrix < matrix.rowOffsets()[row + 1];
              ++idxOfOriginalMatrix){
             if (matrix.colIndices()[idxOfOriginalMatrix] == col){
                 // Check if the value is missing
@@ -823,97 +1494,141 @@ bool check_rphm(const sparseMatrix::CSR<float>& matrix, const RPHM& rphm){
     return true;
 }
 
-void evaluationReordering(const sparseMatrix::CSR<float>& matrix, const BSMR& bsmr, Logger& logger){
+namespace{
+// The statistics of one row panel in `evaluationReordering`
+struct RowPanelEvaluation{
     int numDenseBlocks = 0;
     float totalDensity = 0.0f;
     int numDenseThreadBlocks = 0;
     int numSparseThreadBlocks = 0;
     int numSparseData = 0;
+};
+} // namespace
 
-    // row panel loop
-    for (int rowPanelId = 0; rowPanelId < bsmr.numRowPanels(); ++rowPanelId){
-        const int numDenseBlocksInCurrentRowPanel =
-            std::ceil(
-                (bsmr.denseColOffsets()[rowPanelId + 1] - bsmr.denseColOffsets()[rowPanelId]) /
-                static_cast<float>(BLOCK_COL_SIZE));
-        const int numSparseBlocksInCurrentRowPanel =
-            std::ceil(
-                (bsmr.sparseColOffsets()[rowPanelId + 1] - bsmr.sparseColOffsets()[rowPanelId]) /
-                static_cast<float>(BLOCK_COL_SIZE));
-
-        numDenseThreadBlocks += std::ceil(
-            static_cast<float>(numDenseBlocksInCurrentRowPanel) / each_thread_block_counts_the_number_Of_dense_blocks);
-
-        numSparseThreadBlocks += std::ceil(
-            static_cast<float>(bsmr.sparseValueOffsets()[rowPanelId + 1] - bsmr.sparseValueOffsets()[rowPanelId]) /
-            sddmm_sparse_block_each_thread_block_counts_the_number_Of_data);
-
-        // Maps each block ID to a set of column indices contained in that block
-        std::vector<std::unordered_set<UIN>> blockToColumnSet(
-            numDenseBlocksInCurrentRowPanel + numSparseBlocksInCurrentRowPanel);
-        std::vector<UIN> nnzInEachBlock(
-            numDenseBlocksInCurrentRowPanel + numSparseBlocksInCurrentRowPanel, 0);
-        // dense column segment loop
-        for (int indexOfReorderedCols = bsmr.denseColOffsets()[rowPanelId];
-             indexOfReorderedCols < bsmr.denseColOffsets()[rowPanelId + 1];
-             ++indexOfReorderedCols){
-            const UIN col = bsmr.denseCols()[indexOfReorderedCols];
-
-            // Calculate the block id
-            const UIN startIndexOfColsCurrentRowPanel = bsmr.denseColOffsets()[rowPanelId];
-            const UIN colBlockId = (indexOfReorderedCols - startIndexOfColsCurrentRowPanel) / BLOCK_COL_SIZE;
-
-            blockToColumnSet[colBlockId].insert(col);
-        }
+void evaluationReordering(const sparseMatrix::CSR<float>& matrix, const BSMR& bsmr, Logger& logger){
+    const UIN numRowPanels = bsmr.numRowPanels();
 
-        std::unordered_set<UIN> sparseColIndicesRecordSet;
-        // sparse column segment loop, record sparse column index
-        for (int indexOfReorderedCols = bsmr.sparseColOffsets()[rowPanelId];
-             indexOfReorderedCols < bsmr.sparseColOffsets()[rowPanelId + 1];
-             ++indexOfReorderedCols){
-            const UIN col = bsmr.sparseCols()[indexOfReorderedCols];
-            sparseColIndicesRecordSet.insert(col);
+    // Row panels are balanced by their number of nonzeros, each row panel also costs one
+    std::vector<UIN> weights(numRowPanels);
+#pragma omp parallel for
+    for (UIN rowPanelId = 0; rowPanelId < numRowPanels; ++rowPanelId){
+        const UIN startIndexOfReorderedRows = rowPanelId * ROW_PANEL_SIZE;
+        const UIN endIndexOfReorderedRows =
+            std::min(startIndexOfReorderedRows + ROW_PANEL_SIZE, static_cast<UIN>(bsmr.reorderedRows().size()));
+        UIN weight = 1;
+        for (UIN indexOfReorderedRows = startIndexOfReorderedRows;
+             indexOfReorderedRows < endIndexOfReorderedRows; ++indexOfReorderedRows){
+            const UIN row = bsmr.reorderedRows()[indexOfReorderedRows];
+            weight += matrix.rowOffsets()[row + 1] - matrix.rowOffsets()[row];
         }
+        weights[rowPanelId] = weight;
+    }
+    std::vector<UIN> weightOffsets;
+    scheduler::exclusiveScan(weights, weightOffsets);
+    const std::vector<scheduler::WorkChunk> chunks =
+        scheduler::partition(weightOffsets.data(), numRowPanels, scheduler::defaultNumChunks(), UINT64_MAX);
+
+    // The results are kept for each row panel and added in order, so they do not depend on the schedule
+    std::vector<RowPanelEvaluation> evaluations(numRowPanels);
+    scheduler::run(chunks, [&](const scheduler::WorkChunk& chunk, int){
+        for (UIN rowPanelId = chunk.rowBegin; rowPanelId < chunk.rowEnd; ++rowPanelId){
+            RowPanelEvaluation& evaluation = evaluations[rowPanelId];
+            const int numDenseBlocksInCurrentRowPanel =
+                std::ceil(
+                    (bsmr.denseColOffsets()[rowPanelId + 1] - bsmr.denseColOffsets()[rowPanelId]) /
+                    static_cast<float>(BLOCK_COL_SIZE));
+            const int numSparseBlocksInCurrentRowPanel =
+                std::ceil(
+                    (bsmr.sparseColOffsets()[rowPanelId + 1] - bsmr.sparseColOffsets()[rowPanelId]) /
+                    static_cast<float>(BLOCK_COL_SIZE));
+
+            evaluation.numDenseThreadBlocks += std::ceil(
+                static_cast<float>(numDenseBlocksInCurrentRowPanel) / each_thread_block_counts_the_number_Of_dense_blocks);
+
+            evaluation.numSparseThreadBlocks += std::ceil(
+                static_cast<float>(bsmr.sparseValueOffsets()[rowPanelId + 1] - bsmr.sparseValueOffsets()[rowPanelId]) /
+                sddmm_sparse_block_each_thread_block_counts_the_number_Of_data);
+
+            // Maps each block ID to a set of column indices contained in that block
+            std::vector<std::unordered_set<UIN>> blockToColumnSet(
+                numDenseBlocksInCurrentRowPanel + numSparseBlocksInCurrentRowPanel);
+            std::vector<UIN> nnzInEachBlock(
+                numDenseBlocksInCurrentRowPanel + numSparseBlocksInCurrentRowPanel, 0);
+            // dense column segment loop
+            for (UIN indexOfReorderedCols = bsmr.denseColOffsets()[rowPanelId];
+                 indexOfReorderedCols < bsmr.denseColOffsets()[rowPanelId + 1];
+                 ++indexOfReorderedCols){
+                const UIN col = bsmr.denseCols()[indexOfReorderedCols];
+
+                // Calculate the block id
+                const UIN startIndexOfColsCurrentRowPanel = bsmr.denseColOffsets()[rowPanelId];
+                const UIN colBlockId = (indexOfReorderedCols - startIndexOfColsCurrentRowPanel) / BLOCK_COL_SIZE;
+
+                blockToColumnSet[colBlockId].insert(col);
+            }
 
-        const UIN startIndexOfReorderedRowsCurrentRowPanel = rowPanelId * ROW_PANEL_SIZE;
-        const UIN endIndexOfReorderedRowsCurrentRowPanel =
-            std::min(startIndexOfReorderedRowsCurrentRowPanel + ROW_PANEL_SIZE,
-                     static_cast<UIN>(bsmr.reorderedRows().size()));
-        // row index loop
-        for (int indexOfReorderedRows = startIndexOfReorderedRowsCurrentRowPanel;
-             indexOfReorderedRows < endIndexOfReorderedRowsCurrentRowPanel; ++indexOfReorderedRows){
-            const UIN row = bsmr.reorderedRows()[indexOfReorderedRows];
+            std::unordered_set<UIN> sparseColIndicesRecordSet;
+            // sparse column segment loop, record sparse column index
+            for (UIN indexOfReorderedCols = bsmr.sparseColOffsets()[rowPanelId];
+                 indexOfReorderedCols < bsmr.sparseColOffsets()[rowPanelId + 1];
+                 ++indexOfReorderedCols){
+                const UIN col = bsmr.sparseCols()[indexOfReorderedCols];
+                sparseColIndicesRecordSet.insert(col);
+            }
 
-            // column index loop
-            for (int idx = matrix.rowOffsets()[row]; idx < matrix.rowOffsets()[row + 1]; ++idx){
-                const UIN col = matrix.colIndices()[idx];
+            const UIN startIndexOfReorderedRowsCurrentRowPanel = rowPanelId * ROW_PANEL_SIZE;
+            const UIN endIndexOfReorderedRowsCurrentRowPanel =
+                std::min(startIndexOfReorderedRowsCurrentRowPanel + ROW_PANEL_SIZE,
+                         static_cast<UIN>(bsmr.reorderedRows().size()));
+            // row index loop
+            for (UIN indexOfReorderedRows = startIndexOfReorderedRowsCurrentRowPanel;
+                 indexOfReorderedRows < endIndexOfReorderedRowsCurrentRowPanel; ++indexOfReorderedRows){
+                const UIN row = bsmr.reorderedRows()[indexOfReorderedRows];
+
+                // column index loop
+                for (UIN idx = matrix.rowOffsets()[row]; idx < matrix.rowOffsets()[row + 1]; ++idx){
+                    const UIN col = matrix.colIndices()[idx];
 
-                // Check if the column index is in the dense column segment, if so, increment the nnz count for the corresponding block
-                for (int blockId = 0; blockId < blockToColumnSet.size(); ++blockId){
-                    if (blockToColumnSet[blockId].find(col) != blockToColumnSet[blockId].end()){
-                        ++nnzInEachBlock[blockId];
+                    // Check if the column index is in the dense column segment, if so, increment the nnz count for the corresponding block
+                    for (int blockId = 0; blockId < blockToColumnSet.size(); ++blockId){
+                        if (blockToColumnSet[blockId].find(col) != blockToColumnSet[blockId].end()){
+                            ++nnzInEachBlock[blockId];
+                        }
                     }
-                }
 
-                if (sparseColIndicesRecordSet.find(col) != sparseColIndicesRecordSet.end()){
-                    ++numSparseData;
+                    if (sparseColIndicesRecordSet.find(col) != sparseColIndicesRecordSet.end()){
+                        ++evaluation.numSparseData;
+                    }
                 }
             }
-        }
 
-        // Calculate the average density in the current row panel
-        for (int blockId = 0; blockId < blockToColumnSet.size(); ++blockId){
-            const float blockSize = static_cast<float>(ROW_PANEL_SIZE * BLOCK_COL_SIZE);
-            if (nnzInEachBlock[blockId] > 0){
-                const float density = static_cast<float>(nnzInEachBlock[blockId]) / blockSize;
-                totalDensity += density;
+            // Calculate the average density in the current row panel
+            for (int blockId = 0; blockId < blockToColumnSet.size(); ++blockId){
+                const float blockSize = static_cast<float>(ROW_PANEL_SIZE * BLOCK_COL_SIZE);
+                if (nnzInEachBlock[blockId] > 0){
+                    const float density = static_cast<float>(nnzInEachBlock[blockId]) / blockSize;
+                    evaluation.totalDensity += density;
 
-                const float densityThreshold = logger.delta_;
-                if (density >= densityThreshold){
-                    ++numDenseBlocks;
+                    const float densityThreshold = logger.delta_;
+                    if (density >= densityThreshold){
+                        ++evaluation.numDenseBlocks;
+                    }
                 }
             }
         }
+    });
+
+    int numDenseBlocks = 0;
+    float totalDensity = 0.0f;
+    int numDenseThreadBlocks = 0;
+    int numSparseThreadBlocks = 0;
+    int numSparseData = 0;
+    for (const RowPanelEvaluation& evaluation : evaluations){
+        numDenseBlocks += evaluation.numDenseBlocks;
+        totalDensity += evaluation.totalDensity;
+        numDenseThreadBlocks += evaluation.numDenseThreadBlocks;
+        numSparseThreadBlocks += evaluation.numSparseThreadBlocks;
+        numSparseData += evaluation.numSparseData;
     }
 
     const auto [numDenseBlocksInOriginalMatrix, averageDensityInOriginalMatrix] =
@@ -968,8 +1683,8 @@ std::pair<UIN, float> calculateNumDenseBlocksAndAverageDensityInOriginalMatrix(
             const UIN endCol = std::min(static_cast<UIN>(startCol + BLOCK_COL_SIZE), matrix.col());
 
             UIN numNonZero = 0;
-            for (int row = startRow; row < endRow; ++row){
-                for (int idx = matrix.rowOffsets()[row]; idx < matrix.rowOffsets()[row + 1]; ++idx){
+            for (UIN row = startRow; row < endRow; ++row){
+                for (UIN idx = matrix.rowOffsets()[row]; idx < matrix.rowOffsets()[row + 1]; ++idx){
                     const UIN col = matrix.colIndices()[idx];
 
                     if (col >= startCol && col < endCol){
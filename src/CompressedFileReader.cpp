@@ -0,0 +1,229 @@
+#include <cstdio>
+#include <iostream>
+#include <utility>
+
+#include <zlib.h>
+
+#ifdef BSMR_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+#include "CompressedFileReader.hpp"
+#include "util.hpp"
+
+CompressedFileReader::~CompressedFileReader(){
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        isStopped_ = true;
+    }
+    spaceReady_.notify_all();
+    if (decoder_.joinable()){
+        decoder_.join();
+    }
+}
+
+bool CompressedFileReader::isCompressedFile(const std::string& file){
+    const std::string fileSuffix = util::getFileSuffix(file);
+    return fileSuffix == ".gz" || fileSuffix == ".zst";
+}
+
+std::string CompressedFileReader::getUncompressedFileName(const std::string& file){
+    if (!isCompressedFile(file)){
+        return file;
+    }
+    return file.substr(0, file.find_last_of('.'));
+}
+
+bool CompressedFileReader::open(const std::string& file){
+    const std::string fileSuffix = util::getFileSuffix(file);
+#ifndef BSMR_WITH_ZSTD
+    if (fileSuffix == ".zst"){
+        std::cerr << "Error, zstd support is not compiled in, cannot read file : " << file << std::endl;
+        return false;
+    }
+#endif
+    if (!isCompressedFile(file)){
+        std::cerr << "Error, file format is not supported : " << file << std::endl;
+        return false;
+    }
+
+    FILE* fp = std::fopen(file.c_str(), "rb");
+    if (!fp){
+        std::cerr << "Error, file cannot be opened : " << file << std::endl;
+        return false;
+    }
+    std::fclose(fp);
+
+    if (fileSuffix == ".gz"){
+        decoder_ = std::thread(&CompressedFileReader::decodeGzip, this, file);
+    }
+    else{
+        decoder_ = std::thread(&CompressedFileReader::decodeZstd, this, file);
+    }
+
+    return true;
+}
+
+bool CompressedFileReader::nextBlock(std::vector<char>& block){
+    std::unique_lock<std::mutex> lock(mutex_);
+    blockReady_.wait(lock, [this]{ return !blocks_.empty() || isFinished_; });
+    if (hasError_ || blocks_.empty()){
+        return false;
+    }
+    block = std::move(blocks_.front());
+    blocks_.pop_front();
+    lock.unlock();
+    spaceReady_.notify_one();
+
+    return true;
+}
+
+bool CompressedFileReader::nextLineBlock(std::vector<char>& block){
+    std::vector<char> decompressed;
+    while (nextBlock(decompressed)){
+        lineCarry_.insert(lineCarry_.end(), decompressed.begin(), decompressed.end());
+
+        // Cut after the last line feed, a block without any line feed is joined with the next block
+        size_t lineEnd = lineCarry_.size();
+        while (lineEnd > 0 && lineCarry_[lineEnd - 1] != '\n'){
+            --lineEnd;
+        }
+        if (lineEnd == 0){
+            continue;
+        }
+        block.assign(lineCarry_.begin(), lineCarry_.begin() + lineEnd);
+        lineCarry_.erase(lineCarry_.begin(), lineCarry_.begin() + lineEnd);
+        return true;
+    }
+    if (hasError() || lineCarry_.empty()){
+        return false;
+    }
+
+    // The last line of the file has no line feed
+    block.swap(lineCarry_);
+    lineCarry_.clear();
+    return true;
+}
+
+bool CompressedFileReader::hasError() const{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return hasError_;
+}
+
+bool CompressedFileReader::pushBlock(std::vector<char>&& block){
+    std::unique_lock<std::mutex> lock(mutex_);
+    spaceReady_.wait(lock, [this]{ return blocks_.size() < maxNumQueuedBlocks_ || isStopped_; });
+    if (isStopped_){
+        return false;
+    }
+    blocks_.push_back(std::move(block));
+    lock.unlock();
+    blockReady_.notify_one();
+
+    return true;
+}
+
+void CompressedFileReader::finish(const bool hasError){
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        isFinished_ = true;
+        hasError_ = hasError;
+    }
+    blockReady_.notify_all();
+}
+
+void CompressedFileReader::decodeGzip(const std::string& file){
+    gzFile gzFp = gzopen(file.c_str(), "rb");
+    if (!gzFp){
+        std::cerr << "Error, file cannot be opened : " << file << std::endl;
+        finish(true);
+        return;
+    }
+    gzbuffer(gzFp, 1 << 20);
+
+    bool hasError = false;
+    while (true){
+        std::vector<char> block(blockSize_);
+        const int numBytes = gzread(gzFp, block.data(), static_cast<unsigned>(block.size()));
+        if (numBytes < 0){
+            int errorNumber = 0;
+            std::cerr << "Error, file " << file << " decompression failed : " << gzerror(gzFp, &errorNumber) << std::endl;
+            hasError = true;
+            break;
+        }
+        if (numBytes == 0){
+            // gzread also returns 0 when the input ends in the middle of a stream, then the error is Z_BUF_ERROR
+            int errorNumber = Z_OK;
+            const char* errorMessage = gzerror(gzFp, &errorNumber);
+            if (errorNumber != Z_OK || !gzeof(gzFp)){
+                std::cerr << "Error, file " << file << " decompression failed : "
+                    << (errorNumber == Z_BUF_ERROR ? "unexpected end of file" : errorMessage) << std::endl;
+                hasError = true;
+            }
+            break;
+        }
+        block.resize(numBytes);
+        if (!pushBlock(std::move(block))){
+            break;
+        }
+    }
+
+    gzclose(gzFp);
+    finish(hasError);
+}
+
+void CompressedFileReader::decodeZstd(const std::string& file){
+#ifdef BSMR_WITH_ZSTD
+    FILE* fp = std::fopen(file.c_str(), "rb");
+    ZSTD_DStream* dStream = ZSTD_createDStream();
+    if (!fp || !dStream){
+        std::cerr << "Error, file cannot be opened : " << file << std::endl;
+        if (fp){
+            std::fclose(fp);
+        }
+        ZSTD_freeDStream(dStream);
+        finish(true);
+        return;
+    }
+    ZSTD_initDStream(dStream);
+
+    bool hasError = false;
+    bool isStopped = false;
+    std::vector<char> inputBuffer(ZSTD_DStreamInSize());
+    size_t lastResult = 0;
+    size_t numInputBytes;
+    while (!isStopped && !hasError && (numInputBytes = std::fread(inputBuffer.data(), 1, inputBuffer.size(), fp)) > 0){
+        ZSTD_inBuffer input = {inputBuffer.data(), numInputBytes, 0};
+        bool isOutputFull = false;
+        // A full output block means that the decoder may still hold data, so it is called again
+        while (input.pos < input.size || isOutputFull){
+            std::vector<char> block(blockSize_);
+            ZSTD_outBuffer output = {block.data(), block.size(), 0};
+            lastResult = ZSTD_decompressStream(dStream, &output, &input);
+            if (ZSTD_isError(lastResult)){
+                std::cerr << "Error, file " << file << " decompression failed : "
+                          << ZSTD_getErrorName(lastResult) << std::endl;
+                hasError = true;
+                break;
+            }
+            isOutputFull = output.pos == output.size;
+            block.resize(output.pos);
+            if (!block.empty() && !pushBlock(std::move(block))){
+                isStopped = true;
+                break;
+            }
+        }
+    }
+    if (!isStopped && !hasError && lastResult != 0){
+        std::cerr << "Error, file " << file << " is truncated!" << std::endl;
+        hasError = true;
+    }
+
+    ZSTD_freeDStream(dStream);
+    std::fclose(fp);
+    finish(hasError);
+#else
+    std::cerr << "Error, zstd support is not compiled in, cannot read file : " << file << std::endl;
+    finish(true);
+#endif
+}
@@ -0,0 +1,71 @@
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "MappedFile.hpp"
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : fd_(other.fd_), data_(other.data_), size_(other.size_){
+    other.fd_ = -1;
+    other.data_ = nullptr;
+    other.size_ = 0;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept{
+    if (this != &other){
+        close();
+        std::swap(fd_, other.fd_);
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+    }
+    return *this;
+}
+
+bool MappedFile::open(const std::string& file, const bool sequentialAccess){
+    close();
+
+    fd_ = ::open(file.c_str(), O_RDONLY);
+    if (fd_ < 0){
+        return false;
+    }
+
+    struct stat fileStat{};
+    if (fstat(fd_, &fileStat) != 0 || !S_ISREG(fileStat.st_mode)){
+        close();
+        return false;
+    }
+    size_ = static_cast<size_t>(fileStat.st_size);
+
+    // An empty file cannot be mapped, but it is still a valid (empty) file
+    if (size_ == 0){
+        return true;
+    }
+
+    void* addr = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+    if (addr == MAP_FAILED){
+        close();
+        return false;
+    }
+    data_ = static_cast<const char*>(addr);
+
+    if (sequentialAccess){
+        madvise(addr, size_, MADV_SEQUENTIAL);
+    }
+
+    return true;
+}
+
+void MappedFile::close(){
+    if (data_){
+        munmap(const_cast<char*>(data_), size_);
+        data_ = nullptr;
+    }
+    if (fd_ >= 0){
+        ::close(fd_);
+        fd_ = -1;
+    }
+    size_ = 0;
+}
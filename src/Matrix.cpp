@@ -3,12 +3,20 @@
 #include <string>
 #include <random>
 #include <set>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <memory>
 #include <unordered_map>
 #include <unordered_set>
 
 #include <omp.h>
 
 #include "Matrix.hpp"
+#include "MappedFile.hpp"
+#include "CompressedFileReader.hpp"
+#include "NpzFile.hpp"
+#include "textParser.hpp"
 #include "util.hpp"
 #include "parallelAlgorithm.cuh"
 #include "CudaTimeCalculator.cuh"
@@ -18,7 +26,7 @@ template<typename T>
 Matrix<T>::Matrix(const sparseMatrix::COO<T> &matrixS) {
     row_ = matrixS.row();
     col_ = matrixS.col();
-    const UIN size = matrixS.row() * matrixS.col();
+    const size_t size = static_cast<size_t>(matrixS.row()) * matrixS.col();
     storageOrder_ = MatrixStorageOrder::row_major;
     const UIN ld = matrixS.col();
     leadingDimension_ = ld;
@@ -26,17 +34,17 @@ Matrix<T>::Matrix(const sparseMatrix::COO<T> &matrixS) {
     values_.clear();
     values_.resize(size);
 #pragma omp parallel for
-    for (int idx = 0; idx < matrixS.nnz(); ++idx) {
+    for (UIN idx = 0; idx < matrixS.nnz(); ++idx) {
         const UIN curRow = matrixS.rowIndices()[idx];
         const UIN curCol = matrixS.colIndices()[idx];
         const auto curVal = matrixS.values()[idx];
 
-        values_[curRow * ld + curCol] = curVal;
+        values_[static_cast<size_t>(curRow) * ld + curCol] = curVal;
     }
 }
 
 template<typename T>
-UIN Matrix<T>::rowOfValueIndex(UIN idx) const {
+UIN Matrix<T>::rowOfValueIndex(size_t idx) const {
     if (idx == 0) {
         return 0;
     }
@@ -48,7 +56,7 @@ UIN Matrix<T>::rowOfValueIndex(UIN idx) const {
 }
 
 template<typename T>
-UIN Matrix<T>::colOfValueIndex(UIN idx) const {
+UIN Matrix<T>::colOfValueIndex(size_t idx) const {
     if (idx == 0) {
         return 0;
     }
@@ -61,7 +69,7 @@ UIN Matrix<T>::colOfValueIndex(UIN idx) const {
 
 template<typename T>
 bool Matrix<T>::initializeValue(const std::vector<T> &src) {
-    if (src.size() != row_ * col_) {
+    if (src.size() != static_cast<size_t>(row_) * col_) {
         std::cout << "Warning! Matrix value size mismatch" << std::endl;
         return false;
     }
@@ -83,24 +91,24 @@ void Matrix<T>::changeStorageOrder() {
         newLd = row_;
 
 #pragma omp parallel for
-        for (int idx = 0; idx < oldValues.size(); ++idx) {
+        for (size_t idx = 0; idx < oldValues.size(); ++idx) {
             const UIN row = idx / oldLd;
             const UIN col = idx % oldLd;
             const auto val = oldValues[idx];
 
-            newValues[col * newLd + row] = val;
+            newValues[static_cast<size_t>(col) * newLd + row] = val;
         }
     } else {
         newMatrixOrder = MatrixStorageOrder::row_major;
         newLd = col_;
 
 #pragma omp parallel for
-        for (int idx = 0; idx < values_.size(); ++idx) {
+        for (size_t idx = 0; idx < values_.size(); ++idx) {
             const UIN col = idx / oldLd;
             const UIN row = idx % oldLd;
             const auto val = values_[idx];
 
-            newValues[row * newLd + col] = val;
+            newValues[static_cast<size_t>(row) * newLd + col] = val;
         }
     }
 
@@ -123,7 +131,7 @@ void Matrix<T>::makeData(UIN numRow, UIN numCol) {
     } else {
         leadingDimension_ = numRow;
     }
-    values_.resize(numRow * numCol);
+    values_.resize(static_cast<size_t>(numRow) * numCol);
 
 //    for (UIN idx = 0; idx < values_.size(); ++idx) {
 //        values_[idx] = static_cast<T>(idx);
@@ -132,7 +140,7 @@ void Matrix<T>::makeData(UIN numRow, UIN numCol) {
     auto distribution = util::createRandomUniformDistribution(static_cast<T>(0), static_cast<T>(2));
 
 #pragma omp parallel for
-    for (int idx = 0; idx < values_.size(); ++idx) {
+    for (size_t idx = 0; idx < values_.size(); ++idx) {
         values_[idx] = distribution(generator);
     }
 }
@@ -151,20 +159,20 @@ void Matrix<T>::print() const {
 template<typename T>
 void Matrix<T>::printToMarkdownTable() const {
     std::cout << "| |";
-    for (int colIdx = 0; colIdx < col_; ++colIdx) {
+    for (UIN colIdx = 0; colIdx < col_; ++colIdx) {
         std::cout << colIdx << "|";
     }
     std::cout << std::endl;
 
     std::cout << "|-|";
-    for (int colIdx = 0; colIdx < col_; ++colIdx) {
+    for (UIN colIdx = 0; colIdx < col_; ++colIdx) {
         std::cout << "-|";
     }
     std::cout << std::endl;
 
-    for (int rowIdx = 0; rowIdx < row_; ++rowIdx) {
+    for (UIN rowIdx = 0; rowIdx < row_; ++rowIdx) {
         std::cout << "|" << rowIdx << "|";
-        for (int colIdx = 0; colIdx < col_; ++colIdx) {
+        for (UIN colIdx = 0; colIdx < col_; ++colIdx) {
             std::cout << getOneValue(rowIdx, colIdx) << "|";
         }
         std::cout << std::endl;
@@ -176,19 +184,80 @@ std::vector<T> Matrix<T>::getRowVector(UIN row) const {
     std::vector<T> rowVector(col());
 
 #pragma omp parallel for
-    for (int col = 0; col < col_; ++col) {
+    for (UIN col = 0; col < col_; ++col) {
         rowVector[col] = getOneValue(row, col);
     }
 
     return rowVector;
 }
 
+template<typename T>
+Matrix<int8_t> Matrix<T>::quantize(const MatrixMultiplicationOrder multiplicationOrder,
+                                   std::vector<float> &scales) const {
+    return ::quantize(view(), multiplicationOrder, scales);
+}
+
+template<typename T>
+Matrix<int8_t> quantize(const MatrixView<const T> &matrix,
+                        const MatrixMultiplicationOrder multiplicationOrder,
+                        std::vector<float> &scales) {
+    const bool isVectorRow = multiplicationOrder == MatrixMultiplicationOrder::left_multiplication;
+    const UIN numVectors = isVectorRow ? matrix.row : matrix.col;
+    const UIN vectorLength = isVectorRow ? matrix.col : matrix.row;
+
+    // Element i of vector v is at v * vectorStride + i * elementStride, the int8 matrix is packed
+    const bool isVectorContiguous = isVectorRow == (matrix.storageOrder == MatrixStorageOrder::row_major);
+    const UIN packedLeadingDimension = matrix.storageOrder == MatrixStorageOrder::row_major ? matrix.col : matrix.row;
+    const size_t vectorStride = isVectorContiguous ? matrix.leadingDimension : 1;
+    const size_t elementStride = isVectorContiguous ? 1 : matrix.leadingDimension;
+    const size_t quantizedVectorStride = isVectorContiguous ? packedLeadingDimension : 1;
+    const size_t quantizedElementStride = isVectorContiguous ? 1 : packedLeadingDimension;
+
+    // Raw pointers, int8_t stores may alias the members and would reload them for every value
+    std::vector<int8_t> quantizedValues(static_cast<size_t>(matrix.row) * matrix.col);
+    const T *values = matrix.data;
+    int8_t *quantized = quantizedValues.data();
+    scales.resize(numVectors);
+#pragma omp parallel for
+    for (UIN vectorId = 0; vectorId < numVectors; ++vectorId) {
+        const size_t vectorBegin = vectorId * vectorStride;
+        float maxMagnitude = 0.0f;
+        for (UIN idx = 0; idx < vectorLength; ++idx) {
+            const float value = static_cast<float>(values[vectorBegin + idx * elementStride]);
+            maxMagnitude = std::max(maxMagnitude, std::fabs(value));
+        }
+        const float scale = maxMagnitude / 127.0f;
+        const float inverseScale = scale > 0.0f ? 1.0f / scale : 0.0f;
+        const size_t quantizedVectorBegin = vectorId * quantizedVectorStride;
+        for (UIN idx = 0; idx < vectorLength; ++idx) {
+            // Rounded half away from 0, the scaled value is already in [-127, 127] up to rounding
+            const float scaledValue = static_cast<float>(values[vectorBegin + idx * elementStride]) * inverseScale;
+            const float roundedValue = scaledValue + (scaledValue < 0.0f ? -0.5f : 0.5f);
+            quantized[quantizedVectorBegin + idx * quantizedElementStride] =
+                static_cast<int8_t>(std::min(std::max(roundedValue, -127.0f), 127.0f));
+        }
+        scales[vectorId] = scale;
+    }
+
+    return Matrix<int8_t>(matrix.row, matrix.col, matrix.storageOrder, quantizedValues);
+}
+
+template Matrix<int8_t> quantize<int>(const MatrixView<const int> &matrix,
+                                      MatrixMultiplicationOrder multiplicationOrder,
+                                      std::vector<float> &scales);
+template Matrix<int8_t> quantize<float>(const MatrixView<const float> &matrix,
+                                        MatrixMultiplicationOrder multiplicationOrder,
+                                        std::vector<float> &scales);
+template Matrix<int8_t> quantize<double>(const MatrixView<const double> &matrix,
+                                         MatrixMultiplicationOrder multiplicationOrder,
+                                         std::vector<float> &scales);
+
 template<typename T>
 std::vector<T> Matrix<T>::getColVector(UIN col) const {
     std::vector<T> colVector(row());
 
 #pragma omp parallel for
-    for (int row = 0; row < row_; ++row) {
+    for (UIN row = 0; row < row_; ++row) {
         colVector[row] = getOneValue(row, col);
     }
 
@@ -205,18 +274,18 @@ T Matrix<T>::getOneValueForMultiplication(MatrixMultiplicationOrder multiplicati
             std::cout << "Warning! The input rows exceed the matrix" << std::endl;
         }
         if (storageOrder_ == MatrixStorageOrder::row_major) {
-            return values_[rowMtxC * leadingDimension_ + positionOfKIter];
+            return values_[static_cast<size_t>(rowMtxC) * leadingDimension_ + positionOfKIter];
         } else {
-            return values_[positionOfKIter * leadingDimension_ + rowMtxC];
+            return values_[static_cast<size_t>(positionOfKIter) * leadingDimension_ + rowMtxC];
         }
     } else {
         if (colMtxC > col_) {
             std::cout << "Warning! The input columns exceed the matrix" << std::endl;
         }
         if (storageOrder_ == MatrixStorageOrder::row_major) {
-            return values_[positionOfKIter * leadingDimension_ + colMtxC];
+            return values_[static_cast<size_t>(positionOfKIter) * leadingDimension_ + colMtxC];
         } else {
-            return values_[colMtxC * leadingDimension_ + positionOfKIter];
+            return values_[static_cast<size_t>(colMtxC) * leadingDimension_ + positionOfKIter];
         }
     }
 }
@@ -227,9 +296,9 @@ T Matrix<T>::getOneValue(UIN row, UIN col) const {
         std::cout << "Warning! The input rows or columns exceed the matrix" << std::endl;
     }
     if (storageOrder_ == MatrixStorageOrder::row_major) {
-        return values_[row * leadingDimension_ + col];
+        return values_[static_cast<size_t>(row) * leadingDimension_ + col];
     } else {
-        return values_[col * leadingDimension_ + row];
+        return values_[static_cast<size_t>(col) * leadingDimension_ + row];
     }
 }
 
@@ -237,7 +306,7 @@ void getCsrRowOffsets(const UIN row, const std::vector<UIN> &rowIndices, std::ve
     rowOffsets.resize(row + 1);
     rowOffsets[0] = 0;
     UIN rowPtrIdx = 0;
-    for (int idx = 0; idx < rowIndices.size(); ++idx) {
+    for (UIN idx = 0; idx < rowIndices.size(); ++idx) {
         while (rowPtrIdx < rowOffsets.size() - 1 && rowPtrIdx != rowIndices[idx]) {
             rowOffsets[rowPtrIdx + 1] = idx;
             ++rowPtrIdx;
@@ -277,15 +346,21 @@ template
 class sparseMatrix::COO<double>;
 
 template<typename T>
-bool sparseMatrix::CSR<T>::initializeFromMatrixFile(const std::string &file) {
+bool sparseMatrix::CSR<T>::initializeFromMatrixFile(const std::string &file, const bool degreeOrderedRelabel) {
 
-    const std::string fileSuffix = util::getFileSuffix(file);
+    // Compressed files are recognized by the suffix before the compression suffix, "a.mtx.gz" -> ".mtx"
+    const bool isCompressed = CompressedFileReader::isCompressedFile(file);
+    const std::string fileSuffix = util::getFileSuffix(CompressedFileReader::getUncompressedFileName(file));
     if (fileSuffix == ".mtx" || fileSuffix == ".mmio") {
         return initializeFromMtxFile(file);
     } else if (fileSuffix == ".smtx") {
         return initializeFromSmtxFile(file);
-    } else if (fileSuffix == ".txt") {
-        return initializeFromGraphDataset(file);
+    } else if (fileSuffix == ".txt" && !isCompressed) {
+        return initializeFromGraphDataset(file, degreeOrderedRelabel);
+    } else if (fileSuffix == ".bcsr" && !isCompressed) {
+        return initializeFromBinaryFile(file);
+    } else if (fileSuffix == ".npz" && !isCompressed) {
+        return initializeFromNpzFile(file);
     } else {
         std::cerr << "Error, file format is not supported : " << file << std::endl;
     }
@@ -293,79 +368,351 @@ bool sparseMatrix::CSR<T>::initializeFromMatrixFile(const std::string &file) {
     return false;
 }
 
-template<typename T>
-bool sparseMatrix::CSR<T>::initializeFromSmtxFile(const std::string &file) {
-    std::ifstream inFile;
-    inFile.open(file, std::ios::in); // open file
-    if (!inFile.is_open()) {
+/**
+ * Parse the unsigned integers of one line [begin, end) directly into `output`.
+ * The line is processed in fixed-size blocks by all threads:
+ * the first pass counts the words that begin in each block, a scan of the counts gives the position of the first word of
+ * each block, and the second pass decodes the words of each block to their positions.
+ * Return false if a word is not a number or the line does not contain exactly `numWords` words.
+ **/
+bool parseUnsignedWordsInParallel(const char *begin, const char *end, const size_t numWords, UIN *output,
+                                  size_t &numWordsInLine) {
+    constexpr size_t blockSize = 1 << 20;
+    const size_t numBlocks = (end - begin + blockSize - 1) / blockSize;
+
+    // A word begins at a character that is not blank and follows a blank or the beginning of the line
+    const auto isWordBegin = [begin](const char *cur) {
+        return !parser::isBlank(*cur) && (cur == begin || parser::isBlank(cur[-1]));
+    };
+
+    std::vector<size_t> numWordsInEachBlock(numBlocks + 1, 0);
+#pragma omp parallel for schedule(static)
+    for (size_t blockId = 0; blockId < numBlocks; ++blockId) {
+        const char *blockBegin = begin + blockId * blockSize;
+        const char *blockEnd = std::min(blockBegin + blockSize, end);
+        size_t numWordsCurrentBlock = 0;
+        for (const char *cur = blockBegin; cur < blockEnd; ++cur) {
+            numWordsCurrentBlock += isWordBegin(cur);
+        }
+        numWordsInEachBlock[blockId + 1] = numWordsCurrentBlock;
+    }
+    for (size_t blockId = 0; blockId < numBlocks; ++blockId) {
+        numWordsInEachBlock[blockId + 1] += numWordsInEachBlock[blockId];
+    }
+
+    numWordsInLine = numWordsInEachBlock[numBlocks];
+    if (numWordsInLine != numWords) {
+        return false;
+    }
+
+    bool isNumber = true;
+#pragma omp parallel for schedule(static) reduction(&& : isNumber)
+    for (size_t blockId = 0; blockId < numBlocks; ++blockId) {
+        const char *blockBegin = begin + blockId * blockSize;
+        const char *blockEnd = std::min(blockBegin + blockSize, end);
+        size_t wordId = numWordsInEachBlock[blockId];
+        for (const char *cur = blockBegin; cur < blockEnd && isNumber; ++cur) {
+            if (!isWordBegin(cur)) {
+                continue;
+            }
+            // The last word of the block may continue into the next block
+            const char *wordEnd = cur;
+            isNumber = parser::parseUnsigned(wordEnd, end, output[wordId])
+                && (wordEnd == end || parser::isBlank(*wordEnd));
+            ++wordId;
+            cur = wordEnd - 1;
+        }
+    }
+
+    return isNumber;
+}
+
+/**
+ * Parse the smtx file through a memory mapping. The rowOffsets and colIndices lines are decoded in parallel.
+ **/
+bool parseSmtxFile(const std::string &file, UIN &row, UIN &col, UIN &nnz,
+                   std::vector<UIN> &rowOffsets, std::vector<UIN> &colIndices) {
+    MappedFile mappedFile;
+    if (!mappedFile.open(file)) {
         std::cerr << "Error, file cannot be opened : " << file << std::endl;
         return false;
     }
 
     std::cout << "sparseMatrix::CSR initialize From file : " << file << std::endl;
 
-    std::string line; // Store the data for each line
-    while (getline(inFile, line) && line[0] == '%') {} // Skip comments
+    const char *end = mappedFile.end();
+    const char *cur = parser::skipCommentLines(mappedFile.data(), end, '%'); // Skip comments
 
-    int wordIter = 0;
-    row_ = std::stoi(util::iterateOneWordFromLine(line, wordIter));
-    col_ = std::stoi(util::iterateOneWordFromLine(line, wordIter));
-    nnz_ = std::stoi(util::iterateOneWordFromLine(line, wordIter));
+    // The header is "nrows, ncols, nnz"
+    const auto parseHeaderWord = [&cur, end](UIN &value) {
+        if (!parser::parseUnsigned(cur, end, value)) {
+            return false;
+        }
+        cur = parser::skipBlank(cur, end);
+        if (cur < end && *cur == ',') {
+            ++cur;
+        }
+        return true;
+    };
+    row = 0, col = 0, nnz = 0;
+    if (!parseHeaderWord(row) || !parseHeaderWord(col) || !parseHeaderWord(nnz)) {
+        std::cerr << "Error, file " << file << " format is incorrect!" << std::endl;
+        return false;
+    }
 
-    if (nnz_ == 0) {
+    if (nnz == 0) {
         std::cerr << "Error, file " << file << " nnz is 0!" << std::endl;
         return false;
     }
 
-    rowOffsets_.resize(row_ + 1);
-    colIndices_.resize(nnz_);
-    values_.resize(nnz_);
+    const char *rowOffsetsLine = parser::nextLine(cur, end);
+    const char *colIndicesLine = parser::nextLine(rowOffsetsLine, end);
+    const auto lineEnd = [end](const char *line) {
+        const char *next = parser::nextLine(line, end);
+        return next > line && next[-1] == '\n' ? next - 1 : next;
+    };
+
+    rowOffsets.resize(row + 1);
+    colIndices.resize(nnz);
 
     // initialize rowOffsets
-    {
-        getline(inFile, line);
-        wordIter = 0;
-        int idx = 0;
-        for (; idx < rowOffsets_.size(); ++idx) {
-            const UIN rowOffset = std::stoi(util::iterateOneWordFromLine(line, wordIter));
-            rowOffsets_[idx] = rowOffset;
-        }
-        if (idx < rowOffsets_.size()) {
+    size_t numWordsInLine = 0;
+    if (!parseUnsignedWordsInParallel(rowOffsetsLine, lineEnd(rowOffsetsLine),
+                                      rowOffsets.size(), rowOffsets.data(), numWordsInLine)) {
+        if (numWordsInLine < rowOffsets.size()) {
             std::cerr << "Error, file " << file << " rowOffsets is not enough!" << std::endl;
-            return false;
+        } else {
+            std::cerr << "Error, file " << file << " rowOffsets format is incorrect!" << std::endl;
         }
+        return false;
     }
 
-    // initialize colIndices and values
-    {
-        getline(inFile, line);
-        wordIter = 0;
-        int idx = 0;
-        for (; idx < colIndices_.size(); ++idx) {
-            const UIN col = std::stoi(util::iterateOneWordFromLine(line, wordIter));
-            colIndices_[idx] = col;
-            values_[idx] = static_cast<T>(1);
-        }
-        if (idx < nnz_) {
+    // initialize colIndices
+    if (!parseUnsignedWordsInParallel(colIndicesLine, lineEnd(colIndicesLine),
+                                      colIndices.size(), colIndices.data(), numWordsInLine)) {
+        if (numWordsInLine < nnz) {
             std::cerr << "Error, file " << file << " nnz is not enough!" << std::endl;
-            return false;
+        } else {
+            std::cerr << "Error, file " << file << " colIndices format is incorrect!" << std::endl;
         }
+        return false;
     }
 
-    // Check data
-    for (int row = 0; row < row_; ++row) {
-        std::unordered_set<UIN> colSet;
-        for (int idx = rowOffsets_[row]; idx < rowOffsets_[row + 1]; ++idx) {
-            const UIN col = colIndices_[idx];
-            if (colSet.find(col) != colSet.end()) {
-                std::cerr << "Error, matrix has duplicate data!" << std::endl;
+    return true;
+}
+
+/**
+ * Parse the compressed smtx file while it is being decompressed.
+ * The words are decoded one character at a time, so a word may be split between two blocks,
+ * and the huge rowOffsets and colIndices lines never have to be held as text.
+ **/
+bool parseCompressedSmtxFile(const std::string &file, UIN &row, UIN &col, UIN &nnz,
+                             std::vector<UIN> &rowOffsets, std::vector<UIN> &colIndices) {
+    CompressedFileReader reader;
+    if (!reader.open(file)) {
+        return false;
+    }
+
+    std::cout << "sparseMatrix::CSR initialize From file : " << file << std::endl;
+
+    // Lines: header, rowOffsets, colIndices
+    enum { header, rowOffsetsLine, colIndicesLine, afterColIndicesLine } section = header;
+    UIN headerWords[3];
+    size_t numWordsInSection = 0;
+    bool isFormatCorrect = true;
+
+    const auto addWord = [&](const UIN word) {
+        if (section == header) {
+            if (numWordsInSection < 3) {
+                headerWords[numWordsInSection] = word;
+            }
+        } else if (section == rowOffsetsLine) {
+            if (numWordsInSection < rowOffsets.size()) {
+                rowOffsets[numWordsInSection] = word;
+            }
+        } else if (section == colIndicesLine) {
+            if (numWordsInSection < colIndices.size()) {
+                colIndices[numWordsInSection] = word;
+            }
+        } else {
+            isFormatCorrect = false; // Nothing is allowed after the colIndices line
+        }
+        ++numWordsInSection;
+    };
+    const auto endSection = [&]() {
+        if (section == header) {
+            if (numWordsInSection != 3) {
+                std::cerr << "Error, file " << file << " format is incorrect!" << std::endl;
+                return false;
+            }
+            row = headerWords[0], col = headerWords[1], nnz = headerWords[2];
+            if (nnz == 0) {
+                std::cerr << "Error, file " << file << " nnz is 0!" << std::endl;
+                return false;
+            }
+            rowOffsets.resize(row + 1);
+            colIndices.resize(nnz);
+        } else if (section == rowOffsetsLine) {
+            if (numWordsInSection < rowOffsets.size()) {
+                std::cerr << "Error, file " << file << " rowOffsets is not enough!" << std::endl;
+                return false;
+            }
+            if (numWordsInSection > rowOffsets.size()) {
+                std::cerr << "Error, file " << file << " rowOffsets format is incorrect!" << std::endl;
+                return false;
+            }
+        } else if (section == colIndicesLine) {
+            if (numWordsInSection < nnz) {
+                std::cerr << "Error, file " << file << " nnz is not enough!" << std::endl;
+                return false;
+            }
+            if (numWordsInSection > nnz) {
+                std::cerr << "Error, file " << file << " colIndices format is incorrect!" << std::endl;
+                return false;
+            }
+        }
+        section = section == afterColIndicesLine ? afterColIndicesLine : static_cast<decltype(section)>(section + 1);
+        numWordsInSection = 0;
+        return true;
+    };
+
+    uint64_t word = 0;
+    bool isInWord = false;
+    bool isInComment = false;
+    bool isLineBegin = true;
+    std::vector<char> block;
+    while (reader.nextBlock(block)) {
+        for (const char c : block) {
+            if (isInComment) {
+                isInComment = c != '\n';
+                isLineBegin = !isInComment;
+                continue;
+            }
+            if (isLineBegin && c == '%' && section == header) {
+                isInComment = true;
+                continue;
+            }
+            isLineBegin = c == '\n';
+
+            if (static_cast<unsigned>(c - '0') <= 9) {
+                word = word * 10 + (c - '0');
+                if (word >= NULL_VALUE) {
+                    std::cerr << "Error, file " << file << " number is too big!" << std::endl;
+                    return false;
+                }
+                isInWord = true;
+                continue;
+            }
+            if (isInWord) {
+                addWord(static_cast<UIN>(word));
+                word = 0;
+                isInWord = false;
+            }
+            if (c == '\n') {
+                if (!endSection()) {
+                    return false;
+                }
+            } else if (!parser::isBlank(c) && c != ',') {
+                isFormatCorrect = false;
+            }
+            if (!isFormatCorrect) {
+                std::cerr << "Error, file " << file << " format is incorrect!" << std::endl;
                 return false;
             }
-            colSet.insert(col);
         }
     }
+    if (reader.hasError()) {
+        return false;
+    }
 
-    inFile.close();
+    // The last line may have no line feed
+    if (isInWord) {
+        addWord(static_cast<UIN>(word));
+    }
+    if (!isFormatCorrect) {
+        std::cerr << "Error, file " << file << " format is incorrect!" << std::endl;
+        return false;
+    }
+    while (section != afterColIndicesLine) {
+        if (!endSection()) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Check that rowOffsets and colIndices describe a valid CSR structure without duplicate data.
+ **/
+bool checkCsrStructure(const std::string &file, const UIN row, const UIN col, const UIN nnz,
+                       const UIN *rowOffsets, const UIN *colIndices) {
+    if (rowOffsets[0] != 0 || rowOffsets[row] != nnz) {
+        std::cerr << "Error, file " << file << " rowOffsets does not match nnz!" << std::endl;
+        return false;
+    }
+    bool isRowOffsetsIncreasing = true;
+#pragma omp parallel for reduction(&& : isRowOffsetsIncreasing)
+    for (UIN rowId = 0; rowId < row; ++rowId) {
+        isRowOffsetsIncreasing = isRowOffsetsIncreasing && rowOffsets[rowId] <= rowOffsets[rowId + 1];
+    }
+    if (!isRowOffsetsIncreasing) {
+        std::cerr << "Error, file " << file << " rowOffsets is not increasing!" << std::endl;
+        return false;
+    }
+
+    // Each thread marks the columns of the current row in its own bitmap, and clears them again after the row
+    bool isColOutOfRange = false;
+    bool hasDuplicateData = false;
+#pragma omp parallel reduction(|| : isColOutOfRange, hasDuplicateData)
+    {
+        std::vector<uint64_t> colBitmap((col + 63) / 64, 0);
+#pragma omp for schedule(dynamic, 1024)
+        for (UIN rowId = 0; rowId < row; ++rowId) {
+            UIN idx = rowOffsets[rowId];
+            for (; idx < rowOffsets[rowId + 1]; ++idx) {
+                const UIN curCol = colIndices[idx];
+                if (curCol >= col) {
+                    isColOutOfRange = true;
+                    break;
+                }
+                const uint64_t bit = uint64_t(1) << (curCol % 64);
+                if (colBitmap[curCol / 64] & bit) {
+                    hasDuplicateData = true;
+                    break;
+                }
+                colBitmap[curCol / 64] |= bit;
+            }
+            for (UIN clearIdx = rowOffsets[rowId]; clearIdx < idx; ++clearIdx) {
+                colBitmap[colIndices[clearIdx] / 64] = 0;
+            }
+        }
+    }
+    if (isColOutOfRange) {
+        std::cerr << "Error, file " << file << " row or col is too big!" << std::endl;
+        return false;
+    }
+    if (hasDuplicateData) {
+        std::cerr << "Error, matrix has duplicate data!" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+template<typename T>
+bool sparseMatrix::CSR<T>::initializeFromSmtxFile(const std::string &file) {
+    std::vector<UIN> rowOffsets, colIndices;
+    const bool isParsed = CompressedFileReader::isCompressedFile(file)
+                          ? parseCompressedSmtxFile(file, row_, col_, nnz_, rowOffsets, colIndices)
+                          : parseSmtxFile(file, row_, col_, nnz_, rowOffsets, colIndices);
+    if (!isParsed || !checkCsrStructure(file, row_, col_, nnz_, rowOffsets.data(), colIndices.data())) {
+        return false;
+    }
+
+    rowOffsets_ = std::move(rowOffsets);
+    colIndices_ = std::move(colIndices);
+    values_.assign(nnz_, static_cast<T>(1));
 
     return true;
 }
@@ -395,103 +742,353 @@ bool getOneLineThreeData(const std::string &line, UIN &first, UIN &second, T &th
     return true;
 }
 
+/**
+ * Parse the "first second [third]" lines in [begin, end). Empty lines and lines beginning with `commentMark` are skipped,
+ * a missing third word is read as 0.
+ * Return false if a line cannot be parsed.
+ **/
 template<typename T>
-bool sparseMatrix::CSR<T>::initializeFromMtxFile(const std::string &file) {
-    std::ifstream inFile;
-    inFile.open(file, std::ios::in); // open file
-    if (!inFile.is_open()) {
+bool parseThreeDataLines(const char *begin, const char *end, const char commentMark,
+                         std::vector<UIN> &first, std::vector<UIN> &second, std::vector<T> &third) {
+    const char *cur = begin;
+    while (cur < end) {
+        cur = parser::skipBlank(cur, end);
+        if (cur >= end) {
+            break;
+        }
+        if (*cur == '\n' || *cur == commentMark) {
+            cur = parser::nextLine(cur, end);
+            continue;
+        }
+
+        UIN firstData, secondData;
+        if (!parser::parseUnsigned(cur, end, firstData) || !parser::parseUnsigned(cur, end, secondData)) {
+            return false;
+        }
+        double thirdData = 0.0;
+        if (!parser::isLineEnd(cur, end) && !parser::parseFloat(cur, end, thirdData)) {
+            return false;
+        }
+        if (std::isinf(thirdData)) {
+            thirdData = 0.0; // Out of range, same as the `std::stod` based reader
+        }
+
+        first.push_back(firstData);
+        second.push_back(secondData);
+        third.push_back(static_cast<T>(thirdData));
+
+        cur = parser::nextLine(cur, end);
+    }
+
+    return true;
+}
+
+/**
+ * Build the CSR arrays from COO data that is spread over several chunks and is not ordered.
+ * Rows are assembled with a parallel counting sort, then every row is sorted by column,
+ * which also exposes duplicate entries as neighbours.
+ * Return false if the matrix has duplicate data.
+ **/
+template<typename T>
+bool buildCsrFromCooChunks(const UIN numRow,
+                           const std::vector<std::vector<UIN>> &rowIndicesPerChunk,
+                           const std::vector<std::vector<UIN>> &colIndicesPerChunk,
+                           const std::vector<std::vector<T>> &valuesPerChunk,
+                           std::vector<UIN> &rowOffsets,
+                           std::vector<UIN> &colIndices,
+                           std::vector<T> &values) {
+    const int numChunks = rowIndicesPerChunk.size();
+
+    // Count the number of non-zero elements in each row
+    std::vector<UIN> numNonZeroInEachRow(numRow, 0);
+#pragma omp parallel for schedule(dynamic, 1)
+    for (int chunkId = 0; chunkId < numChunks; ++chunkId) {
+        for (const UIN row : rowIndicesPerChunk[chunkId]) {
+#pragma omp atomic
+            ++numNonZeroInEachRow[row];
+        }
+    }
+
+    rowOffsets.resize(numRow + 1);
+    rowOffsets[0] = 0;
+    host::inclusive_scan(numNonZeroInEachRow.data(),
+                         numNonZeroInEachRow.data() + numNonZeroInEachRow.size(),
+                         rowOffsets.data() + 1);
+
+    // Scatter each element to its row
+    const UIN nnz = rowOffsets[numRow];
+    colIndices.resize(nnz);
+    values.resize(nnz);
+    std::vector<UIN> rowCursors(rowOffsets.begin(), rowOffsets.end() - 1);
+#pragma omp parallel for schedule(dynamic, 1)
+    for (int chunkId = 0; chunkId < numChunks; ++chunkId) {
+        const std::vector<UIN> &rowIndicesCurrentChunk = rowIndicesPerChunk[chunkId];
+        for (size_t idx = 0; idx < rowIndicesCurrentChunk.size(); ++idx) {
+            UIN position;
+#pragma omp atomic capture
+            position = rowCursors[rowIndicesCurrentChunk[idx]]++;
+
+            colIndices[position] = colIndicesPerChunk[chunkId][idx];
+            values[position] = valuesPerChunk[chunkId][idx];
+        }
+    }
+
+    // Sort each row by column and check for duplicate data
+    bool hasDuplicateData = false;
+#pragma omp parallel
+    {
+        std::vector<std::pair<UIN, T>> colAndValueCurrentRow;
+#pragma omp for schedule(dynamic, 1024)
+        for (UIN row = 0; row < numRow; ++row) {
+            const UIN startIdx = rowOffsets[row];
+            const UIN endIdx = rowOffsets[row + 1];
+            if (endIdx - startIdx <= 1) {
+                continue;
+            }
+
+            colAndValueCurrentRow.resize(endIdx - startIdx);
+            for (UIN idx = startIdx; idx < endIdx; ++idx) {
+                colAndValueCurrentRow[idx - startIdx] = std::make_pair(colIndices[idx], values[idx]);
+            }
+            std::sort(colAndValueCurrentRow.begin(), colAndValueCurrentRow.end(),
+                      [](const std::pair<UIN, T> &a, const std::pair<UIN, T> &b) { return a.first < b.first; });
+
+            for (UIN idx = startIdx; idx < endIdx; ++idx) {
+                const auto &colAndValue = colAndValueCurrentRow[idx - startIdx];
+                if (idx > startIdx && colAndValue.first == colIndices[idx - 1]) {
+#pragma omp atomic write
+                    hasDuplicateData = true;
+                }
+                colIndices[idx] = colAndValue.first;
+                values[idx] = colAndValue.second;
+            }
+        }
+    }
+
+    return !hasDuplicateData;
+}
+
+/**
+ * Parse the "row col nnz" header line of the mtx file, after the comments.
+ * Return false if the header format is incorrect.
+ **/
+bool parseMtxHeader(const char *&cur, const char *end, UIN &row, UIN &col, UIN &nnz) {
+    row = NULL_VALUE, col = NULL_VALUE, nnz = NULL_VALUE;
+    if (!parser::parseUnsigned(cur, end, row) ||
+        !parser::parseUnsigned(cur, end, col) ||
+        !parser::parseUnsigned(cur, end, nnz) ||
+        row == NULL_VALUE || col == NULL_VALUE || nnz == NULL_VALUE) {
+        return false;
+    }
+    cur = parser::nextLine(cur, end);
+    return true;
+}
+
+/**
+ * Parse the lines in [begin, end) in parallel. Each thread appends the data of its part to its own chunk.
+ **/
+template<typename T>
+bool parseMtxLinesInParallel(const char *begin, const char *end, const UIN nnz,
+                             std::vector<std::vector<UIN>> &rowIndicesPerChunk,
+                             std::vector<std::vector<UIN>> &colIndicesPerChunk,
+                             std::vector<std::vector<T>> &valuesPerChunk) {
+    const int numChunks = rowIndicesPerChunk.size();
+    const std::vector<const char *> chunkBoundaries = parser::splitIntoLineAlignedChunks(begin, end, numChunks);
+    std::vector<char> isChunkParsed(numChunks, true);
+#pragma omp parallel for schedule(dynamic, 1)
+    for (int chunkId = 0; chunkId < numChunks; ++chunkId) {
+        if (rowIndicesPerChunk[chunkId].empty()) {
+            const size_t approximateNumLines = nnz / numChunks + 1;
+            rowIndicesPerChunk[chunkId].reserve(approximateNumLines);
+            colIndicesPerChunk[chunkId].reserve(approximateNumLines);
+            valuesPerChunk[chunkId].reserve(approximateNumLines);
+        }
+        isChunkParsed[chunkId] = parseThreeDataLines(chunkBoundaries[chunkId], chunkBoundaries[chunkId + 1], '%',
+                                                     rowIndicesPerChunk[chunkId],
+                                                     colIndicesPerChunk[chunkId],
+                                                     valuesPerChunk[chunkId]);
+    }
+    return std::find(isChunkParsed.begin(), isChunkParsed.end(), false) == isChunkParsed.end();
+}
+
+/**
+ * Parse the mtx file through a memory mapping.
+ **/
+template<typename T>
+bool parseMtxFile(const std::string &file, UIN &row, UIN &col, UIN &nnz,
+                  std::vector<std::vector<UIN>> &rowIndicesPerChunk,
+                  std::vector<std::vector<UIN>> &colIndicesPerChunk,
+                  std::vector<std::vector<T>> &valuesPerChunk) {
+    MappedFile mappedFile;
+    if (!mappedFile.open(file)) {
         std::cerr << "Error, file cannot be opened : " << file << std::endl;
         return false;
     }
 
     std::cout << "sparseMatrix::CSR initialize from file : " << file << std::endl;
 
-    std::string line; // Store the data for each line
-    while (getline(inFile, line) && line[0] == '%') {} // Skip comments
+    const char *end = mappedFile.end();
+    const char *cur = parser::skipCommentLines(mappedFile.data(), end, '%'); // Skip comments
 
-    getOneLineThreeData(line, row_, col_, nnz_);
-    if (row_ == NULL_VALUE || col_ == NULL_VALUE || nnz_ == NULL_VALUE) {
+    if (!parseMtxHeader(cur, end, row, col, nnz) ||
+        !parseMtxLinesInParallel(cur, end, nnz, rowIndicesPerChunk, colIndicesPerChunk, valuesPerChunk)) {
         std::cerr << "Error, file " << file << " format is incorrect!" << std::endl;
         return false;
     }
 
-    std::vector<UIN> rowIndices(nnz_);
-    std::vector<UIN> colIndices(nnz_);
-    std::vector<T> values(nnz_);
+    return true;
+}
 
-    UIN idx = 0;
-    while (getline(inFile, line)) {
-        UIN row = NULL_VALUE, col = NULL_VALUE;
-        T val;
-        if (!getOneLineThreeData(line, row, col, val)) {
-            continue;
+/**
+ * Parse the compressed mtx file while it is being decompressed.
+ * The decoder thread decompresses the next blocks while all the OpenMP threads parse the current one.
+ **/
+template<typename T>
+bool parseCompressedMtxFile(const std::string &file, UIN &row, UIN &col, UIN &nnz,
+                            std::vector<std::vector<UIN>> &rowIndicesPerChunk,
+                            std::vector<std::vector<UIN>> &colIndicesPerChunk,
+                            std::vector<std::vector<T>> &valuesPerChunk) {
+    CompressedFileReader reader;
+    if (!reader.open(file)) {
+        return false;
+    }
+
+    std::cout << "sparseMatrix::CSR initialize from file : " << file << std::endl;
+
+    bool isHeaderParsed = false;
+    std::vector<char> block;
+    while (reader.nextLineBlock(block)) {
+        const char *end = block.data() + block.size();
+        const char *cur = block.data();
+        if (!isHeaderParsed) {
+            cur = parser::skipCommentLines(cur, end, '%'); // Skip comments
+            if (cur >= end) {
+                continue;
+            }
+            if (!parseMtxHeader(cur, end, row, col, nnz)) {
+                std::cerr << "Error, file " << file << " format is incorrect!" << std::endl;
+                return false;
+            }
+            isHeaderParsed = true;
         }
 
-        if (idx >= nnz_) {
-            std::cerr << "Error, file " << file << " too many elements, exceeding the number nnz!" << std::endl;
+        if (!parseMtxLinesInParallel(cur, end, nnz, rowIndicesPerChunk, colIndicesPerChunk, valuesPerChunk)) {
+            std::cerr << "Error, file " << file << " format is incorrect!" << std::endl;
             return false;
         }
+    }
+    if (reader.hasError()) {
+        return false;
+    }
+    if (!isHeaderParsed) {
+        std::cerr << "Error, file " << file << " format is incorrect!" << std::endl;
+        return false;
+    }
 
-        rowIndices[idx] = row - 1;
-        colIndices[idx] = col - 1;
-        values[idx] = val;
+    return true;
+}
 
-        ++idx;
-    }
+/**
+ * Check the COO data parsed from the mtx file and build the CSR arrays from it.
+ **/
+template<typename T>
+bool buildCsrFromMtxChunks(const std::string &file, const UIN row, const UIN col, const UIN nnz,
+                           std::vector<std::vector<UIN>> &rowIndicesPerChunk,
+                           std::vector<std::vector<UIN>> &colIndicesPerChunk,
+                           const std::vector<std::vector<T>> &valuesPerChunk,
+                           std::vector<UIN> &rowOffsets,
+                           std::vector<UIN> &colIndices,
+                           std::vector<T> &values) {
+    const int numChunks = rowIndicesPerChunk.size();
 
     // Check data
-    if (idx < nnz_) {
+    size_t numElements = 0;
+    for (const auto &rowIndicesCurrentChunk : rowIndicesPerChunk) {
+        numElements += rowIndicesCurrentChunk.size();
+    }
+    if (numElements > nnz) {
+        std::cerr << "Error, file " << file << " too many elements, exceeding the number nnz!" << std::endl;
+        return false;
+    }
+    if (numElements < nnz) {
         std::cerr << "Error, file " << file << " elements is not enough!" << std::endl;
         return false;
     }
-    std::set<std::pair<UIN, UIN>> rowColSet;
-    for (int idx = 0; idx < nnz_; ++idx) {
-        const UIN row = rowIndices[idx];
-        const UIN col = colIndices[idx];
-        if (row >= row_ || col >= col_) {
-            std::cerr << "Error, file " << file << " row or col is too big!" << std::endl;
-            return false;
-        }
-        std::pair<UIN, UIN> rowColPair(row, col);
-        if (rowColSet.find(rowColPair) != rowColSet.end()) {
-            std::cerr << "Error, matrix has duplicate data!" << std::endl;
-            return false;
+    bool isIndexOutOfRange = false;
+#pragma omp parallel for schedule(dynamic, 1) reduction(|| : isIndexOutOfRange)
+    for (int chunkId = 0; chunkId < numChunks; ++chunkId) {
+        std::vector<UIN> &rowIndicesCurrentChunk = rowIndicesPerChunk[chunkId];
+        std::vector<UIN> &colIndicesCurrentChunk = colIndicesPerChunk[chunkId];
+        for (size_t idx = 0; idx < rowIndicesCurrentChunk.size(); ++idx) {
+            // Matrix Market indices start from 1. An index of 0 wraps around and is caught as too big
+            const UIN curRow = --rowIndicesCurrentChunk[idx];
+            const UIN curCol = --colIndicesCurrentChunk[idx];
+            if (curRow >= row || curCol >= col) {
+                isIndexOutOfRange = true;
+            }
         }
-        rowColSet.insert(rowColPair);
     }
-    if (nnz_ <= 1) {
+    if (isIndexOutOfRange) {
+        std::cerr << "Error, file " << file << " row or col is too big!" << std::endl;
+        return false;
+    }
+
+    if (!buildCsrFromCooChunks(row, rowIndicesPerChunk, colIndicesPerChunk, valuesPerChunk,
+                               rowOffsets, colIndices, values)) {
+        std::cerr << "Error, matrix has duplicate data!" << std::endl;
+        return false;
+    }
+    if (nnz <= 1) {
         std::cerr << "Warning, file " << file << " nnz is 1, this is not a valid matrix!" << std::endl;
         return false;
     }
 
-    host::sort_by_key_for_multiple_vectors(rowIndices.data(),
-                                           rowIndices.data() + rowIndices.size(),
-                                           colIndices.data(),
-                                           values.data());
+    return true;
+}
 
-    std::vector<UIN> rowOffsets;
-    getCsrRowOffsets(row_, rowIndices, rowOffsets_);
-    colIndices_ = colIndices;
-    values_ = values;
+template<typename T>
+bool sparseMatrix::CSR<T>::initializeFromMtxFile(const std::string &file) {
+    // Each thread parses its own chunk of lines
+    const int numChunks = omp_get_max_threads();
+    std::vector<std::vector<UIN>> rowIndicesPerChunk(numChunks);
+    std::vector<std::vector<UIN>> colIndicesPerChunk(numChunks);
+    std::vector<std::vector<T>> valuesPerChunk(numChunks);
+    const bool isParsed = CompressedFileReader::isCompressedFile(file)
+                          ? parseCompressedMtxFile(file, row_, col_, nnz_,
+                                                   rowIndicesPerChunk, colIndicesPerChunk, valuesPerChunk)
+                          : parseMtxFile(file, row_, col_, nnz_,
+                                         rowIndicesPerChunk, colIndicesPerChunk, valuesPerChunk);
+    if (!isParsed) {
+        return false;
+    }
 
-    inFile.close();
+    std::vector<UIN> rowOffsets, colIndices;
+    if (!buildCsrFromMtxChunks(file, row_, col_, nnz_, rowIndicesPerChunk, colIndicesPerChunk, valuesPerChunk,
+                               rowOffsets, colIndices, values_)) {
+        return false;
+    }
+    rowOffsets_ = std::move(rowOffsets);
+    colIndices_ = std::move(colIndices);
 
     return true;
 }
 
 template<typename T>
-bool sparseMatrix::CSR<T>::initializeFromGraphDataset(const std::string &file) {
-    std::ifstream inFile;
-    inFile.open(file, std::ios::in); // open file
-    if (!inFile.is_open()) {
+bool sparseMatrix::CSR<T>::initializeFromGraphDataset(const std::string &file, const bool degreeOrderedRelabel) {
+    MappedFile mappedFile;
+    if (!mappedFile.open(file)) {
         std::cerr << "Error, file cannot be opened : " << file << std::endl;
         return false;
     }
 
     std::cout << "sparseMatrix::CSR initialize From file : " << file << std::endl;
 
-    std::string line; // Store the data for each line
-    while (getline(inFile, line) && line[0] == '#') {
+    const char *end = mappedFile.end();
+    const char *cur = mappedFile.data();
+    row_ = 0, col_ = 0, nnz_ = 0;
+    while (cur < end && *cur == '#') {
+        const char *next = parser::nextLine(cur, end);
+        const std::string line(cur, next);
         int wordIter = 0;
         const std::string nodesStr("Nodes: ");
         const std::string edgesStr("Edges: ");
@@ -506,6 +1103,7 @@ bool sparseMatrix::CSR<T>::initializeFromGraphDataset(const std::string &file) {
             const int edges = std::stoi(util::iterateOneWordFromLine(line, wordIter));
             nnz_ = edges;
         }
+        cur = next;
     }
 
     if (!row_ || !col_ || !nnz_) {
@@ -513,73 +1111,686 @@ bool sparseMatrix::CSR<T>::initializeFromGraphDataset(const std::string &file) {
         return false;
     }
 
-    std::vector<UIN> rowIndices(nnz_);
-    std::vector<UIN> colIndices(nnz_);
-    std::vector<T> values(nnz_, 0);
+    // Each thread parses one chunk of edges
+    const int numChunks = omp_get_max_threads();
+    const std::vector<const char *> chunkBoundaries = parser::splitIntoLineAlignedChunks(cur, end, numChunks);
+    std::vector<std::vector<UIN>> rowIndicesPerChunk(numChunks);
+    std::vector<std::vector<UIN>> colIndicesPerChunk(numChunks);
+    std::vector<std::vector<T>> valuesPerChunk(numChunks);
+    std::vector<char> isChunkParsed(numChunks, true);
+#pragma omp parallel for schedule(dynamic, 1)
+    for (int chunkId = 0; chunkId < numChunks; ++chunkId) {
+        const size_t approximateNumLines = nnz_ / numChunks + 1;
+        rowIndicesPerChunk[chunkId].reserve(approximateNumLines);
+        colIndicesPerChunk[chunkId].reserve(approximateNumLines);
+        valuesPerChunk[chunkId].reserve(approximateNumLines);
+        isChunkParsed[chunkId] = parseThreeDataLines(chunkBoundaries[chunkId], chunkBoundaries[chunkId + 1], '#',
+                                                     rowIndicesPerChunk[chunkId],
+                                                     colIndicesPerChunk[chunkId],
+                                                     valuesPerChunk[chunkId]);
+    }
+    if (std::find(isChunkParsed.begin(), isChunkParsed.end(), false) != isChunkParsed.end()) {
+        std::cerr << "Error, file " << file << " format is incorrect!" << std::endl;
+        return false;
+    }
 
-    UIN idx = 0;
-    std::unordered_map<UIN, UIN> nodeToIdMap;
-    UIN nodeCount = 0;
-    do {
-        UIN node, node2;
-        T third;
-        if (!getOneLineThreeData(line, node, node2, third)) {
-            continue;
+    // Check data
+    std::vector<size_t> chunkOffsets(numChunks + 1, 0);
+    for (int chunkId = 0; chunkId < numChunks; ++chunkId) {
+        chunkOffsets[chunkId + 1] = chunkOffsets[chunkId] + rowIndicesPerChunk[chunkId].size();
+    }
+    const size_t numEdges = chunkOffsets[numChunks];
+    if (numEdges > nnz_) {
+        std::cerr << "Error, file " << file << " too many elements, exceeding the number nnz!" << std::endl;
+        return false;
+    }
+    if (numEdges < nnz_) {
+        std::cerr << "Error, file " << file << " elements is not enough!" << std::endl;
+        return false;
+    }
+
+    // Collect the distinct node IDs
+    std::vector<UIN> nodes(numEdges * 2);
+#pragma omp parallel for schedule(dynamic, 1)
+    for (int chunkId = 0; chunkId < numChunks; ++chunkId) {
+        std::copy(rowIndicesPerChunk[chunkId].begin(), rowIndicesPerChunk[chunkId].end(),
+                  nodes.begin() + chunkOffsets[chunkId] * 2);
+        std::copy(colIndicesPerChunk[chunkId].begin(), colIndicesPerChunk[chunkId].end(),
+                  nodes.begin() + chunkOffsets[chunkId] * 2 + rowIndicesPerChunk[chunkId].size());
+    }
+    host::sort(nodes.data(), nodes.data() + nodes.size());
+    nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+    if (nodes.size() > row_) {
+        std::cerr << "Error, file " << file << " row or col is too big!" << std::endl;
+        return false;
+    }
+
+    // Relabel each node with its position in the sorted node IDs
+#pragma omp parallel for schedule(dynamic, 1)
+    for (int chunkId = 0; chunkId < numChunks; ++chunkId) {
+        for (UIN &node : rowIndicesPerChunk[chunkId]) {
+            node = std::lower_bound(nodes.begin(), nodes.end(), node) - nodes.begin();
         }
-        if (nodeToIdMap.find(node) == nodeToIdMap.end()) {
-            nodeToIdMap[node] = nodeCount;
-            ++nodeCount;
+        for (UIN &node : colIndicesPerChunk[chunkId]) {
+            node = std::lower_bound(nodes.begin(), nodes.end(), node) - nodes.begin();
         }
-        if (nodeToIdMap.find(node2) == nodeToIdMap.end()) {
-            nodeToIdMap[node2] = nodeCount;
-            ++nodeCount;
+    }
+
+    // Optionally relabel again in descending order of degree, so that the high degree nodes are next to each other
+    if (degreeOrderedRelabel) {
+        std::vector<UIN> degrees(nodes.size(), 0);
+#pragma omp parallel for schedule(dynamic, 1)
+        for (int chunkId = 0; chunkId < numChunks; ++chunkId) {
+            for (size_t idx = 0; idx < rowIndicesPerChunk[chunkId].size(); ++idx) {
+#pragma omp atomic
+                ++degrees[rowIndicesPerChunk[chunkId][idx]];
+#pragma omp atomic
+                ++degrees[colIndicesPerChunk[chunkId][idx]];
+            }
+        }
+
+        // Key: MAX_UIN - degree, the stable sort keeps the order of the labels for equal degrees
+        std::vector<UIN> reversedDegrees(nodes.size());
+        std::vector<UIN> labels(nodes.size());
+#pragma omp parallel for
+        for (UIN label = 0; label < nodes.size(); ++label) {
+            reversedDegrees[label] = MAX_UIN - degrees[label];
+            labels[label] = label;
         }
+        host::stable_sort_by_key(reversedDegrees.data(), reversedDegrees.data() + reversedDegrees.size(),
+                                 labels.data());
 
-        if (idx >= nnz_) {
-            std::cerr << "Error, file " << file << " too many elements, exceeding the number nnz!" << std::endl;
+        std::vector<UIN> newLabels(nodes.size());
+#pragma omp parallel for
+        for (UIN newLabel = 0; newLabel < labels.size(); ++newLabel) {
+            newLabels[labels[newLabel]] = newLabel;
+        }
+#pragma omp parallel for schedule(dynamic, 1)
+        for (int chunkId = 0; chunkId < numChunks; ++chunkId) {
+            for (UIN &node : rowIndicesPerChunk[chunkId]) {
+                node = newLabels[node];
+            }
+            for (UIN &node : colIndicesPerChunk[chunkId]) {
+                node = newLabels[node];
+            }
+        }
+    }
+
+    std::vector<UIN> rowOffsets, colIndices;
+    if (!buildCsrFromCooChunks(row_, rowIndicesPerChunk, colIndicesPerChunk, valuesPerChunk,
+                               rowOffsets, colIndices, values_)) {
+        std::cerr << "Error, matrix has duplicate data!" << std::endl;
+        return false;
+    }
+    rowOffsets_ = std::move(rowOffsets);
+    colIndices_ = std::move(colIndices);
+
+    return true;
+}
+
+/**
+ * Wrap an index array stored in a file. If the stored width is the width of UIN and the array is aligned,
+ * the result points into the file and `owner` keeps it alive. Otherwise the indices are converted,
+ * so the 32-bit and the 64-bit index builds read the same files.
+ **/
+bool makeIndexArray(const char *data, const size_t numElements, const size_t indexBytes,
+                    const std::shared_ptr<const void> &owner, SharedArray<UIN> &indices) {
+    if (indexBytes == sizeof(UIN) && reinterpret_cast<uintptr_t>(data) % alignof(UIN) == 0) {
+        indices = SharedArray<UIN>::borrow(reinterpret_cast<const UIN *>(data), numElements, owner);
+        return true;
+    }
+    if (indexBytes != sizeof(uint32_t) && indexBytes != sizeof(uint64_t)) {
+        return false;
+    }
+
+    std::vector<UIN> converted(numElements);
+    bool isInRange = true;
+#pragma omp parallel for reduction(&& : isInRange)
+    for (size_t idx = 0; idx < numElements; ++idx) {
+        uint64_t index;
+        if (indexBytes == sizeof(uint32_t)) {
+            uint32_t index32;
+            std::memcpy(&index32, data + idx * indexBytes, sizeof(uint32_t));
+            index = index32;
+        } else {
+            std::memcpy(&index, data + idx * indexBytes, sizeof(uint64_t));
+        }
+        isInRange = isInRange && index <= MAX_UIN;
+        converted[idx] = static_cast<UIN>(index);
+    }
+    if (!isInRange) {
+        return false;
+    }
+    indices = std::move(converted);
+    return true;
+}
+
+/**
+ * Header of the binary CSR file. Every field is little-endian.
+ **/
+struct CsrBinaryFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrderMark;
+    uint32_t indexBytes;
+    uint32_t valueType;
+    uint64_t row;
+    uint64_t col;
+    uint64_t nnz;
+    uint64_t rowOffsetsOffset;
+    uint64_t colIndicesOffset;
+    uint64_t valuesOffset; // 0 if all values are 1
+    uint64_t dataChecksum;
+    uint64_t headerChecksum;
+    char reserved[40];
+};
+static_assert(sizeof(CsrBinaryFileHeader) == 128, "The binary CSR file header must be 128 bytes");
+
+constexpr char csrBinaryFileMagic[8] = {'B', 'S', 'M', 'R', 'C', 'S', 'R', '\0'};
+constexpr uint32_t csrBinaryFileVersion = 1;
+constexpr uint32_t csrBinaryFileByteOrderMark = 0x01020304;
+constexpr uint64_t csrBinaryFileSectionAlignment = 64;
+
+enum CsrBinaryFileValueType : uint32_t {
+    noValue = 0,
+    int32Value = 1,
+    float32Value = 2,
+    float64Value = 3
+};
+
+template<typename T>
+uint32_t getCsrBinaryFileValueType();
+
+template<>
+uint32_t getCsrBinaryFileValueType<int>() { return CsrBinaryFileValueType::int32Value; }
+
+template<>
+uint32_t getCsrBinaryFileValueType<float>() { return CsrBinaryFileValueType::float32Value; }
+
+template<>
+uint32_t getCsrBinaryFileValueType<double>() { return CsrBinaryFileValueType::float64Value; }
+
+uint32_t getCsrBinaryFileValueBytes(const uint32_t valueType) {
+    switch (valueType) {
+        case CsrBinaryFileValueType::int32Value:
+        case CsrBinaryFileValueType::float32Value: return 4;
+        case CsrBinaryFileValueType::float64Value: return 8;
+        default: return 0;
+    }
+}
+
+uint64_t alignToCsrBinaryFileSection(const uint64_t offset) {
+    return (offset + csrBinaryFileSectionAlignment - 1) / csrBinaryFileSectionAlignment
+        * csrBinaryFileSectionAlignment;
+}
+
+/**
+ * 64-bit FNV-1a over 8 bytes words, the tail is read byte by byte.
+ **/
+uint64_t hashBytes(const char *data, const size_t size, uint64_t hash = 0xcbf29ce484222325ULL) {
+    constexpr uint64_t prime = 0x100000001b3ULL;
+    size_t idx = 0;
+    for (; idx + sizeof(uint64_t) <= size; idx += sizeof(uint64_t)) {
+        uint64_t word;
+        std::memcpy(&word, data + idx, sizeof(uint64_t));
+        hash = (hash ^ word) * prime;
+    }
+    for (; idx < size; ++idx) {
+        hash = (hash ^ static_cast<unsigned char>(data[idx])) * prime;
+    }
+    return hash;
+}
+
+/**
+ * Checksum of the data sections. The data is hashed in 1 MB blocks by all threads,
+ * then the block hashes are combined in order, so the result does not depend on the number of threads.
+ **/
+uint64_t calculateCsrBinaryFileDataChecksum(const std::vector<std::pair<const char *, size_t>> &sections) {
+    constexpr size_t blockSize = 1 << 20;
+
+    uint64_t checksum = 0;
+    for (const auto &section : sections) {
+        const size_t numBlocks = (section.second + blockSize - 1) / blockSize;
+        std::vector<uint64_t> blockHashes(numBlocks);
+#pragma omp parallel for schedule(static)
+        for (size_t blockId = 0; blockId < numBlocks; ++blockId) {
+            const size_t begin = blockId * blockSize;
+            blockHashes[blockId] = hashBytes(section.first + begin, std::min(blockSize, section.second - begin));
+        }
+        checksum = hashBytes(reinterpret_cast<const char *>(blockHashes.data()),
+                             blockHashes.size() * sizeof(uint64_t),
+                             hashBytes(reinterpret_cast<const char *>(&section.second), sizeof(size_t), checksum));
+    }
+
+    return checksum;
+}
+
+uint64_t calculateCsrBinaryFileHeaderChecksum(CsrBinaryFileHeader header) {
+    header.headerChecksum = 0;
+    return hashBytes(reinterpret_cast<const char *>(&header), sizeof(CsrBinaryFileHeader));
+}
+
+template<typename T, typename ValueType>
+void copyCsrBinaryFileValues(const char *data, const UIN nnz, std::vector<T> &values) {
+    values.resize(nnz);
+    const ValueType *fileValues = reinterpret_cast<const ValueType *>(data);
+#pragma omp parallel for
+    for (UIN idx = 0; idx < nnz; ++idx) {
+        values[idx] = static_cast<T>(fileValues[idx]);
+    }
+}
+
+template<typename T>
+bool sparseMatrix::CSR<T>::initializeFromBinaryFile(const std::string &file, const bool verifyChecksum) {
+    auto mappedFile = std::make_shared<MappedFile>();
+    if (!mappedFile->open(file, false)) {
+        std::cerr << "Error, file cannot be opened : " << file << std::endl;
+        return false;
+    }
+
+    std::cout << "sparseMatrix::CSR initialize from file : " << file << std::endl;
+
+    // Check header
+    CsrBinaryFileHeader header;
+    if (mappedFile->size() < sizeof(CsrBinaryFileHeader)) {
+        std::cerr << "Error, file " << file << " format is incorrect!" << std::endl;
+        return false;
+    }
+    std::memcpy(&header, mappedFile->data(), sizeof(CsrBinaryFileHeader));
+    if (std::memcmp(header.magic, csrBinaryFileMagic, sizeof(csrBinaryFileMagic)) != 0
+        || header.headerChecksum != calculateCsrBinaryFileHeaderChecksum(header)) {
+        std::cerr << "Error, file " << file << " format is incorrect!" << std::endl;
+        return false;
+    }
+    if (header.version != csrBinaryFileVersion || header.byteOrderMark != csrBinaryFileByteOrderMark) {
+        std::cerr << "Error, file " << file << " version " << header.version
+                  << " or byte order is not supported!" << std::endl;
+        return false;
+    }
+    if ((header.indexBytes != sizeof(uint32_t) && header.indexBytes != sizeof(uint64_t))
+        || header.row >= NULL_VALUE || header.col >= NULL_VALUE || header.nnz >= NULL_VALUE) {
+        std::cerr << "Error, file " << file << " exceeds the range of UIN, use the 64-bit index build!" << std::endl;
+        return false;
+    }
+    if (header.valueType > CsrBinaryFileValueType::float64Value) {
+        std::cerr << "Error, file " << file << " value type is not supported!" << std::endl;
+        return false;
+    }
+
+    // Check sections, the sizes are bounded by the file size first so the numbers of bytes do not overflow
+    const uint64_t maxNumElements = mappedFile->size() / header.indexBytes;
+    if (header.row >= maxNumElements || header.nnz > maxNumElements) {
+        std::cerr << "Error, file " << file << " is truncated!" << std::endl;
+        return false;
+    }
+    const uint64_t rowOffsetsBytes = (header.row + 1) * header.indexBytes;
+    const uint64_t colIndicesBytes = header.nnz * header.indexBytes;
+    const uint64_t valuesBytes = header.nnz * getCsrBinaryFileValueBytes(header.valueType);
+    const auto isSectionValid = [&](const uint64_t offset, const uint64_t bytes) {
+        return offset >= sizeof(CsrBinaryFileHeader) && offset % csrBinaryFileSectionAlignment == 0
+            && offset <= mappedFile->size() && bytes <= mappedFile->size() - offset;
+    };
+    if (!isSectionValid(header.rowOffsetsOffset, rowOffsetsBytes)
+        || !isSectionValid(header.colIndicesOffset, colIndicesBytes)
+        || (header.valueType != CsrBinaryFileValueType::noValue && !isSectionValid(header.valuesOffset, valuesBytes))) {
+        std::cerr << "Error, file " << file << " is truncated!" << std::endl;
+        return false;
+    }
+    const char *rowOffsetsData = mappedFile->data() + header.rowOffsetsOffset;
+    const char *colIndicesData = mappedFile->data() + header.colIndicesOffset;
+    const char *valuesData = mappedFile->data() + header.valuesOffset;
+
+    if (verifyChecksum) {
+        std::vector<std::pair<const char *, size_t>> sections{{rowOffsetsData, rowOffsetsBytes},
+                                                              {colIndicesData, colIndicesBytes}};
+        if (header.valueType != CsrBinaryFileValueType::noValue) {
+            sections.emplace_back(valuesData, valuesBytes);
+        }
+        if (calculateCsrBinaryFileDataChecksum(sections) != header.dataChecksum) {
+            std::cerr << "Error, file " << file << " checksum mismatch!" << std::endl;
             return false;
         }
+    }
+
+    // The structure stays in the mapped file, the values are copied because the SDDMM result is written into them
+    SharedArray<UIN> rowOffsets, colIndices;
+    if (!makeIndexArray(rowOffsetsData, header.row + 1, header.indexBytes, mappedFile, rowOffsets)
+        || !makeIndexArray(colIndicesData, header.nnz, header.indexBytes, mappedFile, colIndices)) {
+        std::cerr << "Error, file " << file << " exceeds the range of UIN, use the 64-bit index build!" << std::endl;
+        return false;
+    }
+    // The kernels trust the structure, so a corrupt or foreign file must not reach them
+    if (!checkCsrStructure(file, header.row, header.col, header.nnz, rowOffsets.data(), colIndices.data())) {
+        return false;
+    }
 
-        rowIndices[idx] = nodeToIdMap[node];
-        colIndices[idx] = nodeToIdMap[node2];
-        values[idx] = third;
+    row_ = header.row;
+    col_ = header.col;
+    nnz_ = header.nnz;
 
-        ++idx;
-    } while (getline(inFile, line));
+    // A file without values has all the values 1, they are left empty instead of filled
+    rowOffsets_ = std::move(rowOffsets);
+    colIndices_ = std::move(colIndices);
+    values_.clear();
+    switch (header.valueType) {
+        case CsrBinaryFileValueType::int32Value: copyCsrBinaryFileValues<T, int32_t>(valuesData, nnz_, values_);
+            break;
+        case CsrBinaryFileValueType::float32Value: copyCsrBinaryFileValues<T, float>(valuesData, nnz_, values_);
+            break;
+        case CsrBinaryFileValueType::float64Value: copyCsrBinaryFileValues<T, double>(valuesData, nnz_, values_);
+            break;
+        default: break;
+    }
 
-    // Check data
-    if (idx < nnz_) {
-        std::cerr << "Error, file " << file << " elements is not enough!" << std::endl;
+    return true;
+}
+
+template<typename T>
+bool sparseMatrix::CSR<T>::outputToBinaryFile(const std::string &file) const {
+    bool isAllOne = true;
+#pragma omp parallel for reduction(&& : isAllOne)
+    for (UIN idx = 0; idx < values_.size(); ++idx) {
+        isAllOne = isAllOne && values_[idx] == static_cast<T>(1);
+    }
+
+    CsrBinaryFileHeader header{};
+    std::memcpy(header.magic, csrBinaryFileMagic, sizeof(csrBinaryFileMagic));
+    header.version = csrBinaryFileVersion;
+    header.byteOrderMark = csrBinaryFileByteOrderMark;
+    header.indexBytes = sizeof(UIN);
+    header.valueType = isAllOne ? CsrBinaryFileValueType::noValue : getCsrBinaryFileValueType<T>();
+    header.row = row_;
+    header.col = col_;
+    header.nnz = nnz_;
+
+    const uint64_t rowOffsetsBytes = rowOffsets_.size() * sizeof(UIN);
+    const uint64_t colIndicesBytes = colIndices_.size() * sizeof(UIN);
+    const uint64_t valuesBytes = isAllOne ? 0 : values_.size() * sizeof(T);
+    header.rowOffsetsOffset = alignToCsrBinaryFileSection(sizeof(CsrBinaryFileHeader));
+    header.colIndicesOffset = alignToCsrBinaryFileSection(header.rowOffsetsOffset + rowOffsetsBytes);
+    header.valuesOffset = isAllOne ? 0 : alignToCsrBinaryFileSection(header.colIndicesOffset + colIndicesBytes);
+
+    std::vector<std::pair<const char *, size_t>> sections{
+        {reinterpret_cast<const char *>(rowOffsets_.data()), rowOffsetsBytes},
+        {reinterpret_cast<const char *>(colIndices_.data()), colIndicesBytes}};
+    if (!isAllOne) {
+        sections.emplace_back(reinterpret_cast<const char *>(values_.data()), valuesBytes);
+    }
+    header.dataChecksum = calculateCsrBinaryFileDataChecksum(sections);
+    header.headerChecksum = calculateCsrBinaryFileHeaderChecksum(header);
+
+    std::ofstream outfile(file, std::ios::binary);
+    if (!outfile.is_open()) {
+        std::cerr << "Unable to create file: " << file << std::endl;
         return false;
     }
-    std::set<std::pair<UIN, UIN>> rowColSet;
-    for (int idx = 0; idx < nnz_; ++idx) {
-        const UIN row = rowIndices[idx];
-        const UIN col = colIndices[idx];
-        if (row >= row_ || col >= col_) {
-            std::cerr << "Error, file " << file << " row or col is too big!" << std::endl;
+
+    const char padding[csrBinaryFileSectionAlignment] = {};
+    outfile.write(reinterpret_cast<const char *>(&header), sizeof(CsrBinaryFileHeader));
+    uint64_t offset = sizeof(CsrBinaryFileHeader);
+    const uint64_t sectionOffsets[] = {header.rowOffsetsOffset, header.colIndicesOffset, header.valuesOffset};
+    for (size_t sectionId = 0; sectionId < sections.size(); ++sectionId) {
+        outfile.write(padding, sectionOffsets[sectionId] - offset);
+        outfile.write(sections[sectionId].first, sections[sectionId].second);
+        offset = sectionOffsets[sectionId] + sections[sectionId].second;
+    }
+
+    outfile.close();
+    if (!outfile) {
+        std::cerr << "Error, failed to write file: " << file << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+template<typename T>
+uint64_t sparseMatrix::CSR<T>::structureHash() const {
+    const uint64_t size[] = {row_, col_, nnz_};
+    const std::vector<std::pair<const char *, size_t>> sections{
+        {reinterpret_cast<const char *>(size), sizeof(size)},
+        {reinterpret_cast<const char *>(rowOffsets_.data()), rowOffsets_.size() * sizeof(UIN)},
+        {reinterpret_cast<const char *>(colIndices_.data()), colIndices_.size() * sizeof(UIN)}};
+
+    // Same block-parallel hash as the data checksum of the binary file
+    return calculateCsrBinaryFileDataChecksum(sections);
+}
+
+/**
+ * Read a scalar integer (a 0-d or one element array) of the npz file.
+ **/
+bool getNpyScalar(const NpzFile &npzFile, const std::string &name, uint64_t &value) {
+    NpyArray array;
+    if (!npzFile.getArray(name, array) || array.numElements() != 1) {
+        return false;
+    }
+    if ((array.dtype == "<i8" || array.dtype == "<u8") && array.numBytes >= 8) {
+        int64_t number;
+        std::memcpy(&number, array.data, 8);
+        value = number;
+        return number >= 0;
+    }
+    if ((array.dtype == "<i4" || array.dtype == "<u4") && array.numBytes >= 4) {
+        int32_t number;
+        std::memcpy(&number, array.data, 4);
+        value = number;
+        return number >= 0;
+    }
+    return false;
+}
+
+/**
+ * Convert an integer array `name` of the npz file, already read into `array`, to UIN.
+ * Aligned arrays of the width of UIN are not copied, the result points into the mapped (or inflated) member.
+ **/
+bool getNpyIndexArray(const NpyArray &array, const std::string &file, const std::string &name,
+                      const size_t numElements, SharedArray<UIN> &indices) {
+    if (array.shape.size() != 1 || array.shape[0] != numElements) {
+        std::cerr << "Error, file " << file << " array " << name << " size is incorrect!" << std::endl;
+        return false;
+    }
+
+    size_t indexBytes = 0;
+    if (array.dtype == "<i4" || array.dtype == "<u4") {
+        indexBytes = sizeof(uint32_t);
+    } else if (array.dtype == "<i8" || array.dtype == "<u8") {
+        indexBytes = sizeof(uint64_t);
+    } else {
+        std::cerr << "Error, file " << file << " array " << name << " type " << array.dtype
+                  << " is not supported!" << std::endl;
+        return false;
+    }
+    if (array.numBytes < numElements * indexBytes) {
+        std::cerr << "Error, file " << file << " array " << name << " is truncated!" << std::endl;
+        return false;
+    }
+    if (!makeIndexArray(array.data, numElements, indexBytes, array.owner, indices)) {
+        std::cerr << "Error, file " << file << " array " << name << " exceeds the range of UIN!" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Read an integer array of the npz file as UIN, see the overload above.
+ **/
+bool getNpyIndexArray(const NpzFile &npzFile, const std::string &file, const std::string &name,
+                      const size_t numElements, SharedArray<UIN> &indices) {
+    NpyArray array;
+    if (!npzFile.getArray(name, array)) {
+        return false;
+    }
+    return getNpyIndexArray(array, file, name, numElements, indices);
+}
+
+/**
+ * Read the value array of the npz file and convert it to T. A missing array means that every value is 1.
+ **/
+template<typename T>
+bool getNpyValueArray(const NpzFile &npzFile, const std::string &file, const std::string &name,
+                      const size_t numElements, std::vector<T> &values) {
+    if (!npzFile.contains(name)) {
+        values.assign(numElements, static_cast<T>(1));
+        return true;
+    }
+    NpyArray array;
+    if (!npzFile.getArray(name, array)) {
+        return false;
+    }
+    if (array.shape.size() != 1 || array.shape[0] != numElements) {
+        std::cerr << "Error, file " << file << " array " << name << " size is incorrect!" << std::endl;
+        return false;
+    }
+
+    const auto convert = [&](auto typeTag) {
+        using ValueType = decltype(typeTag);
+        if (array.numBytes < numElements * sizeof(ValueType)) {
             return false;
         }
-        std::pair<UIN, UIN> rowColPair(row, col);
-        if (rowColSet.find(rowColPair) != rowColSet.end()) {
-            fprintf(stderr, "Error, matrix has duplicate data! row:%d, col:%d\n",
-                    row, col);
+        values.resize(numElements);
+#pragma omp parallel for
+        for (size_t idx = 0; idx < numElements; ++idx) {
+            ValueType value;
+            std::memcpy(&value, array.data + idx * sizeof(ValueType), sizeof(ValueType));
+            values[idx] = static_cast<T>(value);
+        }
+        return true;
+    };
+    bool isConverted = false;
+    if (array.dtype == "<f4") {
+        isConverted = convert(float());
+    } else if (array.dtype == "<f8") {
+        isConverted = convert(double());
+    } else if (array.dtype == "<i4") {
+        isConverted = convert(int32_t());
+    } else if (array.dtype == "<i8") {
+        isConverted = convert(int64_t());
+    }
+    if (!isConverted) {
+        std::cerr << "Error, file " << file << " array " << name << " type " << array.dtype
+                  << " is not supported!" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+template<typename T>
+bool sparseMatrix::CSR<T>::initializeFromNpzFile(const std::string &file) {
+    NpzFile npzFile;
+    if (!npzFile.open(file)) {
+        return false;
+    }
+
+    std::cout << "sparseMatrix::CSR initialize from file : " << file << std::endl;
+
+    // Matrix format of `scipy.sparse.save_npz`, or the edge list of scripts/convert_mtx_to_npz.py
+    std::string format;
+    uint64_t numRow = 0, numCol = 0, nnz = 0;
+    std::string rowName, colName;
+    // The array whose size is nnz, "indices" of CSR or the row indices of COO. It is read once and converted later,
+    // so a deflated member is not inflated twice
+    NpyArray nnzArray;
+    if (npzFile.contains("format") && npzFile.contains("shape")) {
+        NpyArray formatArray, shapeArray;
+        if (!npzFile.getArray("format", formatArray) || !npzFile.getArray("shape", shapeArray)
+            || shapeArray.dtype != "<i8" || shapeArray.numElements() != 2 || shapeArray.numBytes < 16) {
+            std::cerr << "Error, file " << file << " format is incorrect!" << std::endl;
             return false;
         }
-        rowColSet.insert(rowColPair);
+        // "|S3" for the bytes written by scipy, "<U3" (UTF-32) if the string was saved as str
+        const size_t charBytes = formatArray.dtype.compare(0, 2, "<U") == 0 ? 4 : 1;
+        for (size_t idx = 0; idx < formatArray.numBytes && formatArray.data[idx] != '\0'; idx += charBytes) {
+            format.push_back(formatArray.data[idx]);
+        }
+        int64_t shape[2];
+        std::memcpy(shape, shapeArray.data, sizeof(shape));
+        numRow = shape[0], numCol = shape[1];
+        if (format == "csr") {
+            if (!npzFile.getArray("indices", nnzArray)) {
+                return false;
+            }
+        } else if (format == "coo") {
+            rowName = "row", colName = "col";
+        } else {
+            std::cerr << "Error, file " << file << " sparse format \"" << format << "\" is not supported!" << std::endl;
+            return false;
+        }
+    } else if (npzFile.contains("src_li") && npzFile.contains("dst_li")) {
+        if (!getNpyScalar(npzFile, "num_nodes_src", numRow) || !getNpyScalar(npzFile, "num_nodes_dst", numCol)) {
+            std::cerr << "Error, file " << file << " format is incorrect!" << std::endl;
+            return false;
+        }
+        format = "coo";
+        rowName = "src_li", colName = "dst_li";
+    } else {
+        std::cerr << "Error, file " << file << " has no sparse matrix!" << std::endl;
+        return false;
+    }
+    if (format == "coo" && !npzFile.getArray(rowName, nnzArray)) {
+        return false;
+    }
+    nnz = nnzArray.numElements();
+    if (numRow >= NULL_VALUE || numCol >= NULL_VALUE || nnz >= NULL_VALUE) {
+        std::cerr << "Error, file " << file << " exceeds the range of UIN!" << std::endl;
+        return false;
     }
+    row_ = numRow;
+    col_ = numCol;
+    nnz_ = nnz;
 
-    host::sort_by_key_for_multiple_vectors(rowIndices.data(),
-                                           rowIndices.data() + rowIndices.size(),
-                                           colIndices.data(),
-                                           values.data());
+    // Already CSR: use the arrays as they are
+    if (format == "csr") {
+        SharedArray<UIN> rowOffsets, colIndices;
+        if (!getNpyIndexArray(npzFile, file, "indptr", row_ + 1, rowOffsets) ||
+            !getNpyIndexArray(nnzArray, file, "indices", nnz_, colIndices) ||
+            !checkCsrStructure(file, row_, col_, nnz_, rowOffsets.data(), colIndices.data()) ||
+            !getNpyValueArray(npzFile, file, "data", nnz_, values_)) {
+            return false;
+        }
+        rowOffsets_ = std::move(rowOffsets);
+        colIndices_ = std::move(colIndices);
+        return true;
+    }
 
-    std::vector<UIN> rowOffsets;
-    getCsrRowOffsets(row_, rowIndices, rowOffsets_);
-    colIndices_ = colIndices;
-    values_ = values;
+    // COO: split the arrays between the threads and build the CSR with the counting sort
+    SharedArray<UIN> rowIndices, colIndices;
+    std::vector<T> values;
+    if (!getNpyIndexArray(nnzArray, file, rowName, nnz_, rowIndices) ||
+        !getNpyIndexArray(npzFile, file, colName, nnz_, colIndices) ||
+        !getNpyValueArray(npzFile, file, "data", nnz_, values)) {
+        return false;
+    }
+    const int numChunks = omp_get_max_threads();
+    std::vector<std::vector<UIN>> rowIndicesPerChunk(numChunks);
+    std::vector<std::vector<UIN>> colIndicesPerChunk(numChunks);
+    std::vector<std::vector<T>> valuesPerChunk(numChunks);
+    bool isIndexOutOfRange = false;
+#pragma omp parallel for schedule(static, 1) reduction(|| : isIndexOutOfRange)
+    for (int chunkId = 0; chunkId < numChunks; ++chunkId) {
+        const size_t begin = static_cast<size_t>(nnz_) * chunkId / numChunks;
+        const size_t end = static_cast<size_t>(nnz_) * (chunkId + 1) / numChunks;
+        rowIndicesPerChunk[chunkId].assign(rowIndices.begin() + begin, rowIndices.begin() + end);
+        colIndicesPerChunk[chunkId].assign(colIndices.begin() + begin, colIndices.begin() + end);
+        valuesPerChunk[chunkId].assign(values.begin() + begin, values.begin() + end);
+        for (size_t idx = 0; idx < end - begin; ++idx) {
+            if (rowIndicesPerChunk[chunkId][idx] >= row_ || colIndicesPerChunk[chunkId][idx] >= col_) {
+                isIndexOutOfRange = true;
+            }
+        }
+    }
+    if (isIndexOutOfRange) {
+        std::cerr << "Error, file " << file << " row or col is too big!" << std::endl;
+        return false;
+    }
 
-    inFile.close();
+    std::vector<UIN> rowOffsets, csrColIndices;
+    if (!buildCsrFromCooChunks(row_, rowIndicesPerChunk, colIndicesPerChunk, valuesPerChunk,
+                               rowOffsets, csrColIndices, values_)) {
+        std::cerr << "Error, matrix has duplicate data!" << std::endl;
+        return false;
+    }
+    rowOffsets_ = std::move(rowOffsets);
+    colIndices_ = std::move(csrColIndices);
 
     return true;
 }
@@ -610,10 +1821,10 @@ sparseMatrix::COO<T>::COO(const CSR<T> &csr) {
     values_.resize(nnz_);
 
 #pragma omp parallel for
-    for (int row = 0; row < row_; ++row) {
-        for (int idx = csr.rowOffsets()[row]; idx < csr.rowOffsets()[row + 1]; ++idx) {
+    for (UIN row = 0; row < row_; ++row) {
+        for (UIN idx = csr.rowOffsets()[row]; idx < csr.rowOffsets()[row + 1]; ++idx) {
             const UIN col = csr.colIndices()[idx];
-            const T val = csr.values()[idx];
+            const T val = csr.values().empty() ? static_cast<T>(1) : csr.values()[idx];
 
             rowIndices_[idx] = row;
             colIndices_[idx] = col;
@@ -667,7 +1878,7 @@ bool sparseMatrix::COO<T>::initializeFromMatrixMarketFile(const std::string &fil
         return false;
     }
     std::set<std::pair<UIN, UIN>> rowColSet;
-    for (int idx = 0; idx < nnz_; ++idx) {
+    for (UIN idx = 0; idx < nnz_; ++idx) {
         const UIN row = rowIndices_[idx];
         const UIN col = colIndices_[idx];
         if (row >= row_ || col >= col_) {
@@ -752,7 +1963,7 @@ bool sparseMatrix::COO<T>::setValuesFromMatrix(const Matrix<T> &inputMatrix) {
     values_.resize(nnz_);
 
 #pragma omp parallel for
-    for (int idx = 0; idx < nnz_; ++idx) {
+    for (UIN idx = 0; idx < nnz_; ++idx) {
         const UIN row = rowIndices_[idx];
         const UIN col = colIndices_[idx];
 
@@ -858,8 +2069,8 @@ void sparseMatrix::COO<T>::draw() const {
     std::vector<UIN> rowOffsets(row_ + 1);
     getCsrRowOffsets(row_, rowIndicesTmp, rowOffsets);
 
-    printf("SparseMatrix : [%d,%d,%d]\n", row_, col_, nnz_);
-    for (int colIdx = 0; colIdx < col_ + 2; ++colIdx) {
+    printf("SparseMatrix : [%" PRIuUIN ",%" PRIuUIN ",%" PRIuUIN "]\n", row_, col_, nnz_);
+    for (UIN colIdx = 0; colIdx < col_ + 2; ++colIdx) {
         std::cout << "-";
     }
     std::cout << std::endl;
@@ -879,7 +2090,7 @@ void sparseMatrix::COO<T>::draw() const {
         std::cout << "|";
         std::cout << std::endl;
     }
-    for (int colIdx = 0; colIdx < col_ + 2; ++colIdx) {
+    for (UIN colIdx = 0; colIdx < col_ + 2; ++colIdx) {
         std::cout << "-";
     }
     std::cout << std::endl;
@@ -925,9 +2136,9 @@ bool checkMatrixData(const sparseMatrix::CSR<T> &csr) {
     }
 
     int numNonZeroRows = 0;
-    for (int row = 0; row < csr.row(); ++row) {
+    for (UIN row = 0; row < csr.row(); ++row) {
         if (csr.rowOffsets()[row] > csr.rowOffsets()[row + 1]) {
-            fprintf(stderr, "Error, CSR rowOffsets[%d] > rowOffsets[%d]\n", row, row + 1);
+            fprintf(stderr, "Error, CSR rowOffsets[%" PRIuUIN "] > rowOffsets[%" PRIuUIN "]\n", row, row + 1);
             return false;
         }
         if (csr.rowOffsets()[row + 1] - csr.rowOffsets()[row] > 0) {
@@ -935,12 +2146,12 @@ bool checkMatrixData(const sparseMatrix::CSR<T> &csr) {
         }
     }
     if (numNonZeroRows == 0 && csr.nnz() > 0) {
-        fprintf(stderr, "Error, CSR nnz is %d, but no non-zero rows!\n", csr.nnz());
+        fprintf(stderr, "Error, CSR nnz is %" PRIuUIN ", but no non-zero rows!\n", csr.nnz());
         return false;
     }
 
-    for (int row = 0; row < csr.row(); ++row) {
-        for (int idx = csr.rowOffsets()[row]; idx < csr.rowOffsets()[row + 1]; ++idx) {
+    for (UIN row = 0; row < csr.row(); ++row) {
+        for (UIN idx = csr.rowOffsets()[row]; idx < csr.rowOffsets()[row + 1]; ++idx) {
             const UIN col = csr.colIndices()[idx];
             if (col >= csr.col()) {
                 return false;
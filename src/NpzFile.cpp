@@ -0,0 +1,276 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#include <zlib.h>
+
+#include "NpzFile.hpp"
+
+namespace{
+constexpr uint32_t localFileHeaderSignature = 0x04034b50;
+constexpr uint32_t centralDirectoryHeaderSignature = 0x02014b50;
+constexpr uint32_t endOfCentralDirectorySignature = 0x06054b50;
+constexpr uint32_t zip64EndOfCentralDirectorySignature = 0x06064b50;
+constexpr uint32_t zip64EndOfCentralDirectoryLocatorSignature = 0x07064b50;
+constexpr uint16_t zip64ExtraFieldId = 0x0001;
+constexpr uint16_t compressionMethodStored = 0;
+constexpr uint16_t compressionMethodDeflated = 8;
+
+// Zip fields are little-endian and not aligned
+template <typename T>
+T readLittleEndian(const char* data){
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return value;
+}
+
+/**
+ * Parse the header of a .npy file: magic string, version, header length, then a python dict such as
+ * "{'descr': '<i4', 'fortran_order': False, 'shape': (10,), }".
+ * Return the position of the first element, or nullptr if the header is invalid.
+ **/
+const char* parseNpyHeader(const char* data, const size_t size, std::string& dtype, std::vector<size_t>& shape){
+    if (size < 10 || std::memcmp(data, "\x93NUMPY", 6) != 0){
+        return nullptr;
+    }
+    const uint8_t majorVersion = static_cast<uint8_t>(data[6]);
+    size_t headerLength, headerBegin;
+    if (majorVersion == 1){
+        headerLength = readLittleEndian<uint16_t>(data + 8);
+        headerBegin = 10;
+    }
+    else{
+        if (size < 12){
+            return nullptr;
+        }
+        headerLength = readLittleEndian<uint32_t>(data + 8);
+        headerBegin = 12;
+    }
+    if (headerBegin + headerLength > size){
+        return nullptr;
+    }
+    const std::string header(data + headerBegin, headerLength);
+
+    const size_t descrPos = header.find("'descr'");
+    const size_t fortranOrderPos = header.find("'fortran_order'");
+    const size_t shapePos = header.find("'shape'");
+    if (descrPos == std::string::npos || fortranOrderPos == std::string::npos || shapePos == std::string::npos){
+        return nullptr;
+    }
+
+    const size_t dtypeBegin = header.find('\'', descrPos + 7);
+    const size_t dtypeEnd = header.find('\'', dtypeBegin + 1);
+    if (dtypeBegin == std::string::npos || dtypeEnd == std::string::npos){
+        return nullptr;
+    }
+    dtype = header.substr(dtypeBegin + 1, dtypeEnd - dtypeBegin - 1);
+
+    // Only one-dimensional arrays and scalars are used, so the order does not matter for them
+    const size_t fortranOrderValue = header.find_first_not_of(" :", fortranOrderPos + 15);
+    const bool isFortranOrder = fortranOrderValue != std::string::npos
+        && header.compare(fortranOrderValue, 4, "True") == 0;
+
+    const size_t shapeBegin = header.find('(', shapePos);
+    const size_t shapeEnd = header.find(')', shapeBegin);
+    if (shapeBegin == std::string::npos || shapeEnd == std::string::npos){
+        return nullptr;
+    }
+    shape.clear();
+    const char* cur = header.c_str() + shapeBegin + 1;
+    const char* end = header.c_str() + shapeEnd;
+    while (cur < end){
+        if (*cur >= '0' && *cur <= '9'){
+            char* numberEnd;
+            shape.push_back(std::strtoull(cur, &numberEnd, 10));
+            cur = numberEnd;
+        }
+        else{
+            ++cur;
+        }
+    }
+    if (isFortranOrder && shape.size() > 1){
+        return nullptr;
+    }
+
+    return data + headerBegin + headerLength;
+}
+} // namespace
+
+bool NpzFile::open(const std::string& file){
+    file_ = file;
+    entries_.clear();
+    mappedFile_ = std::make_shared<MappedFile>();
+    if (!mappedFile_->open(file, false)){
+        std::cerr << "Error, file cannot be opened : " << file << std::endl;
+        return false;
+    }
+    const char* data = mappedFile_->data();
+    const size_t size = mappedFile_->size();
+
+    // The end of central directory record is at the end of the file, followed by a comment of at most 65535 bytes
+    constexpr size_t endOfCentralDirectorySize = 22;
+    if (size < endOfCentralDirectorySize){
+        std::cerr << "Error, file " << file << " is not a zip archive!" << std::endl;
+        return false;
+    }
+    size_t endOfCentralDirectoryPos = size - endOfCentralDirectorySize;
+    const size_t searchLimit = size > endOfCentralDirectorySize + 0xFFFF ? size - endOfCentralDirectorySize - 0xFFFF : 0;
+    while (readLittleEndian<uint32_t>(data + endOfCentralDirectoryPos) != endOfCentralDirectorySignature){
+        if (endOfCentralDirectoryPos == searchLimit){
+            std::cerr << "Error, file " << file << " is not a zip archive!" << std::endl;
+            return false;
+        }
+        --endOfCentralDirectoryPos;
+    }
+    uint64_t numEntries = readLittleEndian<uint16_t>(data + endOfCentralDirectoryPos + 10);
+    uint64_t centralDirectoryOffset = readLittleEndian<uint32_t>(data + endOfCentralDirectoryPos + 16);
+
+    // Zip64 archive
+    constexpr size_t zip64LocatorSize = 20;
+    if (endOfCentralDirectoryPos >= zip64LocatorSize
+        && readLittleEndian<uint32_t>(data + endOfCentralDirectoryPos - zip64LocatorSize)
+            == zip64EndOfCentralDirectoryLocatorSignature){
+        const uint64_t zip64RecordPos =
+            readLittleEndian<uint64_t>(data + endOfCentralDirectoryPos - zip64LocatorSize + 8);
+        if (zip64RecordPos + 56 > size
+            || readLittleEndian<uint32_t>(data + zip64RecordPos) != zip64EndOfCentralDirectorySignature){
+            std::cerr << "Error, file " << file << " zip64 record is incorrect!" << std::endl;
+            return false;
+        }
+        numEntries = readLittleEndian<uint64_t>(data + zip64RecordPos + 32);
+        centralDirectoryOffset = readLittleEndian<uint64_t>(data + zip64RecordPos + 48);
+    }
+
+    size_t pos = centralDirectoryOffset;
+    for (uint64_t entryId = 0; entryId < numEntries; ++entryId){
+        constexpr size_t centralDirectoryHeaderSize = 46;
+        if (pos + centralDirectoryHeaderSize > size
+            || readLittleEndian<uint32_t>(data + pos) != centralDirectoryHeaderSignature){
+            std::cerr << "Error, file " << file << " central directory is incorrect!" << std::endl;
+            return false;
+        }
+        Entry entry;
+        entry.compressionMethod = readLittleEndian<uint16_t>(data + pos + 10);
+        entry.compressedSize = readLittleEndian<uint32_t>(data + pos + 20);
+        entry.uncompressedSize = readLittleEndian<uint32_t>(data + pos + 24);
+        const uint16_t nameLength = readLittleEndian<uint16_t>(data + pos + 28);
+        const uint16_t extraLength = readLittleEndian<uint16_t>(data + pos + 30);
+        const uint16_t commentLength = readLittleEndian<uint16_t>(data + pos + 32);
+        entry.localHeaderOffset = readLittleEndian<uint32_t>(data + pos + 42);
+        if (pos + centralDirectoryHeaderSize + nameLength + extraLength + commentLength > size){
+            std::cerr << "Error, file " << file << " central directory is incorrect!" << std::endl;
+            return false;
+        }
+        std::string name(data + pos + centralDirectoryHeaderSize, nameLength);
+
+        // The 64-bit values are in the zip64 extra field, in this order, only for the fields that are 0xFFFFFFFF
+        const char* extra = data + pos + centralDirectoryHeaderSize + nameLength;
+        const char* extraEnd = extra + extraLength;
+        while (extra + 4 <= extraEnd){
+            const uint16_t fieldId = readLittleEndian<uint16_t>(extra);
+            const uint16_t fieldSize = readLittleEndian<uint16_t>(extra + 2);
+            const char* field = extra + 4;
+            const char* fieldEnd = std::min(field + fieldSize, extraEnd);
+            if (fieldId == zip64ExtraFieldId){
+                for (uint64_t* value : {&entry.uncompressedSize, &entry.compressedSize, &entry.localHeaderOffset}){
+                    if (*value == 0xFFFFFFFF && field + 8 <= fieldEnd){
+                        *value = readLittleEndian<uint64_t>(field);
+                        field += 8;
+                    }
+                }
+            }
+            extra += 4 + fieldSize;
+        }
+
+        // numpy names the members "<keyword>.npy"
+        if (name.size() > 4 && name.compare(name.size() - 4, 4, ".npy") == 0){
+            name.resize(name.size() - 4);
+        }
+        entries_[name] = entry;
+
+        pos += centralDirectoryHeaderSize + nameLength + extraLength + commentLength;
+    }
+
+    return true;
+}
+
+bool NpzFile::getArray(const std::string& name, NpyArray& array) const{
+    const auto findEntry = entries_.find(name);
+    if (findEntry == entries_.end()){
+        std::cerr << "Error, file " << file_ << " has no array " << name << "!" << std::endl;
+        return false;
+    }
+    const Entry& entry = findEntry->second;
+    const char* data = mappedFile_->data();
+    const size_t size = mappedFile_->size();
+
+    constexpr size_t localFileHeaderSize = 30;
+    if (entry.localHeaderOffset + localFileHeaderSize > size
+        || readLittleEndian<uint32_t>(data + entry.localHeaderOffset) != localFileHeaderSignature){
+        std::cerr << "Error, file " << file_ << " array " << name << " header is incorrect!" << std::endl;
+        return false;
+    }
+    const uint16_t nameLength = readLittleEndian<uint16_t>(data + entry.localHeaderOffset + 26);
+    const uint16_t extraLength = readLittleEndian<uint16_t>(data + entry.localHeaderOffset + 28);
+    const uint64_t memberOffset = entry.localHeaderOffset + localFileHeaderSize + nameLength + extraLength;
+    if (memberOffset > size || entry.compressedSize > size - memberOffset){
+        std::cerr << "Error, file " << file_ << " is truncated!" << std::endl;
+        return false;
+    }
+
+    const char* member = data + memberOffset;
+    size_t memberSize = entry.compressedSize;
+    array.owner = mappedFile_;
+    if (entry.compressionMethod == compressionMethodDeflated){
+        auto inflated = std::make_shared<std::vector<char>>(entry.uncompressedSize);
+
+        // Raw deflate stream, the sizes may exceed the 32-bit fields of z_stream
+        z_stream stream{};
+        if (inflateInit2(&stream, -MAX_WBITS) != Z_OK){
+            std::cerr << "Error, zlib initialization failed!" << std::endl;
+            return false;
+        }
+        const char* input = member;
+        size_t inputRemain = memberSize;
+        int status = Z_OK;
+        while (status == Z_OK){
+            constexpr size_t maxStep = 1u << 30;
+            if (stream.avail_in == 0){
+                stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input));
+                stream.avail_in = static_cast<uInt>(std::min(inputRemain, maxStep));
+                input += stream.avail_in;
+                inputRemain -= stream.avail_in;
+            }
+            const size_t outputPos = stream.total_out;
+            stream.next_out = reinterpret_cast<Bytef*>(inflated->data() + outputPos);
+            stream.avail_out = static_cast<uInt>(std::min(inflated->size() - outputPos, maxStep));
+            status = inflate(&stream, Z_NO_FLUSH);
+        }
+        const size_t outputPos = stream.total_out;
+        inflateEnd(&stream);
+        if (status != Z_STREAM_END || outputPos != inflated->size()){
+            std::cerr << "Error, file " << file_ << " array " << name << " cannot be inflated!" << std::endl;
+            return false;
+        }
+
+        member = inflated->data();
+        memberSize = inflated->size();
+        array.owner = inflated;
+    }
+    else if (entry.compressionMethod != compressionMethodStored){
+        std::cerr << "Error, file " << file_ << " compression method " << entry.compressionMethod
+                  << " is not supported!" << std::endl;
+        return false;
+    }
+
+    const char* elements = parseNpyHeader(member, memberSize, array.dtype, array.shape);
+    if (!elements){
+        std::cerr << "Error, file " << file_ << " array " << name << " is not a npy array!" << std::endl;
+        return false;
+    }
+    array.data = elements;
+    array.numBytes = member + memberSize - elements;
+
+    return true;
+}
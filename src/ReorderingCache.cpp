@@ -0,0 +1,274 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <tuple>
+#include <vector>
+#include <unistd.h>
+
+#include "BSMR.hpp"
+#include "ReorderingCache.hpp"
+#include "util.hpp"
+
+namespace{
+constexpr char reorderingCacheFileMagic[8] = {'B', 'S', 'M', 'R', 'R', 'C', '\0', '\0'};
+constexpr uint32_t reorderingCacheFileVersion = 1;
+const std::string reorderingCacheFileSuffix = ".bsmrcache";
+
+/**
+ * Header of a cache file. The key is stored again, so a file name collision is a miss and not a wrong result.
+ * The arrays follow the header in the order of `arraySizes`: reorderedRows, denseCols, denseColOffsets,
+ * sparseCols, sparseColOffsets, sparseValueOffsets.
+ **/
+struct ReorderingCacheFileHeader{
+    char magic[8];
+    uint32_t version;
+    uint32_t indexBytes;
+    uint32_t rowPanelSize;
+    uint32_t blockColSize;
+    uint64_t structureHash;
+    float alpha;
+    float delta;
+    int32_t numRowPanels;
+    int32_t numClusters;
+    float rowReorderingTime;
+    float colReorderingTime;
+    uint64_t arraySizes[6];
+};
+
+// `remainingBytes` is the number of bytes left in the file, a size that does not fit is rejected before allocating
+bool readArray(std::ifstream& infile, const uint64_t size, uint64_t& remainingBytes, std::vector<UIN>& array){
+    if (size > remainingBytes / sizeof(UIN)){
+        return false;
+    }
+    remainingBytes -= size * sizeof(UIN);
+    array.resize(size);
+    infile.read(reinterpret_cast<char*>(array.data()), size * sizeof(UIN));
+    return static_cast<bool>(infile);
+}
+
+void writeArray(std::ofstream& outfile, const std::vector<UIN>& array){
+    outfile.write(reinterpret_cast<const char*>(array.data()), array.size() * sizeof(UIN));
+}
+
+// Offsets of `numRowPanels` row panels into an array of `size` elements
+bool isOffsetsValid(const std::vector<UIN>& offsets, const int numRowPanels, const size_t size){
+    if (offsets.size() != static_cast<size_t>(numRowPanels) + 1 || offsets.front() != 0 || offsets.back() != size){
+        return false;
+    }
+    return std::is_sorted(offsets.begin(), offsets.end());
+}
+
+// Every element is less than `bound`, or equal to `padding`
+bool isAllLessThan(const std::vector<UIN>& array, const UIN bound, const UIN padding = NULL_VALUE){
+    return std::all_of(array.begin(), array.end(), [&](const UIN value){
+        return value < bound || value == padding;
+    });
+}
+
+// A name that no other process or thread writes to, the entry is renamed from it when complete
+std::string getTemporaryFileName(const std::string& file){
+    std::random_device randomDevice;
+    std::ostringstream tmpFile;
+    tmpFile << file << "." << getpid() << "." << std::hex << randomDevice() << ".tmp";
+    return tmpFile.str();
+}
+} // namespace
+
+ReorderingCache::ReorderingCache(const std::string& directory, const uint64_t maxBytes)
+    : directory_(directory), maxBytes_(maxBytes){
+    std::error_code errorCode;
+    std::filesystem::create_directories(directory_, errorCode);
+    if (errorCode){
+        std::cerr << "Error, reordering cache directory cannot be created : " << directory_ << std::endl;
+    }
+}
+
+ReorderingCache::Key ReorderingCache::makeKey(const sparseMatrix::CSR<float>& matrix,
+                                              const float alpha,
+                                              const float delta,
+                                              const RowReorderingEngine rowReorderingEngine){
+    Key key;
+    key.structureHash = matrix.structureHash();
+    key.row = matrix.row();
+    key.col = matrix.col();
+    key.nnz = matrix.nnz();
+    key.alpha = alpha;
+    key.delta = delta;
+    key.rowReorderingEngine = rowReorderingEngine;
+    return key;
+}
+
+std::string ReorderingCache::getFileName(const Key& key) const{
+    std::ostringstream fileName;
+    fileName << std::hex << std::setw(16) << std::setfill('0') << key.structureHash << std::dec
+        << "_a" << util::to_trimmed_string(key.alpha)
+        << "_d" << util::to_trimmed_string(key.delta)
+        << (key.rowReorderingEngine != RowReorderingEngine::gpu ? "_r" : "")
+        << (key.rowReorderingEngine != RowReorderingEngine::gpu ? toString(key.rowReorderingEngine) : "")
+        << "_p" << ROW_PANEL_SIZE
+        << "_b" << BLOCK_COL_SIZE
+        << "_i" << sizeof(UIN) * 8
+        << reorderingCacheFileSuffix;
+    return (std::filesystem::path(directory_) / fileName.str()).string();
+}
+
+bool ReorderingCache::load(const Key& key, BSMR& bsmr) const{
+    const std::string file = getFileName(key);
+    std::ifstream infile(file, std::ios::binary | std::ios::ate);
+    if (!infile.is_open()){
+        return false;
+    }
+    const uint64_t fileBytes = infile.tellg();
+    infile.seekg(0);
+
+    ReorderingCacheFileHeader header{};
+    infile.read(reinterpret_cast<char*>(&header), sizeof(ReorderingCacheFileHeader));
+    if (!infile
+        || std::memcmp(header.magic, reorderingCacheFileMagic, sizeof(reorderingCacheFileMagic)) != 0
+        || header.version != reorderingCacheFileVersion
+        || header.indexBytes != sizeof(UIN)
+        || header.rowPanelSize != ROW_PANEL_SIZE
+        || header.blockColSize != BLOCK_COL_SIZE
+        || header.structureHash != key.structureHash
+        || header.alpha != key.alpha
+        || header.delta != key.delta
+        || header.numRowPanels < 0){
+        return false;
+    }
+
+    std::vector<UIN> reorderedRows, denseCols, denseColOffsets, sparseCols, sparseColOffsets, sparseValueOffsets;
+    uint64_t remainingBytes = fileBytes - sizeof(ReorderingCacheFileHeader);
+    if (!readArray(infile, header.arraySizes[0], remainingBytes, reorderedRows)
+        || !readArray(infile, header.arraySizes[1], remainingBytes, denseCols)
+        || !readArray(infile, header.arraySizes[2], remainingBytes, denseColOffsets)
+        || !readArray(infile, header.arraySizes[3], remainingBytes, sparseCols)
+        || !readArray(infile, header.arraySizes[4], remainingBytes, sparseColOffsets)
+        || !readArray(infile, header.arraySizes[5], remainingBytes, sparseValueOffsets)){
+        std::cerr << "Error, reordering cache file " << file << " is truncated!" << std::endl;
+        return false;
+    }
+
+    // Every index is checked, so a corrupted entry never makes the tiling access out of bounds.
+    // The columns of a row panel are padded to a multiple of BLOCK_COL_SIZE with the number of columns
+    if (!isOffsetsValid(denseColOffsets, header.numRowPanels, denseCols.size())
+        || !isOffsetsValid(sparseColOffsets, header.numRowPanels, sparseCols.size())
+        || sparseValueOffsets.size() != static_cast<size_t>(header.numRowPanels) + 1
+        || sparseValueOffsets.front() != 0 || sparseValueOffsets.back() > key.nnz
+        || !std::is_sorted(sparseValueOffsets.begin(), sparseValueOffsets.end())
+        || reorderedRows.size() > static_cast<size_t>(header.numRowPanels) * ROW_PANEL_SIZE
+        || !isAllLessThan(reorderedRows, key.row)
+        || !isAllLessThan(denseCols, key.col, key.col)
+        || !isAllLessThan(sparseCols, key.col, key.col)){
+        std::cerr << "Error, reordering cache file " << file << " is incorrect!" << std::endl;
+        return false;
+    }
+
+    bsmr.numRowPanels_ = header.numRowPanels;
+    bsmr.numClusters_ = header.numClusters;
+    bsmr.reorderedRows_ = std::move(reorderedRows);
+    bsmr.denseCols_ = std::move(denseCols);
+    bsmr.denseColOffsets_ = std::move(denseColOffsets);
+    bsmr.sparseCols_ = std::move(sparseCols);
+    bsmr.sparseColOffsets_ = std::move(sparseColOffsets);
+    bsmr.sparseValueOffsets_ = std::move(sparseValueOffsets);
+    bsmr.rowReorderingTime_ = header.rowReorderingTime;
+    bsmr.colReorderingTime_ = header.colReorderingTime;
+
+    // Least recently used is decided by the modification time
+    std::error_code errorCode;
+    std::filesystem::last_write_time(file, std::filesystem::file_time_type::clock::now(), errorCode);
+
+    return true;
+}
+
+bool ReorderingCache::store(const Key& key, const BSMR& bsmr) const{
+    ReorderingCacheFileHeader header{};
+    std::memcpy(header.magic, reorderingCacheFileMagic, sizeof(reorderingCacheFileMagic));
+    header.version = reorderingCacheFileVersion;
+    header.indexBytes = sizeof(UIN);
+    header.rowPanelSize = ROW_PANEL_SIZE;
+    header.blockColSize = BLOCK_COL_SIZE;
+    header.structureHash = key.structureHash;
+    header.alpha = key.alpha;
+    header.delta = key.delta;
+    header.numRowPanels = bsmr.numRowPanels();
+    header.numClusters = bsmr.numClusters();
+    header.rowReorderingTime = bsmr.rowReorderingTime();
+    header.colReorderingTime = bsmr.colReorderingTime();
+    const std::vector<UIN>* arrays[] = {&bsmr.reorderedRows(), &bsmr.denseCols(), &bsmr.denseColOffsets(),
+                                        &bsmr.sparseCols(), &bsmr.sparseColOffsets(), &bsmr.sparseValueOffsets()};
+    uint64_t fileBytes = sizeof(ReorderingCacheFileHeader);
+    for (int arrayId = 0; arrayId < 6; ++arrayId){
+        header.arraySizes[arrayId] = arrays[arrayId]->size();
+        fileBytes += arrays[arrayId]->size() * sizeof(UIN);
+    }
+    if (fileBytes > maxBytes_){
+        return false;
+    }
+
+    // Write to a temporary file first, so other processes never read a partial entry
+    const std::string file = getFileName(key);
+    const std::string tmpFile = getTemporaryFileName(file);
+    {
+        std::ofstream outfile(tmpFile, std::ios::binary);
+        if (!outfile.is_open()){
+            std::cerr << "Error, reordering cache file cannot be created : " << tmpFile << std::endl;
+            return false;
+        }
+        outfile.write(reinterpret_cast<const char*>(&header), sizeof(ReorderingCacheFileHeader));
+        for (const std::vector<UIN>* array : arrays){
+            writeArray(outfile, *array);
+        }
+        outfile.close();
+        if (!outfile){
+            std::cerr << "Error, failed to write file: " << tmpFile << std::endl;
+            std::remove(tmpFile.c_str());
+            return false;
+        }
+    }
+    std::error_code errorCode;
+    std::filesystem::rename(tmpFile, file, errorCode);
+    if (errorCode){
+        std::cerr << "Error, failed to write file: " << file << std::endl;
+        std::remove(tmpFile.c_str());
+        return false;
+    }
+
+    evict();
+
+    return true;
+}
+
+void ReorderingCache::evict() const{
+    std::error_code errorCode;
+    std::vector<std::tuple<std::filesystem::file_time_type, uint64_t, std::filesystem::path>> entries;
+    uint64_t totalBytes = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(directory_, errorCode)){
+        if (!entry.is_regular_file(errorCode) || entry.path().extension() != reorderingCacheFileSuffix){
+            continue;
+        }
+        const uint64_t bytes = entry.file_size(errorCode);
+        if (errorCode){
+            continue;
+        }
+        entries.emplace_back(entry.last_write_time(errorCode), bytes, entry.path());
+        totalBytes += bytes;
+    }
+
+    // Oldest first
+    std::sort(entries.begin(), entries.end());
+    for (const auto& entry : entries){
+        if (totalBytes <= maxBytes_){
+            break;
+        }
+        if (std::filesystem::remove(std::get<2>(entry), errorCode)){
+            totalBytes -= std::get<1>(entry);
+        }
+    }
+}
@@ -0,0 +1,102 @@
+#include <algorithm>
+
+#include <omp.h>
+
+#include "WorkScheduler.hpp"
+
+template<typename OffsetType>
+void scheduler::exclusiveScan(const std::vector<OffsetType>& weights, std::vector<OffsetType>& offsets){
+    const size_t size = weights.size();
+    offsets.resize(size + 1);
+    offsets[0] = 0;
+
+    // Each thread sums its part, then adds the sum of the parts before it
+    std::vector<OffsetType> partSums;
+#pragma omp parallel
+    {
+        const int threadId = omp_get_thread_num();
+        const int numThreads = omp_get_num_threads();
+#pragma omp single
+        partSums.assign(numThreads + 1, 0);
+
+        const size_t begin = size * threadId / numThreads;
+        const size_t end = size * (threadId + 1) / numThreads;
+        OffsetType sum = 0;
+        for (size_t idx = begin; idx < end; ++idx){
+            sum += weights[idx];
+            offsets[idx + 1] = sum;
+        }
+        partSums[threadId + 1] = sum;
+#pragma omp barrier
+
+#pragma omp single
+        for (int partId = 0; partId < numThreads; ++partId){
+            partSums[partId + 1] += partSums[partId];
+        }
+
+        const OffsetType partOffset = partSums[threadId];
+        for (size_t idx = begin; idx < end; ++idx){
+            offsets[idx + 1] += partOffset;
+        }
+    }
+}
+
+template<typename OffsetType>
+std::vector<scheduler::WorkChunk> scheduler::partition(const OffsetType* offsets,
+                                                       const UIN numRows,
+                                                       const UIN numChunks,
+                                                       const uint64_t longRowThreshold){
+    std::vector<WorkChunk> chunks;
+    if (numRows == 0 || numChunks == 0 || offsets[numRows] == offsets[0]){
+        return chunks;
+    }
+    const uint64_t totalWeight = offsets[numRows] - offsets[0];
+
+    std::vector<OffsetType> boundaries(static_cast<size_t>(numChunks) + 1);
+    boundaries[0] = offsets[0];
+    boundaries[numChunks] = offsets[numRows];
+#pragma omp parallel for
+    for (UIN chunkId = 1; chunkId < numChunks; ++chunkId){
+        OffsetType boundary = offsets[0] + static_cast<OffsetType>(totalWeight * chunkId / numChunks);
+
+        // The row that contains the boundary, the empty rows before it are skipped
+        const UIN row = std::upper_bound(offsets, offsets + numRows + 1, boundary) - offsets - 1;
+        const OffsetType rowBegin = offsets[row];
+        const OffsetType rowEnd = offsets[row + 1];
+        if (boundary > rowBegin && static_cast<uint64_t>(rowEnd - rowBegin) <= longRowThreshold){
+            boundary = boundary - rowBegin < rowEnd - boundary ? rowBegin : rowEnd;
+        }
+        boundaries[chunkId] = boundary;
+    }
+
+    for (UIN chunkId = 0; chunkId < numChunks; ++chunkId){
+        const OffsetType indexBegin = std::max<OffsetType>(boundaries[chunkId],
+                                                           chunks.empty() ? offsets[0] : chunks.back().indexEnd);
+        const OffsetType indexEnd = std::max(indexBegin, boundaries[chunkId + 1]);
+        if (indexBegin == indexEnd){
+            continue;
+        }
+        WorkChunk chunk;
+        chunk.indexBegin = indexBegin;
+        chunk.indexEnd = indexEnd;
+        chunk.rowBegin = std::upper_bound(offsets, offsets + numRows + 1, indexBegin) - offsets - 1;
+        chunk.rowEnd = std::lower_bound(offsets, offsets + numRows + 1, indexEnd) - offsets;
+        chunks.push_back(chunk);
+    }
+
+    return chunks;
+}
+
+template void scheduler::exclusiveScan<uint32_t>(const std::vector<uint32_t>& weights,
+                                                 std::vector<uint32_t>& offsets);
+template void scheduler::exclusiveScan<uint64_t>(const std::vector<uint64_t>& weights,
+                                                 std::vector<uint64_t>& offsets);
+
+template std::vector<scheduler::WorkChunk> scheduler::partition<uint32_t>(const uint32_t* offsets,
+                                                                          UIN numRows,
+                                                                          UIN numChunks,
+                                                                          uint64_t longRowThreshold);
+template std::vector<scheduler::WorkChunk> scheduler::partition<uint64_t>(const uint64_t* offsets,
+                                                                          UIN numRows,
+                                                                          UIN numChunks,
+                                                                          uint64_t longRowThreshold);
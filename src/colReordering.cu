@@ -1,4 +1,5 @@
 #include <numeric>
+#include <algorithm>
 #include <cmath>
 #include <unordered_map>
 #include <omp.h>
@@ -64,7 +65,7 @@ __global__ void calculateNumNonZeroInColSegmentsPerRowPanel(const UIN numCols,
 
     for (int idx = rowOffsets[row] + laneId; idx < rowOffsets[row + 1]; idx += WARP_SIZE){
         const UIN col = colIndices[idx];
-        atomicAdd(numNonZeroColSegmentsPerRowPanel + rowPanelId * numCols + col, 1);
+        atomicAdd(numNonZeroColSegmentsPerRowPanel + static_cast<size_t>(rowPanelId) * numCols + col, 1);
     }
 }
 
@@ -157,7 +158,7 @@ void colReordering_gpu(const sparseMatrix::CSR<float>& matrix,
     dev::vector<UIN> colIndices_dev(matrix.colIndices());
     dev::vector<UIN> reorderedRows_dev(reorderedRows);
 
-    dev::vector<UIN> numNonZeroPerColSegmentPerRowPanel_dev(numRowPanels * matrix.col(), 0);
+    dev::vector<UIN> numNonZeroPerColSegmentPerRowPanel_dev(static_cast<size_t>(numRowPanels) * matrix.col(), 0);
 
     CudaTimeCalculator timeCalculator;
     timeCalculator.startClock();
@@ -172,14 +173,14 @@ void colReordering_gpu(const sparseMatrix::CSR<float>& matrix,
     printf("calculateNumNonZeroInColSegmentsPerRowPanel_time: %f ms\n",
            calculateNumNonZeroInColSegmentsPerRowPanel_time);
 
-    std::vector<UIN> colIndices_sparse(matrix.col() * numRowPanels); // Containing empty columns
+    std::vector<UIN> colIndices_sparse(static_cast<size_t>(matrix.col()) * numRowPanels); // Containing empty columns
     std::vector<UIN> numNonZeroColSegmentsPerRowPanel(numRowPanels, 0);
 
     timeCalculator.startClock();
 #pragma omp parallel for
     for (int rowPanelId = 0; rowPanelId < numRowPanels; ++rowPanelId){
-        const UIN startIdx = rowPanelId * matrix.col();
-        const UIN endIdx = startIdx + matrix.col();
+        const size_t startIdx = static_cast<size_t>(rowPanelId) * matrix.col();
+        const size_t endIdx = startIdx + matrix.col();
         host::sequence(colIndices_sparse.data() + startIdx,
                        colIndices_sparse.data() + endIdx,
                        0);
@@ -270,6 +271,105 @@ std::pair<UIN, UIN> analysisDescendingOrderColSegment(const float blockDensityTh
     return std::make_pair(numDenseColSegment, numSparseColSegment);
 }
 
+void colReorderingOfRowPanels_cpu(const sparseMatrix::CSR<float>& matrix,
+                                  const std::vector<UIN>& reorderedRows,
+                                  const std::vector<UIN>& rowPanelIds,
+                                  const float blockDensityThreshold,
+                                  std::vector<std::vector<UIN>>& colsInEachRowPanel,
+                                  std::vector<UIN>& numDenseColsInEachRowPanel,
+                                  std::vector<UIN>& numSparseColsInEachRowPanel,
+                                  std::vector<UIN>& numSparseDataInEachRowPanel){
+    colsInEachRowPanel.assign(rowPanelIds.size(), std::vector<UIN>());
+    numDenseColsInEachRowPanel.assign(rowPanelIds.size(), 0);
+    numSparseColsInEachRowPanel.assign(rowPanelIds.size(), 0);
+    numSparseDataInEachRowPanel.assign(rowPanelIds.size(), 0);
+
+    // The columns of a row panel are counted from its nonzeros, so the work and the buffers of a thread are bounded by
+    // the number of nonzeros of a row panel instead of the number of columns of the matrix
+#pragma omp parallel
+    {
+        std::vector<UIN> colsCurrentRowPanel;
+        std::vector<UIN> nonZeroCols;
+        std::vector<UIN> numOfNonZeroInEachNonZeroCol;
+        std::vector<UIN> countOffsets;
+        std::vector<UIN> numOfNonZeroInEachColSegment_dense;
+
+#pragma omp for schedule(dynamic)
+        for (size_t idxOfRowPanelIds = 0; idxOfRowPanelIds < rowPanelIds.size(); ++idxOfRowPanelIds){
+            const UIN rowPanelId = rowPanelIds[idxOfRowPanelIds];
+            const UIN startIdxOfReorderedRowsCurrentRowPanel = rowPanelId * ROW_PANEL_SIZE;
+            const UIN endIdxOfReorderedRowsCurrentRowPanel = std::min(
+                startIdxOfReorderedRowsCurrentRowPanel + ROW_PANEL_SIZE,
+                static_cast<UIN>(reorderedRows.size()));
+
+            // Gather the column indices of the rows in this row panel
+            colsCurrentRowPanel.clear();
+            for (UIN reorderedRowIndex = startIdxOfReorderedRowsCurrentRowPanel;
+                 reorderedRowIndex < endIdxOfReorderedRowsCurrentRowPanel;
+                 ++reorderedRowIndex){
+                const UIN row = reorderedRows[reorderedRowIndex];
+                colsCurrentRowPanel.insert(colsCurrentRowPanel.end(),
+                                           matrix.colIndices().begin() + matrix.rowOffsets()[row],
+                                           matrix.colIndices().begin() + matrix.rowOffsets()[row + 1]);
+            }
+            std::sort(colsCurrentRowPanel.begin(), colsCurrentRowPanel.end());
+
+            // Count the number of non-zero elements for each non-zero column, the columns in ascending order
+            nonZeroCols.clear();
+            numOfNonZeroInEachNonZeroCol.clear();
+            UIN maxNumOfNonZeroInCol = 0;
+            for (size_t idx = 0; idx < colsCurrentRowPanel.size(); ++idx){
+                if (nonZeroCols.empty() || nonZeroCols.back() != colsCurrentRowPanel[idx]){
+                    nonZeroCols.push_back(colsCurrentRowPanel[idx]);
+                    numOfNonZeroInEachNonZeroCol.push_back(0);
+                }
+                ++numOfNonZeroInEachNonZeroCol.back();
+                maxNumOfNonZeroInCol = std::max(maxNumOfNonZeroInCol, numOfNonZeroInEachNonZeroCol.back());
+            }
+            const size_t numNonZeroCols = nonZeroCols.size();
+
+            // Descending order of the number of non-zero elements, the columns with the same number in ascending
+            // order. The number is at most the number of rows of the row panel, so it is a counting sort
+            countOffsets.assign(maxNumOfNonZeroInCol + 2, 0);
+            for (const UIN numOfNonZero : numOfNonZeroInEachNonZeroCol){
+                ++countOffsets[maxNumOfNonZeroInCol - numOfNonZero + 1];
+            }
+            std::partial_sum(countOffsets.begin(), countOffsets.end(), countOffsets.begin());
+            std::vector<UIN> colIndices_dense(numNonZeroCols);
+            numOfNonZeroInEachColSegment_dense.resize(numNonZeroCols);
+            for (size_t idx = 0; idx < numNonZeroCols; ++idx){
+                const UIN numOfNonZero = numOfNonZeroInEachNonZeroCol[idx];
+                const UIN sortedIdx = countOffsets[maxNumOfNonZeroInCol - numOfNonZero]++;
+                colIndices_dense[sortedIdx] = nonZeroCols[idx];
+                numOfNonZeroInEachColSegment_dense[sortedIdx] = numOfNonZero;
+            }
+
+            if (colIndices_dense.size() % BLOCK_COL_SIZE != 0){
+                // If the number of columns is not a multiple of BLOCK_COL_SIZE, fill the remaining columns with
+                // matrix numCols
+                colIndices_dense.resize(
+                    colIndices_dense.size() + BLOCK_COL_SIZE - colIndices_dense.size() % BLOCK_COL_SIZE,
+                    matrix.col());
+                numOfNonZeroInEachColSegment_dense.resize(colIndices_dense.size(), 0);
+            }
+
+            colsInEachRowPanel[idxOfRowPanelIds] = std::move(colIndices_dense);
+
+            const auto [numDenseColSegment, numSparseColSegment] =
+                analysisDescendingOrderColSegment(blockDensityThreshold, numOfNonZeroInEachColSegment_dense);
+
+            UIN numSparsePartData = 0;
+            for (int i = numDenseColSegment; i < numDenseColSegment + numSparseColSegment; ++i){
+                numSparsePartData += numOfNonZeroInEachColSegment_dense[i];
+            }
+            numDenseColsInEachRowPanel[idxOfRowPanelIds] = numDenseColSegment;
+            numSparseColsInEachRowPanel[idxOfRowPanelIds] = numSparseColSegment;
+            numSparseDataInEachRowPanel[idxOfRowPanelIds] = numSparsePartData;
+        }
+    }
+
+}
+
 // Divide rows into row panels and columns reordered in each row panel. After the columns reordered, the columns are divided into dense and sparse residual columns.
 void colReordering_cpu(const sparseMatrix::CSR<float>& matrix,
                        const UIN numRowPanels,
@@ -281,80 +381,24 @@ void colReordering_cpu(const sparseMatrix::CSR<float>& matrix,
                        std::vector<UIN>& sparseColOffsets,
                        std::vector<UIN>& sparseDataOffsets,
                        float& time){
-    std::vector<UIN> numOfDenseColSegmentInEachRowPanel(numRowPanels, 0);
-    std::vector<UIN> numOfSparseColSegmentInEachRowPanel(numRowPanels, 0);
-    std::vector<std::vector<UIN>> nonZeroColsInEachRowPanel(numRowPanels);
-    std::vector<UIN> numOfSparsePartDataInEachRowPanel(numRowPanels, 0);
+    std::vector<UIN> numOfDenseColSegmentInEachRowPanel;
+    std::vector<UIN> numOfSparseColSegmentInEachRowPanel;
+    std::vector<std::vector<UIN>> nonZeroColsInEachRowPanel;
+    std::vector<UIN> numOfSparsePartDataInEachRowPanel;
 
     CudaTimeCalculator timeCalculator;
     timeCalculator.startClock();
 
-#pragma omp parallel for schedule(dynamic)
-    for (int rowPanelId = 0; rowPanelId < numRowPanels; ++rowPanelId){
-        const UIN startIdxOfReorderedRowsCurrentRowPanel = rowPanelId * ROW_PANEL_SIZE;
-        const UIN endIdxOfReorderedRowsCurrentRowPanel = std::min(
-            startIdxOfReorderedRowsCurrentRowPanel + ROW_PANEL_SIZE,
-            static_cast<UIN>(reorderedRows.size()));
-
-        // Count the number of non-zero elements for each column segment
-        std::vector<UIN> numOfNonZeroInEachColSegment(matrix.col(), 0);
-        for (int reorderedRowIndex = startIdxOfReorderedRowsCurrentRowPanel;
-             reorderedRowIndex < endIdxOfReorderedRowsCurrentRowPanel;
-             ++reorderedRowIndex){
-            // Loop through the rows in this row panel
-            const UIN row = reorderedRows[reorderedRowIndex];
-            for (UIN idx = matrix.rowOffsets()[row]; idx < matrix.rowOffsets()[row + 1];
-                 ++idx){
-                // Loop through the columns in this row
-                const UIN col = matrix.colIndices()[idx];
-                ++numOfNonZeroInEachColSegment[col];
-            }
-        }
-
-        std::vector<UIN> colIndices_sparse(numOfNonZeroInEachColSegment.size()); // Containing empty columns
-        host::sequence(colIndices_sparse.data(), colIndices_sparse.data() + colIndices_sparse.size(), 0);
-
-        // 计算具有非零元素的列的数量
-        size_t numNonZeroCols = host::count_if_positive(numOfNonZeroInEachColSegment.data(),
-                                                        numOfNonZeroInEachColSegment.data()
-                                                        + numOfNonZeroInEachColSegment.size());
-        std::vector<UIN> numOfNonZeroInEachColSegment_dense(numNonZeroCols);
-        std::vector<UIN> colIndices_dense(numNonZeroCols);
-
-        host::copy_if_positive(numOfNonZeroInEachColSegment.data(),
-                               numOfNonZeroInEachColSegment.data() + numOfNonZeroInEachColSegment.size(),
-                               numOfNonZeroInEachColSegment.data(),
-                               numOfNonZeroInEachColSegment_dense.data());
-        host::copy_if_positive(colIndices_sparse.data(),
-                               colIndices_sparse.data() + colIndices_sparse.size(),
-                               numOfNonZeroInEachColSegment.data(),
-                               colIndices_dense.data());
-
-        host::sort_by_key_descending_order(numOfNonZeroInEachColSegment_dense.data(),
-                                           numOfNonZeroInEachColSegment_dense.data()
-                                           + numOfNonZeroInEachColSegment_dense.size(),
-                                           colIndices_dense.data());
-
-        if (colIndices_dense.size() % BLOCK_COL_SIZE != 0){
-            // If the number of columns is not a multiple of BLOCK_COL_SIZE, fill the remaining columns with matrix numCols
-            colIndices_dense.resize(colIndices_dense.size() + BLOCK_COL_SIZE - colIndices_dense.size() % BLOCK_COL_SIZE,
-                                    matrix.col());
-            numOfNonZeroInEachColSegment_dense.resize(colIndices_dense.size(), 0);
-        }
-
-        nonZeroColsInEachRowPanel[rowPanelId] = colIndices_dense;
-
-        const auto [numDenseColSegment, numSparseColSegment] =
-            analysisDescendingOrderColSegment(blockDensityThreshold, numOfNonZeroInEachColSegment_dense);
-
-        UIN numSparsePartData = 0;
-        for (int i = numDenseColSegment; i < numDenseColSegment + numSparseColSegment; ++i){
-            numSparsePartData += numOfNonZeroInEachColSegment_dense[i];
-        }
-        numOfDenseColSegmentInEachRowPanel[rowPanelId] = numDenseColSegment;
-        numOfSparseColSegmentInEachRowPanel[rowPanelId] = numSparseColSegment;
-        numOfSparsePartDataInEachRowPanel[rowPanelId] = numSparsePartData;
-    }
+    std::vector<UIN> rowPanelIds(numRowPanels);
+    std::iota(rowPanelIds.begin(), rowPanelIds.end(), 0);
+    colReorderingOfRowPanels_cpu(matrix,
+                                 reorderedRows,
+                                 rowPanelIds,
+                                 blockDensityThreshold,
+                                 nonZeroColsInEachRowPanel,
+                                 numOfDenseColSegmentInEachRowPanel,
+                                 numOfSparseColSegmentInEachRowPanel,
+                                 numOfSparsePartDataInEachRowPanel);
 
     // Initialize the sparsePartDataOffsets
     sparseDataOffsets.resize(numRowPanels + 1);
@@ -0,0 +1,1919 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BSMR_CPU_X86
+#endif
+
+#include <omp.h>
+
+#include "BSMR.hpp"
+#include "cpuKernel.hpp"
+#include "KDispatch.hpp"
+#include "precision.hpp"
+#include "WorkScheduler.hpp"
+
+namespace{
+// K is processed in blocks of `kBlockSize`, the block of the A row stays in L1 while the nonzeros of the row
+// stream their B columns. 4 KB of A plus 4 B columns of 4 KB fit in a 32 KB L1.
+constexpr UIN kBlockSize = 1024;
+// A row of a specialized K is one block, the dot products of a block are of length K
+static_assert(kdispatch::maxSpecializedK <= kBlockSize, "The specialized K must fit in one block of K");
+
+// Number of nonzeros of a row that share one load of A
+constexpr UIN numColsEachDot = 4;
+
+// The operands are float, or __half / __nv_bfloat16 that are converted to fp32 when they are loaded.
+// The products are always accumulated in fp32
+template<typename T>
+using DotFunction = float (*)(const T* a, const T* b, UIN K);
+template<typename T>
+using MultiDotFunction = void (*)(const T* a, const T* const* b, UIN K, float* dots);
+
+template<typename T>
+struct DotFunctions{
+    DotFunction<T> dot;
+    MultiDotFunction<T> multiDot;
+};
+
+// Converts `n` 16-bit values to fp32, for the columns of B of a dense block
+template<typename T>
+using ConvertFunction = void (*)(const T* source, UIN n, float* destination);
+
+// y += alpha * x, for the rows of V in the attention
+using AxpyFunction = void (*)(float alpha, const float* x, UIN D, float* y);
+
+// One dense block of the tiling: `packedA` holds the rows of the row panel, k-major
+// (packedA[k * ROW_PANEL_SIZE + localRow]), `b` the BLOCK_COL_SIZE columns of B.
+// `block` is written column-major (block[localCol * ROW_PANEL_SIZE + localRow]).
+using DenseBlockFunction = void (*)(const float* packedA, const float* const* b, UIN K, float* block);
+
+// Number of columns of a dense block that are accumulated in registers at the same time
+constexpr UIN numColsEachDenseBlockPass = 8;
+static_assert(ROW_PANEL_SIZE % 8 == 0 && BLOCK_COL_SIZE % numColsEachDenseBlockPass == 0,
+              "The dense block kernels use vectors of 8 rows and passes of 8 columns");
+
+template<typename T, UIN FixedK = 0>
+float dot_scalar(const T* a, const T* b, const UIN runtimeK){
+    const UIN K = kdispatch::resolveK<FixedK>(runtimeK);
+    using precision::toFloat;
+    float sum[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    UIN k = 0;
+    for (; k + 4 <= K; k += 4){
+        sum[0] += toFloat(a[k]) * toFloat(b[k]);
+        sum[1] += toFloat(a[k + 1]) * toFloat(b[k + 1]);
+        sum[2] += toFloat(a[k + 2]) * toFloat(b[k + 2]);
+        sum[3] += toFloat(a[k + 3]) * toFloat(b[k + 3]);
+    }
+    for (; k < K; ++k){
+        sum[0] += toFloat(a[k]) * toFloat(b[k]);
+    }
+    return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+}
+
+template<typename T, UIN FixedK = 0>
+void multiDot_scalar(const T* a, const T* const* b, const UIN K, float* dots){
+    for (UIN colId = 0; colId < numColsEachDot; ++colId){
+        dots[colId] = dot_scalar<T, FixedK>(a, b[colId], K);
+    }
+}
+
+template<typename T>
+void convert_scalar(const T* source, const UIN n, float* destination){
+    for (UIN idx = 0; idx < n; ++idx){
+        destination[idx] = precision::toFloat(source[idx]);
+    }
+}
+
+template<UIN FixedK = 0>
+void denseBlock_scalar(const float* packedA, const float* const* b, const UIN runtimeK, float* block){
+    const UIN K = kdispatch::resolveK<FixedK>(runtimeK);
+    std::fill(block, block + BLOCK_SIZE, 0.0f);
+    for (UIN k = 0; k < K; ++k){
+        const float* a = packedA + static_cast<size_t>(k) * ROW_PANEL_SIZE;
+        for (UIN localCol = 0; localCol < BLOCK_COL_SIZE; ++localCol){
+            const float bValue = b[localCol][k];
+            float* blockCol = block + localCol * ROW_PANEL_SIZE;
+            for (UIN localRow = 0; localRow < ROW_PANEL_SIZE; ++localRow){
+                blockCol[localRow] += a[localRow] * bValue;
+            }
+        }
+    }
+}
+
+void axpy_scalar(const float alpha, const float* x, const UIN D, float* y){
+    for (UIN d = 0; d < D; ++d){
+        y[d] += alpha * x[d];
+    }
+}
+
+// int8 operands, the products are accumulated in int32 and are exact. The dot functions return the int32 sum as float,
+// the scales are applied by the caller
+float dotInt8_scalar(const int8_t* a, const int8_t* b, const UIN K){
+    int32_t sum = 0;
+    for (UIN k = 0; k < K; ++k){
+        sum += a[k] * b[k];
+    }
+    return static_cast<float>(sum);
+}
+
+void multiDotInt8_scalar(const int8_t* a, const int8_t* const* b, const UIN K, float* dots){
+    for (UIN colId = 0; colId < numColsEachDot; ++colId){
+        dots[colId] = dotInt8_scalar(a, b[colId], K);
+    }
+}
+
+// One int8 dense block. `packedA` holds the rows of the row panel in groups of 4 values of K
+// (packedA[(k / 4 * ROW_PANEL_SIZE + localRow) * 4 + k % 4]), K is padded to a multiple of 4 with 0.
+// `rowSumsA` is the sum of each packed row. `block` is written column-major like `DenseBlockFunction`
+using Int8DenseBlockFunction = void (*)(const int8_t* packedA,
+                                        const int32_t* rowSumsA,
+                                        const int8_t* const* b,
+                                        UIN K,
+                                        int32_t* block);
+
+void denseBlockInt8_scalar(const int8_t* packedA, const int32_t*, const int8_t* const* b, const UIN K, int32_t* block){
+    std::fill(block, block + BLOCK_SIZE, 0);
+    for (UIN k = 0; k < K; ++k){
+        const int8_t* a = packedA + static_cast<size_t>(k / 4) * ROW_PANEL_SIZE * 4 + k % 4;
+        for (UIN localCol = 0; localCol < BLOCK_COL_SIZE; ++localCol){
+            const int32_t bValue = b[localCol][k];
+            int32_t* blockCol = block + localCol * ROW_PANEL_SIZE;
+            for (UIN localRow = 0; localRow < ROW_PANEL_SIZE; ++localRow){
+                blockCol[localRow] += a[localRow * 4] * bValue;
+            }
+        }
+    }
+}
+
+#ifdef BSMR_CPU_X86
+__attribute__((target("avx2,fma")))
+inline float horizontalSum_avx2(const __m256 value){
+    const __m128 sum = _mm_add_ps(_mm256_castps256_ps128(value), _mm256_extractf128_ps(value, 1));
+    const __m128 sum2 = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    return _mm_cvtss_f32(_mm_add_ss(sum2, _mm_movehdup_ps(sum2)));
+}
+
+// 8 16-bit values converted to fp32. F16C converts fp16, bf16 is the upper half of fp32
+__attribute__((target("avx2,fma,f16c")))
+inline __m256 convert8_avx2(const __m128i values, const __half*){
+    return _mm256_cvtph_ps(values);
+}
+
+__attribute__((target("avx2,fma,f16c")))
+inline __m256 convert8_avx2(const __m128i values, const __nv_bfloat16*){
+    return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_cvtepu16_epi32(values), 16));
+}
+
+__attribute__((target("avx2,fma,f16c")))
+inline __m256 load8_avx2(const float* source){
+    return _mm256_loadu_ps(source);
+}
+
+template<typename T>
+__attribute__((target("avx2,fma,f16c")))
+inline __m256 load8_avx2(const T* source){
+    return convert8_avx2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(source)), source);
+}
+
+// The first n (< 8) values, the other lanes are 0
+__attribute__((target("avx2,fma,f16c")))
+inline __m256 loadTail8_avx2(const float* source, const UIN n){
+    const __m256i mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(static_cast<int>(n)),
+                                            _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+    return _mm256_maskload_ps(source, mask);
+}
+
+// There are no 16-bit masked loads, the values are loaded in pairs as 32-bit lanes and an odd last value is added
+// to the next lane
+template<typename T>
+__attribute__((target("avx2,fma,f16c")))
+inline __m256 loadTail8_avx2(const T* source, const UIN n){
+    const __m128i laneIds = _mm_setr_epi32(0, 1, 2, 3);
+    const __m128i numPairs = _mm_set1_epi32(static_cast<int>(n / 2));
+    __m128i values = _mm_maskload_epi32(reinterpret_cast<const int*>(source), _mm_cmpgt_epi32(numPairs, laneIds));
+    if (n % 2){
+        const __m128i lastValue = _mm_set1_epi32(precision::bitsOf(source[n - 1]));
+        values = _mm_blendv_epi8(values, lastValue, _mm_cmpeq_epi32(numPairs, laneIds));
+    }
+    return convert8_avx2(values, source);
+}
+
+template<typename T, UIN FixedK = 0>
+__attribute__((target("avx2,fma,f16c")))
+float dot_avx2(const T* a, const T* b, const UIN runtimeK){
+    const UIN K = kdispatch::resolveK<FixedK>(runtimeK);
+    // 4 accumulators hide the latency of the FMA
+    __m256 sum0 = _mm256_setzero_ps(), sum1 = _mm256_setzero_ps();
+    __m256 sum2 = _mm256_setzero_ps(), sum3 = _mm256_setzero_ps();
+    UIN k = 0;
+    for (; k + 32 <= K; k += 32){
+        sum0 = _mm256_fmadd_ps(load8_avx2(a + k), load8_avx2(b + k), sum0);
+        sum1 = _mm256_fmadd_ps(load8_avx2(a + k + 8), load8_avx2(b + k + 8), sum1);
+        sum2 = _mm256_fmadd_ps(load8_avx2(a + k + 16), load8_avx2(b + k + 16), sum2);
+        sum3 = _mm256_fmadd_ps(load8_avx2(a + k + 24), load8_avx2(b + k + 24), sum3);
+    }
+    for (; k + 8 <= K; k += 8){
+        sum0 = _mm256_fmadd_ps(load8_avx2(a + k), load8_avx2(b + k), sum0);
+    }
+    if (k < K){
+        sum1 = _mm256_fmadd_ps(loadTail8_avx2(a + k, K - k), loadTail8_avx2(b + k, K - k), sum1);
+    }
+    return horizontalSum_avx2(_mm256_add_ps(_mm256_add_ps(sum0, sum1), _mm256_add_ps(sum2, sum3)));
+}
+
+template<typename T, UIN FixedK = 0>
+__attribute__((target("avx2,fma,f16c")))
+void multiDot_avx2(const T* a, const T* const* b, const UIN runtimeK, float* dots){
+    const UIN K = kdispatch::resolveK<FixedK>(runtimeK);
+    // Each load of A is used by the 4 columns, 2 steps of K give 8 independent accumulators
+    __m256 sum[2][numColsEachDot];
+    for (UIN colId = 0; colId < numColsEachDot; ++colId){
+        sum[0][colId] = _mm256_setzero_ps();
+        sum[1][colId] = _mm256_setzero_ps();
+    }
+    UIN k = 0;
+    for (; k + 16 <= K; k += 16){
+        const __m256 a0 = load8_avx2(a + k);
+        const __m256 a1 = load8_avx2(a + k + 8);
+        for (UIN colId = 0; colId < numColsEachDot; ++colId){
+            sum[0][colId] = _mm256_fmadd_ps(a0, load8_avx2(b[colId] + k), sum[0][colId]);
+            sum[1][colId] = _mm256_fmadd_ps(a1, load8_avx2(b[colId] + k + 8), sum[1][colId]);
+        }
+    }
+    for (; k + 8 <= K; k += 8){
+        const __m256 a0 = load8_avx2(a + k);
+        for (UIN colId = 0; colId < numColsEachDot; ++colId){
+            sum[0][colId] = _mm256_fmadd_ps(a0, load8_avx2(b[colId] + k), sum[0][colId]);
+        }
+    }
+    if (k < K){
+        const __m256 a0 = loadTail8_avx2(a + k, K - k);
+        for (UIN colId = 0; colId < numColsEachDot; ++colId){
+            sum[1][colId] = _mm256_fmadd_ps(a0, loadTail8_avx2(b[colId] + k, K - k), sum[1][colId]);
+        }
+    }
+    for (UIN colId = 0; colId < numColsEachDot; ++colId){
+        dots[colId] = horizontalSum_avx2(_mm256_add_ps(sum[0][colId], sum[1][colId]));
+    }
+}
+
+template<typename T>
+__attribute__((target("avx2,fma,f16c")))
+void convert_avx2(const T* source, const UIN n, float* destination){
+    UIN idx = 0;
+    for (; idx + 8 <= n; idx += 8){
+        _mm256_storeu_ps(destination + idx, load8_avx2(source + idx));
+    }
+    for (; idx < n; ++idx){
+        destination[idx] = precision::toFloat(source[idx]);
+    }
+}
+
+template<UIN FixedK = 0>
+__attribute__((target("avx2,fma")))
+void denseBlock_avx2(const float* packedA, const float* const* b, const UIN runtimeK, float* block){
+    const UIN K = kdispatch::resolveK<FixedK>(runtimeK);
+    // 8 rows x 8 columns of accumulators per pass, each k is one load of A and 8 broadcasts of B
+    for (UIN rowBegin = 0; rowBegin < ROW_PANEL_SIZE; rowBegin += 8){
+        for (UIN colBegin = 0; colBegin < BLOCK_COL_SIZE; colBegin += numColsEachDenseBlockPass){
+            const float* const* bCols = b + colBegin;
+            __m256 sum[numColsEachDenseBlockPass];
+            for (UIN colId = 0; colId < numColsEachDenseBlockPass; ++colId){
+                sum[colId] = _mm256_setzero_ps();
+            }
+            for (UIN k = 0; k < K; ++k){
+                const __m256 a = _mm256_loadu_ps(packedA + static_cast<size_t>(k) * ROW_PANEL_SIZE + rowBegin);
+                for (UIN colId = 0; colId < numColsEachDenseBlockPass; ++colId){
+                    sum[colId] = _mm256_fmadd_ps(a, _mm256_broadcast_ss(bCols[colId] + k), sum[colId]);
+                }
+            }
+            for (UIN colId = 0; colId < numColsEachDenseBlockPass; ++colId){
+                _mm256_storeu_ps(block + (colBegin + colId) * ROW_PANEL_SIZE + rowBegin, sum[colId]);
+            }
+        }
+    }
+}
+
+__attribute__((target("avx2,fma")))
+void axpy_avx2(const float alpha, const float* x, const UIN D, float* y){
+    const __m256 alphaVector = _mm256_set1_ps(alpha);
+    UIN d = 0;
+    for (; d + 8 <= D; d += 8){
+        _mm256_storeu_ps(y + d, _mm256_fmadd_ps(alphaVector, _mm256_loadu_ps(x + d), _mm256_loadu_ps(y + d)));
+    }
+    for (; d < D; ++d){
+        y[d] += alpha * x[d];
+    }
+}
+
+// 16 16-bit values converted to fp32
+__attribute__((target("avx512f")))
+inline __m512 convert16_avx512(const __m256i values, const __half*){
+    return _mm512_cvtph_ps(values);
+}
+
+__attribute__((target("avx512f")))
+inline __m512 convert16_avx512(const __m256i values, const __nv_bfloat16*){
+    return _mm512_castsi512_ps(_mm512_slli_epi32(_mm512_cvtepu16_epi32(values), 16));
+}
+
+__attribute__((target("avx512f")))
+inline __m512 load16_avx512(const float* source){
+    return _mm512_loadu_ps(source);
+}
+
+template<typename T>
+__attribute__((target("avx512f")))
+inline __m512 load16_avx512(const T* source){
+    return convert16_avx512(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(source)), source);
+}
+
+// `mask` selects the first lanes, the other lanes are 0
+__attribute__((target("avx512f")))
+inline __m512 maskzLoad16_avx512(const __mmask16 mask, const float* source){
+    return _mm512_maskz_loadu_ps(mask, source);
+}
+
+// Masked 16-bit loads need AVX512BW, the values are loaded in pairs as 32-bit lanes and an odd last value is added
+// to the next lane
+template<typename T>
+__attribute__((target("avx512f")))
+inline __m512 maskzLoad16_avx512(const __mmask16 mask, const T* source){
+    const UIN n = __builtin_popcount(mask);
+    const UIN numPairs = n / 2;
+    __m512i values = _mm512_maskz_loadu_epi32(static_cast<__mmask16>((1u << numPairs) - 1), source);
+    if (n % 2){
+        values = _mm512_mask_set1_epi32(values, static_cast<__mmask16>(1u << numPairs), precision::bitsOf(source[n - 1]));
+    }
+    return convert16_avx512(_mm512_castsi512_si256(values), source);
+}
+
+template<typename T, UIN FixedK = 0>
+__attribute__((target("avx512f")))
+float dot_avx512(const T* a, const T* b, const UIN runtimeK){
+    const UIN K = kdispatch::resolveK<FixedK>(runtimeK);
+    __m512 sum0 = _mm512_setzero_ps(), sum1 = _mm512_setzero_ps();
+    __m512 sum2 = _mm512_setzero_ps(), sum3 = _mm512_setzero_ps();
+    UIN k = 0;
+    for (; k + 64 <= K; k += 64){
+        sum0 = _mm512_fmadd_ps(load16_avx512(a + k), load16_avx512(b + k), sum0);
+        sum1 = _mm512_fmadd_ps(load16_avx512(a + k + 16), load16_avx512(b + k + 16), sum1);
+        sum2 = _mm512_fmadd_ps(load16_avx512(a + k + 32), load16_avx512(b + k + 32), sum2);
+        sum3 = _mm512_fmadd_ps(load16_avx512(a + k + 48), load16_avx512(b + k + 48), sum3);
+    }
+    for (; k + 16 <= K; k += 16){
+        sum0 = _mm512_fmadd_ps(load16_avx512(a + k), load16_avx512(b + k), sum0);
+    }
+
+    // The tail is a masked load, the masked out lanes are 0
+    if (k < K){
+        const __mmask16 mask = static_cast<__mmask16>((1u << (K - k)) - 1);
+        sum1 = _mm512_fmadd_ps(maskzLoad16_avx512(mask, a + k), maskzLoad16_avx512(mask, b + k), sum1);
+    }
+    return _mm512_reduce_add_ps(_mm512_add_ps(_mm512_add_ps(sum0, sum1), _mm512_add_ps(sum2, sum3)));
+}
+
+template<typename T, UIN FixedK = 0>
+__attribute__((target("avx512f")))
+void multiDot_avx512(const T* a, const T* const* b, const UIN runtimeK, float* dots){
+    const UIN K = kdispatch::resolveK<FixedK>(runtimeK);
+    __m512 sum[2][numColsEachDot];
+    for (UIN colId = 0; colId < numColsEachDot; ++colId){
+        sum[0][colId] = _mm512_setzero_ps();
+        sum[1][colId] = _mm512_setzero_ps();
+    }
+    UIN k = 0;
+    for (; k + 32 <= K; k += 32){
+        const __m512 a0 = load16_avx512(a + k);
+        const __m512 a1 = load16_avx512(a + k + 16);
+        for (UIN colId = 0; colId < numColsEachDot; ++colId){
+            sum[0][colId] = _mm512_fmadd_ps(a0, load16_avx512(b[colId] + k), sum[0][colId]);
+            sum[1][colId] = _mm512_fmadd_ps(a1, load16_avx512(b[colId] + k + 16), sum[1][colId]);
+        }
+    }
+    for (; k < K; k += 16){
+        const __mmask16 mask = K - k >= 16 ? static_cast<__mmask16>(0xFFFF)
+                                           : static_cast<__mmask16>((1u << (K - k)) - 1);
+        const __m512 a0 = maskzLoad16_avx512(mask, a + k);
+        for (UIN colId = 0; colId < numColsEachDot; ++colId){
+            sum[0][colId] = _mm512_fmadd_ps(a0, maskzLoad16_avx512(mask, b[colId] + k), sum[0][colId]);
+        }
+    }
+    for (UIN colId = 0; colId < numColsEachDot; ++colId){
+        dots[colId] = _mm512_reduce_add_ps(_mm512_add_ps(sum[0][colId], sum[1][colId]));
+    }
+}
+
+template<typename T>
+__attribute__((target("avx512f")))
+void convert_avx512(const T* source, const UIN n, float* destination){
+    UIN idx = 0;
+    for (; idx + 16 <= n; idx += 16){
+        _mm512_storeu_ps(destination + idx, load16_avx512(source + idx));
+    }
+    for (; idx < n; ++idx){
+        destination[idx] = precision::toFloat(source[idx]);
+    }
+}
+
+// bf16 with AVX512-BF16, one instruction multiplies 32 pairs and adds them to 16 fp32 accumulators.
+// The tail of less than 32 values is converted like without AVX512-BF16
+template<UIN FixedK = 0>
+__attribute__((target("avx512f,avx512bf16")))
+float dot_avx512bf16(const __nv_bfloat16* a, const __nv_bfloat16* b, const UIN runtimeK){
+    const UIN K = kdispatch::resolveK<FixedK>(runtimeK);
+    __m512 sum0 = _mm512_setzero_ps(), sum1 = _mm512_setzero_ps();
+    UIN k = 0;
+    for (; k + 64 <= K; k += 64){
+        sum0 = _mm512_dpbf16_ps(sum0, (__m512bh) _mm512_loadu_si512(a + k), (__m512bh) _mm512_loadu_si512(b + k));
+        sum1 = _mm512_dpbf16_ps(sum1, (__m512bh) _mm512_loadu_si512(a + k + 32),
+                                (__m512bh) _mm512_loadu_si512(b + k + 32));
+    }
+    for (; k + 32 <= K; k += 32){
+        sum0 = _mm512_dpbf16_ps(sum0, (__m512bh) _mm512_loadu_si512(a + k), (__m512bh) _mm512_loadu_si512(b + k));
+    }
+    for (; k < K; k += 16){
+        const __mmask16 mask = K - k >= 16 ? static_cast<__mmask16>(0xFFFF)
+                                           : static_cast<__mmask16>((1u << (K - k)) - 1);
+        sum1 = _mm512_fmadd_ps(maskzLoad16_avx512(mask, a + k), maskzLoad16_avx512(mask, b + k), sum1);
+    }
+    return _mm512_reduce_add_ps(_mm512_add_ps(sum0, sum1));
+}
+
+template<UIN FixedK = 0>
+__attribute__((target("avx512f,avx512bf16")))
+void multiDot_avx512bf16(const __nv_bfloat16* a, const __nv_bfloat16* const* b, const UIN runtimeK, float* dots){
+    const UIN K = kdispatch::resolveK<FixedK>(runtimeK);
+    __m512 sum[numColsEachDot];
+    for (UIN colId = 0; colId < numColsEachDot; ++colId){
+        sum[colId] = _mm512_setzero_ps();
+    }
+    UIN k = 0;
+    for (; k + 32 <= K; k += 32){
+        const __m512bh a0 = (__m512bh) _mm512_loadu_si512(a + k);
+        for (UIN colId = 0; colId < numColsEachDot; ++colId){
+            sum[colId] = _mm512_dpbf16_ps(sum[colId], a0, (__m512bh) _mm512_loadu_si512(b[colId] + k));
+        }
+    }
+    for (; k < K; k += 16){
+        const __mmask16 mask = K - k >= 16 ? static_cast<__mmask16>(0xFFFF)
+                                           : static_cast<__mmask16>((1u << (K - k)) - 1);
+        const __m512 a0 = maskzLoad16_avx512(mask, a + k);
+        for (UIN colId = 0; colId < numColsEachDot; ++colId){
+            sum[colId] = _mm512_fmadd_ps(a0, maskzLoad16_avx512(mask, b[colId] + k), sum[colId]);
+        }
+    }
+    for (UIN colId = 0; colId < numColsEachDot; ++colId){
+        dots[colId] = _mm512_reduce_add_ps(sum[colId]);
+    }
+}
+
+// Only used if ROW_PANEL_SIZE is a multiple of 16
+template<UIN FixedK = 0>
+__attribute__((target("avx512f")))
+void denseBlock_avx512(const float* packedA, const float* const* b, const UIN runtimeK, float* block){
+    const UIN K = kdispatch::resolveK<FixedK>(runtimeK);
+    for (UIN rowBegin = 0; rowBegin + 16 <= ROW_PANEL_SIZE; rowBegin += 16){
+        for (UIN colBegin = 0; colBegin < BLOCK_COL_SIZE; colBegin += numColsEachDenseBlockPass){
+            const float* const* bCols = b + colBegin;
+            __m512 sum[numColsEachDenseBlockPass];
+            for (UIN colId = 0; colId < numColsEachDenseBlockPass; ++colId){
+                sum[colId] = _mm512_setzero_ps();
+            }
+            for (UIN k = 0; k < K; ++k){
+                const __m512 a = _mm512_loadu_ps(packedA + static_cast<size_t>(k) * ROW_PANEL_SIZE + rowBegin);
+                for (UIN colId = 0; colId < numColsEachDenseBlockPass; ++colId){
+                    sum[colId] = _mm512_fmadd_ps(a, _mm512_set1_ps(bCols[colId][k]), sum[colId]);
+                }
+            }
+            for (UIN colId = 0; colId < numColsEachDenseBlockPass; ++colId){
+                _mm512_storeu_ps(block + (colBegin + colId) * ROW_PANEL_SIZE + rowBegin, sum[colId]);
+            }
+        }
+    }
+}
+
+__attribute__((target("avx512f")))
+void axpy_avx512(const float alpha, const float* x, const UIN D, float* y){
+    const __m512 alphaVector = _mm512_set1_ps(alpha);
+    for (UIN d = 0; d < D; d += 16){
+        const __mmask16 mask = D - d >= 16 ? static_cast<__mmask16>(0xFFFF)
+                                           : static_cast<__mmask16>((1u << (D - d)) - 1);
+        const __m512 result = _mm512_fmadd_ps(alphaVector, _mm512_maskz_loadu_ps(mask, x + d),
+                                              _mm512_maskz_loadu_ps(mask, y + d));
+        _mm512_mask_storeu_ps(y + d, mask, result);
+    }
+}
+
+__attribute__((target("avx2,fma")))
+inline int32_t horizontalSumInt32_avx2(const __m256i value){
+    __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(value), _mm256_extracti128_si256(value, 1));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(sum);
+}
+
+// 16 int8 values sign extended to int16, madd multiplies them and adds the products in pairs to int32
+__attribute__((target("avx2,fma")))
+inline __m256i load16Int8_avx2(const int8_t* source){
+    return _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(source)));
+}
+
+__attribute__((target("avx2,fma")))
+float dotInt8_avx2(const int8_t* a, const int8_t* b, const UIN K){
+    __m256i sum0 = _mm256_setzero_si256(), sum1 = _mm256_setzero_si256();
+    UIN k = 0;
+    for (; k + 32 <= K; k += 32){
+        sum0 = _mm256_add_epi32(sum0, _mm256_madd_epi16(load16Int8_avx2(a + k), load16Int8_avx2(b + k)));
+        sum1 = _mm256_add_epi32(sum1, _mm256_madd_epi16(load16Int8_avx2(a + k + 16), load16Int8_avx2(b + k + 16)));
+    }
+    for (; k + 16 <= K; k += 16){
+        sum0 = _mm256_add_epi32(sum0, _mm256_madd_epi16(load16Int8_avx2(a + k), load16Int8_avx2(b + k)));
+    }
+    int32_t sum = horizontalSumInt32_avx2(_mm256_add_epi32(sum0, sum1));
+    for (; k < K; ++k){
+        sum += a[k] * b[k];
+    }
+    return static_cast<float>(sum);
+}
+
+__attribute__((target("avx2,fma")))
+void multiDotInt8_avx2(const int8_t* a, const int8_t* const* b, const UIN K, float* dots){
+    __m256i sum[numColsEachDot];
+    for (UIN colId = 0; colId < numColsEachDot; ++colId){
+        sum[colId] = _mm256_setzero_si256();
+    }
+    UIN k = 0;
+    for (; k + 16 <= K; k += 16){
+        const __m256i a0 = load16Int8_avx2(a + k);
+        for (UIN colId = 0; colId < numColsEachDot; ++colId){
+            sum[colId] = _mm256_add_epi32(sum[colId], _mm256_madd_epi16(a0, load16Int8_avx2(b[colId] + k)));
+        }
+    }
+    for (UIN colId = 0; colId < numColsEachDot; ++colId){
+        int32_t dot = horizontalSumInt32_avx2(sum[colId]);
+        for (UIN tailK = k; tailK < K; ++tailK){
+            dot += a[tailK] * b[colId][tailK];
+        }
+        dots[colId] = static_cast<float>(dot);
+    }
+}
+
+// The 4 values of a group of K of a column of B, sign extended to int16 and broadcast to the 4 rows of a vector
+__attribute__((target("avx2,fma")))
+inline __m256i broadcastInt8Group_avx2(const int32_t valuesB){
+    return _mm256_broadcastq_epi64(_mm_cvtepi8_epi16(_mm_cvtsi32_si128(valuesB)));
+}
+
+// Number of columns of an int8 dense block pass with AVX2, 8 rows are 2 vectors of 4 rows
+constexpr UIN numColsEachInt8DenseBlockPass_avx2 = 4;
+
+// Adds one group of K of 8 rows and the pass of columns, `valuesB` are the 4 values of the group of each column
+__attribute__((target("avx2,fma")))
+inline void accumulateInt8Group_avx2(const int8_t* a,
+                                     const int32_t* valuesB,
+                                     __m256i (*sum)[numColsEachInt8DenseBlockPass_avx2]){
+    const __m256i a0 = load16Int8_avx2(a);
+    const __m256i a1 = load16Int8_avx2(a + 16);
+    for (UIN colId = 0; colId < numColsEachInt8DenseBlockPass_avx2; ++colId){
+        const __m256i b0 = broadcastInt8Group_avx2(valuesB[colId]);
+        sum[0][colId] = _mm256_add_epi32(sum[0][colId], _mm256_madd_epi16(a0, b0));
+        sum[1][colId] = _mm256_add_epi32(sum[1][colId], _mm256_madd_epi16(a1, b0));
+    }
+}
+
+// AVX2 has no 4-byte dot product, one vector is 4 rows x 4 values of K sign extended to int16 and madd adds them in
+// pairs. The pair sums of 8 rows are added with hadd at the end
+__attribute__((target("avx2,fma")))
+void denseBlockInt8_avx2(const int8_t* packedA, const int32_t*, const int8_t* const* b, const UIN K, int32_t* block){
+    constexpr UIN numColsEachPass = numColsEachInt8DenseBlockPass_avx2;
+    const UIN numFullGroups = K / 4;
+    const UIN tailLength = K % 4;
+    for (UIN rowBegin = 0; rowBegin < ROW_PANEL_SIZE; rowBegin += 8){
+        const int8_t* packedRows = packedA + static_cast<size_t>(rowBegin) * 4;
+        for (UIN colBegin = 0; colBegin < BLOCK_COL_SIZE; colBegin += numColsEachPass){
+            const int8_t* const* bCols = b + colBegin;
+            __m256i sum[2][numColsEachPass];
+            for (UIN colId = 0; colId < numColsEachPass; ++colId){
+                sum[0][colId] = _mm256_setzero_si256();
+                sum[1][colId] = _mm256_setzero_si256();
+            }
+            int32_t valuesB[numColsEachPass];
+            for (UIN group = 0; group < numFullGroups; ++group){
+                for (UIN colId = 0; colId < numColsEachPass; ++colId){
+                    std::memcpy(valuesB + colId, bCols[colId] + group * 4, sizeof(int32_t));
+                }
+                accumulateInt8Group_avx2(packedRows + static_cast<size_t>(group) * ROW_PANEL_SIZE * 4, valuesB, sum);
+            }
+            if (tailLength > 0){
+                for (UIN colId = 0; colId < numColsEachPass; ++colId){
+                    valuesB[colId] = 0;
+                    std::memcpy(valuesB + colId, bCols[colId] + numFullGroups * 4, tailLength);
+                }
+                accumulateInt8Group_avx2(packedRows + static_cast<size_t>(numFullGroups) * ROW_PANEL_SIZE * 4, valuesB,
+                                         sum);
+            }
+            for (UIN colId = 0; colId < numColsEachPass; ++colId){
+                // [r0 r1 r4 r5 | r2 r3 r6 r7] to the order of the rows
+                const __m256i rowSums = _mm256_hadd_epi32(sum[0][colId], sum[1][colId]);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(block + (colBegin + colId) * ROW_PANEL_SIZE + rowBegin),
+                                    _mm256_permute4x64_epi64(rowSums, _MM_SHUFFLE(3, 1, 2, 0)));
+            }
+        }
+    }
+}
+
+// VNNI multiplies unsigned by signed bytes and adds 4 products to an int32 lane. B is made unsigned by adding 128
+// (b ^ 0x80), which adds 128 * sum(a) to the dot product, sum(a) is one more VNNI instruction with 1 as B.
+// The masked out lanes of A are 0, so they add nothing
+__attribute__((target("avx512f,avx512bw,avx512vnni")))
+inline __mmask64 maskOfInt8Tail_avx512(const UIN n){
+    return n >= 64 ? ~static_cast<__mmask64>(0) : (static_cast<__mmask64>(1) << n) - 1;
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vnni")))
+float dotInt8_avx512vnni(const int8_t* a, const int8_t* b, const UIN K){
+    const __m512i bias = _mm512_set1_epi8(static_cast<char>(0x80));
+    const __m512i ones = _mm512_set1_epi8(1);
+    __m512i sum = _mm512_setzero_si512(), sumA = _mm512_setzero_si512();
+    for (UIN k = 0; k < K; k += 64){
+        const __mmask64 mask = maskOfInt8Tail_avx512(K - k);
+        const __m512i a0 = _mm512_maskz_loadu_epi8(mask, a + k);
+        sum = _mm512_dpbusd_epi32(sum, _mm512_xor_si512(_mm512_maskz_loadu_epi8(mask, b + k), bias), a0);
+        sumA = _mm512_dpbusd_epi32(sumA, ones, a0);
+    }
+    return static_cast<float>(_mm512_reduce_add_epi32(_mm512_sub_epi32(sum, _mm512_slli_epi32(sumA, 7))));
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vnni")))
+void multiDotInt8_avx512vnni(const int8_t* a, const int8_t* const* b, const UIN K, float* dots){
+    const __m512i bias = _mm512_set1_epi8(static_cast<char>(0x80));
+    const __m512i ones = _mm512_set1_epi8(1);
+    __m512i sum[numColsEachDot];
+    for (UIN colId = 0; colId < numColsEachDot; ++colId){
+        sum[colId] = _mm512_setzero_si512();
+    }
+    __m512i sumA = _mm512_setzero_si512();
+    for (UIN k = 0; k < K; k += 64){
+        const __mmask64 mask = maskOfInt8Tail_avx512(K - k);
+        const __m512i a0 = _mm512_maskz_loadu_epi8(mask, a + k);
+        for (UIN colId = 0; colId < numColsEachDot; ++colId){
+            const __m512i b0 = _mm512_xor_si512(_mm512_maskz_loadu_epi8(mask, b[colId] + k), bias);
+            sum[colId] = _mm512_dpbusd_epi32(sum[colId], b0, a0);
+        }
+        sumA = _mm512_dpbusd_epi32(sumA, ones, a0);
+    }
+    const __m512i biasOfA = _mm512_slli_epi32(sumA, 7);
+    for (UIN colId = 0; colId < numColsEachDot; ++colId){
+        dots[colId] = static_cast<float>(_mm512_reduce_add_epi32(_mm512_sub_epi32(sum[colId], biasOfA)));
+    }
+}
+
+// Only used if ROW_PANEL_SIZE is a multiple of 16. A group of 4 values of K of 16 rows is one vector of A, the 4 values
+// of a column of B are broadcast, made unsigned like in `dotInt8_avx512vnni`, and the bias 128 * `rowSumsA` is
+// subtracted at the end
+__attribute__((target("avx512f,avx512bw,avx512vnni")))
+void denseBlockInt8_avx512vnni(const int8_t* packedA,
+                               const int32_t* rowSumsA,
+                               const int8_t* const* b,
+                               const UIN K,
+                               int32_t* block){
+    const UIN numFullGroups = K / 4;
+    const UIN tailLength = K % 4;
+    const __m512i bias = _mm512_set1_epi8(static_cast<char>(0x80));
+    for (UIN rowBegin = 0; rowBegin + 16 <= ROW_PANEL_SIZE; rowBegin += 16){
+        const __m512i rowBias = _mm512_slli_epi32(_mm512_loadu_si512(rowSumsA + rowBegin), 7);
+        const int8_t* packedRows = packedA + static_cast<size_t>(rowBegin) * 4;
+        for (UIN colBegin = 0; colBegin < BLOCK_COL_SIZE; colBegin += numColsEachDenseBlockPass){
+            const int8_t* const* bCols = b + colBegin;
+            __m512i sum[numColsEachDenseBlockPass];
+            for (UIN colId = 0; colId < numColsEachDenseBlockPass; ++colId){
+                sum[colId] = _mm512_setzero_si512();
+            }
+            for (UIN group = 0; group < numFullGroups; ++group){
+                const __m512i a = _mm512_loadu_si512(packedRows + static_cast<size_t>(group) * ROW_PANEL_SIZE * 4);
+                for (UIN colId = 0; colId < numColsEachDenseBlockPass; ++colId){
+                    int32_t valuesB;
+                    std::memcpy(&valuesB, bCols[colId] + group * 4, sizeof(valuesB));
+                    const __m512i b0 = _mm512_xor_si512(_mm512_set1_epi32(valuesB), bias);
+                    sum[colId] = _mm512_dpbusd_epi32(sum[colId], b0, a);
+                }
+            }
+            if (tailLength > 0){
+                const __m512i a = _mm512_loadu_si512(packedRows
+                                                         + static_cast<size_t>(numFullGroups) * ROW_PANEL_SIZE * 4);
+                for (UIN colId = 0; colId < numColsEachDenseBlockPass; ++colId){
+                    int32_t valuesB = 0;
+                    std::memcpy(&valuesB, bCols[colId] + numFullGroups * 4, tailLength);
+                    const __m512i b0 = _mm512_xor_si512(_mm512_set1_epi32(valuesB), bias);
+                    sum[colId] = _mm512_dpbusd_epi32(sum[colId], b0, a);
+                }
+            }
+            for (UIN colId = 0; colId < numColsEachDenseBlockPass; ++colId){
+                _mm512_storeu_si512(block + (colBegin + colId) * ROW_PANEL_SIZE + rowBegin,
+                                    _mm512_sub_epi32(sum[colId], rowBias));
+            }
+        }
+    }
+}
+#endif // BSMR_CPU_X86
+
+cpu::Isa detectIsa(){
+    cpu::Isa isa = cpu::Isa::scalar;
+#ifdef BSMR_CPU_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") && __builtin_cpu_supports("f16c")){
+        isa = cpu::Isa::avx2;
+    }
+    if (__builtin_cpu_supports("avx512f")){
+        isa = cpu::Isa::avx512;
+    }
+#endif
+
+    const char* requestedIsa = std::getenv("BSMR_CPU_ISA");
+    if (requestedIsa){
+        for (const cpu::Isa candidate : {cpu::Isa::scalar, cpu::Isa::avx2, cpu::Isa::avx512}){
+            if (std::strcmp(requestedIsa, cpu::getIsaName(candidate)) == 0){
+                isa = std::min(isa, candidate);
+            }
+        }
+    }
+
+    return isa;
+}
+
+// The kernels of the specialized K ignore the K they are called with, they must only get dot products of length K
+template<typename T>
+DotFunctions<T> getDotFunctions(const UIN K){
+    return kdispatch::dispatchK(K, [](auto fixedK) -> DotFunctions<T>{
+        constexpr UIN FixedK = decltype(fixedK)::value;
+#ifdef BSMR_CPU_X86
+        if constexpr (std::is_same<T, __nv_bfloat16>::value){
+            static const bool hasAvx512Bf16 = __builtin_cpu_supports("avx512bf16");
+            if (cpu::getIsa() == cpu::Isa::avx512 && hasAvx512Bf16){
+                return {dot_avx512bf16<FixedK>, multiDot_avx512bf16<FixedK>};
+            }
+        }
+#endif
+        switch (cpu::getIsa()){
+#ifdef BSMR_CPU_X86
+            case cpu::Isa::avx512: return {dot_avx512<T, FixedK>, multiDot_avx512<T, FixedK>};
+            case cpu::Isa::avx2: return {dot_avx2<T, FixedK>, multiDot_avx2<T, FixedK>};
+#endif
+            default: return {dot_scalar<T, FixedK>, multiDot_scalar<T, FixedK>};
+        }
+    });
+}
+
+template<typename T>
+ConvertFunction<T> getConvertFunction(){
+    switch (cpu::getIsa()){
+#ifdef BSMR_CPU_X86
+        case cpu::Isa::avx512: return convert_avx512<T>;
+        case cpu::Isa::avx2: return convert_avx2<T>;
+#endif
+        default: return convert_scalar<T>;
+    }
+}
+
+AxpyFunction getAxpyFunction(){
+    switch (cpu::getIsa()){
+#ifdef BSMR_CPU_X86
+        case cpu::Isa::avx512: return axpy_avx512;
+        case cpu::Isa::avx2: return axpy_avx2;
+#endif
+        default: return axpy_scalar;
+    }
+}
+
+DenseBlockFunction getDenseBlockFunction(const UIN K){
+    return kdispatch::dispatchK(K, [](auto fixedK) -> DenseBlockFunction{
+        constexpr UIN FixedK = decltype(fixedK)::value;
+        switch (cpu::getIsa()){
+#ifdef BSMR_CPU_X86
+            case cpu::Isa::avx512:
+                return ROW_PANEL_SIZE % 16 == 0 ? denseBlock_avx512<FixedK> : denseBlock_avx2<FixedK>;
+            case cpu::Isa::avx2: return denseBlock_avx2<FixedK>;
+#endif
+            default: return denseBlock_scalar<FixedK>;
+        }
+    });
+}
+
+#ifdef BSMR_CPU_X86
+bool hasAvx512Vnni(){
+    static const bool hasVnni = __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vnni");
+    return cpu::getIsa() == cpu::Isa::avx512 && hasVnni;
+}
+#endif
+
+// The int8 kernels are not specialized for K
+template<>
+DotFunctions<int8_t> getDotFunctions<int8_t>(UIN){
+#ifdef BSMR_CPU_X86
+    if (hasAvx512Vnni()){
+        return {dotInt8_avx512vnni, multiDotInt8_avx512vnni};
+    }
+    if (cpu::getIsa() >= cpu::Isa::avx2){
+        return {dotInt8_avx2, multiDotInt8_avx2};
+    }
+#endif
+    return {dotInt8_scalar, multiDotInt8_scalar};
+}
+
+Int8DenseBlockFunction getInt8DenseBlockFunction(){
+#ifdef BSMR_CPU_X86
+    if (hasAvx512Vnni() && ROW_PANEL_SIZE % 16 == 0){
+        return denseBlockInt8_avx512vnni;
+    }
+    if (cpu::getIsa() >= cpu::Isa::avx2){
+        return denseBlockInt8_avx2;
+    }
+#endif
+    return denseBlockInt8_scalar;
+}
+
+// One row of the sparse matrix, `values` is overwritten
+template<typename T>
+void sddmmRow(const DotFunctions<T>& dotFunctions,
+              const T* rowA,
+              const T* matrixB,
+              const size_t ldb,
+              const UIN K,
+              const UIN* colIndices,
+              const UIN numCols,
+              float* values){
+    if (K == 0){
+        std::fill(values, values + numCols, 0.0f);
+        return;
+    }
+    for (UIN kBegin = 0; kBegin < K; kBegin += kBlockSize){
+        const UIN kLength = std::min(kBlockSize, K - kBegin);
+        const T* a = rowA + kBegin;
+
+        UIN idx = 0;
+        for (; idx + numColsEachDot <= numCols; idx += numColsEachDot){
+            const T* b[numColsEachDot];
+            for (UIN colId = 0; colId < numColsEachDot; ++colId){
+                b[colId] = matrixB + static_cast<size_t>(colIndices[idx + colId]) * ldb + kBegin;
+            }
+            float dots[numColsEachDot];
+            dotFunctions.multiDot(a, b, kLength, dots);
+            for (UIN colId = 0; colId < numColsEachDot; ++colId){
+                values[idx + colId] = kBegin == 0 ? dots[colId] : values[idx + colId] + dots[colId];
+            }
+        }
+        for (; idx < numCols; ++idx){
+            const float dot = dotFunctions.dot(a, matrixB + static_cast<size_t>(colIndices[idx]) * ldb + kBegin,
+                                               kLength);
+            values[idx] = kBegin == 0 ? dot : values[idx] + dot;
+        }
+    }
+}
+/**
+ * The chunks of the row panels, each with about the same number of multiply-adds. A dense block costs BLOCK_SIZE
+ * dot products, a sparse value one, packing a row panel ROW_PANEL_SIZE. Row panels are never split.
+ **/
+std::vector<scheduler::WorkChunk> partitionRowPanels(const RPHM::HostArrays& tiling,
+                                                     const UIN numRowPanels,
+                                                     std::vector<uint64_t>& costOffsets){
+    std::vector<uint64_t> costs(numRowPanels);
+#pragma omp parallel for
+    for (UIN rowPanelId = 0; rowPanelId < numRowPanels; ++rowPanelId){
+        const uint64_t numDenseBlocks = tiling.blockOffsets[rowPanelId + 1] - tiling.blockOffsets[rowPanelId];
+        const uint64_t numSparseValues =
+            tiling.sparseValueOffsets[rowPanelId + 1] - tiling.sparseValueOffsets[rowPanelId];
+        costs[rowPanelId] = numDenseBlocks * BLOCK_SIZE + (numDenseBlocks > 0 ? ROW_PANEL_SIZE : 0) + numSparseValues;
+    }
+    scheduler::exclusiveScan(costs, costOffsets);
+
+    return scheduler::partition(costOffsets.data(), numRowPanels, scheduler::defaultNumChunks(), UINT64_MAX);
+}
+
+// Pack the rows of one row panel k-major, the missing rows of the last row panel are 0.
+// 16-bit rows are converted to `convertedRow` (K values) first, once for all the dense blocks of the row panel
+template<typename T>
+void packRowPanel(const T* matrixA,
+                  const size_t lda,
+                  const UIN K,
+                  const UIN* rows,
+                  const UIN numRows,
+                  float* packedA,
+                  const ConvertFunction<T> convert = nullptr,
+                  float* convertedRow = nullptr){
+    for (UIN localRow = 0; localRow < ROW_PANEL_SIZE; ++localRow){
+        const float* rowA = nullptr;
+        if (localRow < numRows){
+            if constexpr (std::is_same<T, float>::value){
+                rowA = matrixA + static_cast<size_t>(rows[localRow]) * lda;
+            }
+            else{
+                convert(matrixA + static_cast<size_t>(rows[localRow]) * lda, K, convertedRow);
+                rowA = convertedRow;
+            }
+        }
+        for (UIN k = 0; k < K; ++k){
+            packedA[static_cast<size_t>(k) * ROW_PANEL_SIZE + localRow] = rowA ? rowA[k] : 0.0f;
+        }
+    }
+}
+
+// The rows of a row panel in the reordered order, `numRows` is less than ROW_PANEL_SIZE for the last row panel
+const UIN* getRowPanelRows(const RPHM::HostArrays& tiling, const UIN rowPanelId, UIN& numRows){
+    const size_t startIndexOfRows = static_cast<size_t>(rowPanelId) * ROW_PANEL_SIZE;
+    numRows = std::min<size_t>(ROW_PANEL_SIZE,
+                               tiling.reorderedRows.size() - std::min(startIndexOfRows, tiling.reorderedRows.size()));
+    return tiling.reorderedRows.data() + startIndexOfRows;
+}
+
+// One dense block of a packed row panel. 16-bit columns of B are converted to `convertedB` (BLOCK_COL_SIZE x K) first,
+// the conversion is shared by the ROW_PANEL_SIZE rows of the block
+template<typename T>
+void computeDenseBlock(const DenseBlockFunction denseBlock,
+                       const ConvertFunction<T> convert,
+                       const T* matrixB,
+                       const size_t ldb,
+                       const UIN N,
+                       const UIN K,
+                       const RPHM::HostArrays& tiling,
+                       const UIN colBlockId,
+                       const size_t endIndexOfDenseCols,
+                       const float* packedA,
+                       float* convertedB,
+                       float* block){
+    // The padding columns (N) are computed from column 0, their slots are NULL_VALUE
+    const float* b[BLOCK_COL_SIZE];
+    for (UIN localCol = 0; localCol < BLOCK_COL_SIZE; ++localCol){
+        const size_t indexOfDenseCols = static_cast<size_t>(colBlockId) * BLOCK_COL_SIZE + localCol;
+        const UIN col = indexOfDenseCols < endIndexOfDenseCols ? tiling.denseCols[indexOfDenseCols] : N;
+        const T* colB = col < N ? matrixB + static_cast<size_t>(col) * ldb : matrixB;
+        if constexpr (std::is_same<T, float>::value){
+            b[localCol] = colB;
+        }
+        else{
+            float* convertedCol = convertedB + static_cast<size_t>(localCol) * K;
+            convert(colB, K, convertedCol);
+            b[localCol] = convertedCol;
+        }
+    }
+    denseBlock(packedA, b, K, block);
+}
+
+// Sparse values are ordered by column, the values of one column share the loads of B.
+// `store(idx, value)` gets the index of the value in the sparse arrays of the tiling.
+template<typename T, typename Store>
+void computeSparseValues(const DotFunctions<T>& dotFunctions,
+                         const T* matrixA,
+                         const size_t lda,
+                         const T* matrixB,
+                         const size_t ldb,
+                         const UIN K,
+                         const RPHM::HostArrays& tiling,
+                         const UIN rowPanelId,
+                         const UIN* rows,
+                         Store&& store){
+    const UIN endIndexOfSparseData = tiling.sparseValueOffsets[rowPanelId + 1];
+    for (UIN idx = tiling.sparseValueOffsets[rowPanelId]; idx < endIndexOfSparseData;){
+        const UIN col = tiling.sparseColIndices[idx];
+        const T* colB = matrixB + static_cast<size_t>(col) * ldb;
+        UIN numSameCol = 1;
+        while (numSameCol < numColsEachDot && idx + numSameCol < endIndexOfSparseData
+            && tiling.sparseColIndices[idx + numSameCol] == col){
+            ++numSameCol;
+        }
+
+        if (numSameCol == numColsEachDot){
+            const T* a[numColsEachDot];
+            for (UIN valueId = 0; valueId < numColsEachDot; ++valueId){
+                a[valueId] = matrixA + static_cast<size_t>(rows[tiling.sparseRelativeRows[idx + valueId]]) * lda;
+            }
+            float dots[numColsEachDot];
+            dotFunctions.multiDot(colB, a, K, dots);
+            for (UIN valueId = 0; valueId < numColsEachDot; ++valueId){
+                store(idx + valueId, dots[valueId]);
+            }
+            idx += numColsEachDot;
+        }
+        else{
+            const T* rowA = matrixA + static_cast<size_t>(rows[tiling.sparseRelativeRows[idx]]) * lda;
+            store(idx, dotFunctions.dot(rowA, colB, K));
+            ++idx;
+        }
+    }
+}
+
+template<typename T>
+void sddmmRowPanel(const DotFunctions<T>& dotFunctions,
+                   const DenseBlockFunction denseBlock,
+                   const ConvertFunction<T> convert,
+                   const T* matrixA,
+                   const size_t lda,
+                   const T* matrixB,
+                   const size_t ldb,
+                   const UIN N,
+                   const UIN K,
+                   const RPHM::HostArrays& tiling,
+                   const UIN rowPanelId,
+                   float* packedA,
+                   float* convertedB,
+                   float* block,
+                   float* matrixP){
+    UIN numRows;
+    const UIN* rows = getRowPanelRows(tiling, rowPanelId, numRows);
+
+    // Dense blocks, the packed rows are reused by every dense block of the row panel
+    const UIN startBlockId = tiling.blockOffsets[rowPanelId];
+    const UIN endBlockId = tiling.blockOffsets[rowPanelId + 1];
+    if (startBlockId < endBlockId){
+        // `convertedB` is not used until the first dense block
+        packRowPanel(matrixA, lda, K, rows, numRows, packedA, convert, convertedB);
+    }
+    const size_t endIndexOfDenseCols = std::min(static_cast<size_t>(endBlockId) * BLOCK_COL_SIZE,
+                                                tiling.denseCols.size());
+    for (UIN colBlockId = startBlockId; colBlockId < endBlockId; ++colBlockId){
+        computeDenseBlock(denseBlock, convert, matrixB, ldb, N, K, tiling, colBlockId, endIndexOfDenseCols, packedA,
+                          convertedB, block);
+
+        // Only the occupied slots are written. The empty slots write to `discarded` instead of branching,
+        // the occupancy of a block is too irregular to predict
+        const UIN* blockValues = tiling.blockValues.data() + static_cast<size_t>(colBlockId) * BLOCK_SIZE;
+        float discarded;
+        for (UIN localRow = 0; localRow < ROW_PANEL_SIZE; ++localRow){
+            for (UIN localCol = 0; localCol < BLOCK_COL_SIZE; ++localCol){
+                const UIN idxOfMatrixP = blockValues[localRow * BLOCK_COL_SIZE + localCol];
+                float* destination = idxOfMatrixP != NULL_VALUE ? matrixP + idxOfMatrixP : &discarded;
+                *destination = block[localCol * ROW_PANEL_SIZE + localRow];
+            }
+        }
+    }
+
+    computeSparseValues(dotFunctions, matrixA, lda, matrixB, ldb, K, tiling, rowPanelId, rows,
+                        [&](const UIN idx, const float value){
+                            matrixP[tiling.sparseValues[idx]] = value;
+                        });
+}
+
+// Pack the int8 rows of one row panel in groups of 4 values of K (see `Int8DenseBlockFunction`), the padding of K and
+// the missing rows of the last row panel are 0
+void packRowPanelInt8(const int8_t* matrixA,
+                      const size_t lda,
+                      const UIN K,
+                      const UIN* rows,
+                      const UIN numRows,
+                      int8_t* packedA,
+                      int32_t* rowSumsA){
+    std::fill(packedA, packedA + static_cast<size_t>((K + 3) / 4) * ROW_PANEL_SIZE * 4, 0);
+    for (UIN localRow = 0; localRow < ROW_PANEL_SIZE; ++localRow){
+        int32_t rowSum = 0;
+        if (localRow < numRows){
+            const int8_t* rowA = matrixA + static_cast<size_t>(rows[localRow]) * lda;
+            for (UIN k = 0; k < K; ++k){
+                packedA[(static_cast<size_t>(k / 4) * ROW_PANEL_SIZE + localRow) * 4 + k % 4] = rowA[k];
+                rowSum += rowA[k];
+            }
+        }
+        rowSumsA[localRow] = rowSum;
+    }
+}
+
+// `sddmmRowPanel` for int8 operands, the int32 dot products are dequantized with the scales of their row and column
+void sddmmRowPanelInt8(const DotFunctions<int8_t>& dotFunctions,
+                       const Int8DenseBlockFunction denseBlock,
+                       const cpu::QuantizedOperands& operands,
+                       const UIN N,
+                       const UIN K,
+                       const RPHM::HostArrays& tiling,
+                       const UIN rowPanelId,
+                       int8_t* packedA,
+                       int32_t* block,
+                       float* matrixP){
+    UIN numRows;
+    const UIN* rows = getRowPanelRows(tiling, rowPanelId, numRows);
+
+    const UIN startBlockId = tiling.blockOffsets[rowPanelId];
+    const UIN endBlockId = tiling.blockOffsets[rowPanelId + 1];
+    int32_t rowSumsA[ROW_PANEL_SIZE];
+    float scalesA[ROW_PANEL_SIZE];
+    if (startBlockId < endBlockId){
+        packRowPanelInt8(operands.matrixA, operands.lda, K, rows, numRows, packedA, rowSumsA);
+        for (UIN localRow = 0; localRow < ROW_PANEL_SIZE; ++localRow){
+            scalesA[localRow] = localRow < numRows ? operands.scalesA[rows[localRow]] : 0.0f;
+        }
+    }
+    const size_t endIndexOfDenseCols = std::min(static_cast<size_t>(endBlockId) * BLOCK_COL_SIZE,
+                                                tiling.denseCols.size());
+    for (UIN colBlockId = startBlockId; colBlockId < endBlockId; ++colBlockId){
+        // The padding columns (N) are computed from column 0 with the scale 0, their slots are NULL_VALUE
+        const int8_t* b[BLOCK_COL_SIZE];
+        float scalesB[BLOCK_COL_SIZE];
+        for (UIN localCol = 0; localCol < BLOCK_COL_SIZE; ++localCol){
+            const size_t indexOfDenseCols = static_cast<size_t>(colBlockId) * BLOCK_COL_SIZE + localCol;
+            const UIN col = indexOfDenseCols < endIndexOfDenseCols ? tiling.denseCols[indexOfDenseCols] : N;
+            b[localCol] = col < N ? operands.matrixB + static_cast<size_t>(col) * operands.ldb : operands.matrixB;
+            scalesB[localCol] = col < N ? operands.scalesB[col] : 0.0f;
+        }
+        denseBlock(packedA, rowSumsA, b, K, block);
+
+        const UIN* blockValues = tiling.blockValues.data() + static_cast<size_t>(colBlockId) * BLOCK_SIZE;
+        float discarded;
+        for (UIN localRow = 0; localRow < ROW_PANEL_SIZE; ++localRow){
+            for (UIN localCol = 0; localCol < BLOCK_COL_SIZE; ++localCol){
+                const UIN idxOfMatrixP = blockValues[localRow * BLOCK_COL_SIZE + localCol];
+                float* destination = idxOfMatrixP != NULL_VALUE ? matrixP + idxOfMatrixP : &discarded;
+                *destination = scalesA[localRow] * scalesB[localCol]
+                    * static_cast<float>(block[localCol * ROW_PANEL_SIZE + localRow]);
+            }
+        }
+    }
+
+    computeSparseValues(dotFunctions, operands.matrixA, operands.lda, operands.matrixB, operands.ldb, K, tiling,
+                        rowPanelId, rows,
+                        [&](const UIN idx, const float value){
+                            const float scale = operands.scalesA[rows[tiling.sparseRelativeRows[idx]]]
+                                * operands.scalesB[tiling.sparseColIndices[idx]];
+                            matrixP[tiling.sparseValues[idx]] = scale * value;
+                        });
+}
+
+/**
+ * The index metadata of a row panel, decoded once for a batch of heads. The heads share lda and ldb, so the offsets
+ * of the rows of A and the columns of B are the same for every head, a head only adds its own base pointers.
+ **/
+struct RowPanelPlan{
+    const UIN* rows;
+    UIN numRows;
+    UIN numDenseBlocks;
+    std::vector<size_t> denseColOffsetsB; // BLOCK_COL_SIZE for each dense block, the padding columns are 0
+    std::vector<UIN> occupiedSlotOffsets; // Offsets of each dense block in `occupiedSlots`
+    std::vector<UIN> occupiedSlots; // Slot of `block`, localCol * ROW_PANEL_SIZE + localRow
+    std::vector<UIN> occupiedSlotValues; // Index of matrixP
+    std::vector<size_t> sparseOffsetsA;
+    std::vector<size_t> sparseOffsetsB;
+    const UIN* sparseValues;
+    UIN numSparseValues;
+};
+
+void decodeRowPanelPlan(const RPHM::HostArrays& tiling,
+                        const UIN rowPanelId,
+                        const size_t lda,
+                        const size_t ldb,
+                        const UIN N,
+                        RowPanelPlan& plan){
+    plan.rows = getRowPanelRows(tiling, rowPanelId, plan.numRows);
+
+    const UIN startBlockId = tiling.blockOffsets[rowPanelId];
+    const UIN endBlockId = tiling.blockOffsets[rowPanelId + 1];
+    const size_t endIndexOfDenseCols = std::min(static_cast<size_t>(endBlockId) * BLOCK_COL_SIZE,
+                                                tiling.denseCols.size());
+    plan.numDenseBlocks = endBlockId - startBlockId;
+    plan.denseColOffsetsB.resize(static_cast<size_t>(plan.numDenseBlocks) * BLOCK_COL_SIZE);
+    plan.occupiedSlotOffsets.assign(1, 0);
+    plan.occupiedSlots.resize(static_cast<size_t>(plan.numDenseBlocks) * BLOCK_SIZE);
+    plan.occupiedSlotValues.resize(static_cast<size_t>(plan.numDenseBlocks) * BLOCK_SIZE);
+    UIN numOccupiedSlots = 0;
+    for (UIN colBlockId = startBlockId; colBlockId < endBlockId; ++colBlockId){
+        for (UIN localCol = 0; localCol < BLOCK_COL_SIZE; ++localCol){
+            const size_t indexOfDenseCols = static_cast<size_t>(colBlockId) * BLOCK_COL_SIZE + localCol;
+            const UIN col = indexOfDenseCols < endIndexOfDenseCols ? tiling.denseCols[indexOfDenseCols] : N;
+            plan.denseColOffsetsB[indexOfDenseCols - static_cast<size_t>(startBlockId) * BLOCK_COL_SIZE] =
+                col < N ? static_cast<size_t>(col) * ldb : 0;
+        }
+        const UIN* blockValues = tiling.blockValues.data() + static_cast<size_t>(colBlockId) * BLOCK_SIZE;
+        // Compacted without branches, every slot is written and only the occupied ones advance
+        for (UIN localRow = 0; localRow < ROW_PANEL_SIZE; ++localRow){
+            for (UIN localCol = 0; localCol < BLOCK_COL_SIZE; ++localCol){
+                const UIN idxOfMatrixP = blockValues[localRow * BLOCK_COL_SIZE + localCol];
+                plan.occupiedSlots[numOccupiedSlots] = localCol * ROW_PANEL_SIZE + localRow;
+                plan.occupiedSlotValues[numOccupiedSlots] = idxOfMatrixP;
+                numOccupiedSlots += idxOfMatrixP != NULL_VALUE;
+            }
+        }
+        plan.occupiedSlotOffsets.push_back(numOccupiedSlots);
+    }
+
+    const UIN startIndexOfSparseData = tiling.sparseValueOffsets[rowPanelId];
+    plan.numSparseValues = tiling.sparseValueOffsets[rowPanelId + 1] - startIndexOfSparseData;
+    plan.sparseValues = tiling.sparseValues.data() + startIndexOfSparseData;
+    plan.sparseOffsetsA.resize(plan.numSparseValues);
+    plan.sparseOffsetsB.resize(plan.numSparseValues);
+    for (UIN valueId = 0; valueId < plan.numSparseValues; ++valueId){
+        const UIN idx = startIndexOfSparseData + valueId;
+        plan.sparseOffsetsA[valueId] = static_cast<size_t>(plan.rows[tiling.sparseRelativeRows[idx]]) * lda;
+        plan.sparseOffsetsB[valueId] = static_cast<size_t>(tiling.sparseColIndices[idx]) * ldb;
+    }
+}
+
+// One head of a row panel with a decoded plan, the same computation as `sddmmRowPanel`
+void sddmmRowPanelOfHead(const DotFunctions<float>& dotFunctions,
+                         const DenseBlockFunction denseBlock,
+                         const RowPanelPlan& plan,
+                         const float* matrixA,
+                         const size_t lda,
+                         const float* matrixB,
+                         const UIN K,
+                         float* packedA,
+                         float* block,
+                         float* matrixP){
+    if (plan.numDenseBlocks > 0){
+        packRowPanel(matrixA, lda, K, plan.rows, plan.numRows, packedA);
+    }
+    for (UIN blockId = 0; blockId < plan.numDenseBlocks; ++blockId){
+        const float* b[BLOCK_COL_SIZE];
+        for (UIN localCol = 0; localCol < BLOCK_COL_SIZE; ++localCol){
+            b[localCol] = matrixB + plan.denseColOffsetsB[static_cast<size_t>(blockId) * BLOCK_COL_SIZE + localCol];
+        }
+        denseBlock(packedA, b, K, block);
+        for (UIN slotId = plan.occupiedSlotOffsets[blockId]; slotId < plan.occupiedSlotOffsets[blockId + 1]; ++slotId){
+            matrixP[plan.occupiedSlotValues[slotId]] = block[plan.occupiedSlots[slotId]];
+        }
+    }
+
+    for (UIN valueId = 0; valueId < plan.numSparseValues;){
+        const size_t offsetB = plan.sparseOffsetsB[valueId];
+        UIN numSameCol = 1;
+        while (numSameCol < numColsEachDot && valueId + numSameCol < plan.numSparseValues
+            && plan.sparseOffsetsB[valueId + numSameCol] == offsetB){
+            ++numSameCol;
+        }
+
+        if (numSameCol == numColsEachDot){
+            const float* a[numColsEachDot];
+            for (UIN localId = 0; localId < numColsEachDot; ++localId){
+                a[localId] = matrixA + plan.sparseOffsetsA[valueId + localId];
+            }
+            float dots[numColsEachDot];
+            dotFunctions.multiDot(matrixB + offsetB, a, K, dots);
+            for (UIN localId = 0; localId < numColsEachDot; ++localId){
+                matrixP[plan.sparseValues[valueId + localId]] = dots[localId];
+            }
+            valueId += numColsEachDot;
+        }
+        else{
+            matrixP[plan.sparseValues[valueId]] =
+                dotFunctions.dot(matrixA + plan.sparseOffsetsA[valueId], matrixB + offsetB, K);
+            ++valueId;
+        }
+    }
+}
+
+/**
+ * Online softmax of the rows of a row panel, flash-attention style. For each row, `rowMax` is the largest score seen so
+ * far, `rowSum` the sum of exp(score - rowMax) and `output` (ROW_PANEL_SIZE x D, row-major) the sum of
+ * exp(score - rowMax) * V[col]. A block of new scores first raises the max of its rows once, which rescales the sum
+ * and the output, then every score is added.
+ **/
+struct OnlineSoftmax{
+    float rowMax[ROW_PANEL_SIZE];
+    float rowSum[ROW_PANEL_SIZE];
+    float* output;
+    UIN D;
+
+    void reset(){
+        std::fill(rowMax, rowMax + ROW_PANEL_SIZE, -std::numeric_limits<float>::infinity());
+        std::fill(rowSum, rowSum + ROW_PANEL_SIZE, 0.0f);
+        std::fill(output, output + static_cast<size_t>(ROW_PANEL_SIZE) * D, 0.0f);
+    }
+
+    void raiseMax(const UIN localRow, const float max){
+        if (!(max > rowMax[localRow])){
+            return;
+        }
+        const float correction = std::exp(rowMax[localRow] - max);
+        rowSum[localRow] *= correction;
+        float* outputRow = output + static_cast<size_t>(localRow) * D;
+        for (UIN d = 0; d < D; ++d){
+            outputRow[d] *= correction;
+        }
+        rowMax[localRow] = max;
+    }
+
+    void add(const AxpyFunction axpy, const UIN localRow, const float score, const float* rowV){
+        const float weight = std::exp(score - rowMax[localRow]);
+        rowSum[localRow] += weight;
+        axpy(weight, rowV, D, output + static_cast<size_t>(localRow) * D);
+    }
+};
+
+// The same row panel as `sddmmRowPanel`, the scores go into the online softmax instead of matrixP
+void attentionRowPanel(const DotFunctions<float>& dotFunctions,
+                       const DenseBlockFunction denseBlock,
+                       const AxpyFunction axpy,
+                       const cpu::AttentionArguments& arguments,
+                       const RPHM::HostArrays& tiling,
+                       const UIN rowPanelId,
+                       float* packedA,
+                       float* block,
+                       std::vector<float>& sparseScores,
+                       OnlineSoftmax& softmax){
+    UIN numRows;
+    const UIN* rows = getRowPanelRows(tiling, rowPanelId, numRows);
+    softmax.reset();
+
+    // score = scale * S * dot, S is 1 if `valuesS` is null
+    const auto getScore = [&](const float dot, const UIN idxOfMatrixS){
+        return arguments.scale * (arguments.valuesS ? arguments.valuesS[idxOfMatrixS] * dot : dot);
+    };
+
+    const UIN startBlockId = tiling.blockOffsets[rowPanelId];
+    const UIN endBlockId = tiling.blockOffsets[rowPanelId + 1];
+    if (startBlockId < endBlockId){
+        packRowPanel(arguments.matrixA, arguments.lda, arguments.K, rows, numRows, packedA);
+    }
+    const size_t endIndexOfDenseCols = std::min(static_cast<size_t>(endBlockId) * BLOCK_COL_SIZE,
+                                                tiling.denseCols.size());
+    for (UIN colBlockId = startBlockId; colBlockId < endBlockId; ++colBlockId){
+        computeDenseBlock<float>(denseBlock, nullptr, arguments.matrixB, arguments.ldb, arguments.N, arguments.K, tiling,
+                                 colBlockId, endIndexOfDenseCols, packedA, nullptr, block);
+
+        const UIN* blockValues = tiling.blockValues.data() + static_cast<size_t>(colBlockId) * BLOCK_SIZE;
+        const UIN* blockCols = tiling.denseCols.data() + static_cast<size_t>(colBlockId) * BLOCK_COL_SIZE;
+        for (UIN localRow = 0; localRow < numRows; ++localRow){
+            const UIN* rowValues = blockValues + localRow * BLOCK_COL_SIZE;
+            float scores[BLOCK_COL_SIZE];
+            float max = -std::numeric_limits<float>::infinity();
+            for (UIN localCol = 0; localCol < BLOCK_COL_SIZE; ++localCol){
+                if (rowValues[localCol] != NULL_VALUE){
+                    scores[localCol] = getScore(block[localCol * ROW_PANEL_SIZE + localRow], rowValues[localCol]);
+                    max = std::max(max, scores[localCol]);
+                }
+            }
+            softmax.raiseMax(localRow, max);
+            for (UIN localCol = 0; localCol < BLOCK_COL_SIZE; ++localCol){
+                if (rowValues[localCol] != NULL_VALUE){
+                    softmax.add(axpy, localRow, scores[localCol],
+                                arguments.matrixV + static_cast<size_t>(blockCols[localCol]) * arguments.ldv);
+                }
+            }
+        }
+    }
+
+    // The sparse scores of the row panel are one block, they are computed first to raise the max of each row once
+    const UIN startIndexOfSparseData = tiling.sparseValueOffsets[rowPanelId];
+    const UIN endIndexOfSparseData = tiling.sparseValueOffsets[rowPanelId + 1];
+    sparseScores.resize(endIndexOfSparseData - startIndexOfSparseData);
+    computeSparseValues(dotFunctions, arguments.matrixA, arguments.lda, arguments.matrixB, arguments.ldb, arguments.K,
+                        tiling, rowPanelId, rows,
+                        [&](const UIN idx, const float value){
+                            sparseScores[idx - startIndexOfSparseData] = getScore(value, tiling.sparseValues[idx]);
+                        });
+    float sparseMax[ROW_PANEL_SIZE];
+    std::fill(sparseMax, sparseMax + ROW_PANEL_SIZE, -std::numeric_limits<float>::infinity());
+    for (UIN idx = startIndexOfSparseData; idx < endIndexOfSparseData; ++idx){
+        const UIN localRow = tiling.sparseRelativeRows[idx];
+        sparseMax[localRow] = std::max(sparseMax[localRow], sparseScores[idx - startIndexOfSparseData]);
+    }
+    for (UIN localRow = 0; localRow < numRows; ++localRow){
+        softmax.raiseMax(localRow, sparseMax[localRow]);
+    }
+    for (UIN idx = startIndexOfSparseData; idx < endIndexOfSparseData; ++idx){
+        softmax.add(axpy, tiling.sparseRelativeRows[idx], sparseScores[idx - startIndexOfSparseData],
+                    arguments.matrixV + static_cast<size_t>(tiling.sparseColIndices[idx]) * arguments.ldv);
+    }
+
+    // Normalize and write the rows of O
+    for (UIN localRow = 0; localRow < numRows; ++localRow){
+        const float* outputRow = softmax.output + static_cast<size_t>(localRow) * arguments.D;
+        float* rowO = arguments.matrixO + static_cast<size_t>(rows[localRow]) * arguments.ldo;
+        const float inverseSum = softmax.rowSum[localRow] > 0.0f ? 1.0f / softmax.rowSum[localRow] : 0.0f;
+        for (UIN d = 0; d < arguments.D; ++d){
+            rowO[d] = outputRow[d] * inverseSum;
+        }
+    }
+}
+
+// Cache blocking of the GEMM: a KC x NC panel of B is shared by all threads, each thread packs an MC x KC block
+// of A that stays in L2 and runs the micro-kernel over MR x NR tiles of C. MC and NC are rounded down to MR and NR.
+constexpr UIN gemmBlockSizeM = 96;
+constexpr UIN gemmBlockSizeK = 256;
+constexpr UIN gemmBlockSizeN = 2048;
+
+// The micro-kernel computes one MR x NR tile of C from a packed panel of A (packedA[k * MR + localRow])
+// and a packed panel of B (packedB[k * NR + localCol]). `tile` is written column-major (tile[localCol * MR + localRow]).
+template<typename T>
+struct GemmKernel{
+    void (*microKernel)(UIN kc, const T* packedA, const T* packedB, T* tile);
+    UIN mr;
+    UIN nr;
+};
+
+template<typename T, UIN MR, UIN NR>
+void gemmMicroKernel_generic(const UIN kc, const T* packedA, const T* packedB, T* tile){
+    T sum[NR][MR] = {};
+    for (UIN k = 0; k < kc; ++k){
+        const T* a = packedA + static_cast<size_t>(k) * MR;
+        const T* b = packedB + static_cast<size_t>(k) * NR;
+        for (UIN localCol = 0; localCol < NR; ++localCol){
+            for (UIN localRow = 0; localRow < MR; ++localRow){
+                sum[localCol][localRow] += a[localRow] * b[localCol];
+            }
+        }
+    }
+    for (UIN localCol = 0; localCol < NR; ++localCol){
+        std::copy(sum[localCol], sum[localCol] + MR, tile + localCol * MR);
+    }
+}
+
+#ifdef BSMR_CPU_X86
+// 16 x 6 tile, 12 accumulators of the 16 ymm registers
+__attribute__((target("avx2,fma")))
+void gemmMicroKernel_avx2(const UIN kc, const float* packedA, const float* packedB, float* tile){
+    constexpr UIN MR = 16, NR = 6;
+    __m256 sum[NR][2];
+    for (UIN localCol = 0; localCol < NR; ++localCol){
+        sum[localCol][0] = _mm256_setzero_ps();
+        sum[localCol][1] = _mm256_setzero_ps();
+    }
+    for (UIN k = 0; k < kc; ++k){
+        const __m256 a0 = _mm256_loadu_ps(packedA + static_cast<size_t>(k) * MR);
+        const __m256 a1 = _mm256_loadu_ps(packedA + static_cast<size_t>(k) * MR + 8);
+        const float* b = packedB + static_cast<size_t>(k) * NR;
+        for (UIN localCol = 0; localCol < NR; ++localCol){
+            const __m256 bValue = _mm256_broadcast_ss(b + localCol);
+            sum[localCol][0] = _mm256_fmadd_ps(a0, bValue, sum[localCol][0]);
+            sum[localCol][1] = _mm256_fmadd_ps(a1, bValue, sum[localCol][1]);
+        }
+    }
+    for (UIN localCol = 0; localCol < NR; ++localCol){
+        _mm256_storeu_ps(tile + localCol * MR, sum[localCol][0]);
+        _mm256_storeu_ps(tile + localCol * MR + 8, sum[localCol][1]);
+    }
+}
+
+// 32 x 12 tile, 24 accumulators of the 32 zmm registers
+__attribute__((target("avx512f")))
+void gemmMicroKernel_avx512(const UIN kc, const float* packedA, const float* packedB, float* tile){
+    constexpr UIN MR = 32, NR = 12;
+    __m512 sum[NR][2];
+    for (UIN localCol = 0; localCol < NR; ++localCol){
+        sum[localCol][0] = _mm512_setzero_ps();
+        sum[localCol][1] = _mm512_setzero_ps();
+    }
+    for (UIN k = 0; k < kc; ++k){
+        const __m512 a0 = _mm512_loadu_ps(packedA + static_cast<size_t>(k) * MR);
+        const __m512 a1 = _mm512_loadu_ps(packedA + static_cast<size_t>(k) * MR + 16);
+        const float* b = packedB + static_cast<size_t>(k) * NR;
+        for (UIN localCol = 0; localCol < NR; ++localCol){
+            const __m512 bValue = _mm512_set1_ps(b[localCol]);
+            sum[localCol][0] = _mm512_fmadd_ps(a0, bValue, sum[localCol][0]);
+            sum[localCol][1] = _mm512_fmadd_ps(a1, bValue, sum[localCol][1]);
+        }
+    }
+    for (UIN localCol = 0; localCol < NR; ++localCol){
+        _mm512_storeu_ps(tile + localCol * MR, sum[localCol][0]);
+        _mm512_storeu_ps(tile + localCol * MR + 16, sum[localCol][1]);
+    }
+}
+#endif // BSMR_CPU_X86
+
+// int and double use the generic micro-kernel, it is vectorized by the compiler
+template<typename T>
+GemmKernel<T> getGemmKernel(){
+    return {gemmMicroKernel_generic<T, 8, 4>, 8, 4};
+}
+
+template<>
+GemmKernel<float> getGemmKernel<float>(){
+    switch (cpu::getIsa()){
+#ifdef BSMR_CPU_X86
+        case cpu::Isa::avx512: return {gemmMicroKernel_avx512, 32, 12};
+        case cpu::Isa::avx2: return {gemmMicroKernel_avx2, 16, 6};
+#endif
+        default: return {gemmMicroKernel_generic<float, 8, 4>, 8, 4};
+    }
+}
+
+// Pack a panel of `width` rows of A (or columns of B) and `kc` values along K, k-major.
+// Element (localIndex, k) of the panel is source[localIndex * panelStride + k * kStride], the missing rows are 0.
+template<typename T>
+void packGemmPanel(const T* source,
+                   const size_t panelStride,
+                   const size_t kStride,
+                   const UIN numValid,
+                   const UIN width,
+                   const UIN kc,
+                   T* packed){
+    // Read along the contiguous dimension of the source
+    if (kStride <= panelStride){
+        for (UIN localIndex = 0; localIndex < numValid; ++localIndex){
+            const T* sourceOfIndex = source + localIndex * panelStride;
+            for (UIN k = 0; k < kc; ++k){
+                packed[static_cast<size_t>(k) * width + localIndex] = sourceOfIndex[k * kStride];
+            }
+        }
+    }
+    else{
+        for (UIN k = 0; k < kc; ++k){
+            const T* sourceOfK = source + k * kStride;
+            for (UIN localIndex = 0; localIndex < numValid; ++localIndex){
+                packed[static_cast<size_t>(k) * width + localIndex] = sourceOfK[localIndex * panelStride];
+            }
+        }
+    }
+    if (numValid < width){
+        for (UIN k = 0; k < kc; ++k){
+            std::fill(packed + static_cast<size_t>(k) * width + numValid, packed + static_cast<size_t>(k + 1) * width,
+                      T(0));
+        }
+    }
+}
+} // namespace
+
+cpu::Isa cpu::getIsa(){
+    static const Isa isa = detectIsa();
+    return isa;
+}
+
+const char* cpu::getIsaName(const Isa isa){
+    switch (isa){
+        case Isa::avx512: return "avx512";
+        case Isa::avx2: return "avx2";
+        default: return "scalar";
+    }
+}
+
+template<typename T>
+void cpu::sddmm(const T* matrixA,
+                const size_t lda,
+                const T* matrixB,
+                const size_t ldb,
+                const UIN K,
+                const UIN numRows,
+                const UIN* rowOffsets,
+                const UIN* colIndices,
+                float* values,
+                float* loadImbalance){
+    const DotFunctions<T> dotFunctions = getDotFunctions<T>(K);
+
+    // Chunks of the same number of nonzeros, a row longer than half a chunk is split between chunks
+    const UIN nnz = rowOffsets[numRows] - rowOffsets[0];
+    const UIN numChunks = scheduler::defaultNumChunks();
+    const std::vector<scheduler::WorkChunk> chunks =
+        scheduler::partition(rowOffsets, numRows, numChunks, nnz / numChunks / 2);
+    const float imbalance = scheduler::run(chunks, [&](const scheduler::WorkChunk& chunk, int){
+        scheduler::forEachRow(chunk, rowOffsets, [&](const UIN row, const size_t indexBegin, const size_t indexEnd){
+            sddmmRow(dotFunctions,
+                     matrixA + static_cast<size_t>(row) * lda,
+                     matrixB,
+                     ldb,
+                     K,
+                     colIndices + indexBegin,
+                     indexEnd - indexBegin,
+                     values + indexBegin);
+        });
+    });
+    if (loadImbalance){
+        *loadImbalance = imbalance;
+    }
+}
+
+void cpu::sddmm_coo(const float* matrixA,
+                    const size_t lda,
+                    const float* matrixB,
+                    const size_t ldb,
+                    const UIN K,
+                    const UIN nnz,
+                    const UIN* rowIndices,
+                    const UIN* colIndices,
+                    float* values){
+    const DotFunctions<float> dotFunctions = getDotFunctions<float>(K);
+
+#pragma omp parallel for schedule(static)
+    for (UIN idx = 0; idx < nnz; ++idx){
+        values[idx] = dotFunctions.dot(matrixA + static_cast<size_t>(rowIndices[idx]) * lda,
+                                       matrixB + static_cast<size_t>(colIndices[idx]) * ldb,
+                                       K);
+    }
+}
+
+template<typename T>
+void cpu::sddmm(const T* matrixA,
+                const size_t lda,
+                const T* matrixB,
+                const size_t ldb,
+                const UIN N,
+                const UIN K,
+                const RPHM& rphm,
+                float* matrixP,
+                float* loadImbalance){
+    const RPHM::HostArrays& tiling = rphm.hostArrays();
+    const UIN numRowPanels = rphm.numRowPanels();
+    const DotFunctions<T> dotFunctions = getDotFunctions<T>(K);
+    const DenseBlockFunction denseBlock = getDenseBlockFunction(K);
+    const ConvertFunction<T> convert = getConvertFunction<T>();
+
+    std::vector<uint64_t> costOffsets;
+    const std::vector<scheduler::WorkChunk> chunks = partitionRowPanels(tiling, numRowPanels, costOffsets);
+
+    std::vector<std::vector<float>> packedAs(omp_get_max_threads(),
+                                             std::vector<float>(static_cast<size_t>(K) * ROW_PANEL_SIZE));
+    std::vector<std::vector<float>> convertedBs(omp_get_max_threads(),
+                                                std::vector<float>(std::is_same<T, float>::value
+                                                                       ? 0 : static_cast<size_t>(K) * BLOCK_COL_SIZE));
+    std::vector<std::vector<float>> blocks(omp_get_max_threads(), std::vector<float>(BLOCK_SIZE));
+    const float imbalance = scheduler::run(chunks, [&](const scheduler::WorkChunk& chunk, const int threadId){
+        for (UIN rowPanelId = chunk.rowBegin; rowPanelId < chunk.rowEnd; ++rowPanelId){
+            sddmmRowPanel(dotFunctions, denseBlock, convert, matrixA, lda, matrixB, ldb, N, K, tiling, rowPanelId,
+                          packedAs[threadId].data(), convertedBs[threadId].data(), blocks[threadId].data(), matrixP);
+        }
+    });
+    if (loadImbalance){
+        *loadImbalance = imbalance;
+    }
+}
+
+void cpu::sddmm_int8(const QuantizedOperands& operands,
+                     const UIN K,
+                     const UIN numRows,
+                     const UIN* rowOffsets,
+                     const UIN* colIndices,
+                     float* values,
+                     float* loadImbalance){
+    const DotFunctions<int8_t> dotFunctions = getDotFunctions<int8_t>(K);
+
+    const UIN nnz = rowOffsets[numRows] - rowOffsets[0];
+    const UIN numChunks = scheduler::defaultNumChunks();
+    const std::vector<scheduler::WorkChunk> chunks =
+        scheduler::partition(rowOffsets, numRows, numChunks, nnz / numChunks / 2);
+    const float imbalance = scheduler::run(chunks, [&](const scheduler::WorkChunk& chunk, int){
+        scheduler::forEachRow(chunk, rowOffsets, [&](const UIN row, const size_t indexBegin, const size_t indexEnd){
+            sddmmRow(dotFunctions,
+                     operands.matrixA + static_cast<size_t>(row) * operands.lda,
+                     operands.matrixB,
+                     operands.ldb,
+                     K,
+                     colIndices + indexBegin,
+                     indexEnd - indexBegin,
+                     values + indexBegin);
+            const float scaleA = operands.scalesA[row];
+            for (size_t idx = indexBegin; idx < indexEnd; ++idx){
+                values[idx] *= scaleA * operands.scalesB[colIndices[idx]];
+            }
+        });
+    });
+    if (loadImbalance){
+        *loadImbalance = imbalance;
+    }
+}
+
+void cpu::sddmm_int8(const QuantizedOperands& operands,
+                     const UIN N,
+                     const UIN K,
+                     const RPHM& rphm,
+                     float* matrixP,
+                     float* loadImbalance){
+    const RPHM::HostArrays& tiling = rphm.hostArrays();
+    const UIN numRowPanels = rphm.numRowPanels();
+    const DotFunctions<int8_t> dotFunctions = getDotFunctions<int8_t>(K);
+    const Int8DenseBlockFunction denseBlock = getInt8DenseBlockFunction();
+
+    std::vector<uint64_t> costOffsets;
+    const std::vector<scheduler::WorkChunk> chunks = partitionRowPanels(tiling, numRowPanels, costOffsets);
+
+    const int numThreads = omp_get_max_threads();
+    const size_t packedSize = static_cast<size_t>((K + 3) / 4) * ROW_PANEL_SIZE * 4;
+    std::vector<std::vector<int8_t>> packedAs(numThreads, std::vector<int8_t>(packedSize));
+    std::vector<std::vector<int32_t>> blocks(numThreads, std::vector<int32_t>(BLOCK_SIZE));
+    const float imbalance = scheduler::run(chunks, [&](const scheduler::WorkChunk& chunk, const int threadId){
+        for (UIN rowPanelId = chunk.rowBegin; rowPanelId < chunk.rowEnd; ++rowPanelId){
+            sddmmRowPanelInt8(dotFunctions, denseBlock, operands, N, K, tiling, rowPanelId,
+                              packedAs[threadId].data(), blocks[threadId].data(), matrixP);
+        }
+    });
+    if (loadImbalance){
+        *loadImbalance = imbalance;
+    }
+}
+
+void cpu::sddmm_batch(const UIN numHeads,
+                      const float* matrixA,
+                      const size_t lda,
+                      const size_t headStrideA,
+                      const float* matrixB,
+                      const size_t ldb,
+                      const size_t headStrideB,
+                      const UIN N,
+                      const UIN K,
+                      const RPHM& rphm,
+                      float* matrixP,
+                      const size_t headStrideP,
+                      float* headTimes,
+                      float* loadImbalance){
+    const RPHM::HostArrays& tiling = rphm.hostArrays();
+    const UIN numRowPanels = rphm.numRowPanels();
+    const DotFunctions<float> dotFunctions = getDotFunctions<float>(K);
+    const DenseBlockFunction denseBlock = getDenseBlockFunction(K);
+
+    std::vector<uint64_t> costOffsets;
+    const std::vector<scheduler::WorkChunk> chunks = partitionRowPanels(tiling, numRowPanels, costOffsets);
+
+    const int numThreads = omp_get_max_threads();
+    std::vector<std::vector<float>> packedAs(numThreads, std::vector<float>(static_cast<size_t>(K) * ROW_PANEL_SIZE));
+    std::vector<std::vector<float>> blocks(numThreads, std::vector<float>(BLOCK_SIZE));
+    std::vector<RowPanelPlan> plans(numThreads);
+    std::vector<std::vector<double>> threadHeadTimes(numThreads, std::vector<double>(numHeads, 0.0));
+
+    const float imbalance = scheduler::run(chunks, [&](const scheduler::WorkChunk& chunk, const int threadId){
+        RowPanelPlan& plan = plans[threadId];
+        for (UIN rowPanelId = chunk.rowBegin; rowPanelId < chunk.rowEnd; ++rowPanelId){
+            decodeRowPanelPlan(tiling, rowPanelId, lda, ldb, N, plan);
+            for (UIN headId = 0; headId < numHeads; ++headId){
+                const auto startTime = std::chrono::steady_clock::now();
+                sddmmRowPanelOfHead(dotFunctions, denseBlock, plan,
+                                    matrixA + headId * headStrideA, lda,
+                                    matrixB + headId * headStrideB,
+                                    K,
+                                    packedAs[threadId].data(), blocks[threadId].data(),
+                                    matrixP + headId * headStrideP);
+                threadHeadTimes[threadId][headId] +=
+                    std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+            }
+        }
+    });
+
+    if (headTimes){
+        for (UIN headId = 0; headId < numHeads; ++headId){
+            double headTime = 0.0;
+            for (int threadId = 0; threadId < numThreads; ++threadId){
+                headTime += threadHeadTimes[threadId][headId];
+            }
+            headTimes[headId] = static_cast<float>(headTime);
+        }
+    }
+    if (loadImbalance){
+        *loadImbalance = imbalance;
+    }
+}
+
+void cpu::attention(const AttentionArguments& arguments, const RPHM& rphm, float* loadImbalance){
+    const RPHM::HostArrays& tiling = rphm.hostArrays();
+    const UIN numRowPanels = rphm.numRowPanels();
+    const DotFunctions<float> dotFunctions = getDotFunctions<float>(arguments.K);
+    const DenseBlockFunction denseBlock = getDenseBlockFunction(arguments.K);
+    const AxpyFunction axpy = getAxpyFunction();
+
+    std::vector<uint64_t> costOffsets;
+    const std::vector<scheduler::WorkChunk> chunks = partitionRowPanels(tiling, numRowPanels, costOffsets);
+
+    const int numThreads = omp_get_max_threads();
+    std::vector<std::vector<float>> packedAs(numThreads,
+                                             std::vector<float>(static_cast<size_t>(arguments.K) * ROW_PANEL_SIZE));
+    std::vector<std::vector<float>> blocks(numThreads, std::vector<float>(BLOCK_SIZE));
+    std::vector<std::vector<float>> sparseScores(numThreads);
+    std::vector<std::vector<float>> outputs(numThreads,
+                                            std::vector<float>(static_cast<size_t>(ROW_PANEL_SIZE) * arguments.D));
+    std::vector<OnlineSoftmax> softmaxes(numThreads);
+    for (int threadId = 0; threadId < numThreads; ++threadId){
+        softmaxes[threadId].output = outputs[threadId].data();
+        softmaxes[threadId].D = arguments.D;
+    }
+
+    const float imbalance = scheduler::run(chunks, [&](const scheduler::WorkChunk& chunk, const int threadId){
+        for (UIN rowPanelId = chunk.rowBegin; rowPanelId < chunk.rowEnd; ++rowPanelId){
+            attentionRowPanel(dotFunctions, denseBlock, axpy, arguments, tiling, rowPanelId,
+                              packedAs[threadId].data(), blocks[threadId].data(), sparseScores[threadId],
+                              softmaxes[threadId]);
+        }
+    });
+    if (loadImbalance){
+        *loadImbalance = imbalance;
+    }
+}
+
+template<typename T>
+void cpu::gemm(const UIN M,
+               const UIN N,
+               const UIN K,
+               const T* matrixA,
+               const size_t rowStrideA,
+               const size_t colStrideA,
+               const T* matrixB,
+               const size_t rowStrideB,
+               const size_t colStrideB,
+               T* matrixC,
+               const size_t rowStrideC,
+               const size_t colStrideC){
+    if (K == 0){
+        for (UIN row = 0; row < M; ++row){
+            for (UIN col = 0; col < N; ++col){
+                matrixC[row * rowStrideC + col * colStrideC] = T(0);
+            }
+        }
+        return;
+    }
+
+    const GemmKernel<T> kernel = getGemmKernel<T>();
+    const UIN mr = kernel.mr, nr = kernel.nr;
+    const UIN mc = gemmBlockSizeM / mr * mr;
+    const UIN nc = gemmBlockSizeN / nr * nr;
+    const UIN kc = gemmBlockSizeK;
+    const UIN numRowBlocks = (M + mc - 1) / mc;
+
+    std::vector<T> packedB(static_cast<size_t>(nc) * kc);
+
+#pragma omp parallel
+    {
+        std::vector<T> packedA(static_cast<size_t>(mc) * kc);
+        std::vector<T> tile(static_cast<size_t>(mr) * nr);
+
+        for (UIN colBegin = 0; colBegin < N; colBegin += nc){
+            const UIN numCols = std::min(nc, N - colBegin);
+            const UIN numColPanels = (numCols + nr - 1) / nr;
+            for (UIN kBegin = 0; kBegin < K; kBegin += kc){
+                const UIN kcOfBlock = std::min(kc, K - kBegin);
+
+                // The panel of B is shared, the implicit barriers keep it stable while the row blocks use it
+#pragma omp for schedule(static)
+                for (UIN colPanelId = 0; colPanelId < numColPanels; ++colPanelId){
+                    const UIN localCol = colPanelId * nr;
+                    packGemmPanel(matrixB + kBegin * rowStrideB + (colBegin + localCol) * colStrideB,
+                                  colStrideB,
+                                  rowStrideB,
+                                  std::min(nr, numCols - localCol),
+                                  nr,
+                                  kcOfBlock,
+                                  packedB.data() + static_cast<size_t>(colPanelId) * nr * kcOfBlock);
+                }
+
+#pragma omp for schedule(dynamic, 1)
+                for (UIN rowBlockId = 0; rowBlockId < numRowBlocks; ++rowBlockId){
+                    const UIN rowBegin = rowBlockId * mc;
+                    const UIN numRows = std::min(mc, M - rowBegin);
+                    const UIN numRowPanels = (numRows + mr - 1) / mr;
+                    for (UIN rowPanelId = 0; rowPanelId < numRowPanels; ++rowPanelId){
+                        const UIN localRow = rowPanelId * mr;
+                        packGemmPanel(matrixA + (rowBegin + localRow) * rowStrideA + kBegin * colStrideA,
+                                      rowStrideA,
+                                      colStrideA,
+                                      std::min(mr, numRows - localRow),
+                                      mr,
+                                      kcOfBlock,
+                                      packedA.data() + static_cast<size_t>(rowPanelId) * mr * kcOfBlock);
+                    }
+
+                    for (UIN colPanelId = 0; colPanelId < numColPanels; ++colPanelId){
+                        const UIN col = colBegin + colPanelId * nr;
+                        const UIN numTileCols = std::min(nr, N - col);
+                        for (UIN rowPanelId = 0; rowPanelId < numRowPanels; ++rowPanelId){
+                            const UIN row = rowBegin + rowPanelId * mr;
+                            const UIN numTileRows = std::min(mr, M - row);
+                            kernel.microKernel(kcOfBlock,
+                                               packedA.data() + static_cast<size_t>(rowPanelId) * mr * kcOfBlock,
+                                               packedB.data() + static_cast<size_t>(colPanelId) * nr * kcOfBlock,
+                                               tile.data());
+
+                            // The first block of K overwrites C, the others accumulate
+                            for (UIN localCol = 0; localCol < numTileCols; ++localCol){
+                                T* colC = matrixC + (col + localCol) * colStrideC + row * rowStrideC;
+                                const T* tileCol = tile.data() + localCol * mr;
+                                for (UIN localRow = 0; localRow < numTileRows; ++localRow){
+                                    T& valueC = colC[localRow * rowStrideC];
+                                    valueC = kBegin == 0 ? tileCol[localRow] : valueC + tileCol[localRow];
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+template void cpu::gemm<int>(UIN M, UIN N, UIN K,
+                             const int* matrixA, size_t rowStrideA, size_t colStrideA,
+                             const int* matrixB, size_t rowStrideB, size_t colStrideB,
+                             int* matrixC, size_t rowStrideC, size_t colStrideC);
+template void cpu::gemm<float>(UIN M, UIN N, UIN K,
+                               const float* matrixA, size_t rowStrideA, size_t colStrideA,
+                               const float* matrixB, size_t rowStrideB, size_t colStrideB,
+                               float* matrixC, size_t rowStrideC, size_t colStrideC);
+template void cpu::gemm<double>(UIN M, UIN N, UIN K,
+                                const double* matrixA, size_t rowStrideA, size_t colStrideA,
+                                const double* matrixB, size_t rowStrideB, size_t colStrideB,
+                                double* matrixC, size_t rowStrideC, size_t colStrideC);
+
+template void cpu::sddmm<float>(const float* matrixA, size_t lda, const float* matrixB, size_t ldb,
+                                UIN K, UIN numRows, const UIN* rowOffsets, const UIN* colIndices,
+                                float* values, float* loadImbalance);
+template void cpu::sddmm<__half>(const __half* matrixA, size_t lda, const __half* matrixB, size_t ldb,
+                                 UIN K, UIN numRows, const UIN* rowOffsets, const UIN* colIndices,
+                                 float* values, float* loadImbalance);
+template void cpu::sddmm<__nv_bfloat16>(const __nv_bfloat16* matrixA, size_t lda,
+                                        const __nv_bfloat16* matrixB, size_t ldb,
+                                        UIN K, UIN numRows, const UIN* rowOffsets, const UIN* colIndices,
+                                        float* values, float* loadImbalance);
+
+template void cpu::sddmm<float>(const float* matrixA, size_t lda, const float* matrixB, size_t ldb,
+                                UIN N, UIN K, const RPHM& rphm, float* matrixP, float* loadImbalance);
+template void cpu::sddmm<__half>(const __half* matrixA, size_t lda, const __half* matrixB, size_t ldb,
+                                 UIN N, UIN K, const RPHM& rphm, float* matrixP, float* loadImbalance);
+template void cpu::sddmm<__nv_bfloat16>(const __nv_bfloat16* matrixA, size_t lda,
+                                        const __nv_bfloat16* matrixB, size_t ldb,
+                                        UIN N, UIN K, const RPHM& rphm, float* matrixP, float* loadImbalance);
@@ -1,6 +1,70 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
 #include <omp.h>
 
+#include "BSMR.hpp"
+#include "cpuKernel.hpp"
 #include "host.hpp"
+#include "Logger.hpp"
+#include "WorkScheduler.hpp"
+
+namespace {
+/**
+ * Strides of the matrix in a multiplication: first the stride between rows of a left matrix (columns of a right
+ * matrix), then the stride along K. The scalar path reads the values through raw pointers with them.
+ **/
+template<typename T>
+std::pair<size_t, size_t> getMultiplicationStrides(const MatrixView<const T> &matrix,
+                                                   const MatrixMultiplicationOrder multiplicationOrder) {
+    const bool isKContiguous =
+        (multiplicationOrder == MatrixMultiplicationOrder::left_multiplication)
+            == (matrix.storageOrder == MatrixStorageOrder::row_major);
+    const size_t leadingDimension = matrix.leadingDimension;
+    return isKContiguous ? std::make_pair(leadingDimension, static_cast<size_t>(1))
+                         : std::make_pair(static_cast<size_t>(1), leadingDimension);
+}
+
+// Strides of the matrix between rows and between columns, for any storage order
+template<typename T>
+std::pair<size_t, size_t> getElementStrides(const MatrixView<const T> &matrix) {
+    const size_t leadingDimension = matrix.leadingDimension;
+    return matrix.storageOrder == MatrixStorageOrder::row_major
+               ? std::make_pair(leadingDimension, static_cast<size_t>(1))
+               : std::make_pair(static_cast<size_t>(1), leadingDimension);
+}
+
+// Row-major A and col-major B are the layouts of the SIMD CPU kernels
+template<typename T>
+bool isSimdSddmmLayout(const MatrixView<const T> &matrixA, const MatrixView<const T> &matrixB) {
+    return matrixA.storageOrder == MatrixStorageOrder::row_major
+        && matrixB.storageOrder == MatrixStorageOrder::col_major;
+}
+
+// The structure of `matrix` with other values
+template<typename U, typename T>
+sparseMatrix::CsrView<U> withValues(const sparseMatrix::CsrView<T> &matrix, U *values) {
+    return {matrix.row, matrix.col, matrix.nnz, matrix.rowOffsets, matrix.colIndices, values};
+}
+
+template<typename T>
+float dotForMultiplication(const T *rowA,
+                           const size_t kStrideA,
+                           const T *colB,
+                           const size_t kStrideB,
+                           const UIN K) {
+    float val = 0.0f;
+    for (UIN kIter = 0; kIter < K; ++kIter) {
+        val += rowA[kIter * kStrideA] * colB[kIter * kStrideB];
+    }
+    return val;
+}
+} // namespace
 
 template<typename T>
 void dmm_cpu(const Matrix<T> &matrixA,
@@ -12,23 +76,13 @@ void dmm_cpu(const Matrix<T> &matrixA,
         std::cerr << "The storage of the three matrices does not match" << std::endl;
         return;
     }
-    const int K = matrixA.col();
-#pragma omp parallel for
-    for (int mtxCIdx = 0; mtxCIdx < matrixC.size(); ++mtxCIdx) {
-        const int row = matrixC.rowOfValueIndex(mtxCIdx);
-        const int col = matrixC.colOfValueIndex(mtxCIdx);
-        float val = 0.0f;
-        for (int kIter = 0; kIter < K; ++kIter) {
-            const auto valA = matrixA.getOneValueForMultiplication(
-                MatrixMultiplicationOrder::left_multiplication,
-                row, col, kIter);
-            const auto valB = matrixB.getOneValueForMultiplication(
-                MatrixMultiplicationOrder::right_multiplication,
-                row, col, kIter);
-            val += valA * valB;
-        }
-        matrixC[mtxCIdx] = val;
-    }
+    const auto stridesA = getElementStrides(matrixA.view());
+    const auto stridesB = getElementStrides(matrixB.view());
+    const auto stridesC = getElementStrides(matrixC.view());
+    cpu::gemm(matrixC.row(), matrixC.col(), matrixA.col(),
+              matrixA.data(), stridesA.first, stridesA.second,
+              matrixB.data(), stridesB.first, stridesB.second,
+              matrixC.data(), stridesC.first, stridesC.second);
 }
 
 template void dmm_cpu<int>(const Matrix<int> &matrixA,
@@ -53,28 +107,64 @@ void sddmm_cpu(
         std::cerr << "The storage of the three matrices does not match" << std::endl;
         return;
     }
-    const int K = matrixA.col();
-#pragma omp parallel for
-    for (int row = 0; row < matrixS.row(); ++row) {
-        for (int matrixSIdx = matrixS.rowOffsets()[row]; matrixSIdx < matrixS.rowOffsets()[row + 1]; ++matrixSIdx) {
-            const size_t col = matrixS.colIndices()[matrixSIdx];
-
-            float val = 0.0f;
-            for (int kIter = 0; kIter < K; ++kIter) {
-                const auto valA = matrixA.getOneValueForMultiplication(
-                    MatrixMultiplicationOrder::left_multiplication,
-                    row, col, kIter);
-                const auto valB = matrixB.getOneValueForMultiplication(
-                    MatrixMultiplicationOrder::right_multiplication,
-                    row, col, kIter);
-                val += valA * valB;
-            }
+    matrixP.setValues().resize(matrixS.nnz());
+    sddmm_cpu(matrixA.view(), matrixB.view(), matrixS.view(matrixP.setValues().data()));
+}
 
-            matrixP.setValues()[matrixSIdx] = val;
+template<typename T>
+void sddmm_cpu(
+    const MatrixView<const T> &matrixA,
+    const MatrixView<const T> &matrixB,
+    const sparseMatrix::CsrView<T> &matrixP) {
+    if (matrixA.col != matrixB.row ||
+        matrixA.row != matrixP.row ||
+        matrixB.col != matrixP.col) {
+        std::cerr << "The storage of the three matrices does not match" << std::endl;
+        return;
+    }
+    const UIN K = matrixA.col;
+    if constexpr (std::is_same<T, float>::value) {
+        if (isSimdSddmmLayout(matrixA, matrixB)) {
+            cpu::sddmm(matrixA.data, matrixA.leadingDimension,
+                       matrixB.data, matrixB.leadingDimension,
+                       K,
+                       matrixP.row,
+                       matrixP.rowOffsets,
+                       matrixP.colIndices,
+                       matrixP.values);
+            return;
         }
     }
+
+    const auto stridesA = getMultiplicationStrides(matrixA, MatrixMultiplicationOrder::left_multiplication);
+    const auto stridesB = getMultiplicationStrides(matrixB, MatrixMultiplicationOrder::right_multiplication);
+    const UIN *rowOffsets = matrixP.rowOffsets;
+    const UIN numChunks = scheduler::defaultNumChunks();
+    const std::vector<scheduler::WorkChunk> chunks =
+        scheduler::partition(rowOffsets, matrixP.row, numChunks, matrixP.nnz / numChunks / 2);
+    scheduler::run(chunks, [&](const scheduler::WorkChunk &chunk, int) {
+        scheduler::forEachRow(chunk, rowOffsets, [&](const UIN row, const size_t indexBegin, const size_t indexEnd) {
+            const T *rowA = matrixA.data + row * stridesA.first;
+            for (size_t matrixPIdx = indexBegin; matrixPIdx < indexEnd; ++matrixPIdx) {
+                const T *colB = matrixB.data + matrixP.colIndices[matrixPIdx] * stridesB.first;
+                matrixP.values[matrixPIdx] = dotForMultiplication(rowA, stridesA.second, colB, stridesB.second, K);
+            }
+        });
+    });
 }
 
+template void sddmm_cpu<int>(const MatrixView<const int> &matrixA,
+                             const MatrixView<const int> &matrixB,
+                             const sparseMatrix::CsrView<int> &matrixP);
+
+template void sddmm_cpu<float>(const MatrixView<const float> &matrixA,
+                               const MatrixView<const float> &matrixB,
+                               const sparseMatrix::CsrView<float> &matrixP);
+
+template void sddmm_cpu<double>(const MatrixView<const double> &matrixA,
+                                const MatrixView<const double> &matrixB,
+                                const sparseMatrix::CsrView<double> &matrixP);
+
 template void sddmm_cpu<int>(const Matrix<int> &matrixA,
                              const Matrix<int> &matrixB,
                              const sparseMatrix::CSR<int> &matrixS,
@@ -102,25 +192,30 @@ void sddmm_cpu(
         std::cerr << "The storage of the three matrices does not match" << std::endl;
         return;
     }
-    const int K = matrixA.col();
-#pragma omp parallel for
-    for (int matrixSIdx = 0; matrixSIdx < matrixS.nnz(); ++matrixSIdx) {
-        const size_t row = matrixS.rowIndices()[matrixSIdx];
-        const size_t col = matrixS.colIndices()[matrixSIdx];
-
-        float val = 0.0f;
-        for (int kIter = 0; kIter < K; ++kIter) {
-            const auto valA = matrixA.getOneValueForMultiplication(
-                MatrixMultiplicationOrder::left_multiplication,
-                row, col, kIter);
-            const auto valB = matrixB.getOneValueForMultiplication(
-                MatrixMultiplicationOrder::right_multiplication,
-                row, col, kIter);
-            val += valA * valB;
+    const UIN K = matrixA.col();
+    matrixP.setValues().resize(matrixS.nnz());
+    if constexpr (std::is_same<T, float>::value) {
+        if (isSimdSddmmLayout(matrixA.view(), matrixB.view())) {
+            cpu::sddmm_coo(matrixA.data(), matrixA.leadingDimension(),
+                           matrixB.data(), matrixB.leadingDimension(),
+                           K,
+                           matrixS.nnz(),
+                           matrixS.rowIndices().data(),
+                           matrixS.colIndices().data(),
+                           matrixP.setValues().data());
+            return;
         }
+    }
+
+    const auto stridesA = getMultiplicationStrides(matrixA.view(), MatrixMultiplicationOrder::left_multiplication);
+    const auto stridesB = getMultiplicationStrides(matrixB.view(), MatrixMultiplicationOrder::right_multiplication);
+#pragma omp parallel for
+    for (UIN matrixSIdx = 0; matrixSIdx < matrixS.nnz(); ++matrixSIdx) {
+        const T *rowA = matrixA.data() + matrixS.rowIndices()[matrixSIdx] * stridesA.first;
+        const T *colB = matrixB.data() + matrixS.colIndices()[matrixSIdx] * stridesB.first;
 
 //        val *= matrixS.values()[matrixSIdx];
-        matrixP.setValues()[matrixSIdx] = val;
+        matrixP.setValues()[matrixSIdx] = dotForMultiplication(rowA, stridesA.second, colB, stridesB.second, K);
     }
 }
 
@@ -137,4 +232,310 @@ template void sddmm_cpu<float>(const Matrix<float> &matrixA,
 template void sddmm_cpu<double>(const Matrix<double> &matrixA,
                                 const Matrix<double> &matrixB,
                                 const sparseMatrix::COO<double> &matrixS,
-                                sparseMatrix::COO<double> &matrixP);
\ No newline at end of file
+                                sparseMatrix::COO<double> &matrixP);
+
+template<typename T>
+void sddmm_cpu(const Matrix<T> &matrixA,
+               const Matrix<T> &matrixB,
+               const RPHM &rphm,
+               sparseMatrix::CSR<float> &matrixP,
+               Logger &logger) {
+    matrixP.setValues().resize(matrixP.nnz());
+    sddmm_cpu(matrixA.view(), matrixB.view(), rphm, matrixP.view(matrixP.setValues().data()), logger);
+}
+
+template void sddmm_cpu<float>(const Matrix<float> &matrixA,
+                               const Matrix<float> &matrixB,
+                               const RPHM &rphm,
+                               sparseMatrix::CSR<float> &matrixP,
+                               Logger &logger);
+template void sddmm_cpu<__half>(const Matrix<__half> &matrixA,
+                                const Matrix<__half> &matrixB,
+                                const RPHM &rphm,
+                                sparseMatrix::CSR<float> &matrixP,
+                                Logger &logger);
+template void sddmm_cpu<__nv_bfloat16>(const Matrix<__nv_bfloat16> &matrixA,
+                                       const Matrix<__nv_bfloat16> &matrixB,
+                                       const RPHM &rphm,
+                                       sparseMatrix::CSR<float> &matrixP,
+                                       Logger &logger);
+
+template<typename T>
+void sddmm_cpu(const MatrixView<const T> &matrixA,
+               const MatrixView<const T> &matrixB,
+               const RPHM &rphm,
+               const sparseMatrix::CsrView<float> &matrixP,
+               Logger &logger) {
+    if (matrixA.col != matrixB.row ||
+        matrixA.row != matrixP.row ||
+        matrixB.col != matrixP.col) {
+        std::cerr << "The storage of the three matrices does not match" << std::endl;
+        return;
+    }
+    if (!isSimdSddmmLayout(matrixA, matrixB)) {
+        std::cerr << "Error, the CPU SDDMM with the BSMR tiling needs row-major A and col-major B" << std::endl;
+        return;
+    }
+
+    const int numIterations = std::max(logger.numITER_, 1);
+    const auto startTime = std::chrono::steady_clock::now();
+    for (int iter = 0; iter < numIterations; ++iter) {
+        cpu::sddmm(matrixA.data, matrixA.leadingDimension,
+                   matrixB.data, matrixB.leadingDimension,
+                   matrixB.col,
+                   matrixA.col,
+                   rphm,
+                   matrixP.values,
+                   &logger.loadImbalance_);
+    }
+    const auto endTime = std::chrono::steady_clock::now();
+
+    logger.sddmmTime_ = std::chrono::duration<float, std::milli>(endTime - startTime).count() / numIterations;
+}
+
+template void sddmm_cpu<float>(const MatrixView<const float> &matrixA,
+                               const MatrixView<const float> &matrixB,
+                               const RPHM &rphm,
+                               const sparseMatrix::CsrView<float> &matrixP,
+                               Logger &logger);
+template void sddmm_cpu<__half>(const MatrixView<const __half> &matrixA,
+                                const MatrixView<const __half> &matrixB,
+                                const RPHM &rphm,
+                                const sparseMatrix::CsrView<float> &matrixP,
+                                Logger &logger);
+template void sddmm_cpu<__nv_bfloat16>(const MatrixView<const __nv_bfloat16> &matrixA,
+                                       const MatrixView<const __nv_bfloat16> &matrixB,
+                                       const RPHM &rphm,
+                                       const sparseMatrix::CsrView<float> &matrixP,
+                                       Logger &logger);
+
+template<typename T>
+bool checkSddmmPrecision(const MatrixView<const float> &matrixA,
+                         const MatrixView<const float> &matrixB,
+                         const sparseMatrix::CsrView<const float> &matrixP,
+                         size_t &numError) {
+    // The fp32 result, and sum_k |a_k * b_k| of each value that scales the rounding error
+    std::vector<float> values_fp32(matrixP.nnz), absProductSums(matrixP.nnz);
+    sddmm_cpu(matrixA, matrixB, withValues(matrixP, values_fp32.data()));
+    std::vector<float> absValuesA(matrixA.data, matrixA.data + matrixA.size());
+    std::vector<float> absValuesB(matrixB.data, matrixB.data + matrixB.size());
+    for (float &value : absValuesA) {
+        value = std::fabs(value);
+    }
+    for (float &value : absValuesB) {
+        value = std::fabs(value);
+    }
+    const MatrixView<const float> absMatrixA{absValuesA.data(), matrixA.row, matrixA.col,
+                                             matrixA.leadingDimension, matrixA.storageOrder};
+    const MatrixView<const float> absMatrixB{absValuesB.data(), matrixB.row, matrixB.col,
+                                             matrixB.leadingDimension, matrixB.storageOrder};
+    sddmm_cpu(absMatrixA, absMatrixB, withValues(matrixP, absProductSums.data()));
+
+    // Both operands are rounded to T (2u + u^2) and both results are accumulated in fp32 (K * 2^-24 each)
+    const float unitRoundoff = precision::Traits<T>::unitRoundoff;
+    const float relativeBound = 2.0f * unitRoundoff + unitRoundoff * unitRoundoff
+        + 2.0f * static_cast<float>(matrixA.col) * precision::Traits<float>::unitRoundoff;
+
+    const float *values = matrixP.values;
+    printf("|-----------------------check data (%s)-----------------------|\n", precision::Traits<T>::name);
+    printf("| Data size : %zu\n", static_cast<size_t>(matrixP.nnz));
+    printf("| Error bound : %g * sum(|a * b|)\n", relativeBound);
+    size_t errors = 0;
+    for (size_t idx = 0; idx < matrixP.nnz; ++idx) {
+        const float difference = std::fabs(values[idx] - values_fp32[idx]);
+        const float bound = relativeBound * absProductSums[idx] + std::numeric_limits<float>::min();
+        if (!(difference <= bound)) {
+            ++errors;
+            if (errors < 10) {
+                printf("| Error : idx = %zu, data = %f, fp32 = %f, difference = %g, bound = %g\n",
+                       idx, values[idx], values_fp32[idx], difference, bound);
+            }
+        }
+    }
+    numError = errors;
+    if (errors > 0) {
+        printf("| No Pass! %zu values exceed the error bound! Error rate : %2.2f%%\n",
+               errors, static_cast<float>(errors) / static_cast<float>(matrixP.nnz) * 100);
+    } else {
+        printf("| Pass! All values are within the error bound of %s.\n", precision::Traits<T>::name);
+    }
+    printf("|----------------------------------------------------------------|\n");
+
+    return errors == 0;
+}
+
+template bool checkSddmmPrecision<float>(const MatrixView<const float> &matrixA,
+                                         const MatrixView<const float> &matrixB,
+                                         const sparseMatrix::CsrView<const float> &matrixP,
+                                         size_t &numError);
+template bool checkSddmmPrecision<__half>(const MatrixView<const float> &matrixA,
+                                          const MatrixView<const float> &matrixB,
+                                          const sparseMatrix::CsrView<const float> &matrixP,
+                                          size_t &numError);
+template bool checkSddmmPrecision<__nv_bfloat16>(const MatrixView<const float> &matrixA,
+                                                 const MatrixView<const float> &matrixB,
+                                                 const sparseMatrix::CsrView<const float> &matrixP,
+                                                 size_t &numError);
+
+void sddmm_cpu_int8(const Matrix<float> &matrixA,
+                    const Matrix<float> &matrixB,
+                    const RPHM &rphm,
+                    sparseMatrix::CSR<float> &matrixP,
+                    Logger &logger) {
+    matrixP.setValues().resize(matrixP.nnz());
+    sddmm_cpu_int8(matrixA.view(), matrixB.view(), rphm, matrixP.view(matrixP.setValues().data()), logger);
+}
+
+void sddmm_cpu_int8(const MatrixView<const float> &matrixA,
+                    const MatrixView<const float> &matrixB,
+                    const RPHM &rphm,
+                    const sparseMatrix::CsrView<float> &matrixP,
+                    Logger &logger) {
+    if (matrixA.col != matrixB.row ||
+        matrixA.row != matrixP.row ||
+        matrixB.col != matrixP.col) {
+        std::cerr << "The storage of the three matrices does not match" << std::endl;
+        return;
+    }
+    if (!isSimdSddmmLayout(matrixA, matrixB)) {
+        std::cerr << "Error, the CPU SDDMM with the BSMR tiling needs row-major A and col-major B" << std::endl;
+        return;
+    }
+
+    const auto quantizationStartTime = std::chrono::steady_clock::now();
+    std::vector<float> scalesA, scalesB;
+    const Matrix<int8_t> quantizedA = quantize(matrixA, MatrixMultiplicationOrder::left_multiplication, scalesA);
+    const Matrix<int8_t> quantizedB = quantize(matrixB, MatrixMultiplicationOrder::right_multiplication, scalesB);
+    const auto quantizationEndTime = std::chrono::steady_clock::now();
+
+    const cpu::QuantizedOperands operands{quantizedA.data(), quantizedA.leadingDimension(), scalesA.data(),
+                                          quantizedB.data(), quantizedB.leadingDimension(), scalesB.data()};
+    const int numIterations = std::max(logger.numITER_, 1);
+    const auto startTime = std::chrono::steady_clock::now();
+    for (int iter = 0; iter < numIterations; ++iter) {
+        cpu::sddmm_int8(operands, matrixB.col, matrixA.col, rphm, matrixP.values, &logger.loadImbalance_);
+    }
+    const auto endTime = std::chrono::steady_clock::now();
+
+    logger.isQuantized_ = true;
+    logger.quantizationTime_ =
+        std::chrono::duration<float, std::milli>(quantizationEndTime - quantizationStartTime).count();
+    logger.sddmmTime_ = std::chrono::duration<float, std::milli>(endTime - startTime).count() / numIterations;
+}
+
+float sddmmRelativeError(const MatrixView<const float> &matrixA,
+                         const MatrixView<const float> &matrixB,
+                         const sparseMatrix::CsrView<const float> &matrixP) {
+    std::vector<float> values_fp32(matrixP.nnz);
+    sddmm_cpu(matrixA, matrixB, withValues(matrixP, values_fp32.data()));
+
+    const float *values = matrixP.values;
+    double squaredError = 0.0, squaredNorm = 0.0;
+#pragma omp parallel for reduction(+ : squaredError, squaredNorm)
+    for (size_t idx = 0; idx < values_fp32.size(); ++idx) {
+        const double reference = values_fp32[idx];
+        const double difference = values[idx] - reference;
+        squaredError += difference * difference;
+        squaredNorm += reference * reference;
+    }
+    return squaredNorm > 0.0 ? static_cast<float>(std::sqrt(squaredError / squaredNorm))
+                             : static_cast<float>(std::sqrt(squaredError));
+}
+
+void sddmm_cpu_batch(const UIN numHeads,
+                     const Matrix<float> &matrixA,
+                     const Matrix<float> &matrixB,
+                     const RPHM &rphm,
+                     const sparseMatrix::CSR<float> &matrixS,
+                     std::vector<float> &matrixP,
+                     Logger &logger) {
+    const UIN M = matrixS.row();
+    const UIN N = matrixS.col();
+    if (numHeads == 0 ||
+        matrixA.col() != matrixB.row() ||
+        matrixA.row() != static_cast<size_t>(numHeads) * M ||
+        matrixB.col() != static_cast<size_t>(numHeads) * N) {
+        std::cerr << "The storage of the batched matrices does not match" << std::endl;
+        return;
+    }
+    if (!isSimdSddmmLayout(matrixA.view(), matrixB.view())) {
+        std::cerr << "Error, the batched CPU SDDMM needs row-major A and col-major B" << std::endl;
+        return;
+    }
+    const UIN K = matrixA.col();
+    matrixP.resize(static_cast<size_t>(numHeads) * matrixS.nnz());
+
+    const int numIterations = std::max(logger.numITER_, 1);
+    std::vector<float> headTimes(numHeads, 0.0f), iterationHeadTimes(numHeads);
+    const auto startTime = std::chrono::steady_clock::now();
+    for (int iter = 0; iter < numIterations; ++iter) {
+        cpu::sddmm_batch(numHeads,
+                         matrixA.data(), matrixA.leadingDimension(), static_cast<size_t>(M) * matrixA.leadingDimension(),
+                         matrixB.data(), matrixB.leadingDimension(), static_cast<size_t>(N) * matrixB.leadingDimension(),
+                         N,
+                         K,
+                         rphm,
+                         matrixP.data(), matrixS.nnz(),
+                         iterationHeadTimes.data(),
+                         &logger.loadImbalance_);
+        for (UIN headId = 0; headId < numHeads; ++headId) {
+            headTimes[headId] += iterationHeadTimes[headId] / numIterations;
+        }
+    }
+    const auto endTime = std::chrono::steady_clock::now();
+
+    logger.numHeads_ = numHeads;
+    logger.batchTime_ = std::chrono::duration<float, std::milli>(endTime - startTime).count() / numIterations;
+    logger.headTimes_ = headTimes;
+}
+
+void attention_cpu(const MatrixView<const float> &matrixA,
+                   const MatrixView<const float> &matrixB,
+                   const Matrix<float> &matrixV,
+                   const RPHM &rphm,
+                   const float *valuesS,
+                   const float scale,
+                   Matrix<float> &matrixO,
+                   Logger &logger) {
+    if (matrixA.col != matrixB.row ||
+        matrixB.col != matrixV.row() ||
+        matrixA.row != matrixO.row() ||
+        matrixV.col() != matrixO.col()) {
+        std::cerr << "The storage of the four matrices does not match" << std::endl;
+        return;
+    }
+    if (!isSimdSddmmLayout(matrixA, matrixB)
+        || matrixV.storageOrder() != MatrixStorageOrder::row_major
+        || matrixO.storageOrder() != MatrixStorageOrder::row_major) {
+        std::cerr << "Error, the CPU attention needs row-major A, V, O and col-major B" << std::endl;
+        return;
+    }
+
+    // The rows of S without nonzeros are not in the tiling, their output is 0
+    std::fill(matrixO.data(), matrixO.data() + matrixO.size(), 0.0f);
+
+    cpu::AttentionArguments arguments{};
+    arguments.matrixA = matrixA.data;
+    arguments.lda = matrixA.leadingDimension;
+    arguments.matrixB = matrixB.data;
+    arguments.ldb = matrixB.leadingDimension;
+    arguments.matrixV = matrixV.data();
+    arguments.ldv = matrixV.leadingDimension();
+    arguments.valuesS = valuesS;
+    arguments.matrixO = matrixO.data();
+    arguments.ldo = matrixO.leadingDimension();
+    arguments.N = matrixB.col;
+    arguments.K = matrixA.col;
+    arguments.D = matrixV.col();
+    arguments.scale = scale;
+
+    const int numIterations = std::max(logger.numITER_, 1);
+    const auto startTime = std::chrono::steady_clock::now();
+    for (int iter = 0; iter < numIterations; ++iter) {
+        cpu::attention(arguments, rphm, &logger.loadImbalance_);
+    }
+    const auto endTime = std::chrono::steady_clock::now();
+
+    logger.attentionDim_ = matrixV.col();
+    logger.attentionTime_ = std::chrono::duration<float, std::milli>(endTime - startTime).count() / numIterations;
+}
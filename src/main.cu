@@ -8,11 +8,25 @@ int main(int argc, char* argv[]){
     Options options(argc, argv);
 
     sparseMatrix::CSR<float> matrixS;
-    if (!matrixS.initializeFromMatrixFile(options.inputFile())){
+    if (!matrixS.initializeFromMatrixFile(options.inputFile(), options.degreeOrderedRelabel())){
         fprintf(stderr, "Error, matrix S initialize failed.\n");
         return -1;
     }
 
+    // Convert the input matrix to a binary CSR file and exit
+    if (!options.convertFile().empty()){
+        if (!matrixS.outputToBinaryFile(options.convertFile())){
+            return -1;
+        }
+        sparseMatrix::CSR<float> matrixCheck;
+        if (!matrixCheck.initializeFromBinaryFile(options.convertFile(), true)){
+            fprintf(stderr, "Error, binary file check failed.\n");
+            return -1;
+        }
+        printf("Converted %s to %s\n", options.inputFile().c_str(), options.convertFile().c_str());
+        return 0;
+    }
+
     if (options.testMode()){
         sddmm_testMode(options, matrixS);
         return 0;
@@ -20,6 +34,12 @@ int main(int argc, char* argv[]){
 
     const size_t K = options.K();
 
+    // The kernels index the dense matrices with UIN
+    if (static_cast<uint64_t>(matrixS.row()) * K >= NULL_VALUE || static_cast<uint64_t>(matrixS.col()) * K >= NULL_VALUE){
+        fprintf(stderr, "Error, dense matrix A or B exceeds the range of UIN. Use the 64-bit index build.\n");
+        return -1;
+    }
+
     Matrix<float> matrixA(matrixS.row(), K, MatrixStorageOrder::row_major);
     matrixA.makeData();
 
@@ -32,9 +52,9 @@ int main(int argc, char* argv[]){
     logger.getInformation(matrixS);
     logger.getInformation(matrixA, matrixB);
 
-    // sddmm
-    sparseMatrix::CSR<float> matrixP(matrixS);
-    sddmm(options, matrixA, matrixB, matrixP, logger);
+    // sddmm, P has the structure of S and only its values are allocated
+    std::vector<float> valuesP;
+    sddmm(options, matrixA, matrixB, matrixS, valuesP, logger);
 
     logger.printLogInformation();
 
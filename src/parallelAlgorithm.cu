@@ -7,19 +7,21 @@
 #include "parallelAlgorithm.cuh"
 
 struct IsPositive {
+  template<typename T>
   __host__ __device__
-  bool operator()(int x) {
+  bool operator()(T x) {
       return x > 0;
   }
 };
 
+template<typename T>
 struct is_equal {
-  int value;
+  T value;
 
-  is_equal(int v) : value(v) {}
+  is_equal(T v) : value(v) {}
 
   __host__ __device__
-  bool operator()(int x) const {
+  bool operator()(T x) const {
       return x == value;
   }
 };
@@ -28,6 +30,9 @@ namespace host {
 void fill_n(uint32_t *first, size_t size, uint32_t val) {
     thrust::fill_n(thrust::host, first, size, val);
 }
+void fill_n(uint64_t *first, size_t size, uint64_t val) {
+    thrust::fill_n(thrust::host, first, size, val);
+}
 void sort(uint32_t *first, uint32_t *last) {
     thrust::sort(thrust::host, first, last);
 }
@@ -40,6 +45,12 @@ void sort_by_key(uint64_t *key_first, uint64_t *key_last, uint64_t *value_first)
 void sort_by_key(int *key_first, int *key_last, uint32_t *value_first) {
     thrust::sort_by_key(thrust::host, key_first, key_last, value_first);
 }
+void sort_by_key(int *key_first, int *key_last, uint64_t *value_first) {
+    thrust::sort_by_key(thrust::host, key_first, key_last, value_first);
+}
+void sort_by_key(uint64_t *key_first, uint64_t *key_last, int *value_first) {
+    thrust::sort_by_key(thrust::host, key_first, key_last, value_first);
+}
 void sort_by_key(uint32_t *key_first, uint32_t *key_last, uint32_t *value_first) {
     thrust::sort_by_key(thrust::host, key_first, key_last, value_first);
 }
@@ -55,10 +66,29 @@ void sort_by_key(uint32_t *key_first, uint32_t *key_last, double *value_first) {
 void sort_by_key(uint64_t *key_first, uint64_t *key_last, float *value_first) {
     thrust::sort_by_key(thrust::host, key_first, key_last, value_first);
 }
+void sort_by_key(uint64_t *key_first, uint64_t *key_last, double *value_first) {
+    thrust::sort_by_key(thrust::host, key_first, key_last, value_first);
+}
+void stable_sort_by_key(uint32_t *key_first, uint32_t *key_last, uint32_t *value_first) {
+    thrust::stable_sort_by_key(thrust::host, key_first, key_last, value_first);
+}
+void stable_sort_by_key(uint32_t *key_first, uint32_t *key_last, int *value_first) {
+    thrust::stable_sort_by_key(thrust::host, key_first, key_last, value_first);
+}
+void stable_sort_by_key(uint64_t *key_first, uint64_t *key_last, uint64_t *value_first) {
+    thrust::stable_sort_by_key(thrust::host, key_first, key_last, value_first);
+}
+void stable_sort_by_key(uint64_t *key_first, uint64_t *key_last, int *value_first) {
+    thrust::stable_sort_by_key(thrust::host, key_first, key_last, value_first);
+}
 void sort_by_key_descending_order(uint32_t *key_first, uint32_t *key_last, uint32_t *value_first) {
     auto descending = thrust::greater<int>();
     thrust::sort_by_key(thrust::host, key_first, key_last, value_first, descending);
 }
+void sort_by_key_descending_order(uint64_t *key_first, uint64_t *key_last, uint64_t *value_first) {
+    auto descending = thrust::greater<uint64_t>();
+    thrust::sort_by_key(thrust::host, key_first, key_last, value_first, descending);
+}
 void sort_by_key_for_multiple_vectors(uint32_t *key_first,
                                       uint32_t *key_last,
                                       uint32_t *value1_first,
@@ -98,6 +128,46 @@ void sort_by_key_for_multiple_vectors(uint32_t *key_first,
                         key_last,
                         thrust::make_zip_iterator(thrust::make_tuple(value1_first, value2_first)));
 
+}
+void sort_by_key_for_multiple_vectors(uint64_t *key_first,
+                                      uint64_t *key_last,
+                                      uint64_t *value1_first,
+                                      uint64_t *value2_first) {
+    thrust::sort_by_key(thrust::host,
+                        key_first,
+                        key_last,
+                        thrust::make_zip_iterator(thrust::make_tuple(value1_first, value2_first)));
+
+}
+void sort_by_key_for_multiple_vectors(uint64_t *key_first,
+                                      uint64_t *key_last,
+                                      uint64_t *value1_first,
+                                      int *value2_first) {
+    thrust::sort_by_key(thrust::host,
+                        key_first,
+                        key_last,
+                        thrust::make_zip_iterator(thrust::make_tuple(value1_first, value2_first)));
+
+}
+void sort_by_key_for_multiple_vectors(uint64_t *key_first,
+                                      uint64_t *key_last,
+                                      uint64_t *value1_first,
+                                      float *value2_first) {
+    thrust::sort_by_key(thrust::host,
+                        key_first,
+                        key_last,
+                        thrust::make_zip_iterator(thrust::make_tuple(value1_first, value2_first)));
+
+}
+void sort_by_key_for_multiple_vectors(uint64_t *key_first,
+                                      uint64_t *key_last,
+                                      uint64_t *value1_first,
+                                      double *value2_first) {
+    thrust::sort_by_key(thrust::host,
+                        key_first,
+                        key_last,
+                        thrust::make_zip_iterator(thrust::make_tuple(value1_first, value2_first)));
+
 }
 void inclusive_scan(size_t *first, size_t *last, size_t *result) {
     thrust::inclusive_scan(thrust::host, first, last, result);
@@ -111,24 +181,42 @@ void sequence(int *first, int *last, int start_value, int step) {
 void sequence(uint32_t *first, uint32_t *last, uint32_t start_value, uint32_t step) {
     thrust::sequence(thrust::host, first, last, start_value, step);
 }
+void sequence(uint64_t *first, uint64_t *last, uint64_t start_value, uint64_t step) {
+    thrust::sequence(thrust::host, first, last, start_value, step);
+}
 size_t count_if_positive(uint32_t *first, uint32_t *last) {
     return thrust::count_if(thrust::host, first, last, IsPositive());
 }
+size_t count_if_positive(uint64_t *first, uint64_t *last) {
+    return thrust::count_if(thrust::host, first, last, IsPositive());
+}
 void copy_if_positive(uint32_t *first, uint32_t *last, uint32_t *result) {
     thrust::copy_if(thrust::host, first, last, result, IsPositive());
 }
+void copy_if_positive(uint64_t *first, uint64_t *last, uint64_t *result) {
+    thrust::copy_if(thrust::host, first, last, result, IsPositive());
+}
 void copy_if_positive(uint32_t *first, uint32_t *last, uint32_t *stencil, uint32_t *result) {
     thrust::copy_if(thrust::host, first, last, stencil, result, IsPositive());
 }
+void copy_if_positive(uint64_t *first, uint64_t *last, uint64_t *stencil, uint64_t *result) {
+    thrust::copy_if(thrust::host, first, last, stencil, result, IsPositive());
+}
 void computeRowNNZCountsFromOffsets(size_t num, uint32_t *offsets, uint32_t *result) {
     thrust::transform(thrust::host, offsets + 1, offsets + num + 1, offsets, result, thrust::minus<int>());
 }
+void computeRowNNZCountsFromOffsets(size_t num, uint64_t *offsets, uint64_t *result) {
+    thrust::transform(thrust::host, offsets + 1, offsets + num + 1, offsets, result, thrust::minus<uint64_t>());
+}
 } // namespace host
 
 namespace dev {
 void fill_n(uint32_t *first, size_t size, uint32_t val) {
     thrust::fill_n(thrust::device, first, size, val);
 }
+void fill_n(uint64_t *first, size_t size, uint64_t val) {
+    thrust::fill_n(thrust::device, first, size, val);
+}
 void sort(uint32_t *first, uint32_t *last) {
     thrust::sort(thrust::device, first, last);
 }
@@ -153,20 +241,39 @@ void inclusive_scan(uint32_t *first, uint32_t *last, uint32_t *result) {
 void sequence(uint32_t *first, uint32_t *last, uint32_t start_value, uint32_t step) {
     thrust::sequence(thrust::device, first, last, start_value, step);
 }
+void sequence(uint64_t *first, uint64_t *last, uint64_t start_value, uint64_t step) {
+    thrust::sequence(thrust::device, first, last, start_value, step);
+}
 void sort_by_key_descending_order(uint32_t *key_first, uint32_t *key_last, uint32_t *value_first) {
     auto descending = thrust::greater<int>();
     thrust::sort_by_key(thrust::device, key_first, key_last, value_first, descending);
 }
+void sort_by_key_descending_order(uint64_t *key_first, uint64_t *key_last, uint64_t *value_first) {
+    auto descending = thrust::greater<uint64_t>();
+    thrust::sort_by_key(thrust::device, key_first, key_last, value_first, descending);
+}
 size_t count_if_positive(uint32_t *first, uint32_t *last) {
     return thrust::count_if(thrust::device, first, last, IsPositive());
 }
+size_t count_if_positive(uint64_t *first, uint64_t *last) {
+    return thrust::count_if(thrust::device, first, last, IsPositive());
+}
 size_t count_if_equal(uint32_t *first, uint32_t *last, uint32_t value) {
-    return thrust::count_if(thrust::device, first, last, is_equal(value));
+    return thrust::count_if(thrust::device, first, last, is_equal<uint32_t>(value));
+}
+size_t count_if_equal(uint64_t *first, uint64_t *last, uint64_t value) {
+    return thrust::count_if(thrust::device, first, last, is_equal<uint64_t>(value));
 }
 void copy(uint32_t *first, uint32_t *last, uint32_t *result) {
     thrust::copy(thrust::device, first, last, result);
 }
+void copy(uint64_t *first, uint64_t *last, uint64_t *result) {
+    thrust::copy(thrust::device, first, last, result);
+}
 void copy_if_positive(uint32_t *first, uint32_t *last, uint32_t *stencil, uint32_t *result) {
     thrust::copy_if(thrust::device, first, last, stencil, result, IsPositive());
 }
+void copy_if_positive(uint64_t *first, uint64_t *last, uint64_t *stencil, uint64_t *result) {
+    thrust::copy_if(thrust::device, first, last, stencil, result, IsPositive());
+}
 } // namespace dev
\ No newline at end of file
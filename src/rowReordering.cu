@@ -4,11 +4,18 @@
 #include <algorithm>
 #include <set>
 #include <queue>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <utility>
 
 #include "cudaUtil.cuh"
 #include "BSMR.hpp"
 #include "parallelAlgorithm.cuh"
 #include "CudaTimeCalculator.cuh"
+#include "WorkScheduler.hpp"
 
 #define COL_BLOCK_SIZE 32
 
@@ -25,7 +32,7 @@ void noReorderRow(const sparseMatrix::CSR<float>& matrix, std::vector<UIN>& reor
 
     const UIN numNonZeroRow = host::count_if_positive(nnz.data(), nnz.data() + nnz.size());
 
-    printf("Number of non-zero rows: %u\n", numNonZeroRow);
+    printf("Number of non-zero rows: %" PRIuUIN "\n", numNonZeroRow);
 
     reorderedRows.resize(numNonZeroRow);
     std::vector<UIN> ascendingRow(matrix.row());
@@ -46,52 +53,6 @@ void noReorderRow(const sparseMatrix::CSR<float>& matrix, std::vector<UIN>& reor
 }
 
 namespace kernel{
-__global__ void calculateDispersion(const UIN* __restrict__ colIndices,
-                                    const UIN* __restrict__ rowPtr,
-                                    UIN* weighted_partitions,
-                                    UIN* dispersion_score,
-                                    int num_blocks_per_row,
-                                    int col_block_size){
-    extern __shared__ UIN shm[];
-    __shared__ UIN* encoding;
-    __shared__ UIN* local_result;
-    encoding = (UIN*)&shm[0];
-    local_result = (UIN*)&shm[num_blocks_per_row];
-    const UIN row = blockIdx.x;
-    const UIN row_start_index = rowPtr[row];
-    const int row_nz_count = rowPtr[row + 1] - row_start_index;
-    if (row_nz_count == 0){
-        return;
-    }
-
-    for (int i = threadIdx.x; i < num_blocks_per_row; i += blockDim.x){
-        encoding[i] = 0;
-    }
-    __syncthreads();
-
-    for (int i = threadIdx.x; i < row_nz_count; i += blockDim.x){
-        int col = colIndices[row_start_index + i];
-        atomicAdd(&encoding[col / col_block_size], 1);
-    }
-    __syncthreads();
-
-    const UIN store_offset = row * num_blocks_per_row;
-    UIN result_tmp = 0;
-    UIN dense_partition_size = 0;
-    for (int i = threadIdx.x; i < num_blocks_per_row; i += blockDim.x){
-        UIN value = encoding[i];
-        weighted_partitions[store_offset + i] = value;
-        int is_dense_partition = (value != 0);
-        dense_partition_size += is_dense_partition;
-        result_tmp += is_dense_partition * (col_block_size - value);
-    }
-    UIN result = cuUtil::reduce_sum(result_tmp + row_nz_count * dense_partition_size, local_result);
-
-    if (threadIdx.x == 0){
-        dispersion_score[row] = result;
-    }
-}
-
 __device__ void normalizeEncoding(int num_blocks_per_row, float* encoding, UIN* scratch){
     UIN sum_of_squares_rep = 0;
 
@@ -147,7 +108,7 @@ __global__ void calculateDispersion(const UIN* __restrict__ colIndices,
     }
     __syncthreads();
 
-    const UIN store_offset = row * num_blocks_per_row;
+    const size_t store_offset = static_cast<size_t>(row) * num_blocks_per_row;
     UIN result_tmp = 0;
     UIN dense_partition_size = 0;
     for (int i = threadIdx.x; i < num_blocks_per_row; i += blockDim.x){
@@ -188,7 +149,7 @@ __global__ void calculateDispersionNoSMEM(const UIN* __restrict__ colidx,
         return;
     }
 
-    const UIN store_offset = row * num_blocks_per_row;
+    const size_t store_offset = static_cast<size_t>(row) * num_blocks_per_row;
     UIN* encoding = weighted_partitions + store_offset;
 
     for (int i = threadIdx.x; i < row_nz_count; i += blockDim.x){
@@ -232,32 +193,53 @@ static __device__ void mutex_unlock(unsigned int* mutex){
     __syncthreads();
 }
 
+/**
+ * Add the sparse encoding of a row to the dense encoding of a cluster, and its sums to the sums of the cluster.
+ * The blocks of a row are distinct, so the threads do not write the same block.
+ **/
+static __device__ void add_to_representative(UIN* encoding_rep,
+                                             const UIN* blocks_cmp,
+                                             const UIN* counts_cmp,
+                                             const UIN size_cmp,
+                                             unsigned long long* sum_of_squares_rep,
+                                             unsigned long long* sum_rep){
+    unsigned long long sum_of_squares_delta = 0;
+    unsigned long long sum_delta = 0;
+    for (UIN i = threadIdx.x; i < size_cmp; i += blockDim.x){
+        const unsigned long long e_rep_i = encoding_rep[blocks_cmp[i]];
+        const unsigned long long e_cmp_i = counts_cmp[i];
+        encoding_rep[blocks_cmp[i]] = e_rep_i + e_cmp_i;
+        sum_of_squares_delta += 2 * e_rep_i * e_cmp_i + e_cmp_i * e_cmp_i;
+        sum_delta += e_cmp_i;
+    }
+    if (sum_delta > 0){
+        atomicAdd(sum_of_squares_rep, sum_of_squares_delta);
+        atomicAdd(sum_rep, sum_delta);
+    }
+}
+
+// The representative is dense and the compared row is sparse, so only the blocks of the compared row are visited
 static __device__ float calculate_similarity_norm_weighted_jaccard(const UIN* encoding_rep,
-                                                                   const UIN* encoding_cmp,
-                                                                   UIN num_blocks_per_row,
+                                                                   const unsigned long long sum_of_squares_rep,
+                                                                   const unsigned long long sum_rep,
+                                                                   const UIN* blocks_cmp,
+                                                                   const UIN* counts_cmp,
+                                                                   const UIN size_cmp,
                                                                    UIN* scratch,
                                                                    float* float_scratch){
-    float similarity;
-    UIN sum_of_squares_rep = 0;
     UIN sum_of_squares_cmp = 0;
+    UIN sum_cmp = 0;
 
-    for (int i = threadIdx.x; i < num_blocks_per_row; i += blockDim.x){
-        int e_rep_i = encoding_rep[i];
-        int e_cmp_i = encoding_cmp[i];
+    for (UIN i = threadIdx.x; i < size_cmp; i += blockDim.x){
+        const UIN e_cmp_i = counts_cmp[i];
 
-        sum_of_squares_rep += e_rep_i * e_rep_i;
         sum_of_squares_cmp += e_cmp_i * e_cmp_i;
+        sum_cmp += e_cmp_i;
     }
-    sum_of_squares_rep = cuUtil::reduce_sum(sum_of_squares_rep, scratch);
     sum_of_squares_cmp = cuUtil::reduce_sum(sum_of_squares_cmp, scratch);
-
-    if (threadIdx.x == 0){
-        scratch[0] = sum_of_squares_rep;
-        scratch[1] = sum_of_squares_cmp;
-    }
     __syncthreads();
-    sum_of_squares_rep = scratch[0];
-    sum_of_squares_cmp = scratch[1];
+    sum_cmp = cuUtil::reduce_sum(sum_cmp, scratch);
+    __syncthreads();
 
     if (sum_of_squares_rep == 0 && sum_of_squares_cmp == 0){
         return 1.0f;
@@ -265,31 +247,24 @@ static __device__ float calculate_similarity_norm_weighted_jaccard(const UIN* en
     else if ((sum_of_squares_rep == 0 || sum_of_squares_cmp == 0)){
         return 0.0f;
     }
-    __syncthreads();
 
     float norm_rep = sqrt((float)sum_of_squares_rep);
     float norm_cmp = sqrt((float)sum_of_squares_cmp);
     float min_sum = 0.0f;
-    float max_sum = 0.0f;
 
-    for (int i = threadIdx.x; i < num_blocks_per_row; i += blockDim.x){
-        float sim_rep = ((float)encoding_rep[i]) / norm_rep;
-        float sim_cmp = ((float)encoding_cmp[i]) / norm_cmp;
+    // The minimum is 0 in the blocks that are not in the compared row
+    for (UIN i = threadIdx.x; i < size_cmp; i += blockDim.x){
+        float sim_rep = ((float)encoding_rep[blocks_cmp[i]]) / norm_rep;
+        float sim_cmp = ((float)counts_cmp[i]) / norm_cmp;
         min_sum += fminf(sim_rep, sim_cmp);
-        max_sum += fmaxf(sim_rep, sim_cmp);
     }
     min_sum = cuUtil::reduce_sum(min_sum, float_scratch);
-    max_sum = cuUtil::reduce_sum(max_sum, float_scratch);
     __syncthreads();
 
-    if (threadIdx.x == 0) // only the first warp holds valid values, and use only one thread for simple write
-    {
-        float sim = min_sum / max_sum;
-        float_scratch[0] = sim;
-    }
-    __syncthreads();
-    similarity = float_scratch[0];
-    return similarity;
+    // min + max = rep + cmp in each block, so the sum of the maximums follows from the sums of the encodings
+    const float max_sum = (float)sum_rep / norm_rep + (float)sum_cmp / norm_cmp - min_sum;
+
+    return min_sum / max_sum;
 }
 
 static __device__ float calculate_similarity_norm_weighted_jaccard(const float* encoding_rep,
@@ -322,7 +297,9 @@ static __device__ float calculate_similarity_norm_weighted_jaccard(const float*
     return similarity;
 }
 
-static __global__ void bsa_clustering(const UIN* weighted_partitions,
+static __global__ void bsa_clustering(const UIN* encoding_offsets,
+                                      const UIN* encoding_blocks,
+                                      const UIN* encoding_counts,
                                       const UIN cluster_id,
                                       int* ascending_idx,
                                       volatile UIN* cluster_ids,
@@ -338,6 +315,8 @@ static __global__ void bsa_clustering(const UIN* weighted_partitions,
     __shared__ UIN* encoding_rep;
     __shared__ UIN* scratch;
     __shared__ float* float_scratch;
+    __shared__ unsigned long long sum_of_squares_rep;
+    __shared__ unsigned long long sum_rep;
     encoding_rep = shm;
     scratch = &encoding_rep[num_blocks_per_row];
     float_scratch = (float*)&scratch[blockDim.x / warpSize];
@@ -347,9 +326,21 @@ static __global__ void bsa_clustering(const UIN* weighted_partitions,
     mutex_lock(&mutexes[start_idx]);
     cluster_ids[start_idx] = cluster_id;
     for (int i = threadIdx.x; i < num_blocks_per_row; i += blockDim.x){
-        encoding_rep[i] = weighted_partitions[ascending_idx[start_idx] * num_blocks_per_row + i];
+        encoding_rep[i] = 0;
+    }
+    if (threadIdx.x == 0){
+        sum_of_squares_rep = 0;
+        sum_rep = 0;
     }
     __syncthreads();
+    const int row_rep = ascending_idx[start_idx];
+    add_to_representative(encoding_rep,
+                          &encoding_blocks[encoding_offsets[row_rep]],
+                          &encoding_counts[encoding_offsets[row_rep]],
+                          encoding_offsets[row_rep + 1] - encoding_offsets[row_rep],
+                          &sum_of_squares_rep,
+                          &sum_rep);
+    __syncthreads();
 
     mutex_unlock(&mutexes[start_idx]);
     if (start_idx + 1 < num_rows){ // if there is a next row
@@ -369,12 +360,17 @@ static __global__ void bsa_clustering(const UIN* weighted_partitions,
         }
 
         int row = ascending_idx[idx]; // ascending_idx[idx];
-        const UIN* encoding_cmp = &weighted_partitions[row * num_blocks_per_row];
+        const UIN* blocks_cmp = &encoding_blocks[encoding_offsets[row]];
+        const UIN* counts_cmp = &encoding_counts[encoding_offsets[row]];
+        const UIN size_cmp = encoding_offsets[row + 1] - encoding_offsets[row];
         float similarity;
 
         similarity = calculate_similarity_norm_weighted_jaccard(encoding_rep,
-                                                                encoding_cmp,
-                                                                num_blocks_per_row,
+                                                                sum_of_squares_rep,
+                                                                sum_rep,
+                                                                blocks_cmp,
+                                                                counts_cmp,
+                                                                size_cmp,
                                                                 scratch,
                                                                 float_scratch);
 
@@ -390,16 +386,21 @@ static __global__ void bsa_clustering(const UIN* weighted_partitions,
                 cluster_ids[idx] = cluster_id;
             }
 
-            for (int i = threadIdx.x; i < num_blocks_per_row; i += blockDim.x){
-                encoding_rep[i] += encoding_cmp[i];
-            }
+            add_to_representative(encoding_rep,
+                                  blocks_cmp,
+                                  counts_cmp,
+                                  size_cmp,
+                                  &sum_of_squares_rep,
+                                  &sum_rep);
 
             __syncthreads();
         }
         else{
             if (!next_cluster_created){
                 if (threadIdx.x == 0){
-                    bsa_clustering<<<1, blockDim.x, shm_size, cudaStreamFireAndForget>>>(weighted_partitions,
+                    bsa_clustering<<<1, blockDim.x, shm_size, cudaStreamFireAndForget>>>(encoding_offsets,
+                        encoding_blocks,
+                        encoding_counts,
                         cluster_id + 1,
                         ascending_idx,
                         cluster_ids,
@@ -431,7 +432,9 @@ static __global__ void bsa_clustering(const UIN* weighted_partitions,
     }
 }
 
-__global__ void clustering(const UIN* __restrict__ weightedPartitions,
+__global__ void clustering(const UIN* __restrict__ encodingOffsets,
+                           const UIN* __restrict__ encodingBlocks,
+                           const UIN* __restrict__ encodingCounts,
                            const UIN num_blocks_per_row,
                            const UIN* __restrict__ rowIndices,
                            const UIN startIndex,
@@ -443,15 +446,28 @@ __global__ void clustering(const UIN* __restrict__ weightedPartitions,
     __shared__ UIN* encoding_rep;
     __shared__ UIN* scratch;
     __shared__ float* float_scratch;
+    __shared__ unsigned long long sum_of_squares_rep;
+    __shared__ unsigned long long sum_rep;
     encoding_rep = shm;
     scratch = &encoding_rep[num_blocks_per_row];
     float_scratch = (float*)&scratch[blockDim.x / WARP_SIZE];
 
     const UIN row = rowIndices[startIndex];
     for (int idx = threadIdx.x; idx < num_blocks_per_row; idx += blockDim.x){
-        encoding_rep[idx] = weightedPartitions[row * num_blocks_per_row + idx];
+        encoding_rep[idx] = 0;
+    }
+    if (threadIdx.x == 0){
+        sum_of_squares_rep = 0;
+        sum_rep = 0;
     }
     __syncthreads();
+    add_to_representative(encoding_rep,
+                          &encodingBlocks[encodingOffsets[row]],
+                          &encodingCounts[encodingOffsets[row]],
+                          encodingOffsets[row + 1] - encodingOffsets[row],
+                          &sum_of_squares_rep,
+                          &sum_rep);
+    __syncthreads();
 
     const UIN idx_cmp = startIndex + blockIdx.x + 1;
     if (idx_cmp >= numRow){
@@ -459,13 +475,15 @@ __global__ void clustering(const UIN* __restrict__ weightedPartitions,
     }
 
     const UIN row_cmp = rowIndices[idx_cmp];
-    const UIN* encoding_cmp = &weightedPartitions[row_cmp * num_blocks_per_row];
     float similarity;
 
     // TODO : 归一化的计算可以提前计算
     similarity = calculate_similarity_norm_weighted_jaccard(encoding_rep,
-                                                            encoding_cmp,
-                                                            num_blocks_per_row,
+                                                            sum_of_squares_rep,
+                                                            sum_rep,
+                                                            &encodingBlocks[encodingOffsets[row_cmp]],
+                                                            &encodingCounts[encodingOffsets[row_cmp]],
+                                                            encodingOffsets[row_cmp + 1] - encodingOffsets[row_cmp],
                                                             scratch,
                                                             float_scratch);
     //    printf("row = %d, similarity = %f", row, similarity);
@@ -475,69 +493,85 @@ __global__ void clustering(const UIN* __restrict__ weightedPartitions,
 }
 } // namespace kernel
 
-void calculateDispersion(const sparseMatrix::CSR<float>& matrix,
-                         dev::vector<UIN>& Encodings_gpu,
-                         dev::vector<UIN>& Dispersions_gpu,
-                         int num_blocks_per_row,
-                         UIN block_size){
-    int blockdim = WARP_SIZE * 4;
-    int grid = matrix.row();
-
-    dev::vector<UIN> rowptr_gpu(matrix.rowOffsets());
-    dev::vector<UIN> colidx_gpu(matrix.colIndices());
-
-    const size_t shm_size = num_blocks_per_row * sizeof(UIN) + (blockdim / WARP_SIZE) * sizeof(UIN);
-    // printf("calculateDispersion shm_size = %lu\n", shm_size);
-    if (shm_size > maxSharedMemoryPerBlock){
-        printf("Warning! Shared memory size exceeds the limit. shm_size = %zu\n", shm_size);
+/**
+ * @structName: SparseEncodings
+ * @structInterpretation: Column block encodings of the rows in a CSR layout. The column blocks with nonzeros of row
+ * `row` and their numbers of nonzeros are `blocks[offsets[row], offsets[row + 1])` and `counts[offsets[row],
+ * offsets[row + 1])`, the blocks in ascending order. The size is at most the number of nonzeros, instead of
+ * rows * blocks of a dense histogram, so a small block size can be kept on large matrices.
+ **/
+struct SparseEncodings{
+    std::vector<UIN> offsets;
+    std::vector<UIN> blocks;
+    std::vector<UIN> counts;
+};
+
+void encoding(const sparseMatrix::CSR<float>& matrix, const UIN blockSize, SparseEncodings& encodings){
+    const UIN numRows = matrix.row();
+    const UIN* rowOffsets = matrix.rowOffsets().data();
+    const UIN* colIndices = matrix.colIndices().data();
+
+    // The blocks of the nonzeros of each row in ascending order, the columns of a row are not always sorted
+    std::vector<UIN> sortedBlocks(matrix.nnz());
+    std::vector<UIN> numRowBlocks(numRows, 0);
+#pragma omp parallel for schedule(dynamic, 1024)
+    for (UIN row = 0; row < numRows; ++row){
+        UIN* blocks = sortedBlocks.data() + rowOffsets[row];
+        const UIN numNonZeros = rowOffsets[row + 1] - rowOffsets[row];
+        for (UIN idx = 0; idx < numNonZeros; ++idx){
+            blocks[idx] = colIndices[rowOffsets[row] + idx] / blockSize;
+        }
+        if (!std::is_sorted(blocks, blocks + numNonZeros)){
+            std::sort(blocks, blocks + numNonZeros);
+        }
+        for (UIN idx = 0; idx < numNonZeros; ++idx){
+            numRowBlocks[row] += idx == 0 || blocks[idx] != blocks[idx - 1];
+        }
     }
 
-    kernel::calculateDispersion<<<grid, blockdim, shm_size>>>(colidx_gpu.data(), rowptr_gpu.data(),
-                                                              Encodings_gpu.data(),
-                                                              Dispersions_gpu.data(),
-                                                              num_blocks_per_row, block_size);
-
-    cudaDeviceSynchronize();
-}
-
-void encoding(const sparseMatrix::CSR<float>& matrix, std::vector<std::vector<UIN>>& encodings){
-    const int colBlock = std::ceil(static_cast<float>(matrix.col()) / COL_BLOCK_SIZE);
-    encodings.resize(matrix.row());
-#pragma omp parallel for schedule(dynamic)
-    for (int row = 0; row < matrix.row(); ++row){
-        encodings[row].resize(colBlock);
-        for (int idx = matrix.rowOffsets()[row]; idx < matrix.rowOffsets()[row + 1]; ++idx){
-            const int col = matrix.colIndices()[idx];
-            ++encodings[row][col / COL_BLOCK_SIZE];
+    scheduler::exclusiveScan(numRowBlocks, encodings.offsets);
+    encodings.blocks.resize(encodings.offsets.back());
+    encodings.counts.resize(encodings.offsets.back());
+#pragma omp parallel for schedule(dynamic, 1024)
+    for (UIN row = 0; row < numRows; ++row){
+        UIN position = encodings.offsets[row];
+        for (UIN idx = rowOffsets[row]; idx < rowOffsets[row + 1]; ++idx){
+            if (idx == rowOffsets[row] || sortedBlocks[idx] != sortedBlocks[idx - 1]){
+                encodings.blocks[position] = sortedBlocks[idx];
+                encodings.counts[position] = 0;
+                ++position;
+            }
+            ++encodings.counts[position - 1];
         }
     }
 }
 
-void calculateDispersion(const UIN col,
-                         const std::vector<std::vector<UIN>>& encodings,
-                         std::vector<UIN>& dispersions){
-#pragma omp parallel for schedule(dynamic)
-    for (int row = 0; row < encodings.size(); ++row){
-        UIN numOfNonZeroColBlocks = 0;
+// The dispersion of `kernel::bsa_clustering`: the zero fillings of the nonzero blocks plus nnz * the nonzero blocks
+void calculateDispersion(const SparseEncodings& encodings, const UIN blockSize, std::vector<UIN>& dispersions){
+    const UIN numRows = encodings.offsets.size() - 1;
+    dispersions.resize(numRows);
+#pragma omp parallel for schedule(dynamic, 1024)
+    for (UIN row = 0; row < numRows; ++row){
+        const UIN numOfNonZeroColBlocks = encodings.offsets[row + 1] - encodings.offsets[row];
+        UIN numOfNonZeros = 0;
         UIN zeroFillings = 0;
-        for (int colBlockIdx = 0; colBlockIdx < encodings[row].size(); ++colBlockIdx){
-            const UIN numOfNonZeroCols = encodings[row][colBlockIdx];
-            if (numOfNonZeroCols != 0){
-                ++numOfNonZeroColBlocks;
-                zeroFillings += BLOCK_COL_SIZE - numOfNonZeroCols;
-            }
+        for (UIN idx = encodings.offsets[row]; idx < encodings.offsets[row + 1]; ++idx){
+            numOfNonZeros += encodings.counts[idx];
+            zeroFillings += blockSize - encodings.counts[idx];
         }
-        dispersions[row] = COL_BLOCK_SIZE * numOfNonZeroColBlocks + zeroFillings;
+        dispersions[row] = zeroFillings + numOfNonZeros * numOfNonZeroColBlocks;
     }
 }
 
-// return similarity between two encodings
-float clusterComparison(const std::vector<UIN>& encoding_rep, const std::vector<UIN>& encoding_cmp){
+// return similarity between two encodings, the blocks of the two rows are merge-joined
+float clusterComparison(const SparseEncodings& encodings, const UIN row_rep, const UIN row_cmp){
     UIN sum_of_squares_rep = 0;
     UIN sum_of_squares_cmp = 0;
-    for (int idx = 0; idx < encoding_rep.size(); ++idx){
-        sum_of_squares_rep += encoding_rep[idx] * encoding_rep[idx];
-        sum_of_squares_cmp += encoding_cmp[idx] * encoding_cmp[idx];
+    for (UIN idx = encodings.offsets[row_rep]; idx < encodings.offsets[row_rep + 1]; ++idx){
+        sum_of_squares_rep += encodings.counts[idx] * encodings.counts[idx];
+    }
+    for (UIN idx = encodings.offsets[row_cmp]; idx < encodings.offsets[row_cmp + 1]; ++idx){
+        sum_of_squares_cmp += encodings.counts[idx] * encodings.counts[idx];
     }
     if (sum_of_squares_rep == 0 && sum_of_squares_cmp == 0){
         return 1.0f;
@@ -549,31 +583,36 @@ float clusterComparison(const std::vector<UIN>& encoding_rep, const std::vector<
     float norm_cmp = sqrt((float)sum_of_squares_cmp);
     float min_sum = 0.0f;
     float max_sum = 0.0f;
-    for (int idx = 0; idx < encoding_rep.size(); ++idx){
-        float sim_rep = (float)encoding_rep[idx] / norm_rep;
-        float sim_cmp = (float)encoding_cmp[idx] / norm_cmp;
+    UIN idx_rep = encodings.offsets[row_rep];
+    UIN idx_cmp = encodings.offsets[row_cmp];
+    while (idx_rep < encodings.offsets[row_rep + 1] || idx_cmp < encodings.offsets[row_cmp + 1]){
+        // A block that is only in one of the rows has a minimum of 0
+        const UIN block_rep = idx_rep < encodings.offsets[row_rep + 1] ? encodings.blocks[idx_rep] : NULL_VALUE;
+        const UIN block_cmp = idx_cmp < encodings.offsets[row_cmp + 1] ? encodings.blocks[idx_cmp] : NULL_VALUE;
+        const float sim_rep = block_rep <= block_cmp ? (float)encodings.counts[idx_rep++] / norm_rep : 0.0f;
+        const float sim_cmp = block_cmp <= block_rep ? (float)encodings.counts[idx_cmp++] / norm_cmp : 0.0f;
         min_sum += fminf(sim_rep, sim_cmp);
         max_sum += fmaxf(sim_rep, sim_cmp);
     }
     return min_sum / max_sum;
 }
 
-// void clustering(const std::vector<std::vector<UIN>> &encodings,
+// void clustering(const SparseEncodings &encodings,
 //                 const std::vector<UIN> &rows, const UIN startIndexOfNonZeroRow, std::vector<int> &clusterIds) {
 //
 // //    UIN num = 0;
-//     for (int idx = startIndexOfNonZeroRow; idx < encodings.size() - 1; ++idx) {
+//     for (int idx = startIndexOfNonZeroRow; idx < encodings.offsets.size() - 2; ++idx) {
 //         if (idx > startIndexOfNonZeroRow && clusterIds[rows[idx]] != -1) {
 //             continue;
 //         }
 //         clusterIds[rows[idx]] = idx;
 // #pragma omp parallel for schedule(dynamic)
-//         for (int cmpIdx = idx + 1; cmpIdx < encodings.size(); ++cmpIdx) {
+//         for (int cmpIdx = idx + 1; cmpIdx < encodings.offsets.size() - 1; ++cmpIdx) {
 //             if (clusterIds[rows[cmpIdx]] != -1) {
 //                 continue;
 //             }
 //             const float similarity =
-//                 clusterComparison(encodings[rows[startIndexOfNonZeroRow]], encodings[rows[cmpIdx]]);
+//                 clusterComparison(encodings, rows[startIndexOfNonZeroRow], rows[cmpIdx]);
 //             if (similarity > row_similarity_threshold_alpha) {
 //                 clusterIds[rows[cmpIdx]] = clusterIds[rows[idx]];
 // //                ++num;
@@ -588,11 +627,11 @@ float clusterComparison(const std::vector<UIN>& encoding_rep, const std::vector<
 //     CudaTimeCalculator timeCalculator;
 //     timeCalculator.startClock();
 //
-//     std::vector<std::vector<UIN>> encodings;
-//     encoding(matrix, encodings);
+//     SparseEncodings encodings;
+//     encoding(matrix, COL_BLOCK_SIZE, encodings);
 //
 //     std::vector<UIN> dispersions(matrix.row());
-//     calculateDispersion(matrix.col(), encodings, dispersions);
+//     calculateDispersion(encodings, COL_BLOCK_SIZE, dispersions);
 //
 //     std::vector<UIN> ascendingRow(matrix.row()); // Store the original row id
 //     std::iota(ascendingRow.begin(), ascendingRow.end(), 0); // ascending = {0, 1, 2, 3, ... rows-1}
@@ -637,7 +676,7 @@ void rowReordering_gpu(const sparseMatrix::CSR<float>& matrix,
                        const int blockSize,
                        std::vector<UIN>& reorderedRows,
                        float& time){
-    printf("start rowReordering_gpu. Number of rows: %u\n", matrix.row());
+    printf("start rowReordering_gpu. Number of rows: %" PRIuUIN "\n", matrix.row());
 
     CudaTimeCalculator timeCalculator;
     timeCalculator.startClock();
@@ -651,7 +690,7 @@ void rowReordering_gpu(const sparseMatrix::CSR<float>& matrix,
 
     const UIN numNonZeroRow = host::count_if_positive(nnz.data(), nnz.data() + nnz.size());
 
-    printf("Number of non-zero rows: %u\n", numNonZeroRow);
+    printf("Number of non-zero rows: %" PRIuUIN "\n", numNonZeroRow);
 
     dev::vector<UIN> rowIndices_dev; // Store the original row id
     {
@@ -670,10 +709,15 @@ void rowReordering_gpu(const sparseMatrix::CSR<float>& matrix,
 
     const UIN numBlocksPerRow = std::ceil(static_cast<float>(matrix.col()) / blockSize);
 
-    dev::vector<UIN> encodings_dev(static_cast<size_t>(numBlocksPerRow) * matrix.row(), 0);
-    dev::vector<UIN> dispersions_dev(matrix.row());
+    SparseEncodings encodings;
+    encoding(matrix, blockSize, encodings);
+    std::vector<UIN> dispersions;
+    calculateDispersion(encodings, blockSize, dispersions);
 
-    calculateDispersion(matrix, encodings_dev, dispersions_dev, numBlocksPerRow, blockSize);
+    dev::vector<UIN> encodingOffsets_dev(encodings.offsets);
+    dev::vector<UIN> encodingBlocks_dev(encodings.blocks);
+    dev::vector<UIN> encodingCounts_dev(encodings.counts);
+    dev::vector<UIN> dispersions_dev(dispersions);
 
     dev::sort_by_key(dispersions_dev.data(),
                      dispersions_dev.data() + dispersions_dev.size(),
@@ -707,7 +751,9 @@ void rowReordering_gpu(const sparseMatrix::CSR<float>& matrix,
         dev::fill_n(clusterIds_dev.data() + startIndex, 1, clusterCount);
 
         clusteringTimer.startClock();
-        kernel::clustering<<<numRemainingRows - 1, block, smemSize>>>(encodings_dev.data(),
+        kernel::clustering<<<numRemainingRows - 1, block, smemSize>>>(encodingOffsets_dev.data(),
+                                                                      encodingBlocks_dev.data(),
+                                                                      encodingCounts_dev.data(),
                                                                       numBlocksPerRow,
                                                                       rowIndices_dev.data(), startIndex,
                                                                       rowIndices_dev.size(),
@@ -719,7 +765,7 @@ void rowReordering_gpu(const sparseMatrix::CSR<float>& matrix,
         clusteringTimer.endClock();
         float clustering_onetime = clusteringTimer.getTime();
 
-        printf("clustering_onetime = %f, clusterCount = %d\n", clustering_onetime, clusterCount);
+        printf("clustering_onetime = %f, clusterCount = %" PRIuUIN "\n", clustering_onetime, clusterCount);
 
         clustering_time += clustering_onetime;
 
@@ -739,7 +785,7 @@ void rowReordering_gpu(const sparseMatrix::CSR<float>& matrix,
         startIndex = newStartIndex;
         ++clusterCount;
     }
-    printf("Number of clusters: %u\n", clusterCount);
+    printf("Number of clusters: %" PRIuUIN "\n", clusterCount);
 
     printf("clustering time: %f ms, sort time: %f ms\n", clustering_time, sort_time);
 
@@ -749,150 +795,807 @@ void rowReordering_gpu(const sparseMatrix::CSR<float>& matrix,
     reorderedRows = d2h(rowIndices_dev);
 }
 
-float normalized_weighted_jaccard_sim(std::vector<int> A_pattern,
-                                      std::vector<int> B_pattern,
-                                      int current_group_size,
-                                      int block_size){
-    float score_A = 0.0;
-    float score_B = 0.0;
+namespace{
+/**
+ * The CPU BSA row reordering is the greedy clustering of `bsa_clustering` with the candidates of a cluster found by
+ * MinHash LSH: a row is only compared with a cluster if it has the same hashes as one of the rows of the cluster in one
+ * band of the signatures. Then the clusters are merged by the same clustering of their sums. The rows are encoded by
+ * `encoding`, like on the GPU.
+ **/
+
+// The signature of an item is numHashes MinHashes of its column blocks, cut into the bands of `MinHashes`
+constexpr UIN numHashes = 16;
+
+// The bands are as selective as possible while an item with the similarity alpha to another item still shares a band
+// with it with this probability
+constexpr double minCandidateProbability = 0.5;
+
+// Larger buckets are split by more hashes of the signature, then into runs of items that are close in the order
+constexpr UIN maxBucketSize = 256;
+
+// Rows clustered by one task. The chunks only depend on the number of rows, not on the number of threads
+constexpr UIN clusteringChunkSize = 1u << 16;
+
+// The clusters are merged until no two clusters merge, or at most this many times
+constexpr UIN maxNumMergePasses = 8;
+
+inline uint64_t mixHash(uint64_t value){
+    value ^= value >> 30;
+    value *= 0xbf58476d1ce4e5b9ull;
+    value ^= value >> 27;
+    value *= 0x94d049bb133111ebull;
+    value ^= value >> 31;
+    return value;
+}
 
-    float sim_A = 0.0;
-    float sim_B = 0.0;
+/**
+ * Sparse column block encodings of the items of a clustering, an item is a row or a cluster of rows.
+ * The blocks of an item are in ascending order.
+ **/
+struct BlockEncodings{
+    std::vector<size_t> offsets;
+    std::vector<UIN> blocks;
+    std::vector<UIN> counts;
+    std::vector<uint32_t> signatures; // numHashes for each item, empty if the items are not hashed
+    std::vector<float> norms; // Euclidean norm of the counts, in fp32 like on the GPU
+    std::vector<uint64_t> sums; // Sum of the counts
+
+    UIN numItems() const{ return static_cast<UIN>(offsets.size() - 1); }
+
+    void resize(const UIN numItems, const bool withSignatures){
+        blocks.resize(offsets.back());
+        counts.resize(offsets.back());
+        signatures.resize(withSignatures ? static_cast<size_t>(numItems) * numHashes : 0);
+        norms.resize(numItems);
+        sums.resize(numItems);
+    }
 
-    float min_sum = 0.0;
-    float max_sum = 0.0;
+    // The norms of an item from its blocks and counts
+    void describe(const UIN item){
+        uint64_t sumOfSquares = 0, sum = 0;
+        for (size_t idx = offsets[item]; idx < offsets[item + 1]; ++idx){
+            sumOfSquares += static_cast<uint64_t>(counts[idx]) * counts[idx];
+            sum += counts[idx];
+        }
+        norms[item] = std::sqrt(static_cast<float>(sumOfSquares));
+        sums[item] = sum;
+    }
 
-    for (int i = 0; i < B_pattern.size(); i++){
-        score_A += A_pattern[i] * A_pattern[i];
-        score_B += B_pattern[i] * B_pattern[i];
+    const uint32_t* signature(const UIN item) const{ return &signatures[static_cast<size_t>(item) * numHashes]; }
+};
+
+/**
+ * The MinHash functions of the column blocks and the bands of the signatures for alpha. A hash of an item is the block
+ * with the minimum `-ln(u) / count`, u uniform for each block and hash function, so a block is drawn in proportion to
+ * its count and two items have the same hash about as often as their weighted similarity (P-MinHash). A cluster, the
+ * sum of its rows, is then hashed by the blocks that most of its rows have and not by the blocks of a few rows.
+ **/
+class MinHashes{
+public:
+    MinHashes(const UIN numBlocks, const float alpha) : hashes_(static_cast<size_t>(numBlocks) * numHashes){
+#pragma omp parallel for
+        for (size_t idx = 0; idx < hashes_.size(); ++idx){
+            const double uniform = (static_cast<double>(mixHash(idx) >> 11) + 0.5) * 0x1.0p-53;
+            hashes_[idx] = static_cast<float>(-std::log(uniform));
+        }
+
+        // A pair with the similarity alpha has the same hashes of a band with the probability alpha^rowsPerBand
+        for (UIN rowsPerBand = 2; rowsPerBand <= numHashes; ++rowsPerBand){
+            const double bandProbability = std::pow(std::max(static_cast<double>(alpha), 0.0), rowsPerBand);
+            if (1.0 - std::pow(1.0 - bandProbability, numHashes / rowsPerBand) < minCandidateProbability){
+                break;
+            }
+            rowsPerBand_ = rowsPerBand;
+        }
+        numBands_ = numHashes / rowsPerBand_;
     }
 
-    score_A = sqrt(score_A);
-    score_B = sqrt(score_B);
+    UIN numBands() const{ return numBands_; }
+
+    // The number of hashes that a bucket of a band can be split by, after the hashes of the band
+    UIN maxRefinement() const{ return numHashes - rowsPerBand_; }
+
+    void sign(BlockEncodings& encodings, const UIN item) const{
+        float minValues[numHashes];
+        uint32_t* signature = &encodings.signatures[static_cast<size_t>(item) * numHashes];
+        std::fill(minValues, minValues + numHashes, std::numeric_limits<float>::infinity());
+        std::fill(signature, signature + numHashes, UINT32_MAX);
+        for (size_t idx = encodings.offsets[item]; idx < encodings.offsets[item + 1]; ++idx){
+            const float* hashes = &hashes_[static_cast<size_t>(encodings.blocks[idx]) * numHashes];
+            const float inverseCount = 1.0f / static_cast<float>(encodings.counts[idx]);
+            for (UIN hashId = 0; hashId < numHashes; ++hashId){
+                if (hashes[hashId] * inverseCount < minValues[hashId]){
+                    minValues[hashId] = hashes[hashId] * inverseCount;
+                    signature[hashId] = static_cast<uint32_t>(encodings.blocks[idx]);
+                }
+            }
+        }
+    }
 
-    if (score_A == 0 && score_B == 0)
-        return 1.0;
-    if (score_A == 0 || score_B == 0)
-        return 0.0;
+    // The key of the bucket of an item in a band
+    uint32_t bandKey(const BlockEncodings& encodings, const UIN item, const UIN band) const{
+        const uint32_t* signature = encodings.signature(item);
+        uint64_t key = band;
+        for (UIN hashId = band * rowsPerBand_; hashId < (band + 1) * rowsPerBand_; ++hashId){
+            key = mixHash(key << 32 ^ signature[hashId]);
+        }
+        return static_cast<uint32_t>(key);
+    }
 
-    for (int i = 0; i < B_pattern.size(); i++){
-        if (A_pattern[i] == 0 && B_pattern[i] == 0){
-            continue;
+    // The key of a bucket that is split by the `refinement`-th hash after the hashes of the band
+    uint32_t refineKey(const BlockEncodings& encodings,
+                       const UIN item,
+                       const UIN band,
+                       const UIN refinement,
+                       const uint32_t key) const{
+        const uint32_t hash = encodings.signature(item)[((band + 1) * rowsPerBand_ + refinement - 1) % numHashes];
+        return static_cast<uint32_t>(mixHash(static_cast<uint64_t>(key) << 32 ^ hash));
+    }
+
+private:
+    std::vector<float> hashes_;
+    UIN rowsPerBand_ = 1;
+    UIN numBands_ = numHashes;
+};
+
+/**
+ * The cluster that is built by a thread: the sum of the encodings of its items, dense over the column blocks.
+ * `similarity` is the normalized weighted Jaccard similarity of `calculate_similarity_norm_weighted_jaccard`, with the
+ * same fp32 operations, only the minimums are summed in another order.
+ **/
+class ClusterRepresentative{
+public:
+    explicit ClusterRepresentative(const UIN numBlocks) : counts_(numBlocks, 0){}
+
+    void add(const BlockEncodings& encodings, const UIN item){
+        for (size_t idx = encodings.offsets[item]; idx < encodings.offsets[item + 1]; ++idx){
+            const UIN block = encodings.blocks[idx];
+            const uint64_t oldCount = counts_[block];
+            const uint64_t newCount = oldCount + encodings.counts[idx];
+            if (oldCount == 0){
+                touchedBlocks_.push_back(block);
+            }
+            counts_[block] = static_cast<UIN>(newCount);
+            sumOfSquares_ += newCount * newCount - oldCount * oldCount;
+            sum_ += encodings.counts[idx];
         }
+    }
 
-        sim_A = A_pattern[i] / score_A;
-        sim_B = B_pattern[i] / score_B;
+    float similarity(const BlockEncodings& encodings, const UIN item) const{
+        const float norm = std::sqrt(static_cast<float>(sumOfSquares_));
+        const float itemNorm = encodings.norms[item];
+        float minSum = 0.0f;
+        for (size_t idx = encodings.offsets[item]; idx < encodings.offsets[item + 1]; ++idx){
+            minSum += std::min(static_cast<float>(counts_[encodings.blocks[idx]]) / norm,
+                               static_cast<float>(encodings.counts[idx]) / itemNorm);
+        }
+        // The maximums of the union of the blocks, the blocks of only one side add their normalized count
+        const float maxSum = static_cast<float>(sum_) / norm + static_cast<float>(encodings.sums[item]) / itemNorm
+            - minSum;
+        return minSum / maxSum;
+    }
 
-        min_sum += std::min(sim_A, sim_B);
-        max_sum += std::max(sim_A, sim_B);
+    UIN count(const UIN block) const{ return counts_[block]; }
+
+    void clear(){
+        for (const UIN block : touchedBlocks_){
+            counts_[block] = 0;
+        }
+        touchedBlocks_.clear();
+        sumOfSquares_ = 0;
+        sum_ = 0;
     }
 
-    return (min_sum / max_sum);
+private:
+    std::vector<UIN> counts_;
+    std::vector<UIN> touchedBlocks_;
+    uint64_t sumOfSquares_ = 0;
+    uint64_t sum_ = 0;
+};
+
+// The key of a bucket in the high half and an item of a chunk in the low half, so the keys sort by bucket and then item
+inline uint64_t packKey(const uint32_t key, const UIN item){ return static_cast<uint64_t>(key) << 32 | item; }
+inline uint32_t bucketKeyOf(const uint64_t packedKey){ return static_cast<uint32_t>(packedKey >> 32); }
+inline UIN itemOf(const uint64_t packedKey){ return static_cast<UIN>(packedKey & UINT32_MAX); }
+
+/**
+ * The LSH buckets of the items of a chunk in all the bands, the items of a bucket are in ascending order.
+ * `itemBuckets[item * numBands + band]` is the bucket of an item in a band.
+ **/
+struct Buckets{
+    std::vector<UIN> offsets{0};
+    std::vector<UIN> items;
+    std::vector<UIN> sizes;
+    std::vector<UIN> itemBuckets;
+
+    // A bucket of the items of keys [first, last)
+    void add(const std::vector<uint64_t>& keys,
+             const size_t first,
+             const size_t last,
+             const UIN band,
+             const UIN numBands){
+        for (size_t idx = first; idx < last; ++idx){
+            itemBuckets[static_cast<size_t>(itemOf(keys[idx])) * numBands + band] = static_cast<UIN>(sizes.size());
+            items.push_back(itemOf(keys[idx]));
+        }
+        sizes.push_back(static_cast<UIN>(last - first));
+        offsets.push_back(static_cast<UIN>(items.size()));
+    }
+};
+
+/**
+ * @funcitonName: bucketBand
+ * @functionInterpretation: The buckets of the keys [first, last) of a band, sorted by key and then by item: a bucket is
+ * a run of equal keys. A run of more than maxBucketSize items is split by one more hash of the signatures, so the items
+ * of the smaller buckets still share the hashes, and only a run that has all the hashes in common is cut into runs of
+ * items that are close in the clustering order.
+ **/
+void bucketBand(const BlockEncodings& encodings,
+                const MinHashes& minHashes,
+                const UIN begin,
+                const UIN band,
+                const UIN refinement,
+                const size_t first,
+                const size_t last,
+                std::vector<uint64_t>& keys,
+                Buckets& buckets){
+    for (size_t runBegin = first; runBegin < last;){
+        size_t runEnd = runBegin + 1;
+        while (runEnd < last && bucketKeyOf(keys[runEnd]) == bucketKeyOf(keys[runBegin])){
+            ++runEnd;
+        }
+        if (runEnd - runBegin <= maxBucketSize){
+            buckets.add(keys, runBegin, runEnd, band, minHashes.numBands());
+        }
+        else if (refinement < minHashes.maxRefinement()){
+            for (size_t idx = runBegin; idx < runEnd; ++idx){
+                const UIN item = itemOf(keys[idx]);
+                keys[idx] = packKey(minHashes.refineKey(encodings, begin + item, band, refinement + 1,
+                                                        bucketKeyOf(keys[idx])), item);
+            }
+            std::sort(keys.begin() + runBegin, keys.begin() + runEnd);
+            bucketBand(encodings, minHashes, begin, band, refinement + 1, runBegin, runEnd, keys, buckets);
+        }
+        else{
+            for (size_t offset = runBegin; offset < runEnd; offset += maxBucketSize){
+                buckets.add(keys, offset, std::min(offset + maxBucketSize, runEnd), band, minHashes.numBands());
+            }
+        }
+        runBegin = runEnd;
+    }
 }
 
-std::vector<int> merge_rows(std::vector<int> A, std::vector<int> B){
-    std::vector<int> result(A.size());
+/**
+ * @funcitonName: clusterChunk
+ * @functionInterpretation: Greedy clustering of the items [begin, end) in their order, like `bsa_clustering`: an item
+ * that is not in a cluster starts a cluster, and the later items join it if their similarity with the cluster is
+ * above alpha. Only the items that share an LSH bucket with a member of the cluster are compared.
+ * @output: `clusterOf[item]` is the first item of the cluster of the item.
+ **/
+void clusterChunk(const BlockEncodings& encodings,
+                  const MinHashes& minHashes,
+                  const UIN begin,
+                  const UIN end,
+                  const float alpha,
+                  ClusterRepresentative& representative,
+                  std::vector<UIN>& clusterOf){
+    const UIN numItems = end - begin;
+    const UIN numBands = minHashes.numBands();
+
+    Buckets buckets;
+    buckets.itemBuckets.resize(static_cast<size_t>(numItems) * numBands);
+    buckets.items.reserve(static_cast<size_t>(numItems) * numBands);
+    std::vector<uint64_t> keys(numItems);
+    for (UIN band = 0; band < numBands; ++band){
+        for (UIN item = 0; item < numItems; ++item){
+            keys[item] = packKey(minHashes.bandKey(encodings, begin + item, band), item);
+        }
+        std::sort(keys.begin(), keys.end());
+        bucketBand(encodings, minHashes, begin, band, 0, 0, numItems, keys, buckets);
+    }
+    const UIN numBuckets = static_cast<UIN>(buckets.sizes.size());
+
+    // The cluster (first item) that queued an item or expanded a bucket, so each is only done once per cluster
+    std::vector<UIN> queuedBy(numItems, NULL_VALUE), expandedBy(numBuckets, NULL_VALUE);
+    std::priority_queue<UIN, std::vector<UIN>, std::greater<UIN>> candidates;
+
+    // Queue the later items of the buckets of `item`. The items that are in a cluster are removed from the buckets
+    auto expand = [&](const UIN item, const UIN cluster){
+        for (UIN band = 0; band < numBands; ++band){
+            const UIN bucket = buckets.itemBuckets[static_cast<size_t>(item) * numBands + band];
+            if (expandedBy[bucket] == cluster){
+                continue;
+            }
+            expandedBy[bucket] = cluster;
+            UIN* items = &buckets.items[buckets.offsets[bucket]];
+            UIN numLiveItems = 0;
+            for (UIN idx = 0; idx < buckets.sizes[bucket]; ++idx){
+                const UIN candidate = items[idx];
+                if (clusterOf[begin + candidate] != NULL_VALUE){
+                    continue;
+                }
+                items[numLiveItems++] = candidate;
+                if (candidate > item && queuedBy[candidate] != cluster){
+                    queuedBy[candidate] = cluster;
+                    candidates.push(candidate);
+                }
+            }
+            buckets.sizes[bucket] = numLiveItems;
+        }
+    };
 
-    for (int i = 0; i < A.size(); i++){
-        result[i] = A[i] + B[i];
+    for (UIN seed = 0; seed < numItems; ++seed){
+        if (clusterOf[begin + seed] != NULL_VALUE){
+            continue;
+        }
+        clusterOf[begin + seed] = begin + seed;
+        representative.add(encodings, begin + seed);
+        expand(seed, seed);
+
+        // In ascending order, as `bsa_clustering` scans the rows
+        while (!candidates.empty()){
+            const UIN candidate = candidates.top();
+            candidates.pop();
+            if (clusterOf[begin + candidate] != NULL_VALUE){
+                continue;
+            }
+            if (representative.similarity(encodings, begin + candidate) > alpha){
+                clusterOf[begin + candidate] = begin + seed;
+                representative.add(encodings, begin + candidate);
+                expand(candidate, seed);
+            }
+        }
+        representative.clear();
     }
-    return result;
 }
 
-std::vector<int> bsa_rowReordering_cpu(const sparseMatrix::CSR<float>& matrix,
-                                       const float similarity_threshold_alpha,
-                                       const int block_size,
-                                       float& reordering_time){
-    int rows = matrix.row();
-    std::vector<int> row_permutation;
-    std::priority_queue<std::pair<float, int>> row_queue;
-    std::priority_queue<std::pair<float, int>> inner_queue;
-    std::vector<std::vector<int>> patterns(rows, std::vector<int>((rows + block_size - 1) / block_size));
+/**
+ * @funcitonName: clusterItems
+ * @functionInterpretation: `clusterChunk` of consecutive chunks of clusteringChunkSize items in parallel, the first
+ * chunk has `firstChunkSize` items. The clusters do not cross the chunks.
+ * @output: `clusterOf[item]` is the first item of the cluster of the item. Return the number of chunks.
+ **/
+UIN clusterItems(const BlockEncodings& encodings,
+                 const MinHashes& minHashes,
+                 const UIN numBlocks,
+                 const float alpha,
+                 const UIN firstChunkSize,
+                 std::vector<UIN>& clusterOf){
+    const UIN numItems = encodings.numItems();
+    std::vector<UIN> chunkOffsets{0};
+    for (UIN offset = std::min(firstChunkSize, numItems); ; offset = std::min(offset + clusteringChunkSize, numItems)){
+        chunkOffsets.push_back(offset);
+        if (offset == numItems){
+            break;
+        }
+    }
+    const UIN numChunks = static_cast<UIN>(chunkOffsets.size() - 1);
 
-    CudaTimeCalculator timeCalculator;
-    timeCalculator.startClock();
-    for (int r = 0; r < rows; r++){
-        std::set<int> dense_partition;
-        int score = 0;
-        int start_pos = matrix.rowOffsets()[r];
-        int end_pos = matrix.rowOffsets()[r + 1];
-        int nnz = end_pos - start_pos;
-        if (nnz == 0){
-            row_permutation.push_back(r);
-            continue;
+    clusterOf.assign(numItems, NULL_VALUE);
+#pragma omp parallel
+    {
+        ClusterRepresentative representative(numBlocks);
+#pragma omp for schedule(dynamic, 1)
+        for (UIN chunk = 0; chunk < numChunks; ++chunk){
+            clusterChunk(encodings, minHashes, chunkOffsets[chunk], chunkOffsets[chunk + 1], alpha, representative,
+                         clusterOf);
         }
+    }
 
-        for (int nz = start_pos; nz < end_pos; nz++){
-            int col = matrix.colIndices()[nz];
-            patterns[r][col / block_size]++;
-            dense_partition.insert(col / block_size);
+    return numChunks;
+}
+
+/**
+ * @funcitonName: groupByCluster
+ * @functionInterpretation: The items of each cluster, the clusters in the order of their first item and the items
+ * of a cluster in ascending order.
+ * @output: The items of cluster c are `clusterItems[clusterOffsets[c], clusterOffsets[c + 1])`.
+ **/
+void groupByCluster(const std::vector<UIN>& clusterOf,
+                    std::vector<UIN>& clusterOffsets,
+                    std::vector<UIN>& clusterItems){
+    const UIN numItems = static_cast<UIN>(clusterOf.size());
+    std::vector<UIN> clusterIds(numItems);
+    clusterOffsets.assign(1, 0);
+    for (UIN item = 0; item < numItems; ++item){
+        if (clusterOf[item] == item){
+            clusterIds[item] = static_cast<UIN>(clusterOffsets.size() - 1);
+            clusterOffsets.push_back(0);
+        }
+        ++clusterOffsets[clusterIds[clusterOf[item]] + 1];
+    }
+    std::partial_sum(clusterOffsets.begin(), clusterOffsets.end(), clusterOffsets.begin());
+
+    std::vector<UIN> positions(clusterOffsets.begin(), clusterOffsets.end() - 1);
+    clusterItems.resize(numItems);
+    for (UIN item = 0; item < numItems; ++item){
+        clusterItems[positions[clusterIds[clusterOf[item]]]++] = item;
+    }
+}
+
+/**
+ * @funcitonName: encodeRows
+ * @functionInterpretation: Encodings of the rows with nonzeros, in ascending order of the dispersion of
+ * `calculateDispersion` and then of the row index, the order of the clustering on the GPU. The items are hashed for
+ * the LSH buckets if `minHashes` is not null.
+ * @output: `rows[item]` is the row of the item.
+ **/
+BlockEncodings encodeRows(const sparseMatrix::CSR<float>& matrix,
+                          const UIN blockSize,
+                          const MinHashes* minHashes,
+                          std::vector<UIN>& rows){
+    SparseEncodings rowEncodings;
+    encoding(matrix, blockSize, rowEncodings);
+    std::vector<UIN> dispersions;
+    calculateDispersion(rowEncodings, blockSize, dispersions);
+
+    std::vector<uint64_t> sortedDispersions, sortedRows;
+    for (UIN row = 0; row < matrix.row(); ++row){
+        if (rowEncodings.offsets[row + 1] > rowEncodings.offsets[row]){
+            sortedDispersions.push_back(dispersions[row]);
+            sortedRows.push_back(row);
         }
+    }
+    host::stable_sort_by_key(sortedDispersions.data(),
+                             sortedDispersions.data() + sortedDispersions.size(),
+                             sortedRows.data());
+    const UIN numItems = static_cast<UIN>(sortedRows.size());
+    rows.assign(sortedRows.begin(), sortedRows.end());
+
+    // The encodings in the order of the items, so a chunk of items is contiguous
+    BlockEncodings encodings;
+    std::vector<size_t> itemSizes(numItems);
+#pragma omp parallel for
+    for (UIN item = 0; item < numItems; ++item){
+        itemSizes[item] = rowEncodings.offsets[rows[item] + 1] - rowEncodings.offsets[rows[item]];
+    }
+    scheduler::exclusiveScan(itemSizes, encodings.offsets);
+    encodings.resize(numItems, minHashes != nullptr);
+
+#pragma omp parallel for schedule(dynamic, 1024)
+    for (UIN item = 0; item < numItems; ++item){
+        const UIN rowBegin = rowEncodings.offsets[rows[item]];
+        const UIN rowEnd = rowEncodings.offsets[rows[item] + 1];
+        std::copy(rowEncodings.blocks.begin() + rowBegin,
+                  rowEncodings.blocks.begin() + rowEnd,
+                  encodings.blocks.begin() + encodings.offsets[item]);
+        std::copy(rowEncodings.counts.begin() + rowBegin,
+                  rowEncodings.counts.begin() + rowEnd,
+                  encodings.counts.begin() + encodings.offsets[item]);
+        encodings.describe(item);
+        if (minHashes){
+            minHashes->sign(encodings, item);
+        }
+    }
+
+    return encodings;
+}
 
-        for (int t = 0; t < patterns[r].size(); t++){
-            if (patterns[r][t]){
-                score += block_size - patterns[r][t];
+/**
+ * @funcitonName: encodeClusters
+ * @functionInterpretation: Encodings of the clusters of `groupByCluster`, the encoding of a cluster is the sum of the
+ * encodings of its items. The clusters are hashed for the LSH buckets.
+ **/
+BlockEncodings encodeClusters(const BlockEncodings& items,
+                              const MinHashes& minHashes,
+                              const UIN numBlocks,
+                              const std::vector<UIN>& clusterOffsets,
+                              const std::vector<UIN>& clusterItems){
+    const UIN numClusters = static_cast<UIN>(clusterOffsets.size() - 1);
+    BlockEncodings encodings;
+    std::vector<size_t> clusterSizes(numClusters);
+
+    // Sum the encodings of the items of `cluster`, then `function(blocks)` with the blocks in ascending order
+    auto sumCluster = [&](const UIN cluster, std::vector<UIN>& counts, std::vector<UIN>& blocks, auto&& function){
+        blocks.clear();
+        for (UIN idx = clusterOffsets[cluster]; idx < clusterOffsets[cluster + 1]; ++idx){
+            const UIN item = clusterItems[idx];
+            for (size_t blockIdx = items.offsets[item]; blockIdx < items.offsets[item + 1]; ++blockIdx){
+                if (counts[items.blocks[blockIdx]] == 0){
+                    blocks.push_back(items.blocks[blockIdx]);
+                }
+                counts[items.blocks[blockIdx]] += items.counts[blockIdx];
             }
         }
+        std::sort(blocks.begin(), blocks.end());
+        function(blocks);
+        for (const UIN block : blocks){
+            counts[block] = 0;
+        }
+    };
 
-        row_queue.push(std::make_pair(-1 * (score + (float)dense_partition.size() * nnz), -1 * r));
+#pragma omp parallel
+    {
+        std::vector<UIN> counts(numBlocks, 0), blocks;
+#pragma omp for schedule(dynamic, 256)
+        for (UIN cluster = 0; cluster < numClusters; ++cluster){
+            sumCluster(cluster, counts, blocks, [&](const std::vector<UIN>& clusterBlocks){
+                clusterSizes[cluster] = clusterBlocks.size();
+            });
+        }
     }
+    scheduler::exclusiveScan(clusterSizes, encodings.offsets);
+    encodings.resize(numClusters, true);
 
-    // usleep(100000);
-    int cluster_cnt = 0;
-    while (!row_queue.empty()){
-        int current_group_size = 1;
-        int i = -1 * row_queue.top().second;
-        row_queue.pop();
-        cluster_cnt++;
-
-        row_permutation.push_back(i);
+#pragma omp parallel
+    {
+        std::vector<UIN> counts(numBlocks, 0), blocks;
+#pragma omp for schedule(dynamic, 256)
+        for (UIN cluster = 0; cluster < numClusters; ++cluster){
+            sumCluster(cluster, counts, blocks, [&](const std::vector<UIN>& clusterBlocks){
+                size_t position = encodings.offsets[cluster];
+                for (const UIN block : clusterBlocks){
+                    encodings.blocks[position] = block;
+                    encodings.counts[position] = counts[block];
+                    ++position;
+                }
+            });
+            encodings.describe(cluster);
+            minHashes.sign(encodings, cluster);
+        }
+    }
 
-        std::vector<int> pattern = patterns[i];
-        int j;
-        while (!row_queue.empty()){
-            auto j_pair = row_queue.top();
-            j = -1 * j_pair.second;
+    return encodings;
+}
 
-            row_queue.pop();
+/**
+ * @funcitonName: clusterInOrder
+ * @functionInterpretation: The clustering of `kernel::bsa_clustering` on the host. Cluster k starts at its seed and
+ * scans the later items in order, an item that is not in an earlier cluster joins it if the similarity is above alpha,
+ * and the first item it rejects is the seed of cluster k + 1. So an item is decided by the clusters in the order of
+ * their seeds, and joins the first one that takes it.
+ * The clusters run as a pipeline, one cluster on each thread: cluster k decides item i after cluster k - 1 published
+ * that it is past i, which replaces the mutex of each row on the GPU. Every decision only depends on the earlier
+ * decisions and not on the timing of the threads, so the clustering is reproducible with any number of threads.
+ * The clusters are started in the order of their seeds, so a cluster never waits for a cluster that is not running.
+ * The similarity of the items that share no block with a cluster is 0, a cluster only compares the items of the
+ * blocks that it has and rejects the others.
+ * @output: `clusterOf[item]` is the first item of the cluster of the item. Return the number of clusters.
+ **/
+UIN clusterInOrder(const BlockEncodings& encodings,
+                   const UIN numBlocks,
+                   const float alpha,
+                   std::vector<UIN>& clusterOf){
+    const UIN numItems = encodings.numItems();
+    if (numItems == 0 || alpha < 0.0f){
+        // Every similarity is above a negative alpha, the first cluster takes all the items
+        clusterOf.assign(numItems, 0);
+        return numItems > 0 ? 1 : 0;
+    }
 
-            std::vector<int> B_pattern = patterns[j];
+    // The items of each block in ascending order
+    std::vector<size_t> blockItemOffsets(static_cast<size_t>(numBlocks) + 1, 0);
+    for (size_t idx = 0; idx < encodings.blocks.size(); ++idx){
+        ++blockItemOffsets[encodings.blocks[idx] + 1];
+    }
+    std::partial_sum(blockItemOffsets.begin(), blockItemOffsets.end(), blockItemOffsets.begin());
+    std::vector<UIN> blockItems(encodings.blocks.size());
+    {
+        std::vector<size_t> positions(blockItemOffsets.begin(), blockItemOffsets.end() - 1);
+        for (UIN item = 0; item < numItems; ++item){
+            for (size_t idx = encodings.offsets[item]; idx < encodings.offsets[item + 1]; ++idx){
+                blockItems[positions[encodings.blocks[idx]]++] = item;
+            }
+        }
+    }
 
-            float sim = normalized_weighted_jaccard_sim(pattern, B_pattern, current_group_size, block_size);
+    // An item is claimed by one cluster. `progress[k]`: the clusters up to k decided the items before it.
+    // `seeds[k]` and `progress[k]` are written before `numClusters` counts cluster k
+    std::unique_ptr<std::atomic<UIN>[]> claims(new std::atomic<UIN>[numItems]);
+    for (UIN item = 0; item < numItems; ++item){
+        claims[item].store(NULL_VALUE, std::memory_order_relaxed);
+    }
+    std::vector<UIN> seeds(numItems);
+    std::unique_ptr<std::atomic<UIN>[]> progress(new std::atomic<UIN>[numItems]);
+    std::atomic<UIN> numClusters(1), numStartedClusters(0), numFinishedClusters(0);
+    seeds[0] = 0;
+    progress[0].store(0, std::memory_order_relaxed);
+
+    auto waitFor = [](const std::atomic<UIN>& value, const UIN item){
+        for (UIN spin = 0; value.load(std::memory_order_acquire) <= item; ++spin){
+            if (spin >= 64){
+                std::this_thread::yield();
+            }
+        }
+    };
+
+    // Cluster `cluster` on a thread. `queuedBy[item]` is the last cluster of the thread that queued the item
+    auto runCluster = [&](const UIN cluster,
+                          ClusterRepresentative& representative,
+                          std::vector<UIN>& queuedBy,
+                          std::priority_queue<UIN, std::vector<UIN>, std::greater<UIN>>& candidates){
+        const UIN seed = seeds[cluster];
+
+        // Queue the later items of the blocks that the item brings into the cluster
+        auto addItem = [&](const UIN item){
+            for (size_t idx = encodings.offsets[item]; idx < encodings.offsets[item + 1]; ++idx){
+                const UIN block = encodings.blocks[idx];
+                if (representative.count(block) > 0){
+                    continue;
+                }
+                const UIN* itemsBegin = blockItems.data() + blockItemOffsets[block];
+                const UIN* itemsEnd = blockItems.data() + blockItemOffsets[block + 1];
+                for (const UIN* candidate = std::upper_bound(itemsBegin, itemsEnd, item);
+                     candidate < itemsEnd; ++candidate){
+                    if (queuedBy[*candidate] != cluster
+                        && claims[*candidate].load(std::memory_order_relaxed) == NULL_VALUE){
+                        queuedBy[*candidate] = cluster;
+                        candidates.push(*candidate);
+                    }
+                }
+            }
+            representative.add(encodings, item);
+        };
+
+        // The items before `end` that are not queued are rejected, the first one that is not claimed either is the
+        // seed of the next cluster
+        UIN nextSeedSearch = seed + 1;
+        bool isNextClusterCreated = false;
+        auto searchNextSeed = [&](const UIN end){
+            for (; !isNextClusterCreated && nextSeedSearch < end; ++nextSeedSearch){
+                if (cluster > 0){
+                    waitFor(progress[cluster - 1], nextSeedSearch);
+                }
+                if (claims[nextSeedSearch].load(std::memory_order_relaxed) == NULL_VALUE){
+                    seeds[cluster + 1] = nextSeedSearch;
+                    progress[cluster + 1].store(0, std::memory_order_relaxed);
+                    numClusters.store(cluster + 2, std::memory_order_release);
+                    isNextClusterCreated = true;
+                }
+            }
+        };
+
+        claims[seed].store(seed, std::memory_order_relaxed);
+        addItem(seed);
+        while (!candidates.empty()){
+            const UIN item = candidates.top();
+            candidates.pop();
+            searchNextSeed(item);
+            if (cluster > 0){
+                waitFor(progress[cluster - 1], item);
+            }
+            progress[cluster].store(item, std::memory_order_release);
+            if (claims[item].load(std::memory_order_relaxed) == NULL_VALUE
+                && representative.similarity(encodings, item) > alpha){
+                claims[item].store(seed, std::memory_order_relaxed);
+                addItem(item);
+            }
+        }
+        searchNextSeed(numItems);
+        if (cluster > 0){
+            waitFor(progress[cluster - 1], numItems - 1);
+        }
+        progress[cluster].store(numItems, std::memory_order_release);
+        representative.clear();
+    };
 
-            if (sim <= similarity_threshold_alpha){
-                inner_queue.push(j_pair);
+#pragma omp parallel
+    {
+        ClusterRepresentative representative(numBlocks);
+        std::vector<UIN> queuedBy(numItems, NULL_VALUE);
+        std::priority_queue<UIN, std::vector<UIN>, std::greater<UIN>> candidates;
+        while (true){
+            // A cluster is created before its creator finishes, so it is counted if the finished clusters are
+            const UIN numFinished = numFinishedClusters.load(std::memory_order_acquire);
+            const UIN numCreated = numClusters.load(std::memory_order_acquire);
+            if (numFinished == numCreated){
+                break;
             }
-            else{
-                row_permutation.push_back(j);
-                pattern = merge_rows(pattern, B_pattern);
-                current_group_size++;
+            UIN cluster = numStartedClusters.load(std::memory_order_relaxed);
+            if (cluster == numCreated
+                || !numStartedClusters.compare_exchange_weak(cluster, cluster + 1, std::memory_order_acq_rel)){
+                std::this_thread::yield();
+                continue;
             }
+            runCluster(cluster, representative, queuedBy, candidates);
+            numFinishedClusters.fetch_add(1, std::memory_order_acq_rel);
         }
+    }
 
-        inner_queue.swap(row_queue);
+    clusterOf.resize(numItems);
+    for (UIN item = 0; item < numItems; ++item){
+        clusterOf[item] = claims[item].load(std::memory_order_relaxed);
     }
 
-    // Remove zero rows
-    {
-        UIN startIndexOfNonZeroRow = 0;
-        while (startIndexOfNonZeroRow < row_permutation.size()
-            && matrix.rowOffsets()[row_permutation[startIndexOfNonZeroRow] + 1]
-            - matrix.rowOffsets()[row_permutation[startIndexOfNonZeroRow]] == 0){
-            ++startIndexOfNonZeroRow;
+    return numClusters.load(std::memory_order_acquire);
+}
+} // namespace
+
+std::vector<UIN> bsa_rowReordering_cpu(const sparseMatrix::CSR<float>& matrix,
+                                       const float alpha,
+                                       const UIN block_size,
+                                       int& num_clusters,
+                                       float& reordering_time){
+    const auto startTime = std::chrono::steady_clock::now();
+    const UIN numBlocks = (matrix.col() + block_size - 1) / block_size;
+
+    const MinHashes minHashes(numBlocks, alpha);
+    std::vector<UIN> rows;
+    const BlockEncodings rowEncodings = encodeRows(matrix, block_size, &minHashes, rows);
+
+    // The clusters of the rows in each chunk
+    std::vector<UIN> clusterOf, clusterOffsets, clusterRows;
+    clusterItems(rowEncodings, minHashes, numBlocks, alpha, clusteringChunkSize, clusterOf);
+    groupByCluster(clusterOf, clusterOffsets, clusterRows);
+
+    // Merge the clusters of all the chunks: the clusters are clustered again by the sums of the encodings of their
+    // rows. A pass over all the clusters in one chunk is the last one, otherwise the passes are repeated until no two
+    // clusters merge, with the chunks shifted by half a chunk on every other pass so the clusters on both sides of a
+    // chunk boundary meet
+    for (UIN pass = 0; pass < maxNumMergePasses && clusterOffsets.size() > 2; ++pass){
+        const BlockEncodings clusterEncodings =
+            encodeClusters(rowEncodings, minHashes, numBlocks, clusterOffsets, clusterRows);
+        std::vector<UIN> mergedOffsets, mergedClusters;
+        const UIN numChunks = clusterItems(clusterEncodings, minHashes, numBlocks, alpha,
+                                           pass % 2 == 0 ? clusteringChunkSize : clusteringChunkSize / 2, clusterOf);
+        groupByCluster(clusterOf, mergedOffsets, mergedClusters);
+        if (mergedOffsets.size() == clusterOffsets.size()){
+            break;
+        }
+
+        // The rows of a merged cluster are the rows of its clusters in the order of the clusters
+        std::vector<UIN> mergedRowOffsets{0}, mergedRows;
+        mergedRows.reserve(clusterRows.size());
+        for (UIN merged = 0; merged + 1 < mergedOffsets.size(); ++merged){
+            for (UIN idx = mergedOffsets[merged]; idx < mergedOffsets[merged + 1]; ++idx){
+                const UIN cluster = mergedClusters[idx];
+                mergedRows.insert(mergedRows.end(),
+                                  clusterRows.begin() + clusterOffsets[cluster],
+                                  clusterRows.begin() + clusterOffsets[cluster + 1]);
+            }
+            mergedRowOffsets.push_back(static_cast<UIN>(mergedRows.size()));
+        }
+        clusterOffsets.swap(mergedRowOffsets);
+        clusterRows.swap(mergedRows);
+        if (numChunks == 1){
+            break;
         }
-        row_permutation.erase(row_permutation.begin(), row_permutation.begin() + startIndexOfNonZeroRow);
     }
 
-    timeCalculator.endClock();
-    reordering_time = timeCalculator.getTime();
-    std::cout << reordering_time << "ms" << std::endl;
+    std::vector<UIN> row_permutation(clusterRows.size());
+    for (size_t idx = 0; idx < clusterRows.size(); ++idx){
+        row_permutation[idx] = rows[clusterRows[idx]];
+    }
+
+    // The zero rows are one cluster on the GPU
+    num_clusters = static_cast<int>(clusterOffsets.size() - 1) + (rows.size() < matrix.row() ? 1 : 0);
+
+    reordering_time = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+
+    return row_permutation;
+}
+
+std::vector<UIN> bsa_rowReordering_cpu_exact(const sparseMatrix::CSR<float>& matrix,
+                                             const float alpha,
+                                             const UIN block_size,
+                                             int& num_clusters,
+                                             float& reordering_time){
+    const auto startTime = std::chrono::steady_clock::now();
+    const UIN numBlocks = (matrix.col() + block_size - 1) / block_size;
+
+    std::vector<UIN> rows;
+    const BlockEncodings rowEncodings = encodeRows(matrix, block_size, nullptr, rows);
+
+    std::vector<UIN> clusterOf, clusterOffsets, clusterRows;
+    clusterInOrder(rowEncodings, numBlocks, alpha, clusterOf);
+    groupByCluster(clusterOf, clusterOffsets, clusterRows);
+
+    std::vector<UIN> row_permutation(clusterRows.size());
+    for (size_t idx = 0; idx < clusterRows.size(); ++idx){
+        row_permutation[idx] = rows[clusterRows[idx]];
+    }
+
+    // The zero rows are one cluster on the GPU
+    num_clusters = static_cast<int>(clusterOffsets.size() - 1) + (rows.size() < matrix.row() ? 1 : 0);
+
+    reordering_time = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - startTime).count();
 
     return row_permutation;
 }
 
 std::vector<UIN> get_permutation_gpu(const sparseMatrix::CSR<float>& mat,
                                      std::vector<int> ascending_idx,
-                                     const dev::vector<UIN>& Encodings,
+                                     const SparseEncodings& Encodings,
                                      const std::vector<UIN>& Dispersions,
                                      int num_blocks_per_row,
                                      float alpha,
@@ -907,6 +1610,9 @@ std::vector<UIN> get_permutation_gpu(const sparseMatrix::CSR<float>& mat,
     cudaDeviceSynchronize();
 
     dev::vector<int> ascending_idx_gpu(ascending_idx);
+    dev::vector<UIN> encoding_offsets_gpu(Encodings.offsets);
+    dev::vector<UIN> encoding_blocks_gpu(Encodings.blocks);
+    dev::vector<UIN> encoding_counts_gpu(Encodings.counts);
 
     int blockdim;
     if (num_blocks_per_row < 32){
@@ -960,7 +1666,9 @@ std::vector<UIN> get_permutation_gpu(const sparseMatrix::CSR<float>& mat,
     start_idx_to_launch[0] = zero_row_idx;
 
     do{
-        kernel::bsa_clustering<<<grid, blockdim, shm_size, initial_stream>>>(Encodings.data(),
+        kernel::bsa_clustering<<<grid, blockdim, shm_size, initial_stream>>>(encoding_offsets_gpu.data(),
+                                                                             encoding_blocks_gpu.data(),
+                                                                             encoding_counts_gpu.data(),
                                                                              cluster_id_to_launch[0],
                                                                              ascending_idx_gpu.data(),
                                                                              cluster_ids_gpu.data(),
@@ -987,7 +1695,8 @@ std::vector<UIN> get_permutation_gpu(const sparseMatrix::CSR<float>& mat,
 
     std::vector<UIN> indices(mat.row());
     host::sequence(indices.data(), indices.data() + indices.size(), 0);
-    host::sort_by_key(cluster_ids.data(), cluster_ids.data() + cluster_ids.size(), indices.data());
+    // Stable, the rows of a cluster stay in the order of the clustering, so the permutation is the same on every run
+    host::stable_sort_by_key(cluster_ids.data(), cluster_ids.data() + cluster_ids.size(), indices.data());
 
     std::vector<UIN> permutation(mat.row());
     for (int i = 0; i < mat.row(); i++){
@@ -1006,22 +1715,14 @@ std::vector<UIN> get_permutation_gpu(const sparseMatrix::CSR<float>& mat,
     return permutation;
 }
 
+// The encodings are sparse, only the dense representative of a cluster in shared memory bounds the block size
 UIN calculateBlockSize(const sparseMatrix::CSR<float>& matrix){
-    size_t freeMem = 0;
-    size_t totalMem = 0;
-    cudaMemGetInfo(&freeMem, &totalMem);
-
-    const UIN minBlockSizeDueToGMEM =
-        std::ceil(
-            (static_cast<size_t>(matrix.row()) * matrix.row()) * sizeof(UIN) / static_cast<float>(freeMem / 2));
     const UIN minBlockSizeDueToSMEM =
         std::ceil(
             (static_cast<size_t>(matrix.col()) * sizeof(UIN)) / static_cast<float>(maxSharedMemoryPerBlock / 2));
-    // printf("minBlockSizeDueToGMEM : %d, minBlockSizeDueToSMEM : %d\n", minBlockSizeDueToGMEM, minBlockSizeDueToSMEM);
-
-    UIN blockSize = std::max(minBlockSizeDueToGMEM, minBlockSizeDueToSMEM);
+    // printf("minBlockSizeDueToSMEM : %d\n", minBlockSizeDueToSMEM);
 
-    return blockSize > 16 ? blockSize : 16;
+    return minBlockSizeDueToSMEM > 16 ? minBlockSizeDueToSMEM : 16;
 }
 
 std::vector<UIN> bsa_rowReordering_gpu(const sparseMatrix::CSR<float>& matrix,
@@ -1035,31 +1736,24 @@ std::vector<UIN> bsa_rowReordering_gpu(const sparseMatrix::CSR<float>& matrix,
     const int num_blocks_per_row = ceil((float)matrix.col() / (float)block_size);
     // printf("num_blocks_per_row = %d\n", num_blocks_per_row);
 
-    /*prepare resources -start*/
-    dev::vector<UIN> Encodings_gpu(static_cast<size_t>(num_blocks_per_row) * matrix.row(), 0);
-    dev::vector<UIN> Dispersions_gpu(matrix.row(), 0);
-    /*prepare resources -done*/
-
     CudaTimeCalculator timeCalculator;
 
     timeCalculator.startClock();
-    calculateDispersion(matrix,
-                        Encodings_gpu,
-                        Dispersions_gpu,
-                        num_blocks_per_row,
-                        block_size);
+    SparseEncodings Encodings;
+    encoding(matrix, block_size, Encodings);
+    std::vector<UIN> Dispersions;
+    calculateDispersion(Encodings, block_size, Dispersions);
     timeCalculator.endClock();
     const float calculateDispersion_time = timeCalculator.getTime();
     // printf("calculateDispersion_time = %f ms\n", calculateDispersion_time);
 
-    std::vector<UIN> Dispersions = d2h(Dispersions_gpu);
-
     std::vector<UIN> DispersionsTmp = Dispersions;
 
     timeCalculator.startClock();
     std::vector<int> ascending(matrix.row());
     host::sequence(ascending.data(), ascending.data() + ascending.size(), 0);
-    host::sort_by_key(DispersionsTmp.data(), DispersionsTmp.data() + DispersionsTmp.size(), ascending.data());
+    // Stable, the rows with the same dispersion are clustered in the order of their index, as on the CPU
+    host::stable_sort_by_key(DispersionsTmp.data(), DispersionsTmp.data() + DispersionsTmp.size(), ascending.data());
     timeCalculator.endClock();
     const float sort_ascending_time = timeCalculator.getTime();
     // printf("sort_ascending_time = %f ms\n", sort_ascending_time);
@@ -1068,7 +1762,7 @@ std::vector<UIN> bsa_rowReordering_gpu(const sparseMatrix::CSR<float>& matrix,
 
     row_permutation = get_permutation_gpu(matrix,
                                           ascending,
-                                          Encodings_gpu,
+                                          Encodings,
                                           Dispersions,
                                           num_blocks_per_row,
                                           alpha,
@@ -1,40 +1,182 @@
+#include <cmath>
+#include <memory>
+
 #include "BSMR.hpp"
 #include "checkData.hpp"
+#include "cpuKernel.hpp"
 #include "host.hpp"
+#include "precision.hpp"
 #include "sddmm.hpp"
 #include "sddmmKernel.cuh"
 
 // #define VALIDATE
 
+namespace{
+// The read-only view of a result, for the checks
+sparseMatrix::CsrView<const float> asConst(const sparseMatrix::CsrView<float>& matrix){
+    return {matrix.row, matrix.col, matrix.nnz, matrix.rowOffsets, matrix.colIndices, matrix.values};
+}
+
+// The cpu sddmm with A and B rounded to T, checked against fp32 with the error bound of T
+template<typename T>
+void sddmm_cpu_precision(const MatrixView<const float>& matrixA,
+                         const MatrixView<const float>& matrixB,
+                         const RPHM& rphm,
+                         const sparseMatrix::CsrView<float>& matrixP,
+                         Logger& logger){
+    sddmm_cpu(convertTo<T>(matrixA).view(), convertTo<T>(matrixB).view(), rphm, matrixP, logger);
+    logger.matrixA_type_ = precision::Traits<T>::name;
+    logger.matrixB_type_ = precision::Traits<T>::name;
+
+    size_t numError = 0;
+    if (!checkSddmmPrecision<T>(matrixA, matrixB, asConst(matrixP), numError)){
+        logger.errorRate_ = static_cast<float>(numError) / static_cast<float>(matrixP.nnz) * 100;
+    }
+}
+} // namespace
+
 // Reordering method
 void sddmm(const Options& options,
            const Matrix<float>& matrixA,
            const Matrix<float>& matrixB,
            sparseMatrix::CSR<float>& matrixP,
            Logger& logger){
-    // Reordering
-    BSMR bsmr(options.similarityThresholdAlpha(),
-              options.blockDensityThresholdDelta(),
-              matrixP,
-              1);
+    matrixP.setValues().resize(matrixP.nnz());
+    sddmm(options, matrixA.view(), matrixB.view(), matrixP.view(matrixP.setValues().data()), logger);
+}
+
+void sddmm(const Options& options,
+           const Matrix<float>& matrixA,
+           const Matrix<float>& matrixB,
+           const sparseMatrix::CSR<float>& matrixS,
+           std::vector<float>& valuesP,
+           Logger& logger){
+    valuesP.resize(matrixS.nnz());
+    sddmm(options, matrixA.view(), matrixB.view(), matrixS.view(valuesP.data()), logger);
+}
+
+void sddmm(const Options& options,
+           const MatrixView<const float>& matrixA,
+           const MatrixView<const float>& matrixB,
+           const sparseMatrix::CsrView<float>& matrixP,
+           Logger& logger){
+    // The structure of P in place, for the reordering and the tiling
+    const sparseMatrix::CSR<float> matrixS = sparseMatrix::CSR<float>::borrowStructure(matrixP);
+
+    // Reordering, reuse the result of an earlier run with the same structure, alpha, delta and engine if cached
+    std::unique_ptr<ReorderingCache> reorderingCache;
+    if (!options.reorderingCacheDirectory().empty()){
+        reorderingCache = std::make_unique<ReorderingCache>(options.reorderingCacheDirectory(),
+                                                            options.reorderingCacheSizeMB() << 20);
+    }
+    RowReorderingEngine rowReorderingEngine = RowReorderingEngine::gpu;
+    if (options.rowReorderingEngine() == "cpu"){
+        rowReorderingEngine = RowReorderingEngine::cpu;
+    }
+    else if (options.rowReorderingEngine() == "cpu_exact"){
+        rowReorderingEngine = RowReorderingEngine::cpu_exact;
+    }
+    else if (options.rowReorderingEngine() != "gpu"){
+        std::cerr << "Warning, row reordering engine " << options.rowReorderingEngine()
+            << " is not supported, gpu is used" << std::endl;
+    }
+
+    // Tiling on the host, use the prebuilt tiling file if it matches the matrix and the reordering parameters, then
+    // the reordering is recovered from the tiling instead of calculated. Otherwise reorder, build the tiling and save
+    // it. Only the gpu backend copies the tiling to the device
+    BSMR bsmr;
+    std::unique_ptr<RPHM> rphm = std::make_unique<RPHM>();
+    const std::string rphmFile = options.rphmFile();
+    if (!rphmFile.empty() && util::fileExists(rphmFile)
+        && rphm->initializeFromBinaryFile(rphmFile,
+                                          matrixS,
+                                          options.similarityThresholdAlpha(),
+                                          options.blockDensityThresholdDelta(),
+                                          rowReorderingEngine)){
+        bsmr = BSMR(matrixS, *rphm);
+    }
+    else{
+        bsmr = BSMR(options.similarityThresholdAlpha(),
+                    options.blockDensityThresholdDelta(),
+                    matrixS,
+                    1,
+                    reorderingCache.get(),
+                    rowReorderingEngine);
+        rphm = std::make_unique<RPHM>(matrixS, bsmr);
+        if (!rphmFile.empty()){
+            rphm->outputToBinaryFile(rphmFile, matrixS);
+        }
+    }
+    logger.rowReorderingEngine_ = toString(rowReorderingEngine);
     logger.rowReorderingTime_ = bsmr.rowReorderingTime();
     logger.colReorderingTime_ = bsmr.colReorderingTime();
     logger.reorderingTime_ = bsmr.reorderingTime();
     logger.numRowPanels_ = bsmr.numRowPanels();
     logger.numClusters_ = bsmr.numClusters();
+    logger.isReorderingCacheHit_ = bsmr.isLoadedFromCache();
+    logger.savedReorderingTime_ = bsmr.savedReorderingTime();
+
+    // sddmm comp by gpu, or by cpu with the same tiling
+    logger.backend_ = options.backend();
+    if (options.precision() != "fp32" && (options.backend() != "cpu" ||
+        (options.precision() != "fp16" && options.precision() != "bf16" && options.precision() != "int8"))){
+        std::cerr << "Warning, precision " << options.precision() << " is not supported by the " << options.backend()
+            << " backend, fp32 is used" << std::endl;
+    }
+    if (options.backend() == "cpu"){
+        logger.cpuIsa_ = cpu::getIsaName(cpu::getIsa());
+        if (options.precision() == "fp16"){
+            sddmm_cpu_precision<__half>(matrixA, matrixB, *rphm, matrixP, logger);
+        }
+        else if (options.precision() == "bf16"){
+            sddmm_cpu_precision<__nv_bfloat16>(matrixA, matrixB, *rphm, matrixP, logger);
+        }
+        else if (options.precision() == "int8"){
+            // Quantization errors are not bounded per value, the accuracy is the relative error of P
+            sddmm_cpu_int8(matrixA, matrixB, *rphm, matrixP, logger);
+            logger.matrixA_type_ = "int8";
+            logger.matrixB_type_ = "int8";
+            logger.relativeError_ = sddmmRelativeError(matrixA, matrixB, asConst(matrixP));
+        }
+        else{
+            sddmm_cpu(matrixA, matrixB, *rphm, matrixP, logger);
+        }
+    }
+    else{
+        sddmm_gpu(matrixA, matrixB, *rphm, matrixP, logger);
+    }
 
-    // Device data
-    RPHM rphm(matrixP, bsmr);
+    // Batched sddmm of several heads over the same tiling, the heads are random
+    if (options.numHeads() > 1){
+        const UIN numHeads = options.numHeads();
+        Matrix<float> matrixA_heads(numHeads * matrixP.row, matrixA.col, MatrixStorageOrder::row_major);
+        matrixA_heads.makeData();
+        Matrix<float> matrixB_heads(matrixB.row, numHeads * matrixP.col, MatrixStorageOrder::col_major);
+        matrixB_heads.makeData();
+        std::vector<float> matrixP_heads;
+        if (options.backend() == "cpu"){
+            sddmm_cpu_batch(numHeads, matrixA_heads, matrixB_heads, *rphm, matrixS, matrixP_heads, logger);
+        }
+        else{
+            sddmm_gpu_batch(numHeads, matrixA_heads, matrixB_heads, *rphm, matrixS, matrixP_heads, logger);
+        }
+    }
 
-    // sddmm comp by gpu
-    sddmm_gpu(matrixA, matrixB, rphm, matrixP, logger);
+    // Fused attention on the cpu with the same tiling, S is a 0/1 mask and V is random
+    if (options.attentionDim() > 0){
+        Matrix<float> matrixV(matrixP.col, options.attentionDim(), MatrixStorageOrder::row_major);
+        matrixV.makeData();
+        Matrix<float> matrixO(matrixP.row, options.attentionDim(), MatrixStorageOrder::row_major);
+        attention_cpu(matrixA, matrixB, matrixV, *rphm, nullptr, 1.0f / std::sqrt(static_cast<float>(matrixA.col)),
+                      matrixO, logger);
+    }
 
-    evaluationReordering(matrixP, bsmr, logger);
+    evaluationReordering(matrixS, bsmr, logger);
 
     // Error check
 #ifdef VALIDATE
-    check_rphm(matrixP, bsmr, rphm, options.blockDensityThresholdDelta());
-    checkSddmm(matrixA, matrixB, matrixP, matrixP);
+    check_rphm(matrixS, bsmr, *rphm, options.blockDensityThresholdDelta());
+    checkSddmm(matrixA, matrixB, asConst(matrixP));
 #endif
 }
 
@@ -42,16 +184,28 @@ bool checkSddmm(const Matrix<float>& matrixA,
                 const Matrix<float>& matrixB,
                 const sparseMatrix::CSR<float>& matrixS,
                 const sparseMatrix::CSR<float>& matrixP){
+    if (matrixP.values().size() != matrixS.nnz()){
+        std::cerr << "The number of values does not match the sparse matrix" << std::endl;
+        return false;
+    }
+    return checkSddmm(matrixA.view(), matrixB.view(), matrixS.view(matrixP.values().data()));
+}
+
+bool checkSddmm(const MatrixView<const float>& matrixA,
+                const MatrixView<const float>& matrixB,
+                const sparseMatrix::CsrView<const float>& matrixP){
     // sddmm comp by cpu
-    sparseMatrix::CSR<MATRIX_C_TYPE> matrixP_cpu_res(matrixS);
-    sddmm_cpu(matrixA, matrixB, matrixS, matrixP_cpu_res);
+    std::vector<MATRIX_C_TYPE> values_cpu_res(matrixP.nnz);
+    sddmm_cpu(matrixA, matrixB, sparseMatrix::CsrView<MATRIX_C_TYPE>{matrixP.row, matrixP.col, matrixP.nnz,
+                                                                    matrixP.rowOffsets, matrixP.colIndices,
+                                                                    values_cpu_res.data()});
 
     // Error check
     printf("check cpu sddmm and BSMR sddmm: \n");
     size_t numError = 0;
-    if (!checkData(matrixP_cpu_res.values(), matrixP.values(), numError)){
+    if (!checkDataFunction(values_cpu_res.size(), values_cpu_res.data(), matrixP.values, numError)){
         printf("[checkData : NO PASS Error rate : %2.2f%%]\n",
-               static_cast<float>(numError) / static_cast<float>(matrixP.values().size()) * 100);
+               static_cast<float>(numError) / static_cast<float>(matrixP.nnz) * 100);
         return false;
     }
 
@@ -60,33 +214,36 @@ bool checkSddmm(const Matrix<float>& matrixA,
 
 
 void sddmm_testMode(const Options& options,
-                    sparseMatrix::CSR<float>& matrixP){
+                    const sparseMatrix::CSR<float>& matrixS){
     std::vector<float> similarityThresholdAlpha = {0.1f, 0.3f, 0.5f, 0.7f, 0.9f};
     std::vector<float> blockDensityThresholdDelta = {0.0f, 0.1f, 0.3f, 0.5f, 0.7f, 0.9f, 1.1f};
     std::vector<UIN> K = {32, 64, 128, 256};
 
     BSMR bsmr;
 
+    // The values of P, the structure is the one of S
+    std::vector<float> valuesP(matrixS.nnz());
+
     for (const auto& alpha : similarityThresholdAlpha){
-        bsmr.rowReordering(alpha, matrixP);
+        bsmr.rowReordering(alpha, matrixS);
         for (const auto& delta : blockDensityThresholdDelta){
             for (const auto& k : K){
-                Matrix<float> matrixA(matrixP.row(), k, MatrixStorageOrder::row_major);
+                Matrix<float> matrixA(matrixS.row(), k, MatrixStorageOrder::row_major);
                 matrixA.makeData();
 
-                Matrix<float> matrixB(k, matrixP.col(), MatrixStorageOrder::col_major);
+                Matrix<float> matrixB(k, matrixS.col(), MatrixStorageOrder::col_major);
                 matrixB.makeData();
 
                 // Result information logger
                 Logger logger;
                 logger.getInformation(options);
-                logger.getInformation(matrixP);
+                logger.getInformation(matrixS);
                 logger.getInformation(matrixA, matrixB);
                 logger.alpha_ = alpha;
                 logger.delta_ = delta;
 
                 // Reordering
-                bsmr.colReordering(delta, matrixP);
+                bsmr.colReordering(delta, matrixS);
                 logger.rowReorderingTime_ = bsmr.rowReorderingTime();
                 logger.colReorderingTime_ = bsmr.colReorderingTime();
                 logger.reorderingTime_ = bsmr.reorderingTime();
@@ -94,12 +251,12 @@ void sddmm_testMode(const Options& options,
                 logger.numClusters_ = bsmr.numClusters();
 
                 // Device data
-                RPHM rphm(matrixP, bsmr);
+                RPHM rphm(matrixS, bsmr);
 
                 // sddmm comp by gpu
-                sddmm_gpu(matrixA, matrixB, rphm, matrixP, logger);
+                sddmm_gpu(matrixA.view(), matrixB.view(), rphm, matrixS.view(valuesP.data()), logger);
 
-                evaluationReordering(matrixP, bsmr, logger);
+                evaluationReordering(matrixS, bsmr, logger);
 
                 const std::string logFile = options.outputLogDirectory() + "BSMR_" +
                     "k_" + util::to_trimmed_string(k) + "_" +
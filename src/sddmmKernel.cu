@@ -2520,21 +2520,36 @@ void sddmm_gpu(const Matrix<float>& matrixA,
                const RPHM& rphm,
                sparseMatrix::CSR<float>& matrixP,
                Logger& logger){
-    dev::vector<float> matrixA_dev(matrixA.values());
-    dev::vector<float> matrixB_dev(matrixB.values());
-    dev::vector<float> matrixP_dev(matrixP.nnz(), 0);
+    matrixP.setValues().resize(matrixP.nnz());
+    sddmm_gpu(matrixA.view(), matrixB.view(), rphm, matrixP.view(matrixP.setValues().data()), logger);
+}
 
-    if (matrixA.col() <= 32){
-        sddmm_gpu_k32(matrixP.row(), matrixP.col(), matrixA.col(), matrixA_dev.data(),
+void sddmm_gpu(const MatrixView<const float>& matrixA,
+               const MatrixView<const float>& matrixB,
+               const RPHM& rphm,
+               const sparseMatrix::CsrView<float>& matrixP,
+               Logger& logger){
+    if (!matrixA.isPacked() || !matrixB.isPacked()){
+        std::cerr << "Error, the GPU SDDMM needs A and B without padding" << std::endl;
+        return;
+    }
+    dev::vector<float> matrixA_dev(matrixA.size());
+    h2d(matrixA_dev.data(), matrixA.data, matrixA.size());
+    dev::vector<float> matrixB_dev(matrixB.size());
+    h2d(matrixB_dev.data(), matrixB.data, matrixB.size());
+    dev::vector<float> matrixP_dev(matrixP.nnz, 0);
+
+    if (matrixA.col <= 32){
+        sddmm_gpu_k32(matrixP.row, matrixP.col, matrixA.col, matrixA_dev.data(),
                       matrixB_dev.data(), rphm, matrixP_dev.data(), logger);
     }
     else{
-        sddmm_gpu(matrixP.row(), matrixP.col(), matrixA.col(), matrixA_dev.data(),
+        sddmm_gpu(matrixP.row, matrixP.col, matrixA.col, matrixA_dev.data(),
                   matrixB_dev.data(), rphm, matrixP_dev.data(), logger);
     }
 
-    // Copy the results from the device to the host
-    matrixP.setValues() = d2h(matrixP_dev);
+    // Copy the results from the device to the values of the caller
+    d2h(matrixP.values, matrixP_dev.data(), matrixP.nnz);
 }
 
 void sddmm_gpu(UIN M,
@@ -2558,6 +2573,9 @@ void sddmm_gpu(UIN M,
     cudaStreamCreate(&denseStream);
     cudaStreamCreate(&sparseStream);
 
+    // Upload the tiling before the clock starts
+    rphm.copyToDevice();
+
     CudaTimeCalculator totalTimeCalculator;
 
     totalTimeCalculator.startClock();
@@ -2683,6 +2701,9 @@ void sddmm_gpu_k32(UIN M,
     cudaStreamCreate(&denseStream);
     cudaStreamCreate(&sparseStream);
 
+    // Upload the tiling before the clock starts
+    rphm.copyToDevice();
+
     CudaTimeCalculator totalTimeCalculator;
 
     totalTimeCalculator.startClock();
@@ -2761,6 +2782,28 @@ void sddmm_gpu_k32(UIN M,
     cudaStreamDestroy(sparseStream);
 }
 
+void sddmm_gpu_batch(const UIN numHeads,
+                     const Matrix<float>& matrixA,
+                     const Matrix<float>& matrixB,
+                     const RPHM& rphm,
+                     const sparseMatrix::CSR<float>& matrixS,
+                     std::vector<float>& matrixP,
+                     Logger& logger){
+    dev::vector<float> matrixA_dev(matrixA.values());
+    dev::vector<float> matrixB_dev(matrixB.values());
+    dev::vector<float> matrixP_dev(static_cast<size_t>(numHeads) * matrixS.nnz(), 0);
+
+    float time = 0.0f;
+    sddmm_gpu_batch(numHeads, matrixS.row(), matrixS.col(), matrixA.col(), matrixS.nnz(),
+                    matrixA_dev.data(), matrixB_dev.data(), rphm, matrixP_dev.data(), time);
+
+    // Copy the results from the device to the host
+    matrixP = d2h(matrixP_dev);
+
+    logger.numHeads_ = numHeads;
+    logger.batchTime_ = time;
+}
+
 void sddmm_gpu_batch(const UIN numBatch,
                      const UIN M,
                      const UIN N,
@@ -2800,6 +2843,9 @@ void sddmm_gpu_batch(const UIN numBatch,
            grid_sparse.x, grid_sparse.y, grid_sparse.z, block_sparse.x,
            block_sparse.y, block_sparse.z);
 
+    // Upload the tiling before the clock starts
+    rphm.copyToDevice();
+
     CudaTimeCalculator totalTimeCalculator, denseKernelTimeCalculator,
                        sparseKernelTimeCalculator;
 
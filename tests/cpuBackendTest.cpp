@@ -0,0 +1,85 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "BSMR.hpp"
+#include "Logger.hpp"
+#include "Matrix.hpp"
+#include "Options.hpp"
+#include "checkData.hpp"
+#include "host.hpp"
+#include "sddmm.hpp"
+
+// The cpu backend with the BSMR tiling, run without a device (CUDA_VISIBLE_DEVICES is empty in ctest).
+// The tiling must stay on the host and the results must match the cpu sddmm without the tiling.
+namespace{
+bool check(const bool condition, const char* message){
+    if (!condition){
+        fprintf(stderr, "[cpuBackendTest : NO PASS] %s\n", message);
+    }
+    return condition;
+}
+} // namespace
+
+int main(int argc, char* argv[]){
+    const std::string rphmFile = argc > 1 ? argv[1] : "cpuBackendTest.rphm";
+    constexpr float alpha = 0.3f;
+    constexpr float delta = 0.1f;
+    constexpr UIN K = 32;
+
+    sparseMatrix::COO<float> matrixCoo;
+    matrixCoo.makeData(500, 300, 15000);
+    const sparseMatrix::CSR<float> matrixS = matrixCoo.getCsrData();
+
+    Matrix<float> matrixA(matrixS.row(), K, MatrixStorageOrder::row_major);
+    matrixA.makeData();
+    Matrix<float> matrixB(K, matrixS.col(), MatrixStorageOrder::col_major);
+    matrixB.makeData();
+
+    // The reference, without the tiling
+    std::vector<float> valuesReference(matrixS.nnz());
+    sddmm_cpu(matrixA.view(), matrixB.view(), matrixS.view(valuesReference.data()));
+
+    const char* const args[] = {argv[0], "-b", "cpu", "-o", "cpu", "-a", "0.3", "-d", "0.1", "-p",
+                                rphmFile.c_str()};
+    const Options options(sizeof(args) / sizeof(args[0]), args);
+
+    bool isPassed = true;
+    size_t numError = 0;
+
+    // The tiling is built on the host and used by the cpu kernels and the analysis without a device copy
+    const BSMR bsmr(alpha, delta, matrixS, 1, nullptr, RowReorderingEngine::cpu);
+    RPHM rphm(matrixS, bsmr);
+    Logger logger;
+    logger.getInformation(options);
+    sparseMatrix::CSR<float> matrixP = matrixS;
+    sddmm_cpu(matrixA, matrixB, rphm, matrixP, logger);
+    isPassed &= check(checkDataFunction(valuesReference.size(), valuesReference.data(), matrixP.values().data(),
+                                        numError), "sddmm_cpu with the tiling");
+    isPassed &= check(rphm.getNumDenseBlocks() + rphm.getNumSparseBlocks() > 0, "the tiling is empty");
+    isPassed &= check(rphm.getNumDenseBlocks() == 0 || rphm.calculateDenseBlockAverageDensity() > 0.0f,
+                      "the dense blocks are empty");
+    isPassed &= check(!rphm.isOnDevice(), "the tiling built on the host was copied to the device");
+
+    // The tiling loaded from the binary RPHM file stays on the host too
+    isPassed &= check(rphm.outputToBinaryFile(rphmFile, matrixS), "output of the RPHM file");
+    RPHM rphmLoaded;
+    isPassed &= check(rphmLoaded.initializeFromBinaryFile(rphmFile, matrixS, alpha, delta, RowReorderingEngine::cpu),
+                      "initialization from the RPHM file");
+    isPassed &= check(!rphmLoaded.isOnDevice(), "the tiling loaded from the RPHM file was copied to the device");
+
+    // The whole cpu backend, with the tiling loaded from the file written above
+    Logger loggerBackend;
+    loggerBackend.getInformation(options);
+    std::vector<float> valuesP;
+    sddmm(options, matrixA, matrixB, matrixS, valuesP, loggerBackend);
+    isPassed &= check(checkDataFunction(valuesReference.size(), valuesReference.data(), valuesP.data(), numError),
+                      "sddmm with the cpu backend");
+
+    std::remove(rphmFile.c_str());
+
+    if (isPassed){
+        printf("[cpuBackendTest : PASS]\n");
+    }
+    return isPassed ? 0 : 1;
+}
@@ -0,0 +1,100 @@
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "BSMR.hpp"
+#include "Matrix.hpp"
+
+// The LSH row reordering engine (`cpu`) against the exact one (`cpu_exact`, the clustering of the GPU) on matrices
+// whose rows come from groups of columns. The LSH engine must find about as few clusters and as many nonzeros in the
+// dense blocks: at most maxClusterRatio times the clusters of the exact engine plus maxExtraClusters, and at most
+// maxDenseFractionLoss less of the nonzeros in the dense blocks.
+namespace{
+constexpr float maxClusterRatio = 1.1f;
+constexpr int maxExtraClusters = 2;
+constexpr float maxDenseFractionLoss = 0.02f;
+
+struct TestCase{
+    UIN row;
+    UIN col;
+    UIN numGroups;
+    UIN groupWidth; // The columns of a group are consecutive
+    UIN numNonZerosPerRow;
+    float noise; // The fraction of the nonzeros in random columns
+    float alpha;
+    float delta;
+};
+
+// Each row takes its nonzeros from the columns of a random group, and a fraction of them from random columns
+sparseMatrix::CSR<float> makeGroupedMatrix(const TestCase& testCase){
+    std::mt19937 generator(1);
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+    std::vector<UIN> groupBegins(testCase.numGroups);
+    for (UIN& groupBegin : groupBegins){
+        groupBegin = generator() % (testCase.col - testCase.groupWidth);
+    }
+
+    std::vector<UIN> rowOffsets{0}, colIndices, cols;
+    for (UIN row = 0; row < testCase.row; ++row){
+        const UIN groupBegin = groupBegins[generator() % testCase.numGroups];
+        cols.clear();
+        for (UIN idx = 0; idx < testCase.numNonZerosPerRow; ++idx){
+            cols.push_back(uniform(generator) < testCase.noise
+                               ? generator() % testCase.col
+                               : groupBegin + generator() % testCase.groupWidth);
+        }
+        std::sort(cols.begin(), cols.end());
+        cols.erase(std::unique(cols.begin(), cols.end()), cols.end());
+        colIndices.insert(colIndices.end(), cols.begin(), cols.end());
+        rowOffsets.push_back(static_cast<UIN>(colIndices.size()));
+    }
+
+    return sparseMatrix::CSR<float>(testCase.row, testCase.col, static_cast<UIN>(colIndices.size()), rowOffsets,
+                                    colIndices);
+}
+} // namespace
+
+int main(){
+    const std::vector<TestCase> testCases = {
+        {2000, 5000, 13, 64, 16, 0.05f, 0.3f, 0.3f},
+        {20000, 100000, 97, 128, 24, 0.05f, 0.3f, 0.3f},
+        {20000, 100000, 97, 128, 24, 0.05f, 0.5f, 0.3f},
+    };
+
+    bool isPassed = true;
+    for (const TestCase& testCase : testCases){
+        const sparseMatrix::CSR<float> matrix = makeGroupedMatrix(testCase);
+        const BSMR bsmrExact(testCase.alpha, testCase.delta, matrix, 1, nullptr, RowReorderingEngine::cpu_exact);
+        const BSMR bsmrLsh(testCase.alpha, testCase.delta, matrix, 1, nullptr, RowReorderingEngine::cpu);
+
+        const float denseFractionExact = bsmrExact.calculateDenseFraction(matrix);
+        const float denseFractionLsh = bsmrLsh.calculateDenseFraction(matrix);
+        printf("[rows : %" PRIuUIN "] [groups : %" PRIuUIN "] [alpha : %.2f] "
+               "cpu_exact: %d clusters, dense fraction %.4f; cpu: %d clusters, dense fraction %.4f\n",
+               matrix.row(), testCase.numGroups, testCase.alpha,
+               bsmrExact.numClusters(), denseFractionExact, bsmrLsh.numClusters(), denseFractionLsh);
+
+        std::vector<UIN> rowsExact = bsmrExact.reorderedRows();
+        std::vector<UIN> rowsLsh = bsmrLsh.reorderedRows();
+        std::sort(rowsExact.begin(), rowsExact.end());
+        std::sort(rowsLsh.begin(), rowsLsh.end());
+        if (rowsLsh != rowsExact){
+            fprintf(stderr, "[rowReorderingTest : NO PASS] the rows of the cpu engine are not a permutation\n");
+            isPassed = false;
+        }
+        if (bsmrLsh.numClusters() > maxClusterRatio * bsmrExact.numClusters() + maxExtraClusters){
+            fprintf(stderr, "[rowReorderingTest : NO PASS] the cpu engine finds too many clusters\n");
+            isPassed = false;
+        }
+        if (denseFractionLsh < denseFractionExact - maxDenseFractionLoss){
+            fprintf(stderr, "[rowReorderingTest : NO PASS] the cpu engine leaves too many nonzeros in sparse blocks\n");
+            isPassed = false;
+        }
+    }
+
+    if (isPassed){
+        printf("[rowReorderingTest : PASS]\n");
+    }
+    return isPassed ? 0 : 1;
+}